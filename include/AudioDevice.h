@@ -34,6 +34,7 @@
 
 
 class AudioPort;
+class FxChannel;
 
 
 class AudioDevice
@@ -61,6 +62,19 @@ public:
 	virtual void unregisterPort( AudioPort * _port );
 	virtual void renamePort( AudioPort * _port );
 
+	// same for FX channels
+	virtual void registerFxChannel( FxChannel * _ch );
+	virtual void unregisterFxChannel( FxChannel * _ch );
+	virtual void renameFxChannel( FxChannel * _ch );
+
+	// called by mixer threads with final output of registered ports and
+	// channels in current period (see Mixer::renderPeriod()), _gain is
+	// applied while copying
+	virtual void processPortOutput( AudioPort * _port,
+						const sampleFrame * _buf );
+	virtual void processFxChannelOutput( FxChannel * _ch,
+				const sampleFrame * _buf, float _gain );
+
 
 	inline bool supportsCapture() const
 	{
@@ -100,7 +100,7 @@ private:
 			{
 				break;
 			}
-			delete[] b;
+			mixer()->releaseNextBuffer();
 
 			const int microseconds = static_cast<int>( mixer()->framesPerPeriod() * 1000000.0f / mixer()->processingSampleRate() - timer.elapsed() );
 			if( microseconds > 0 )
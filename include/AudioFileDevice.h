@@ -49,6 +49,20 @@ public:
 		return m_outputFile.fileName();
 	}
 
+	// used by ProjectRenderer for rendering and encoding in separate
+	// threads - renderNextBuffer() renders the next period (at the
+	// device's sample rate) into _ab and returns the number of frames
+	fpp_t renderNextBuffer( surroundSampleFrame * _ab )
+	{
+		return getNextBuffer( _ab );
+	}
+
+	void encodeBuffer( const surroundSampleFrame * _ab,
+					const fpp_t _frames, const float _master_gain )
+	{
+		writeBuffer( _ab, _frames, _master_gain );
+	}
+
 
 protected:
 	int writeData( const void* data, int len );
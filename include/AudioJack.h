@@ -33,12 +33,14 @@
 #include <QtCore/QVector>
 #include <QtCore/QList>
 #include <QtCore/QMap>
+#include <QtCore/QMutex>
 
 #include "AudioDevice.h"
 
 
 class QLineEdit;
 class LcdSpinBox;
+class LedCheckBox;
 
 
 class AudioJack : public QObject, public AudioDevice
@@ -66,6 +68,8 @@ public:
 	private:
 		QLineEdit * m_clientName;
 		LcdSpinBox * m_channels;
+		LedCheckBox * m_trackOutputs;
+		LedCheckBox * m_fxOutputs;
 
 	} ;
 
@@ -85,6 +89,28 @@ private:
 	virtual void unregisterPort( AudioPort * _port );
 	virtual void renamePort( AudioPort * _port );
 
+	virtual void registerFxChannel( FxChannel * _ch );
+	virtual void unregisterFxChannel( FxChannel * _ch );
+	virtual void renameFxChannel( FxChannel * _ch );
+
+	virtual void processPortOutput( AudioPort * _port,
+						const sampleFrame * _buf );
+	virtual void processFxChannelOutput( FxChannel * _ch,
+				const sampleFrame * _buf, float _gain );
+
+	// ports and FX channels are handled the same way
+	void addOutput( const void * _source, const QString & _name );
+	void removeOutput( const void * _source );
+	void renameOutput( const void * _source, const QString & _name );
+	void writeOutput( const void * _source, const sampleFrame * _buf,
+								float _gain );
+	// copies _frames frames of m_curBufPeriod starting at
+	// m_framesDoneInCurBuf to _offset in JACK's buffers
+	void copyOutputs( jack_nframes_t _nframes, jack_nframes_t _offset,
+						jack_nframes_t _frames );
+	// registers port with _name or, if taken, a similar name
+	jack_port_t * registerOutputPort( const QString & _name );
+
 	int processCallback( jack_nframes_t _nframes, void * _udata );
 
 	static int staticProcessCallback( jack_nframes_t _nframes,
@@ -105,17 +131,34 @@ private:
 
 	f_cnt_t m_framesDoneInCurBuf;
 	f_cnt_t m_framesToDoInCurBuf;
+	// mixer period m_outBuf belongs to, -1 if individual outputs can't
+	// be played along with it (e.g. because of resampling)
+	int m_curBufPeriod;
 
 
-#ifdef AUDIO_PORT_SUPPORT
+	// individual output of an audio port or FX channel - mixer threads
+	// write it deinterleaved into the slot of the period they're
+	// rendering, so that process callback can copy it straight into
+	// JACK's buffers once master output of that period is played
 	struct StereoPort
 	{
-		jack_port_t * ports[2];
+		QString name;
+		jack_port_t * ports[DEFAULT_CHANNELS];
+		// DEFAULT_CHANNELS * frames per period for each slot
+		jack_default_audio_sample_t * data;
+		// mixer period held by each slot
+		int * periods;
 	} ;
 
-	typedef QMap<AudioPort *, StereoPort> JackPortMap;
+	typedef QMap<const void *, StereoPort *> JackPortMap;
+	// only modified while holding both mixer lock and m_portMapMutex, so
+	// mixer threads don't need to lock and process callback only tries
 	JackPortMap m_portMap;
-#endif
+	QMutex m_portMapMutex;
+	// enough for all periods between rendering and playback
+	int m_portSlots;
+	bool m_trackOutputs;
+	bool m_fxOutputs;
 
 signals:
 	void zombified();
@@ -37,7 +37,7 @@ class EffectChain;
 class FloatModel;
 class BoolModel;
 
-class AudioPort : public ThreadableJob
+class AudioPort : public ThreadableJob, public ProfiledObject
 {
 	MM_OPERATORS
 public:
@@ -63,6 +63,7 @@ public:
 
 
 	// indicate whether JACK & Co should provide output-buffer at ext. port
+	// - off by default, tracks enable it for their ports
 	inline bool extOutputEnabled() const
 	{
 		return m_extOutputEnabled;
@@ -109,7 +110,37 @@ public:
 	void addPlayHandle( PlayHandle * handle );
 	void removePlayHandle( PlayHandle * handle );
 
+	// dependency tracking for the processing graph of a period: the port
+	// gets queued once all play handles feeding it have been processed
+	void resetDependencies()
+	{
+		m_dependencies = 0;
+		m_dependenciesMet = 0;
+		m_fxChannelDependency = m_nextFxChannel;
+	}
+
+	void addDependency()
+	{
+		++m_dependencies;
+	}
+
+	bool hasDependencies() const
+	{
+		return m_dependencies > 0;
+	}
+
+	// FX channel this port sends to in the current period
+	fx_ch_t fxChannelDependency() const
+	{
+		return m_fxChannelDependency;
+	}
+
+	void incrementDeps();
+
 private:
+	void processed();
+
+
 	volatile bool m_bufferUsage;
 
 	sampleFrame * m_portBuffer;
@@ -129,6 +160,10 @@ private:
 	FloatModel * m_panningModel;
 	BoolModel * m_mutedModel;
 
+	int m_dependencies;
+	QAtomicInt m_dependenciesMet;
+	fx_ch_t m_fxChannelDependency;
+
 	friend class Mixer;
 	friend class MixerWorkerThread;
 
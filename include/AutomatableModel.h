@@ -26,12 +26,14 @@
 #define AUTOMATABLE_MODEL_H
 
 #include "lmms_math.h"
+#include <QtCore/QAtomicInt>
 #include <QtCore/QMutex>
 
 #include "JournallingObject.h"
 #include "Model.h"
 #include "MidiTime.h"
 #include "ValueBuffer.h"
+#include "ParameterStream.h"
 #include "MemoryManager.h"
 
 // simple way to map a property of a view to a model
@@ -146,6 +148,11 @@ public:
 	//! @return pointer to model's valueBuffer when s.ex.data exists, NULL otherwise
 	ValueBuffer * valueBuffer();
 
+	//! @brief Function that returns values of current period as constant, linear ramp or buffer
+	//! @return cheaper than valueBuffer() as ramps aren't written into a buffer and
+	//! no lock is taken once the stream has been determined for current period
+	ParameterStream parameterStream();
+
 	template<class T>
 	T initValue() const
 	{
@@ -355,13 +362,19 @@ private:
 	static float s_copiedValue;
 
 	ValueBuffer m_valueBuffer;
-	long m_lastUpdatedPeriod;
 	static long s_periodCounter;
-	
-	bool m_hasSampleExactData;
-	
-	// prevent several threads from attempting to write the same vb at the same time
-	QMutex m_valueBufferMutex;
+
+	// period m_stream was determined for - the first thread calling
+	// parameterStream() in a period determines it, others wait for it
+	// (see claimPeriod())
+	ParameterStream m_stream;
+	QAtomicInt m_streamPeriod;
+	// period a ramp has been written into m_valueBuffer for
+	QAtomicInt m_rampBufferPeriod;
+
+	ParameterStream determineParameterStream();
+	static bool claimPeriod( QAtomicInt & period );
+	static void publishPeriod( QAtomicInt & period );
 
 signals:
 	void initValueChanged( float val );
@@ -39,7 +39,6 @@
 #include <math.h>
 
 #include "lmms_basics.h"
-#include "Mixer.h"
 #include "templates.h"
 #include "lmms_constants.h"
 #include "interpolation.h"
@@ -266,22 +265,20 @@ public:
 		m_doubleFilter = _idx == DoubleLowPass || _idx == DoubleMoog;
 		if( !m_doubleFilter )
 		{
-			m_type = static_cast<FilterTypes>( _idx );
+			setKernel( static_cast<FilterTypes>( _idx ) );
 			return;
 		}
 
 		// Double lowpass mode, backwards-compat for the goofy
 		// Add-NumFilters to signify doubleFilter stuff
-		m_type = _idx == DoubleLowPass 
-			? LowPass
-			: Moog;
+		setKernel( _idx == DoubleLowPass ? LowPass : Moog );
 		if( m_subFilter == NULL )
 		{
 			m_subFilter = new BasicFilters<CHANNELS>(
 						static_cast<sample_rate_t>(
 							m_sampleRate ) );
 		}
-		m_subFilter->m_type = m_type;
+		m_subFilter->setKernel( m_type );
 	}
 
 	inline BasicFilters( const sample_rate_t _sample_rate ) :
@@ -290,9 +287,21 @@ public:
 		m_sampleRatio( 1.0f / m_sampleRate ),
 		m_subFilter( NULL )
 	{
+		setKernel( LowPass );
 		clearHistory();
 	}
 
+	// for reusing filters from a pool
+	inline void setSampleRate( const sample_rate_t _sample_rate )
+	{
+		m_sampleRate = (float) _sample_rate;
+		m_sampleRatio = 1.0f / m_sampleRate;
+		if( m_subFilter != NULL )
+		{
+			m_subFilter->setSampleRate( _sample_rate );
+		}
+	}
+
 	inline ~BasicFilters()
 	{
 		delete m_subFilter;
@@ -327,12 +336,45 @@ public:
 			m_delay3[_chnl] = 0.0f;
 			m_delay4[_chnl] = 0.0f;
 		}
+
+		if( m_subFilter != NULL )
+		{
+			m_subFilter->clearHistory();
+		}
 	}
 
 	inline sample_t update( sample_t _in0, ch_cnt_t _chnl )
+	{
+		const sample_t out = ( this->*m_updateSample )( _in0, _chnl );
+
+		if( m_doubleFilter )
+		{
+			return m_subFilter->update( out, _chnl );
+		}
+
+		// Clipper band limited sigmoid
+		return out;
+	}
+
+	// filters a block of frames - the filter type is resolved once per
+	// block and all channels of a frame are processed together
+	inline void processBlock( sample_t ( * _buf )[CHANNELS], const fpp_t _frames )
+	{
+		( this->*m_processBlock )( _buf, _frames );
+
+		if( m_doubleFilter )
+		{
+			m_subFilter->processBlock( _buf, _frames );
+		}
+	}
+
+	// processes a single sample of a filter type known at compile time
+	// so that the switch below is folded away
+	template<FilterTypes TYPE>
+	inline sample_t updateSample( sample_t _in0, ch_cnt_t _chnl )
 	{
 		sample_t out;
-		switch( m_type )
+		switch( TYPE )
 		{
 			case Moog:
 			{
@@ -422,7 +464,7 @@ public:
 				}
 
 				/* mix filter output into output buffer */
-				return m_type == Lowpass_SV 
+				return TYPE == Lowpass_SV 
 					? m_delay4[_chnl]
 					: m_delay3[_chnl];
 				break;
@@ -513,7 +555,7 @@ public:
 					m_rchp0[_chnl] = hp;
 					m_rcbp0[_chnl] = bp;
 				}
-				return m_type == Highpass_RC12 ? hp : bp;
+				return TYPE == Highpass_RC12 ? hp : bp;
 				break;
 			}
 
@@ -582,7 +624,7 @@ public:
 					m_rcbp0[_chnl] = bp;
 
 					// second stage gets the output of the first stage as input...
-					in = m_type == Highpass_RC24
+					in = TYPE == Highpass_RC24
 						? hp + m_rcbp1[_chnl] * m_rcq
 						: bp + m_rcbp1[_chnl] * m_rcq;
 
@@ -598,7 +640,7 @@ public:
 					m_rchp1[_chnl] = hp;
 					m_rcbp1[_chnl] = bp;
 				}
-				return m_type == Highpass_RC24 ? hp : bp;
+				return TYPE == Highpass_RC24 ? hp : bp;
 				break;
 			}
 
@@ -609,7 +651,7 @@ public:
 				sample_t hp, bp, in;
 
 				out = 0;
-				const int os = m_type == FastFormant ? 1 : 4; // no oversampling for fast formant
+				const int os = TYPE == FastFormant ? 1 : 4; // no oversampling for fast formant
 				for( int o = 0; o < os; ++o )
 				{
 					// first formant
@@ -696,7 +738,7 @@ public:
 
 					out += bp;
 				}
-            	return m_type == FastFormant ? out * 2.0f : out * 0.5f;
+            	return TYPE == FastFormant ? out * 2.0f : out * 0.5f;
 				break;
 			}
 
@@ -705,12 +747,6 @@ public:
 				break;
 		}
 
-		if( m_doubleFilter )
-		{
-			return m_subFilter->update( out, _chnl );
-		}
-
-		// Clipper band limited sigmoid
 		return out;
 	}
 
@@ -882,6 +918,56 @@ public:
 
 
 private:
+	typedef sample_t ( BasicFilters::* UpdateSampleFunc )( sample_t, ch_cnt_t );
+	typedef void ( BasicFilters::* ProcessBlockFunc )( sample_t ( * )[CHANNELS], const fpp_t );
+
+	template<FilterTypes TYPE>
+	void filterBlock( sample_t ( * _buf )[CHANNELS], const fpp_t _frames )
+	{
+		for( fpp_t f = 0; f < _frames; ++f )
+		{
+			for( ch_cnt_t ch = 0; ch < CHANNELS; ++ch )
+			{
+				_buf[f][ch] = updateSample<TYPE>( _buf[f][ch], ch );
+			}
+		}
+	}
+
+	template<FilterTypes TYPE>
+	inline void setKernel()
+	{
+		m_type = TYPE;
+		m_updateSample = &BasicFilters::updateSample<TYPE>;
+		m_processBlock = &BasicFilters::filterBlock<TYPE>;
+	}
+
+	inline void setKernel( const FilterTypes _type )
+	{
+		switch( _type )
+		{
+			case Moog: setKernel<Moog>(); break;
+			case Tripole: setKernel<Tripole>(); break;
+			case Lowpass_SV: setKernel<Lowpass_SV>(); break;
+			case Bandpass_SV: setKernel<Bandpass_SV>(); break;
+			case Highpass_SV: setKernel<Highpass_SV>(); break;
+			case Notch_SV: setKernel<Notch_SV>(); break;
+			case Lowpass_RC12: setKernel<Lowpass_RC12>(); break;
+			case Bandpass_RC12: setKernel<Bandpass_RC12>(); break;
+			case Highpass_RC12: setKernel<Highpass_RC12>(); break;
+			case Lowpass_RC24: setKernel<Lowpass_RC24>(); break;
+			case Bandpass_RC24: setKernel<Bandpass_RC24>(); break;
+			case Highpass_RC24: setKernel<Highpass_RC24>(); break;
+			case Formantfilter: setKernel<Formantfilter>(); break;
+			case FastFormant: setKernel<FastFormant>(); break;
+			default:
+				// all biquads share one kernel, but m_type is
+				// needed for coefficients
+				setKernel<LowPass>();
+				m_type = _type;
+				break;
+		}
+	}
+
 	// biquad filter
 	BiQuad<CHANNELS> m_biQuad;
 
@@ -915,6 +1001,8 @@ private:
 	frame m_delay1, m_delay2, m_delay3, m_delay4;
 
 	FilterTypes m_type;
+	UpdateSampleFunc m_updateSample;
+	ProcessBlockFunc m_processBlock;
 	bool m_doubleFilter;
 
 	float m_sampleRate;
@@ -0,0 +1,91 @@
+/*
+ * BinaryDataFile.h - compact chunked binary encoding of DataFiles
+ *
+ * Copyright (c) 2026 agent <agent/at/local>
+ *
+ * This file is part of LMMS - http://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef BINARY_DATA_FILE_H
+#define BINARY_DATA_FILE_H
+
+#include <QtCore/QByteArray>
+#include <QtCore/QString>
+#include <QtCore/QVector>
+#include <QtXml/QDomDocument>
+
+#include "export.h"
+
+
+// stores the same tree as the XML files (.mmpb instead of .mmp/.mmpz) so
+// converting between both is lossless, but without having to parse text.
+//
+// The file consists of a header, a table of chunks and the chunks. Every
+// track gets a chunk of its own which holds its names and values in a
+// string table followed by its nodes, and is compressed on its own. The
+// first chunk holds the document and refers to the tracks' chunks, which
+// in turn may refer to further ones (e.g. tracks of beat/bassline tracks).
+// All chunks are decompressed and decoded in parallel when loading, so
+// only building the DOM is left for the loading thread.
+class EXPORT BinaryDataFile
+{
+public:
+	// max. nesting of elements - keeps crafted files from overflowing the
+	// stack when decoding
+	static const int MaxDepth = 256;
+
+	static bool isBinary( const QByteArray & _data );
+
+	// returns an empty array if _doc contains nodes which can't be stored
+	// (entity references etc.) or is nested deeper than MaxDepth
+	static QByteArray encode( const QDomDocument & _doc );
+
+	// returns false if _data is not a valid binary data file
+	static bool decode( const QByteArray & _data, QDomDocument & _doc );
+
+
+private:
+	enum NodeTypes
+	{
+		ElementNode = 1,
+		TextNode,
+		CDataNode,
+		CommentNode,
+		ProcessingInstructionNode,
+		ChunkNode		// refers to another chunk
+	} ;
+
+	class Encoder;
+	class Decoder;
+	class ChunkJob;
+
+	// a decompressed chunk with all of its strings decoded
+	struct Chunk
+	{
+		QByteArray nodes;
+		QVector<QString> strings;
+		bool valid;
+	} ;
+
+	static bool decodeChunk( const QByteArray & _data, Chunk & _chunk );
+
+} ;
+
+
+#endif
@@ -31,11 +31,15 @@
 #include "Engine.h"
 #include "Mixer.h"
 #include <QtCore/QAtomicInt>
-#include <QtCore/QReadWriteLock>
+#include <QtCore/QThreadStorage>
 
 
 const int BM_INITIAL_BUFFERS = 512;
-//const int BM_INCREMENT = 64;
+const int BM_INCREMENT = 64;
+// buffers each thread keeps for itself and how many of them are exchanged
+// with the shared pool at once
+const int BM_CACHE_SIZE = 32;
+const int BM_CACHE_BATCH = 16;
 
 class EXPORT BufferManager
 {
@@ -43,17 +47,40 @@ public:
 	static void init( fpp_t framesPerPeriod );
 	static sampleFrame * acquire();
 	static void release( sampleFrame * buf );
-	static void refresh();
-//	static void extend( int c );
-	
+	static void extend( int c );
+
+	// usage statistics for sizing the pool
+	static int size();
+	// maximum number of buffers handed out to threads (in use or cached
+	// there) since last reset
+	static int peakUsage();
+	static int extensions();
+	static void resetPeakUsage();
+
 private:
+	class ThreadCache;
+
+	static ThreadCache * threadCache();
+	static void fetch( sampleFrame * * bufs, int c );
+	static void giveBack( sampleFrame * * bufs, int c );
+	// adds c buffers to the shared pool
+	static void grow( int c );
+
+	static void lock();
+	static void unlock();
+
+	static QThreadStorage<ThreadCache *> s_threadCaches;
+
+	// shared pool, only accessed in batches while holding s_lock
 	static sampleFrame ** s_available;
-	static QAtomicInt s_availableIndex;
-	
-	static sampleFrame ** s_released;
-	static QAtomicInt s_releasedIndex;
-//	static QReadWriteLock s_mutex;
+	static int s_availableCount;
+	static int s_capacity;
+	static QAtomicInt s_lock;
+
+	static fpp_t s_framesPerPeriod;
 	static int s_size;
+	static int s_minAvailable;
+	static QAtomicInt s_extensions;
 };
 
 #endif
@@ -102,6 +102,7 @@ private:
 	static QString typeName( Type type );
 
 	void cleanMetaNodes( QDomElement de );
+	void prepareForWriting();
 
 	void upgrade();
 
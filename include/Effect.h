@@ -37,7 +37,7 @@ class EffectChain;
 class EffectControls;
 
 
-class EXPORT Effect : public Plugin
+class EXPORT Effect : public Plugin, public ProfiledObject
 {
 	MM_OPERATORS
 	Q_OBJECT
@@ -25,6 +25,7 @@
 #ifndef ENVELOPE_AND_LFO_PARAMETERS_H
 #define ENVELOPE_AND_LFO_PARAMETERS_H
 
+#include <QtCore/QMutex>
 #include <QtCore/QVector>
 
 #include "JournallingObject.h"
@@ -158,9 +159,10 @@ private:
 	f_cnt_t m_lfoFrame;
 	float m_lfoAmount;
 	bool m_lfoAmountIsZero;
+	// LFO shape of current period - doesn't depend on note, so it's
+	// computed once for all voices
 	sample_t * m_lfoShapeData;
 	sample_t m_random;
-	bool m_bad_lfoShapeData;
 	SampleBuffer m_userWave;
 
 	enum LfoShapes
@@ -176,6 +178,11 @@ private:
 
 	sample_t lfoShapeSample( fpp_t _frame_offset );
 	void updateLfoShapeData();
+	template<sample_t ( * SHAPE )( const float )>
+	void fillLfoShapeData( const fpp_t _frames );
+	template<bool CONTROL_ENV_AMOUNT>
+	void fillEnvLevel( float * _buf, f_cnt_t _frame,
+				const f_cnt_t _release_begin, const fpp_t _frames );
 
 
 	friend class EnvelopeAndLfoView;
@@ -35,7 +35,7 @@
 class FxRoute;
 typedef QVector<FxRoute *> FxRouteVector;
 
-class FxChannel : public ThreadableJob
+class FxChannel : public ThreadableJob, public ProfiledObject
 {
 	public:
 		FxChannel( int idx, Model * _parent );
@@ -70,8 +70,12 @@ class FxChannel : public ThreadableJob
 		virtual bool requiresProcessing() const { return true; }
 		void unmuteForSolo();
 
+		// also renames ports of audio device
+		void setName( const QString & _name );
+
 	
 		QAtomicInt m_dependenciesMet;
+		int m_audioPortDeps; // number of audio ports sending to us in the current period
 		void incrementDeps();
 		void processed();
 		
@@ -131,6 +135,10 @@ public:
 	void mixToChannel( const sampleFrame * _buf, fx_ch_t _ch );
 
 	void prepareMasterMix();
+	// set up dependency counting and queue all channels that don't have to
+	// wait for any input - needs a reset job queue
+	void prepareChannels( const QVector<AudioPort *> & _ports );
+	void audioPortProcessed( fx_ch_t _ch );
 	void masterMix( sampleFrame * _buf );
 
 	virtual void saveSettings( QDomDocument & _doc, QDomElement & _parent );
@@ -202,7 +210,10 @@ private:
 
 	// make sure we have at least num channels
 	void allocateChannelsTo(int num);
+	// dumps dependency state of all channels and aborts
+	void reportUnprocessedChannels() const;
 	QMutex m_sendsMutex;
+	bool m_processingChannels;
 
 	int m_lastSoloed;
 
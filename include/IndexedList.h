@@ -0,0 +1,136 @@
+/*
+ * IndexedList.h - list of pointers with O(1) lookup and removal
+ *
+ * Copyright (c) 2026 agent <agent/at/local>
+ *
+ * This file is part of LMMS - http://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef INDEXED_LIST_H
+#define INDEXED_LIST_H
+
+#include <QtCore/QVector>
+
+
+// list of pointers with O(1) lookup and removal - each element remembers
+// its position in the list in m_listIndex[slot], so it can be part of one
+// list per slot at the same time. Removing an element moves the last one
+// into the gap, so the order of elements isn't preserved.
+//
+// T has to initialize m_listIndex[] with -1 and declare IndexedList<T> as
+// friend.
+template<typename T>
+class IndexedList
+{
+public:
+	typedef T * const * Iterator;
+	typedef T * const * ConstIterator;
+
+	IndexedList( int _slot ) :
+		m_slot( _slot )
+	{
+		m_items.reserve( 256 );
+	}
+
+	int size() const
+	{
+		return m_items.size();
+	}
+
+	bool isEmpty() const
+	{
+		return m_items.isEmpty();
+	}
+
+	T * at( int _i ) const
+	{
+		return m_items.at( _i );
+	}
+
+	ConstIterator begin() const
+	{
+		return m_items.constData();
+	}
+
+	ConstIterator end() const
+	{
+		return m_items.constData() + m_items.size();
+	}
+
+	bool contains( const T * _item ) const
+	{
+		const int i = _item->m_listIndex[m_slot];
+		return i >= 0 && i < m_items.size() && m_items.at( i ) == _item;
+	}
+
+	void append( T * _item )
+	{
+		_item->m_listIndex[m_slot] = m_items.size();
+		m_items.append( _item );
+	}
+
+	bool remove( T * _item )
+	{
+		if( !contains( _item ) )
+		{
+			return false;
+		}
+		removeAt( _item->m_listIndex[m_slot] );
+		return true;
+	}
+
+	// returns iterator to the element which took the place of the erased
+	// one so erasing while iterating doesn't skip anything
+	Iterator erase( Iterator _it )
+	{
+		const int i = _it - m_items.constData();
+		removeAt( i );
+		return m_items.constData() + i;
+	}
+
+	void clear()
+	{
+		for( int i = 0; i < m_items.size(); ++i )
+		{
+			m_items[i]->m_listIndex[m_slot] = -1;
+		}
+		m_items.resize( 0 );
+	}
+
+
+private:
+	void removeAt( int _i )
+	{
+		T * last = m_items.last();
+		m_items[_i]->m_listIndex[m_slot] = -1;
+		if( last != m_items[_i] )
+		{
+			m_items[_i] = last;
+			last->m_listIndex[m_slot] = _i;
+		}
+		m_items.resize( m_items.size() - 1 );
+	}
+
+	QVector<T *> m_items;
+	int m_slot;
+
+} ;
+
+
+#endif
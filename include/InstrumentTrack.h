@@ -203,6 +203,17 @@ public:
 		return &m_effectChannelModel;
 	}
 
+	IntModel * maxVoicesModel()
+	{
+		return &m_maxVoicesModel;
+	}
+
+	// max. number of notes playing at once, 0 = unlimited
+	int maxVoices() const
+	{
+		return m_maxVoicesModel.value();
+	}
+
 	void setIndicator( FadeButton *fb );
 
 signals:
@@ -250,6 +261,7 @@ private:
 	FloatModel m_pitchModel;
 	IntModel m_pitchRangeModel;
 	IntModel m_effectChannelModel;
+	IntModel m_maxVoicesModel;
 
 	FadeButton *m_fb;
 
@@ -414,6 +426,7 @@ private:
 	Knob * m_pitchKnob;
 	LcdSpinBox* m_pitchRangeSpinBox;
 	LcdSpinBox * m_effectChannelNumber;
+	LcdSpinBox * m_maxVoicesSpinBox;
 
 
 	// tab-widget with all children
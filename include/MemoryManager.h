@@ -28,78 +28,34 @@
 
 #include <QtCore/QVector>
 #include <QtCore/QMutex>
-#include <QtCore/QReadWriteLock>
-#include <QtCore/QHash>
 #include "MemoryHelper.h"
 #include "export.h"
 
-const int MM_CHUNK_SIZE = 64; // granularity of managed memory
-const int MM_INITIAL_CHUNKS = 1024 * 1024; // how many chunks to allocate at startup - TODO: make configurable
-const int MM_INCREMENT_CHUNKS = 16 * 1024; // min. amount of chunks to increment at a time
-
-struct MemoryPool
-{
-	void * m_pool;
-	char * m_free;
-	int m_chunks;
-	QMutex m_mutex;
-
-	MemoryPool() :
-		m_pool( NULL ),
-		m_free( NULL ),
-		m_chunks( 0 )
-	{}
-
-	MemoryPool( int chunks ) :
-		m_chunks( chunks )
-	{
-		m_free = (char*) MemoryHelper::alignedMalloc( chunks );
-		memset( m_free, 1, chunks );
-	}
-
-	MemoryPool( const MemoryPool & mp ) :
-		m_pool( mp.m_pool ),
-		m_free( mp.m_free ),
-		m_chunks( mp.m_chunks ),
-		m_mutex()
-	{}
-
-	MemoryPool & operator = ( const MemoryPool & mp )
-	{
-		m_pool = mp.m_pool;
-		m_free = mp.m_free;
-		m_chunks = mp.m_chunks;
-		return *this;
-	}
-
-	void * getChunks( int chunksNeeded );
-	void releaseChunks( void * ptr, int chunks );
-};
-
-struct PtrInfo
-{
-	int chunks;
-	MemoryPool * memPool;
-};
-
-typedef QVector<MemoryPool> MemoryPoolVector;
-typedef QHash<void*, PtrInfo> PointerInfoMap;
-
+const int MM_ALIGNMENT = 16; // alignment of returned memory, also size of block header
+const int MM_MAX_BLOCK_SIZE = 64 * 1024; // larger allocations bypass the slabs
+const int MM_SLAB_SIZE = 64 * 1024; // min. amount of memory to carve into blocks at a time
+const int MM_MAX_SIZE_CLASSES = 64;
+
+/* Memory is handed out in blocks of a fixed number of size classes. Each
+ * thread keeps its own free lists per size class, so alloc() and free()
+ * usually don't have to synchronize with other threads at all. Blocks are
+ * exchanged with the shared free lists in batches and carved from slabs
+ * when those are empty. A small header in front of every block holds its
+ * size class. */
 class EXPORT MemoryManager
 {
 public:
 	static bool init();
 	static void * alloc( size_t size );
 	static void free( void * ptr );
-	static int extend( int chunks ); // returns index of created pool (for use by alloc)
 	static void cleanup();
 
-private:
-	static MemoryPoolVector s_memoryPools;
-	static QReadWriteLock s_poolMutex;
-
-	static PointerInfoMap s_pointerInfo;
-	static QMutex s_pointerMutex;
+	// statistics
+	static int sizeClasses();
+	static int blockSize( int sizeClass );
+	static qint64 bytesInUse( int sizeClass );
+	static qint64 bytesReserved( int sizeClass );
+	static qint64 largeBytesInUse();
 };
 
 
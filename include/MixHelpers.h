@@ -27,10 +27,18 @@
 
 #include "lmms_basics.h"
 
+class ParameterStream;
 class ValueBuffer;
 namespace MixHelpers
 {
 
+/*! \brief Select fastest implementation (SSE2, AVX2, NEON) supported by
+ *         the CPU - can be overridden via LMMS_MIX_KERNELS environment variable */
+void init();
+
+/*! \brief Name of implementation in use */
+const char * implementation();
+
 bool isSilent( const sampleFrame* src, int frames );
 
 bool sanitize( sampleFrame * src, int frames );
@@ -60,6 +68,15 @@ void addSanitizedMultipliedByBuffer( sampleFrame* dst, const sampleFrame* src, f
 /*! \brief Add samples from src multiplied by coeffSrc and coeffSrcBuf to dst - sanitized version */
 void addSanitizedMultipliedByBuffers( sampleFrame* dst, const sampleFrame* src, ValueBuffer * coeffSrcBuf1, ValueBuffer * coeffSrcBuf2, int frames );
 
+/*! \brief Add samples from src multiplied by coeffSrc1 and coeffSrc2 to dst */
+void addMultipliedByStreams( sampleFrame* dst, const sampleFrame* src, const ParameterStream & coeffSrc1, const ParameterStream & coeffSrc2, int frames );
+
+/*! \brief Add samples from src multiplied by coeffSrc1 and coeffSrc2 to dst - sanitized version */
+void addSanitizedMultipliedByStreams( sampleFrame* dst, const sampleFrame* src, const ParameterStream & coeffSrc1, const ParameterStream & coeffSrc2, int frames );
+
+/*! \brief Apply volume and panning (both in percent) to buf */
+void multiplyByVolumeAndPanning( sampleFrame* buf, const ParameterStream & volume, const ParameterStream & panning, int frames );
+
 /*! \brief Add samples from src multiplied by coeffSrcLeft/coeffSrcRight to dst */
 void addMultipliedStereo( sampleFrame* dst, const sampleFrame* src, float coeffSrcLeft, float coeffSrcRight, int frames );
 
@@ -0,0 +1,402 @@
+/*
+ * MixHelpersSimd.h - vectorized implementations of MixHelpers
+ *
+ * Copyright (c) 2026 agent <agent/at/local>
+ *
+ * This file is part of LMMS - http://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef MIX_HELPERS_SIMD_H
+#define MIX_HELPERS_SIMD_H
+
+#include <math.h>
+#include <string.h>
+
+#include "lmms_basics.h"
+
+// only to be included by MixHelpers' implementation files - kernels may be
+// compiled with instruction sets the host doesn't support, so nothing in
+// here may end up as a non-inline symbol shared with other translation units
+
+namespace MixHelpers
+{
+
+const float SilenceThreshold = 0.0000001f;
+
+
+/*! \brief Table of kernels of one implementation (scalar, SSE2, AVX2, NEON) */
+struct Kernels
+{
+	const char * name;
+
+	bool (*isSilent)( const sampleFrame* src, int frames );
+	bool (*sanitize)( sampleFrame* src, int frames );
+	void (*add)( sampleFrame* dst, const sampleFrame* src, int frames );
+	void (*addMultiplied)( sampleFrame* dst, const sampleFrame* src, float coeffSrc, int frames );
+	void (*addSwappedMultiplied)( sampleFrame* dst, const sampleFrame* src, float coeffSrc, int frames );
+	void (*addMultipliedByBuffer)( sampleFrame* dst, const sampleFrame* src, float coeffSrc, const float* coeffSrcBuf, int frames );
+	void (*addMultipliedByBuffers)( sampleFrame* dst, const sampleFrame* src, const float* coeffSrcBuf1, const float* coeffSrcBuf2, int frames );
+	void (*addSanitizedMultiplied)( sampleFrame* dst, const sampleFrame* src, float coeffSrc, int frames );
+	void (*addSanitizedMultipliedByBuffer)( sampleFrame* dst, const sampleFrame* src, float coeffSrc, const float* coeffSrcBuf, int frames );
+	void (*addSanitizedMultipliedByBuffers)( sampleFrame* dst, const sampleFrame* src, const float* coeffSrcBuf1, const float* coeffSrcBuf2, int frames );
+	void (*addMultipliedStereo)( sampleFrame* dst, const sampleFrame* src, float coeffSrcLeft, float coeffSrcRight, int frames );
+	void (*multiplyAndAddMultiplied)( sampleFrame* dst, const sampleFrame* src, float coeffDst, float coeffSrc, int frames );
+	void (*multiplyAndAddMultipliedJoined)( sampleFrame* dst, const sample_t* srcLeft, const sample_t* srcRight, float coeffDst, float coeffSrc, int frames );
+} ;
+
+
+/*! \brief AVX2 kernels or NULL if not built in (see MixHelpersAvx2.cpp) -
+ *         must not be called unless the CPU supports AVX2 */
+const Kernels * avx2Kernels();
+
+
+
+/*! \brief Generic kernels on top of a vector type V
+ *
+ * V provides a vector of V::Width floats (V::Width / 2 frames) and the
+ * operations used below. Operations are done in exactly the same order as
+ * in the scalar implementation, so results are bit-identical.
+ */
+template<class V>
+struct SimdKernels
+{
+	typedef typename V::Vec Vec;
+
+	static inline float * floats( sampleFrame* buf )
+	{
+		return reinterpret_cast<float *>( buf );
+	}
+
+	static inline const float * floats( const sampleFrame* buf )
+	{
+		return reinterpret_cast<const float *>( buf );
+	}
+
+	// inf or nan - exponent bits all set
+	static inline bool isNonFinite( float x )
+	{
+		uint32_t bits;
+		memcpy( &bits, &x, sizeof( bits ) );
+		return ( bits & 0x7f800000 ) == 0x7f800000;
+	}
+
+	static bool isSilent( const sampleFrame* src, int frames )
+	{
+		const float * s = floats( src );
+		const int n = frames * DEFAULT_CHANNELS;
+		const Vec threshold = V::set1( SilenceThreshold );
+
+		int i = 0;
+		for( ; i + V::Width <= n; i += V::Width )
+		{
+			if( V::anyAbsGreaterEqual( V::load( s + i ), threshold ) )
+			{
+				return false;
+			}
+		}
+		for( ; i < n; ++i )
+		{
+			if( fabsf( s[i] ) >= SilenceThreshold )
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	static bool sanitize( sampleFrame* src, int frames )
+	{
+		float * s = floats( src );
+		const int n = frames * DEFAULT_CHANNELS;
+		bool found = false;
+
+		int i = 0;
+		for( ; i + V::Width <= n; i += V::Width )
+		{
+			const Vec x = V::load( s + i );
+			const Vec mask = V::nonFinite( x );
+			if( V::any( mask ) )
+			{
+				V::store( s + i, V::andNot( mask, x ) );
+				found = true;
+			}
+		}
+		for( ; i < n; ++i )
+		{
+			if( isNonFinite( s[i] ) )
+			{
+				s[i] = 0.0f;
+				found = true;
+			}
+		}
+		return found;
+	}
+
+	static void add( sampleFrame* dst, const sampleFrame* src, int frames )
+	{
+		float * d = floats( dst );
+		const float * s = floats( src );
+		const int n = frames * DEFAULT_CHANNELS;
+
+		int i = 0;
+		for( ; i + V::Width <= n; i += V::Width )
+		{
+			V::store( d + i, V::add( V::load( d + i ), V::load( s + i ) ) );
+		}
+		for( ; i < n; ++i )
+		{
+			d[i] += s[i];
+		}
+	}
+
+	static void addMultiplied( sampleFrame* dst, const sampleFrame* src, float coeffSrc, int frames )
+	{
+		float * d = floats( dst );
+		const float * s = floats( src );
+		const int n = frames * DEFAULT_CHANNELS;
+		const Vec c = V::set1( coeffSrc );
+
+		int i = 0;
+		for( ; i + V::Width <= n; i += V::Width )
+		{
+			V::store( d + i, V::add( V::load( d + i ),
+						V::mul( V::load( s + i ), c ) ) );
+		}
+		for( ; i < n; ++i )
+		{
+			d[i] += s[i] * coeffSrc;
+		}
+	}
+
+	static void addSwappedMultiplied( sampleFrame* dst, const sampleFrame* src, float coeffSrc, int frames )
+	{
+		float * d = floats( dst );
+		const float * s = floats( src );
+		const int n = frames * DEFAULT_CHANNELS;
+		const Vec c = V::set1( coeffSrc );
+
+		int i = 0;
+		for( ; i + V::Width <= n; i += V::Width )
+		{
+			V::store( d + i, V::add( V::load( d + i ),
+				V::mul( V::swapPairs( V::load( s + i ) ), c ) ) );
+		}
+		for( ; i < n; i += DEFAULT_CHANNELS )
+		{
+			d[i] += s[i+1] * coeffSrc;
+			d[i+1] += s[i] * coeffSrc;
+		}
+	}
+
+	static void addMultipliedByBuffer( sampleFrame* dst, const sampleFrame* src, float coeffSrc, const float* coeffSrcBuf, int frames )
+	{
+		float * d = floats( dst );
+		const float * s = floats( src );
+		const int n = frames * DEFAULT_CHANNELS;
+		const Vec c = V::set1( coeffSrc );
+
+		int i = 0;
+		for( ; i + V::Width <= n; i += V::Width )
+		{
+			const Vec b = V::loadDuplicated( coeffSrcBuf + i / DEFAULT_CHANNELS );
+			V::store( d + i, V::add( V::load( d + i ),
+					V::mul( V::mul( V::load( s + i ), c ), b ) ) );
+		}
+		for( ; i < n; ++i )
+		{
+			d[i] += s[i] * coeffSrc * coeffSrcBuf[i / DEFAULT_CHANNELS];
+		}
+	}
+
+	static void addMultipliedByBuffers( sampleFrame* dst, const sampleFrame* src, const float* coeffSrcBuf1, const float* coeffSrcBuf2, int frames )
+	{
+		float * d = floats( dst );
+		const float * s = floats( src );
+		const int n = frames * DEFAULT_CHANNELS;
+
+		int i = 0;
+		for( ; i + V::Width <= n; i += V::Width )
+		{
+			const Vec b1 = V::loadDuplicated( coeffSrcBuf1 + i / DEFAULT_CHANNELS );
+			const Vec b2 = V::loadDuplicated( coeffSrcBuf2 + i / DEFAULT_CHANNELS );
+			V::store( d + i, V::add( V::load( d + i ),
+					V::mul( V::mul( V::load( s + i ), b1 ), b2 ) ) );
+		}
+		for( ; i < n; ++i )
+		{
+			d[i] += s[i] * coeffSrcBuf1[i / DEFAULT_CHANNELS] *
+						coeffSrcBuf2[i / DEFAULT_CHANNELS];
+		}
+	}
+
+	static void addSanitizedMultiplied( sampleFrame* dst, const sampleFrame* src, float coeffSrc, int frames )
+	{
+		float * d = floats( dst );
+		const float * s = floats( src );
+		const int n = frames * DEFAULT_CHANNELS;
+		const Vec c = V::set1( coeffSrc );
+
+		int i = 0;
+		for( ; i + V::Width <= n; i += V::Width )
+		{
+			const Vec x = V::load( s + i );
+			V::store( d + i, V::add( V::load( d + i ),
+				V::andNot( V::nonFinite( x ), V::mul( x, c ) ) ) );
+		}
+		for( ; i < n; ++i )
+		{
+			d[i] += isNonFinite( s[i] ) ? 0.0f : s[i] * coeffSrc;
+		}
+	}
+
+	static void addSanitizedMultipliedByBuffer( sampleFrame* dst, const sampleFrame* src, float coeffSrc, const float* coeffSrcBuf, int frames )
+	{
+		float * d = floats( dst );
+		const float * s = floats( src );
+		const int n = frames * DEFAULT_CHANNELS;
+		const Vec c = V::set1( coeffSrc );
+
+		int i = 0;
+		for( ; i + V::Width <= n; i += V::Width )
+		{
+			const Vec x = V::load( s + i );
+			const Vec b = V::loadDuplicated( coeffSrcBuf + i / DEFAULT_CHANNELS );
+			V::store( d + i, V::add( V::load( d + i ),
+					V::andNot( V::nonFinite( x ),
+						V::mul( V::mul( x, c ), b ) ) ) );
+		}
+		for( ; i < n; ++i )
+		{
+			d[i] += isNonFinite( s[i] ) ? 0.0f :
+				s[i] * coeffSrc * coeffSrcBuf[i / DEFAULT_CHANNELS];
+		}
+	}
+
+	static void addSanitizedMultipliedByBuffers( sampleFrame* dst, const sampleFrame* src, const float* coeffSrcBuf1, const float* coeffSrcBuf2, int frames )
+	{
+		float * d = floats( dst );
+		const float * s = floats( src );
+		const int n = frames * DEFAULT_CHANNELS;
+
+		int i = 0;
+		for( ; i + V::Width <= n; i += V::Width )
+		{
+			const Vec x = V::load( s + i );
+			const Vec b1 = V::loadDuplicated( coeffSrcBuf1 + i / DEFAULT_CHANNELS );
+			const Vec b2 = V::loadDuplicated( coeffSrcBuf2 + i / DEFAULT_CHANNELS );
+			V::store( d + i, V::add( V::load( d + i ),
+					V::andNot( V::nonFinite( x ),
+						V::mul( V::mul( x, b1 ), b2 ) ) ) );
+		}
+		for( ; i < n; ++i )
+		{
+			d[i] += isNonFinite( s[i] ) ? 0.0f :
+				s[i] * coeffSrcBuf1[i / DEFAULT_CHANNELS] *
+					coeffSrcBuf2[i / DEFAULT_CHANNELS];
+		}
+	}
+
+	static void addMultipliedStereo( sampleFrame* dst, const sampleFrame* src, float coeffSrcLeft, float coeffSrcRight, int frames )
+	{
+		float * d = floats( dst );
+		const float * s = floats( src );
+		const int n = frames * DEFAULT_CHANNELS;
+		const Vec c = V::set2( coeffSrcLeft, coeffSrcRight );
+
+		int i = 0;
+		for( ; i + V::Width <= n; i += V::Width )
+		{
+			V::store( d + i, V::add( V::load( d + i ),
+						V::mul( V::load( s + i ), c ) ) );
+		}
+		for( ; i < n; i += DEFAULT_CHANNELS )
+		{
+			d[i] += s[i] * coeffSrcLeft;
+			d[i+1] += s[i+1] * coeffSrcRight;
+		}
+	}
+
+	static void multiplyAndAddMultiplied( sampleFrame* dst, const sampleFrame* src, float coeffDst, float coeffSrc, int frames )
+	{
+		float * d = floats( dst );
+		const float * s = floats( src );
+		const int n = frames * DEFAULT_CHANNELS;
+		const Vec cd = V::set1( coeffDst );
+		const Vec cs = V::set1( coeffSrc );
+
+		int i = 0;
+		for( ; i + V::Width <= n; i += V::Width )
+		{
+			V::store( d + i, V::add( V::mul( V::load( d + i ), cd ),
+						V::mul( V::load( s + i ), cs ) ) );
+		}
+		for( ; i < n; ++i )
+		{
+			d[i] = d[i]*coeffDst + s[i]*coeffSrc;
+		}
+	}
+
+	static void multiplyAndAddMultipliedJoined( sampleFrame* dst, const sample_t* srcLeft, const sample_t* srcRight, float coeffDst, float coeffSrc, int frames )
+	{
+		float * d = floats( dst );
+		const Vec cd = V::set1( coeffDst );
+		const Vec cs = V::set1( coeffSrc );
+		const int step = V::Width / DEFAULT_CHANNELS;
+
+		int f = 0;
+		for( ; f + step <= frames; f += step )
+		{
+			float * df = d + f * DEFAULT_CHANNELS;
+			V::store( df, V::add( V::mul( V::load( df ), cd ),
+				V::mul( V::loadInterleaved( srcLeft + f,
+							srcRight + f ), cs ) ) );
+		}
+		for( ; f < frames; ++f )
+		{
+			dst[f][0] = dst[f][0]*coeffDst + srcLeft[f]*coeffSrc;
+			dst[f][1] = dst[f][1]*coeffDst + srcRight[f]*coeffSrc;
+		}
+	}
+
+	static Kernels kernels( const char * name )
+	{
+		Kernels k = {
+			name,
+			&isSilent,
+			&sanitize,
+			&add,
+			&addMultiplied,
+			&addSwappedMultiplied,
+			&addMultipliedByBuffer,
+			&addMultipliedByBuffers,
+			&addSanitizedMultiplied,
+			&addSanitizedMultipliedByBuffer,
+			&addSanitizedMultipliedByBuffers,
+			&addMultipliedStereo,
+			&multiplyAndAddMultiplied,
+			&multiplyAndAddMultipliedJoined
+		} ;
+		return k;
+	}
+
+} ;
+
+}
+
+#endif
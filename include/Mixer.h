@@ -46,6 +46,7 @@
 #endif
 
 
+#include <QtCore/QAtomicInt>
 #include <QtCore/QMutex>
 #include <QtCore/QThread>
 #include <QtCore/QVector>
@@ -54,7 +55,7 @@
 
 #include "lmms_basics.h"
 #include "Note.h"
-#include "fifo_buffer.h"
+#include "PeriodRing.h"
 #include "MixerProfiler.h"
 
 
@@ -65,6 +66,9 @@ class AudioPort;
 
 const fpp_t DEFAULT_BUFFER_SIZE = 256;
 
+// max. number of periods the mixer renders ahead in lookahead mode
+const int MAX_LOOKAHEAD_PERIODS = 64;
+
 const int BYTES_PER_SAMPLE = sizeof( sample_t );
 const int BYTES_PER_INT_SAMPLE = sizeof( int_sample_t );
 const int BYTES_PER_FRAME = sizeof( sampleFrame );
@@ -82,6 +86,8 @@ const Octaves BaseOctave = DefaultOctave;
 
 
 class MixerWorkerThread;
+class NotePlayHandle;
+class InstrumentTrack;
 
 
 class EXPORT Mixer : public QObject
@@ -230,6 +236,79 @@ public:
 	bool hasNotePlayHandles();
 
 
+	// voice limiting - when there are more notes than allowed per
+	// instrument track or in total, the ones chosen by the policy are
+	// faded out within one period
+	enum VoiceStealingPolicies
+	{
+		StealOldest,
+		StealQuietest,
+		StealReleasedFirst,
+		NumVoiceStealingPolicies
+	} ;
+
+	// 0 = unlimited
+	int maxVoices() const
+	{
+		return m_maxVoices;
+	}
+
+	void setMaxVoices( int _voices )
+	{
+		m_maxVoices = qMax( _voices, 0 );
+	}
+
+	VoiceStealingPolicies voiceStealingPolicy() const
+	{
+		return m_voiceStealingPolicy;
+	}
+
+	void setVoiceStealingPolicy( VoiceStealingPolicies _policy )
+	{
+		m_voiceStealingPolicy = _policy;
+	}
+
+	// notes ended early
+	int stolenVoices() const
+	{
+		return m_stolenVoices;
+	}
+
+	// notes ended before being heard
+	int droppedVoices() const
+	{
+		return m_droppedVoices;
+	}
+
+	void resetVoiceCounters()
+	{
+		m_stolenVoices = 0;
+		m_droppedVoices = 0;
+	}
+
+
+	// number of periods rendered ahead of the audio device in addition to
+	// the ones the configured buffer size requires - gives heavy periods
+	// time to catch up instead of causing xruns, at the cost of that much
+	// more latency for changes made while playing. 0 disables lookahead.
+	int lookahead() const
+	{
+		return m_lookahead;
+	}
+
+	void setLookahead( int _periods );
+
+	// lookahead is suspended while live input (MIDI events, recording)
+	// is going on, so that it follows configured latency
+	bool lookaheadSuspended() const
+	{
+		return (int) m_liveInputHold > 0;
+	}
+
+	// called whenever live input arrives - can be called from any thread
+	void notifyLiveInput();
+
+
 	// methods providing information for other classes
 	inline fpp_t framesPerPeriod() const
 	{
@@ -353,9 +432,60 @@ public:
 		return m_inputBufferFrames[ m_inputBufferRead ];
 	}
 
+	// audio devices have to call releaseNextBuffer() as soon as they're
+	// done with the buffer
 	inline const surroundSampleFrame * nextBuffer()
 	{
-		return hasFifoWriter() ? m_fifo->read() : renderNextBuffer();
+		return hasFifoWriter() ? m_fifo->readBuffer() : renderNextBuffer();
+	}
+
+	inline void releaseNextBuffer()
+	{
+		if( hasFifoWriter() )
+		{
+			m_fifo->release();
+		}
+	}
+
+	// periods rendered ahead by fifo writer and not taken by audio device
+	// yet
+	int fifoFillLevel() const
+	{
+		return hasFifoWriter() ? m_fifo->fillLevel() : 0;
+	}
+
+	// max. number of periods fifo writer renders ahead right now,
+	// including lookahead
+	int fifoDepth() const
+	{
+		return m_fifo->depth();
+	}
+
+	// latency in frames caused by periods rendered ahead right now
+	f_cnt_t fifoLatency() const
+	{
+		return fifoFillLevel() * m_framesPerPeriod;
+	}
+
+	// max. number of periods in flight between rendering and audio device
+	int fifoCapacity() const
+	{
+		return m_fifo->capacity();
+	}
+
+	// number of period audio ports and FX channels are processing right
+	// now - counts up and wraps around to 0 eventually
+	int renderPeriod() const
+	{
+		return m_renderPeriod;
+	}
+
+	// number of period of buffer last returned by nextBuffer(), allows
+	// audio devices to find individual outputs of ports belonging to it
+	int nextBufferPeriod() const
+	{
+		// renderNextBuffer() returns mix of previous period
+		return hasFifoWriter() ? m_fifo->readPeriod() : m_renderPeriod - 1;
 	}
 
 	void changeQuality( const struct qualitySettings & _qs );
@@ -368,7 +498,7 @@ signals:
 
 
 private:
-	typedef fifoBuffer<surroundSampleFrame *> fifo;
+	typedef PeriodRing fifo;
 
 	class fifoWriter : public QThread
 	{
@@ -401,6 +531,29 @@ private:
 
 	const surroundSampleFrame * renderNextBuffer();
 
+	// adjusts number of periods fifo writer may render ahead to current
+	// lookahead - called by fifo writer before each period
+	void updateFifoDepth();
+
+	// remove play handle from its audio port and delete it, note play
+	// handles are released in one go by deleteRetiredPlayHandles() - both
+	// must be called with play handle removal locked
+	void retirePlayHandle( PlayHandle * handle );
+	void deleteRetiredPlayHandles();
+
+	struct Voice
+	{
+		NotePlayHandle * handle;
+		const InstrumentTrack * track;
+		double priority;	// lowest ones are stolen first
+	} ;
+
+	void limitVoices();
+	void stealVoices( int _first, int _last, int _count );
+	double voicePriority( NotePlayHandle * _nph ) const;
+	static bool voiceTrackLessThan( const Voice & _a, const Voice & _b );
+	static bool voicePriorityLessThan( const Voice & _a, const Voice & _b );
+
 
 
 	QVector<AudioPort *> m_audioPorts;
@@ -422,6 +575,7 @@ private:
 	int m_readBuffer;
 	int m_writeBuffer;
 	int m_poolDepth;
+	volatile int m_renderPeriod;
 
 	surroundSampleFrame m_maxClip;
 	surroundSampleFrame m_previousSample;
@@ -433,11 +587,15 @@ private:
 	int m_numWorkers;
 	QWaitCondition m_queueReadyWaitCond;
 
-	PlayHandleList m_newPlayHandles;	// place where new playhandles are added temporarily
+	PlayHandleVector m_newPlayHandles;	// place where new playhandles are added temporarily
 	QMutex m_playHandleMutex;			// mutex used only for adding playhandles
 
 	PlayHandleList m_playHandles;
+	// play handles queued in current period - decided once so that
+	// dependencies of their audio ports always match
+	PlayHandleVector m_scheduledPlayHandles;
 	ConstPlayHandleList m_playHandlesToRemove;
+	QVector<NotePlayHandle *> m_retiredNotePlayHandles;
 
 	struct qualitySettings m_qualitySettings;
 	float m_masterGain;
@@ -459,9 +617,20 @@ private:
 
 	fifo * m_fifo;
 	fifoWriter * m_fifoWriter;
+	// periods needed for configured buffer size
+	int m_fifoPeriods;
+	int m_lookahead;
+	// periods left until lookahead is resumed after live input
+	QAtomicInt m_liveInputHold;
 
 	MixerProfiler m_profiler;
 
+	int m_maxVoices;
+	VoiceStealingPolicies m_voiceStealingPolicy;
+	volatile int m_stolenVoices;
+	volatile int m_droppedVoices;
+	QVector<Voice> m_voices;
+
 	friend class Engine;
 	friend class MixerWorkerThread;
 
@@ -25,13 +25,127 @@
 #ifndef MIXER_PROFILER_H
 #define MIXER_PROFILER_H
 
-#include <QFile>
+#include <stdio.h>
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QFile>
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QPair>
+#include <QtCore/QVector>
 
 #include "MicroTimer.h"
+#include "export.h"
+
+/* setOutputFile() writes the time of each period in microseconds to the
+ * given file, one per line, and a binary trace with the times of stages and
+ * objects to the same file name with ".trace" appended.
+ *
+ * Trace file - all values little endian, times in microseconds:
+ *
+ *   "LMPF", quint16 version, quint8 number of stages
+ *   followed by records starting with a quint8 tag:
+ *   'S' quint32 sample rate, quint16 frames per period
+ *   'N' quint32 entry id, quint8 entry type, quint16 length, UTF-8 name
+ *   'P' quint32 period time, quint32 stage time for each stage,
+ *       quint32 n, n x ( quint32 entry id, quint32 time )
+ *
+ * Entry IDs are never reused within a trace.
+ */
+
+
+// base of objects whose processing times can be recorded. Entries are
+// looked up by an ID which isn't reused, so an object allocated where a
+// deleted one lived doesn't show up under the old name. Entries of an
+// object are dropped when it's destroyed.
+class EXPORT ProfiledObject
+{
+public:
+	ProfiledObject();
+	~ProfiledObject();
+
+	quint32 profileId() const
+	{
+		return m_profileId;
+	}
+
+private:
+	const quint32 m_profileId;
+
+} ;
+
 
 class MixerProfiler
 {
 public:
+	// song processing and master mix are measured in the mixer thread,
+	// the other stages run interleaved in the processing graph, so their
+	// times are CPU times summed over all workers (detailed profiling only)
+	enum Stages
+	{
+		SongStage,
+		PlayHandleStage,
+		AudioPortStage,
+		FxChannelStage,
+		MasterMixStage,
+		NumStages
+	} ;
+
+	enum EntryTypes
+	{
+		PlayHandleEntry,	// all play handles of an audio port
+		AudioPortEntry,		// audio port including its effects
+		EffectEntry,
+		FxChannelEntry,		// FX channel including its effects
+		NumEntryTypes
+	} ;
+
+	struct Entry
+	{
+		quint32 id;		// as written to trace
+		EntryTypes type;
+		QString name;
+		qint64 totalTime;
+		int lastTime;
+		int maxTime;
+	} ;
+
+	// measures time until finish() or destruction and records it for
+	// given object if detailed profiling is enabled
+	class Probe
+	{
+	public:
+		Probe( MixerProfiler & _profiler, EntryTypes _type,
+					const ProfiledObject * _object ) :
+			m_profiler( _profiler.isDetailed() ? &_profiler : NULL ),
+			m_type( _type ),
+			m_object( _object )
+		{
+		}
+
+		~Probe()
+		{
+			finish();
+		}
+
+		void finish()
+		{
+			if( m_profiler )
+			{
+				m_profiler->record( m_type, m_object, m_timer.elapsed() );
+				m_profiler = NULL;
+			}
+		}
+
+	private:
+		MixerProfiler * m_profiler;
+		EntryTypes m_type;
+		const ProfiledObject * m_object;
+		MicroTimer m_timer;
+
+	} ;
+
+
 	MixerProfiler();
 	~MixerProfiler();
 
@@ -42,18 +156,114 @@ public:
 
 	void finishPeriod( sample_rate_t sampleRate, fpp_t framesPerPeriod );
 
+	void startStage()
+	{
+		m_stageTimer.reset();
+	}
+
+	void finishStage( Stages _stage )
+	{
+		m_periodStageTime[_stage] += m_stageTimer.elapsed();
+	}
+
+	// thread-safe, called by workers
+	void record( EntryTypes _type, const ProfiledObject * _object, int _time );
+
+	// merge times recorded by workers - to be called by mixer thread while
+	// recorded objects are guaranteed to still exist
+	void collect();
+
+	// drops entries of given object - called when it's destroyed
+	void remove( quint32 _profileId );
+
 	int cpuLoad() const
 	{
 		return m_cpuLoad;
 	}
 
+	bool isDetailed() const
+	{
+		return m_detailed;
+	}
+
+	void setDetailed( bool _on );
+
+	// statistics for GUI and CLI - thread-safe
+	int periods() const
+	{
+		return m_periods;
+	}
+
+	// of last period
+	int stageTime( Stages _stage ) const
+	{
+		return m_stageTime[_stage];
+	}
+
+	qint64 totalStageTime( Stages _stage ) const
+	{
+		return m_totalStageTime[_stage];
+	}
+
+	// times recorded by workers which didn't fit into the records of their
+	// period and are missing in entries and stage times
+	int droppedRecords() const
+	{
+		return m_droppedRecords;
+	}
+
+	QVector<Entry> entries() const;
+	void reset();
+
+	void printSummary( FILE * _out, int _maxEntries = 20 ) const;
+
+	static const char * stageName( Stages _stage );
+	static const char * entryTypeName( EntryTypes _type );
+
 	void setOutputFile( const QString& outputFile );
 
 
 private:
+	struct Record
+	{
+		const ProfiledObject * object;
+		EntryTypes type;
+		int time;
+	} ;
+
+	// profile ID and entry type
+	typedef QPair<quint32, int> EntryKey;
+
+	QString entryName( EntryTypes _type, const ProfiledObject * _object ) const;
+
+	template<typename T>
+	void write( T _value );
+	void writeName( const Entry & _entry );
+
 	MicroTimer m_periodTimer;
+	MicroTimer m_stageTimer;
 	int m_cpuLoad;
 	QFile m_outputFile;
+	QFile m_traceFile;
+	sample_rate_t m_traceSampleRate;
+	fpp_t m_traceFramesPerPeriod;
+
+	volatile bool m_detailed;
+
+	Record * m_records;
+	QAtomicInt m_recordCount;
+	volatile int m_droppedRecords;
+
+	int m_periodStageTime[NumStages];
+	volatile int m_stageTime[NumStages];
+	volatile qint64 m_totalStageTime[NumStages];
+	volatile int m_periods;
+
+	// protects entries against concurrent access by GUI
+	mutable QMutex m_entryMutex;
+	QHash<EntryKey, Entry> m_entries;
+	QHash<EntryKey, int> m_periodEntryTime;	// entries seen in current period
+	quint32 m_nextEntryId;
 
 };
 
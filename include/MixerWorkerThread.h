@@ -25,11 +25,15 @@
 #ifndef MIXER_WORKER_THREAD_H
 #define MIXER_WORKER_THREAD_H
 
-#include <QtCore/QAtomicPointer>
+#include <QtCore/QAtomicInt>
+#include <QtCore/QList>
+#include <QtCore/QMutex>
 #include <QtCore/QThread>
+#include <QtCore/QVector>
+#include <QtCore/QWaitCondition>
 
+#include "lmms_basics.h"
 #include "ThreadableJob.h"
-#include "Mixer.h"
 
 #ifdef __SSE__
 #include <xmmintrin.h>
@@ -42,6 +46,11 @@ class MixerWorkerThread : public QThread
 {
 public:
 	// internal representation of the job queue - all functions are thread-safe
+	//
+	// every worker owns a deque of jobs - jobs are popped from the tail of
+	// the own deque (LIFO, good cache locality for jobs spawned while
+	// processing) and stolen from the head of other workers' deques once
+	// the own deque ran dry
 	class JobQueue
 	{
 	public:
@@ -51,32 +60,84 @@ public:
 			Dynamic	// jobs can be added while processing queue
 		} ;
 
-		JobQueue() :
-			m_items(),
-			m_queueSize( 0 ),
-			m_itemsDone( 0 ),
-			m_opMode( Static )
-		{
-		}
+		JobQueue();
+		~JobQueue();
+
+		// adds a deque for a new worker and returns its index
+		int registerWorker();
 
 		void reset( OperationMode _opMode );
 
+		// adds _job if it requires processing
 		void addJob( ThreadableJob * _job );
+		// adds _job in any case
+		void enqueue( ThreadableJob * _job );
+
+		void run( int _worker );
+		void wait( int _worker );
+
+		// how often an idle worker polls for new jobs before parking
+		static const int SpinIterations = 1024;
 
-		void run();
-		void wait();
 
 	private:
-#define JOB_QUEUE_SIZE 1024
-		QAtomicPointer<ThreadableJob> m_items[JOB_QUEUE_SIZE];
+		class Deque
+		{
+		public:
+			Deque();
+			~Deque();
+
+			void push( ThreadableJob * _job );
+			ThreadableJob * pop();
+			ThreadableJob * steal();
+
+			bool isEmpty() const
+			{
+				return (int) m_count == 0;
+			}
+
+		private:
+			void lock()
+			{
+				while( !m_lock.testAndSetAcquire( 0, 1 ) )
+				{
+					spinPause();
+				}
+			}
+
+			void unlock()
+			{
+				m_lock.fetchAndStoreRelease( 0 );
+			}
+
+			QAtomicInt m_lock;
+			QAtomicInt m_count;	// for lock-less emptiness checks
+			ThreadableJob * * m_items;
+			int m_capacity;
+			int m_head;
+			int m_tail;
+
+		} ;
+
+		ThreadableJob * takeJob( int _worker );
+		void finishJob();
+		bool hasJobs() const;
+
+		QVector<Deque *> m_deques;
+		QAtomicInt m_nextDeque;
 		QAtomicInt m_queueSize;
 		QAtomicInt m_itemsDone;
 		OperationMode m_opMode;
 
+		// threads parked in wait()
+		QAtomicInt m_waiting;
+		QMutex m_doneMutex;
+		QWaitCondition m_doneWaitCond;
+
 	} ;
 
 
-	MixerWorkerThread( Mixer* mixer );
+	MixerWorkerThread( QObject * _parent );
 	virtual ~MixerWorkerThread();
 
 	virtual void quit();
@@ -92,6 +153,11 @@ public:
 		globalJobQueue.addJob( _job );
 	}
 
+	static void enqueueJob( ThreadableJob * _job )
+	{
+		globalJobQueue.enqueue( _job );
+	}
+
 	// a convenient helper function allowing to pass a container with pointers
 	// to ThreadableJob objects
 	template<typename T>
@@ -107,14 +173,26 @@ public:
 
 	static void startAndWaitForJobs();
 
+	static inline void spinPause()
+	{
+		LMMS_SPIN_PAUSE();
+	}
+
 
 private:
 	virtual void run();
 
+	// spins for a while and then parks until the next call of
+	// startAndWaitForJobs() or until the thread is told to quit
+	void waitForJobs( int _generation );
+
 	static JobQueue globalJobQueue;
 	static QWaitCondition * queueReadyWaitCond;
+	static QMutex * queueReadyMutex;
+	static QAtomicInt queueGeneration;
 	static QList<MixerWorkerThread *> workerThreads;
 
+	int m_index;
 	volatile bool m_quit;
 
 } ;
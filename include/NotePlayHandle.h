@@ -32,7 +32,8 @@
 #include "Track.h"
 #include "MemoryManager.h"
 #include <QtCore/QAtomicInt>
-#include <QtCore/QReadWriteLock>
+#include <QtCore/QMutex>
+#include <QtCore/QThreadStorage>
 
 class InstrumentTrack;
 class NotePlayHandle;
@@ -111,7 +112,7 @@ public:
 	/*! Returns whether playback of note is finished and thus handle can be deleted */
 	virtual bool isFinished() const
 	{
-		return m_released && framesLeft() <= 0;
+		return m_fadedOut || ( m_released && framesLeft() <= 0 );
 	}
 
 	/*! Returns number of frames left for playback */
@@ -205,6 +206,16 @@ public:
 	/*! Mutes playback of note */
 	void mute();
 
+	/*! Ends the note within the next period, used by the mixer's voice
+	    limiter - notes which didn't play yet end without being heard */
+	void steal();
+
+	/*! Returns whether note was stolen */
+	bool isStolen() const
+	{
+		return m_stolen;
+	}
+
 	/*! Returns index of NotePlayHandle in vector of note-play-handles
         belonging to this instrument track - used by arpeggiator */
 	int index() const;
@@ -294,6 +305,8 @@ private:
 	NotePlayHandle * m_parent;			// parent note
 	bool m_hadChildren;
 	bool m_muted;							// indicates whether note is muted
+	bool m_stolen;							// indicates whether note was stolen
+	bool m_fadedOut;						// stolen note is done
 	Track* m_bbTrack;						// related BB track
 
 	// tempo reaction
@@ -316,13 +329,22 @@ private:
 
 
 const int INITIAL_NPH_CACHE = 256;
-const int NPH_CACHE_INCREMENT = 16;
+const int NPH_CACHE_INCREMENT = 64;
+// pool is grown in background as soon as less handles are available
+const int NPH_CACHE_WATERMARK = 32;
+// handles are exchanged between threads in magazines of this size, each
+// thread caches up to two magazines
+const int NPH_MAGAZINE_SIZE = 16;
+// empty magazines kept ready for threads handing back objects
+const int NPH_MAGAZINE_RESERVE = 4;
 
 class NotePlayHandleManager
 {
 	MM_OPERATORS
 public:
 	static void init();
+	// stops background growing - call before MemoryManager::cleanup()
+	static void shutdown();
 	static NotePlayHandle * acquire( InstrumentTrack* instrumentTrack,
 					const f_cnt_t offset,
 					const f_cnt_t frames,
@@ -331,13 +353,44 @@ public:
 					int midiEventChannel = -1,
 					NotePlayHandle::Origin origin = NotePlayHandle::OriginPattern );
 	static void release( NotePlayHandle * nph );
+	static void release( NotePlayHandle * const * nphs, int count );
 	static void extend( int i );
 
+	// filters for InstrumentSoundShaping, so that they don't have to be
+	// created in audio threads - returned filters have history cleared
+	static BasicFilters<> * acquireFilter( sample_rate_t sampleRate );
+	static void releaseFilter( BasicFilters<> * filter );
+
+	// usage statistics for sizing the pool
+	static int size();
+	static int live();
+	static int peakLive();
+	static void resetPeakLive();
+	// number of times pool or its magazines had to be grown in an audio
+	// thread because background growing didn't keep up
+	static int emergencyExtensions();
+
 private:
-	static NotePlayHandle ** s_available;
-	static QReadWriteLock s_mutex;
-	static QAtomicInt s_availableIndex;
+	class Depot;
+	class ThreadCache;
+	class Grower;
+	friend class Grower;
+
+	static ThreadCache * threadCache();
+	static int fetch( Depot & depot, void * * items, bool filters );
+	static void grow( bool filters, int c );
+	static void growInBackground();
+
+	static Depot s_handles;
+	static Depot s_filters;
+	static QThreadStorage<ThreadCache *> s_threadCaches;
+	static QMutex s_growMutex;
+	static Grower * s_grower;
 	static int s_size;
+	static int s_filtersSize;
+	static QAtomicInt s_live;
+	static QAtomicInt s_peakLive;
+	static QAtomicInt s_emergencyExtensions;
 };
 
 
@@ -0,0 +1,125 @@
+/*
+ * ParameterStream.h - values of an automated parameter during one period
+ *
+ * Copyright (c) 2026 agent <agent/at/local>
+ *
+ * This file is part of LMMS - http://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef PARAMETER_STREAM_H
+#define PARAMETER_STREAM_H
+
+#include <QtGlobal>
+
+
+// describes how a parameter changes within a period - most of the time it's
+// constant or moves linearly towards a new value, and only controllers
+// deliver arbitrary values. Consumers can pick a loop for each case instead
+// of always multiplying with a buffer which had to be filled before.
+class ParameterStream
+{
+public:
+	enum Types
+	{
+		Constant,
+		Ramp,
+		Buffer
+	} ;
+
+	ParameterStream() :
+		m_type( Constant ),
+		m_start( 0 ),
+		m_step( 0 ),
+		m_values( NULL )
+	{
+	}
+
+	static ParameterStream constant( float _value )
+	{
+		return ParameterStream( Constant, _value, 0, NULL );
+	}
+
+	// moves from _from (value of previous period) to _to within _frames
+	// frames, reaching _to at last frame - same as ValueBuffer::interpolate()
+	static ParameterStream ramp( float _from, float _to, int _frames )
+	{
+		const float step = ( _to - _from ) / _frames;
+		return ParameterStream( Ramp, _from + step, step, NULL );
+	}
+
+	// _values have to stay valid during the period
+	static ParameterStream buffer( const float * _values )
+	{
+		return ParameterStream( Buffer, 0, 0, _values );
+	}
+
+	Types type() const
+	{
+		return m_type;
+	}
+
+	bool isConstant() const
+	{
+		return m_type == Constant;
+	}
+
+	float value( int _frame ) const
+	{
+		return m_type == Buffer ? m_values[_frame] :
+						m_start + m_step * _frame;
+	}
+
+	// value at first frame - the value for constant streams
+	float start() const
+	{
+		return m_start;
+	}
+
+	// change per frame of ramps
+	float step() const
+	{
+		return m_step;
+	}
+
+	// NULL unless type() is Buffer
+	const float * values() const
+	{
+		return m_values;
+	}
+
+
+private:
+	ParameterStream( Types _type, float _start, float _step,
+						const float * _values ) :
+		m_type( _type ),
+		m_start( _start ),
+		m_step( _step ),
+		m_values( _values )
+	{
+	}
+
+	Types m_type;
+	float m_start;
+	float m_step;
+	const float * m_values;
+
+} ;
+
+
+#endif
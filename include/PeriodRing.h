@@ -0,0 +1,154 @@
+/*
+ * PeriodRing.h - preallocated single-producer/single-consumer ring of periods
+ *
+ * Copyright (c) 2026 agent <agent/at/local>
+ *
+ * This file is part of LMMS - http://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef PERIOD_RING_H
+#define PERIOD_RING_H
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QSemaphore>
+
+#include "lmms_basics.h"
+
+
+// hands rendered periods from the fifo writer to the audio device without
+// allocating anything per period - all buffers are allocated once and the
+// writer fills the slot it gets from writeBuffer().
+//
+// Publishing and consuming are wait-free. A side only blocks (on a
+// semaphore) if the ring is full resp. empty, and the other side only
+// touches the semaphore if someone is actually waiting.
+//
+// There must be exactly one writer thread and one reader thread.
+class PeriodRing
+{
+public:
+	// allocates _capacity buffers of _frames frames - writer may run
+	// ahead by up to depth() periods which can be changed later on
+	PeriodRing( int _capacity, fpp_t _frames );
+	~PeriodRing();
+
+	// writer side: returns slot to render next period into, blocks while
+	// depth() periods are waiting for the reader
+	surroundSampleFrame * writeBuffer();
+	// makes slot returned by writeBuffer() available to reader, _period
+	// is the mixer period it holds
+	void publish( int _period );
+	// no more periods are going to come - reader gets NULL as soon as it
+	// consumed all pending periods
+	void close();
+
+	// reader side: returns oldest pending period, blocks while ring is
+	// empty and returns NULL after close()
+	const surroundSampleFrame * readBuffer();
+	// hands period returned by readBuffer() back to writer
+	void release();
+
+	// mixer period of buffer last returned by readBuffer()
+	int readPeriod() const
+	{
+		return m_readPeriod;
+	}
+
+	// start over after close() - only call while neither writer nor
+	// reader is active
+	void reset();
+
+	// periods rendered but not consumed yet
+	int fillLevel() const
+	{
+		return (int) m_written - (int) m_read;
+	}
+
+	int capacity() const
+	{
+		return m_capacity;
+	}
+
+	int depth() const
+	{
+		return m_depth;
+	}
+
+	// gets clamped to 1...capacity()
+	void setDepth( int _depth );
+
+	fpp_t frames() const
+	{
+		return m_frames;
+	}
+
+
+private:
+	int index( int _count ) const
+	{
+		return (unsigned int) _count % m_capacity;
+	}
+
+	bool isClosed() const
+	{
+		return (int) m_closed != 0;
+	}
+
+	bool canWrite() const
+	{
+		return fillLevel() < depth();
+	}
+
+	bool canRead() const
+	{
+		return fillLevel() > 0 || isClosed();
+	}
+
+	typedef bool ( PeriodRing::*Condition )() const;
+
+	// blocks until _condition is met, other side has to call wake() with
+	// same _waiting and _wake after changing state
+	void waitFor( Condition _condition, QAtomicInt & _waiting,
+							QSemaphore & _wake );
+	static void wake( QAtomicInt & _waiting, QSemaphore & _wake );
+
+	surroundSampleFrame * * m_buffers;
+	int * m_periods;
+	int m_capacity;
+	fpp_t m_frames;
+
+	QAtomicInt m_depth;
+	QAtomicInt m_closed;
+
+	// period counters - only advanced by their own side and wrap around,
+	// differences stay valid though
+	QAtomicInt m_written;
+	QAtomicInt m_read;
+
+	QAtomicInt m_writerWaiting;
+	QAtomicInt m_readerWaiting;
+	QSemaphore m_writerWake;
+	QSemaphore m_readerWake;
+
+	int m_readPeriod;
+
+} ;
+
+
+#endif
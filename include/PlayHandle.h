@@ -29,6 +29,7 @@
 #include <QtCore/QVector>
 #include <QtCore/QMutex>
 
+#include "IndexedList.h"
 #include "ThreadableJob.h"
 #include "lmms_basics.h"
 
@@ -48,6 +49,14 @@ public:
 	} ;
 	typedef Types Type;
 
+	// kinds of PlayHandleLists a play handle can be part of at the same time
+	enum ListSlots
+	{
+		MixerList,
+		AudioPortList,
+		NumListSlots
+	} ;
+
 	PlayHandle( const Type type, f_cnt_t offset = 0 );
 
 	PlayHandle & operator = ( PlayHandle & p )
@@ -149,10 +158,27 @@ private:
 	bool m_usesBuffer;
 	AudioPort * m_audioPort;
 
+	// position in the PlayHandleList of each kind, -1 if not in one
+	int m_listIndex[NumListSlots];
+
+	friend class IndexedList<PlayHandle>;
+
+} ;
+
+
+// see IndexedList for the cost of operations
+class PlayHandleList : public IndexedList<PlayHandle>
+{
+public:
+	PlayHandleList( PlayHandle::ListSlots _slot ) :
+		IndexedList<PlayHandle>( _slot )
+	{
+	}
+
 } ;
 
 
-typedef QList<PlayHandle *> PlayHandleList;
+typedef QVector<PlayHandle *> PlayHandleVector;
 typedef QList<const PlayHandle *> ConstPlayHandleList;
 
 
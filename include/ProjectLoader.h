@@ -0,0 +1,128 @@
+/*
+ * ProjectLoader.h - background sample decoding and timings for loading
+ *                   projects
+ *
+ * Copyright (c) 2026 agent <agent/at/local>
+ *
+ * This file is part of LMMS - http://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef PROJECT_LOADER_H
+#define PROJECT_LOADER_H
+
+#include <stdio.h>
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QMutex>
+#include <QtCore/QSet>
+#include <QtCore/QString>
+#include <QtCore/QThreadPool>
+#include <QtCore/QVector>
+
+#include "MicroTimer.h"
+
+class QDomElement;
+class QXmlStreamReader;
+class SampleBuffer;
+
+
+// helps Song::loadProject() and keeps track of where the time goes.
+//
+// Tracks and their instruments are QObjects living in the GUI thread, so
+// they are still created one after another. What makes most projects slow
+// to load is decoding sample files though, which only needs the file name.
+// So the loader streams through the project file in the background while
+// the DOM is built and decodes every sample it comes across on a thread
+// pool. A track getting to a sample which is being decoded at that moment
+// waits for it (see SampleCache::acquireOrReserve()) instead of decoding it
+// once more.
+class ProjectLoader
+{
+public:
+	enum Phases
+	{
+		ParsePhase,		// reading file and building DOM
+		SettingsPhase,		// song settings and FX mixer
+		TrackPhase,
+		ControllerPhase,
+		EditorPhase,		// editor windows, notes, timeline
+		FinalizePhase,		// resolving connections and IDs
+		NumPhases
+	} ;
+
+	// times in microseconds
+	struct Metrics
+	{
+		Metrics();
+
+		int phaseTime[NumPhases];
+		int totalTime;
+		int samples;
+		// summed over all threads decoding samples
+		qint64 sampleTime;
+
+		void printSummary( FILE * _out ) const;
+
+	} ;
+
+	ProjectLoader();
+	// waits for all samples and releases them - tracks hold their own
+	// references by then
+	~ProjectLoader();
+
+	// starts scanning _fileName for sample files in the background
+	void prefetch( const QString & _fileName );
+
+	// adds time since previous call to previous phase
+	void beginPhase( Phases _phase );
+	// ends current phase
+	void finish();
+
+	Metrics metrics() const;
+
+	static const char * phaseName( Phases _phase );
+
+
+private:
+	class ScanJob;
+	class SampleJob;
+
+	void scanFile( const QString & _fileName );
+	bool scan( QXmlStreamReader & _reader );
+	void scan( const QDomElement & _element );
+	void scheduleSample( const QString & _file, bool _streamingAllowed,
+							bool _reversed );
+	void addSample( SampleBuffer * _buffer, int _time );
+
+	QThreadPool m_pool;
+
+	mutable QMutex m_samplesMutex;
+	QSet<QString> m_scheduled;
+	QVector<SampleBuffer *> m_samples;
+	qint64 m_sampleTime;
+
+	MicroTimer m_totalTimer;
+	MicroTimer m_phaseTimer;
+	Phases m_phase;
+	Metrics m_metrics;
+
+} ;
+
+
+#endif
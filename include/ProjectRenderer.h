@@ -26,6 +26,7 @@
 #define PROJECT_RENDERER_H
 
 #include "AudioFileDevice.h"
+#include "fifo_buffer.h"
 #include "lmmsconfig.h"
 
 
@@ -79,6 +80,19 @@ public:
 	static ExportFileFormats getFileFormatFromExtension(
 							const QString & _ext );
 
+	// throughput of current export in output frames per second, measured
+	// over the last second
+	float framesPerSecond() const
+	{
+		return m_framesPerSecond;
+	}
+
+	// total number of output frames of current/last export
+	f_cnt_t framesRendered() const
+	{
+		return m_framesRendered;
+	}
+
 
 public slots:
 	void startProcessing();
@@ -92,6 +106,30 @@ signals:
 
 
 private:
+	// rendered audio waiting for being encoded - collects several periods
+	// so the encoder gets fed with larger blocks
+	struct RenderedBlock
+	{
+		surroundSampleFrame * m_data;
+		f_cnt_t m_frames;
+		float m_masterGain;
+	} ;
+
+	typedef fifoBuffer<RenderedBlock *> BlockFifo;
+
+	// encodes rendered blocks while the mixer already renders the next ones
+	class EncoderThread : public QThread
+	{
+	public:
+		EncoderThread( ProjectRenderer * _renderer );
+
+	private:
+		virtual void run();
+
+		ProjectRenderer * m_renderer;
+
+	} ;
+
 	virtual void run();
 
 	AudioFileDevice * m_fileDev;
@@ -100,6 +138,11 @@ private:
 
 	volatile int m_progress;
 	volatile bool m_abort;
+	volatile float m_framesPerSecond;
+	volatile f_cnt_t m_framesRendered;
+
+	BlockFifo * m_freeBlocks;
+	BlockFifo * m_renderedBlocks;
 
 } ;
 
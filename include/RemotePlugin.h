@@ -93,6 +93,17 @@ typedef int32_t key_t;
 #include <locale.h>
 #endif
 
+// periods are handed to remote process through RemoteAudioRing and futexes
+// instead of the message queue where available
+#if defined( __linux__ ) && !defined( USE_QT_SEMAPHORES )
+#define LMMS_REMOTE_AUDIO_RING
+#include <climits>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
 
 #ifdef BUILD_REMOTE_PLUGIN_CLIENT
 #undef EXPORT
@@ -109,6 +120,26 @@ typedef int32_t key_t;
 const int SHM_FIFO_SIZE = 512*1024;
 
 
+#ifdef LMMS_REMOTE_AUDIO_RING
+// futexes also work across processes as long as the word is located in
+// shared memory - returns after _timeoutMs at the latest, so that callers
+// can check whether other side is still alive
+static inline void futexWait( volatile int32_t * _addr, int32_t _val,
+							int _timeoutMs )
+{
+	struct timespec t;
+	t.tv_sec = _timeoutMs / 1000;
+	t.tv_nsec = ( _timeoutMs % 1000 ) * 1000000;
+	syscall( SYS_futex, _addr, FUTEX_WAIT, _val, &t, NULL, 0 );
+}
+
+static inline void futexWake( volatile int32_t * _addr )
+{
+	syscall( SYS_futex, _addr, FUTEX_WAKE, INT_MAX, NULL, NULL, 0 );
+}
+#endif
+
+
 // implements a FIFO inside a shared memory segment
 class shmFifo
 {
@@ -129,6 +160,7 @@ class shmFifo
 		sem32_t messageSem;	// semaphore for incoming messages
 		volatile int32_t startPtr; // current start of FIFO in memory
 		volatile int32_t endPtr;   // current end of FIFO in memory
+		volatile int32_t doorbell; // see ringDoorbell()
 		char data[SHM_FIFO_SIZE];  // actual data
 	} ;
 
@@ -319,7 +351,34 @@ public:
 #else
 		sem_post( m_messageSem );
 #endif
+#ifdef LMMS_REMOTE_AUDIO_RING
+		ringDoorbell();
+#endif
+	}
+
+#ifdef LMMS_REMOTE_AUDIO_RING
+	// counts messages and periods submitted through RemoteAudioRing, so
+	// that the receiver can wait for both at once
+	inline int32_t doorbell() const
+	{
+		return m_data->doorbell;
+	}
+
+	inline void ringDoorbell()
+	{
+		__sync_add_and_fetch( &m_data->doorbell, 1 );
+		futexWake( &m_data->doorbell );
+	}
+
+	// wait until doorbell was rung after it had value _seen
+	inline void waitForDoorbell( int32_t _seen )
+	{
+		if( !isInvalid() )
+		{
+			futexWait( &m_data->doorbell, _seen, 100 );
+		}
 	}
+#endif
 
 
 	inline int32_t readInt()
@@ -500,11 +559,57 @@ enum RemoteMessageIDs
 	IdSavePresetFile,
 	IdLoadPresetFile,
 	IdDebugMessage,
+	IdProcessRingSlot,
 	IdUserBase = 64
 } ;
 
 
 
+// header of shared memory for audio data, followed by Slots slots with
+// planar buffers for all inputs and then all outputs. Host writes input of
+// period n into slot n % Slots and increments submitted, remote process
+// processes slots in order and increments completed afterwards. With two
+// slots host can prepare next period while remote process still works on
+// the current one.
+//
+// Where LMMS_REMOTE_AUDIO_RING is defined, remote process waits on the
+// doorbell of its message queue, which is rung for both messages and
+// periods, and host waits on completed - so there's neither a message nor
+// a semaphore involved in processing a period.
+struct RemoteAudioRing
+{
+	enum
+	{
+		Slots = 2
+	} ;
+
+	volatile int32_t submitted;	// periods submitted by host
+	volatile int32_t completed;	// periods processed by remote process
+	int32_t frames;
+	int32_t inputs;
+	int32_t outputs;
+	volatile int32_t remoteWaits;	// set by remote process if it waits
+					// on doorbell instead of messages only
+	int32_t latency;		// frames host delays output by if
+					// remoteWaits is set
+	int32_t reserved[9];		// slots start 64-byte aligned
+
+	static size_t size( int _inputs, int _outputs, int _frames )
+	{
+		return sizeof( RemoteAudioRing ) + Slots *
+				( _inputs + _outputs ) * _frames * sizeof( float );
+	}
+
+	float * slot( int32_t _period )
+	{
+		return (float *)( this + 1 ) + ( (uint32_t) _period % Slots ) *
+						( inputs + outputs ) * frames;
+	}
+
+} ;
+
+
+
 class EXPORT RemotePluginBase
 {
 public:
@@ -633,6 +738,30 @@ public:
 
 
 protected:
+	// called by receiveMessage() before waiting for next message - returns
+	// true if there's a period to process in RemoteAudioRing instead
+	virtual bool waitForProcessingRequest()
+	{
+		return false;
+	}
+
+#ifdef LMMS_REMOTE_AUDIO_RING
+	inline void ringRemoteDoorbell()
+	{
+		m_out->ringDoorbell();
+	}
+
+	inline int32_t doorbell() const
+	{
+		return m_in->doorbell();
+	}
+
+	inline void waitForDoorbell( int32_t _seen )
+	{
+		m_in->waitForDoorbell( _seen );
+	}
+#endif
+
 	inline const shmFifo * in() const
 	{
 		return m_in;
@@ -713,6 +842,9 @@ public:
 
 	bool process( const sampleFrame * _in_buf, sampleFrame * _out_buf );
 
+	// frames by which output of process() lags behind its input
+	f_cnt_t latency() const;
+
 	void processMidiEvent( const MidiEvent&, const f_cnt_t _offset );
 
 	void updateSampleRate( sample_rate_t _sr )
@@ -768,6 +900,14 @@ protected:
 private:
 	void resizeSharedProcessingMemory();
 
+	void writeInput( float * _slot, const sampleFrame * _in_buf,
+							fpp_t _frames );
+	void readOutput( const float * _slot, sampleFrame * _out_buf,
+							fpp_t _frames );
+	// waits until remote process completed given period, false if it
+	// died meanwhile
+	bool waitForPeriod( int32_t _period );
+
 
 	bool m_failed;
 
@@ -782,7 +922,11 @@ private:
 	int m_shmID;
 #endif
 	size_t m_shmSize;
-	float * m_shm;
+	RemoteAudioRing * m_shm;
+
+	// return output of previous period, so that remote process can work
+	// in parallel to the rest of the mixer - adds one period of latency
+	bool m_pipelined;
 
 	int m_inputCount;
 	int m_outputCount;
@@ -812,7 +956,7 @@ public:
 	{
 	}
 
-	inline float * sharedMemory()
+	inline RemoteAudioRing * sharedMemory()
 	{
 		return m_shm;
 	}
@@ -835,6 +979,12 @@ public:
 		return m_bufferSize;
 	}
 
+	// frames by which host delays output in addition to buffer size
+	inline int hostLatency() const
+	{
+		return m_shm != NULL && m_shm->remoteWaits ? m_shm->latency : 0;
+	}
+
 	void setInputCount( int _i )
 	{
 		m_inputCount = _i;
@@ -863,6 +1013,10 @@ public:
 	}
 
 
+protected:
+	virtual bool waitForProcessingRequest();
+
+
 private:
 	void setShmKey( key_t _key, int _size );
 	void doProcessing();
@@ -872,7 +1026,7 @@ private:
 	QSharedMemory m_shmQtID;
 #endif
 	VstSyncData * m_vstSyncData;
-	float * m_shm;
+	RemoteAudioRing * m_shm;
 
 	int m_inputCount;
 	int m_outputCount;
@@ -940,6 +1094,11 @@ int RemotePluginBase::sendMessage( const message & _m )
 
 RemotePluginBase::message RemotePluginBase::receiveMessage()
 {
+	if( waitForProcessingRequest() )
+	{
+		return message( IdProcessRingSlot );
+	}
+
 	m_in->waitForMessage();
 	m_in->lock();
 	message m;
@@ -1116,11 +1275,20 @@ bool RemotePluginClient::processMessage( const message & _m )
 			break;
 
 		case IdStartProcessing:
-			doProcessing();
+			// period might have been picked up through
+			// waitForProcessingRequest() already
+			if( m_shm != NULL && m_shm->completed == _m.getInt( 0 ) )
+			{
+				doProcessing();
+			}
 			reply_message.id = IdProcessingDone;
 			reply = true;
 			break;
 
+		case IdProcessRingSlot:
+			doProcessing();
+			break;
+
 		case IdChangeSharedMemoryKey:
 			setShmKey( _m.getInt( 0 ), _m.getInt( 1 ) );
 			break;
@@ -1153,7 +1321,7 @@ void RemotePluginClient::setShmKey( key_t _key, int _size )
 	m_shmObj.setKey( QString::number( _key ) );
 	if( m_shmObj.attach() || m_shmObj.error() == QSharedMemory::NoError )
 	{
-		m_shm = (float *) m_shmObj.data();
+		m_shm = (RemoteAudioRing *) m_shmObj.data();
 	}
 	else
 	{
@@ -1181,7 +1349,10 @@ void RemotePluginClient::setShmKey( key_t _key, int _size )
 	}
 	else
 	{
-		m_shm = (float *) shmat( shm_id, 0, 0 );
+		m_shm = (RemoteAudioRing *) shmat( shm_id, 0, 0 );
+#ifdef LMMS_REMOTE_AUDIO_RING
+		m_shm->remoteWaits = 1;
+#endif
 	}
 #endif
 }
@@ -1189,13 +1360,43 @@ void RemotePluginClient::setShmKey( key_t _key, int _size )
 
 
 
+bool RemotePluginClient::waitForProcessingRequest()
+{
+#ifdef LMMS_REMOTE_AUDIO_RING
+	while( m_shm != NULL && !isInvalid() )
+	{
+		// read doorbell first so that nothing is missed between
+		// checking and waiting
+		const int32_t seen = doorbell();
+		if( messagesLeft() )
+		{
+			return false;
+		}
+		if( m_shm->submitted != m_shm->completed )
+		{
+			return true;
+		}
+		waitForDoorbell( seen );
+	}
+#endif
+	return false;
+}
+
+
+
+
 void RemotePluginClient::doProcessing()
 {
 	if( m_shm != NULL )
 	{
-		process( (sampleFrame *)( m_inputCount > 0 ? m_shm : NULL ),
-				(sampleFrame *)( m_shm +
-					( m_inputCount*m_bufferSize ) ) );
+		float * slot = m_shm->slot( m_shm->completed );
+		process( (sampleFrame *)( m_shm->inputs > 0 ? slot : NULL ),
+				(sampleFrame *)( slot +
+					m_shm->inputs * m_shm->frames ) );
+		__sync_add_and_fetch( &m_shm->completed, 1 );
+#ifdef LMMS_REMOTE_AUDIO_RING
+		futexWake( &m_shm->completed );
+#endif
 	}
 	else
 	{
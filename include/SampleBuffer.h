@@ -26,6 +26,7 @@
 #ifndef SAMPLE_BUFFER_H
 #define SAMPLE_BUFFER_H
 
+#include <QtCore/QAtomicInt>
 #include <QtCore/QReadWriteLock>
 #include <QtCore/QObject>
 #include <QtCore/QRect>
@@ -39,15 +40,18 @@
 #include "shared_object.h"
 #include "Mixer.h"
 #include "MemoryManager.h"
+#include "Resampler.h"
 
 
 class QPainter;
+class SampleStream;
 
-// values for buffer margins, used for various libsamplerate interpolation modes
-// the array positions correspond to the converter_type parameter values in libsamplerate
+// values for buffer margins, used for the interpolation modes of Resampler
+// the array positions correspond to Resampler::Qualities - sinc needs the most
+// as its kernel gets wider when pitching up
 // if there appears problems with playback on some interpolation mode, then the value for that mode
 // may need to be higher - conversely, to optimize, some may work with lower values
-const f_cnt_t MARGIN[] = { 64, 64, 64, 4, 4 };
+const f_cnt_t MARGIN[Resampler::NumQualities] = { 4, 4, 4, Resampler::MaxTaps };
 
 class EXPORT SampleBuffer : public QObject, public sharedObject
 {
@@ -63,7 +67,8 @@ public:
 	{
 		MM_OPERATORS
 	public:
-		handleState( bool _varying_pitch = false, int interpolation_mode = SRC_LINEAR );
+		handleState( bool _varying_pitch = false,
+				Resampler::Qualities interpolation_mode = Resampler::Linear );
 		virtual ~handleState();
 
 		const f_cnt_t frameIndex() const
@@ -86,7 +91,7 @@ public:
 			m_isBackwards = _backwards;
 		}
 		
-		int interpolationMode() const
+		Resampler::Qualities interpolationMode() const
 		{
 			return m_interpolationMode;
 		}
@@ -96,8 +101,14 @@ public:
 		f_cnt_t m_frameIndex;
 		const bool m_varyingPitch;
 		bool m_isBackwards;
-		SRC_STATE * m_resamplingData;
-		int m_interpolationMode;
+		Resampler m_resampler;
+		Resampler::Qualities m_interpolationMode;
+		// pitch ratio up to which a period is resampled in one go
+		static const int FragmentPitchRatio = 8;
+
+		// fragments crossing loop points are assembled here
+		sampleFrame * m_fragment;
+		f_cnt_t m_fragmentFrames;
 
 		friend class SampleBuffer;
 
@@ -151,26 +162,26 @@ public:
 
 	void setLoopStartFrame( f_cnt_t _start )
 	{
-		m_varLock.lockForWrite();
+		beginParamsWrite();
 		m_loopStartFrame = _start;
-		m_varLock.unlock();
+		endParamsWrite();
 	}
 
 	void setLoopEndFrame( f_cnt_t _end )
 	{
-		m_varLock.lockForWrite();
+		beginParamsWrite();
 		m_loopEndFrame = _end;
-		m_varLock.unlock();
+		endParamsWrite();
 	}
 
 	void setAllPointFrames( f_cnt_t _start, f_cnt_t _end, f_cnt_t _loopstart, f_cnt_t _loopend )
 	{
-		m_varLock.lockForWrite();
+		beginParamsWrite();
 		m_startFrame = _start;
 		m_endFrame = _end;
 		m_loopStartFrame = _loopstart;
 		m_loopEndFrame = _loopend;
-		m_varLock.unlock();
+		endParamsWrite();
 	}
 
 	inline f_cnt_t frames() const
@@ -205,23 +216,39 @@ public:
 
 	inline void setFrequency( float _freq )
 	{
-		m_varLock.lockForWrite();
+		beginParamsWrite();
 		m_frequency = _freq;
-		m_varLock.unlock();
+		endParamsWrite();
 	}
 
 	inline void setSampleRate( sample_rate_t _rate )
 	{
-		m_varLock.lockForWrite();
+		beginParamsWrite();
 		m_sampleRate = _rate;
-		m_varLock.unlock();
+		endParamsWrite();
 	}
 
+	// NULL if buffer is streamed from disk
 	inline const sampleFrame * data() const
 	{
 		return m_data;
 	}
 
+	inline bool isStreamed() const
+	{
+		return m_stream != NULL;
+	}
+
+	// allow streaming big files from disk instead of decoding them at
+	// once - only for owners which don't access data() directly
+	void setStreamingAllowed( bool _allowed )
+	{
+		m_streamingAllowed = _allowed;
+	}
+
+	// bytes used for sample data
+	qint64 memoryUsage() const;
+
     QString openAudioFile() const;
     QString openAndSetAudioFile();
 	QString openAndSetWaveformFile();
@@ -271,6 +298,41 @@ public slots:
 
 private:
 	void update( bool _keep_settings = false );
+	void freeData();
+
+	// setters of playback parameters are serialized by m_varLock and
+	// bump m_paramsVersion twice, so that play() can take a consistent
+	// snapshot without locking
+	void beginParamsWrite()
+	{
+		m_varLock.lockForWrite();
+		m_paramsVersion.ref();
+	}
+
+	void endParamsWrite()
+	{
+		m_paramsVersion.ref();
+		m_varLock.unlock();
+	}
+
+	struct PlaybackParams
+	{
+		f_cnt_t startFrame;
+		f_cnt_t endFrame;
+		f_cnt_t loopStartFrame;
+		f_cnt_t loopEndFrame;
+		float amplification;
+		float frequency;
+		sample_rate_t sampleRate;
+	} ;
+
+	void snapshotParams( PlaybackParams & _p ) const;
+	bool doPlay( sampleFrame * _ab, handleState * _state,
+				const fpp_t _frames, const float _freq,
+				const LoopMode _loopmode );
+
+	void visualizeStream( QPainter & _p, const QRect & _dr,
+					f_cnt_t _from_frame, f_cnt_t _to_frame );
 
     void convertIntToFloat ( int_sample_t * & _ibuf, f_cnt_t _frames, int _channels);
     void directFloatWrite ( sample_t * & _fbuf, f_cnt_t _frames, int _channels);
@@ -291,7 +353,15 @@ private:
 	sampleFrame * m_origData;
 	f_cnt_t m_origFrames;
 	sampleFrame * m_data;
+	bool m_dataShared;	// m_data belongs to SampleCache
+	SampleStream * m_stream;
+	bool m_streamingAllowed;
 	QReadWriteLock m_varLock;
+	QAtomicInt m_paramsVersion;
+	// number of play() calls in progress and whether update() waits for
+	// them to finish before replacing data
+	QAtomicInt m_players;
+	QAtomicInt m_updating;
 	f_cnt_t m_frames;
 	f_cnt_t m_startFrame;
 	f_cnt_t m_endFrame;
@@ -302,11 +372,15 @@ private:
 	float m_frequency;
 	sample_rate_t m_sampleRate;
 
-	sampleFrame * getSampleFragment( f_cnt_t _index, f_cnt_t _frames,
+	const sampleFrame * getSampleFragment( f_cnt_t _index, f_cnt_t _frames,
 						LoopMode _loopmode,
-						sampleFrame * * _tmp,
+						sampleFrame * _tmp,
 						bool * _backwards, f_cnt_t _loopstart, f_cnt_t _loopend,
 						f_cnt_t _end ) const;
+	void fetchFrames( sampleFrame * _dst, f_cnt_t _from,
+						f_cnt_t _frames ) const;
+	void fetchFramesBackwards( sampleFrame * _dst, f_cnt_t _from,
+						f_cnt_t _frames ) const;
 	f_cnt_t getLoopedIndex( f_cnt_t _index, f_cnt_t _startf, f_cnt_t _endf  ) const;
 	f_cnt_t getPingPongIndex( f_cnt_t _index, f_cnt_t _startf, f_cnt_t _endf  ) const;
 
@@ -0,0 +1,145 @@
+/*
+ * SampleCache.h - process-wide cache of decoded sample files
+ *
+ * Copyright (c) 2026 agent <agent/at/local>
+ *
+ * This file is part of LMMS - http://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef SAMPLE_CACHE_H
+#define SAMPLE_CACHE_H
+
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QSet>
+#include <QtCore/QString>
+#include <QtCore/QWaitCondition>
+
+#include "export.h"
+#include "lmms_basics.h"
+
+
+class QFile;
+class QFileInfo;
+
+
+// decoded (and resampled) data of sample files, shared by all SampleBuffers
+// loading the same file with the same settings. Data handed out is
+// immutable - buffers needing different data (e.g. reversed) get their own
+// entry. Entries are freed as soon as the last user releases them.
+//
+// Optionally decoded data is also written to a cache directory, so that
+// reopening a project maps the files instead of decoding them again.
+class EXPORT SampleCache
+{
+public:
+	// identifies file by path, size and modification time, so edited
+	// files are decoded again
+	static QString key( const QFileInfo & _file, sample_rate_t _rate,
+							bool _reversed );
+
+	// returns NULL if there's no entry for _key yet
+	static const sampleFrame * acquire( const QString & _key,
+							f_cnt_t & _frames );
+
+	// same as acquire() but if another thread is decoding _key right now
+	// waits for it instead of returning NULL. If nobody is, _key is
+	// reserved for the caller, who then has to insert() or cancel() it
+	static const sampleFrame * acquireOrReserve( const QString & _key,
+							f_cnt_t & _frames );
+
+	// gives up reservation of _key, e.g. because file couldn't be decoded
+	static void cancel( const QString & _key );
+
+	// takes ownership of MM_ALLOC'ed _data and returns data to use
+	// instead - if another thread inserted same key meanwhile, _data is
+	// freed and existing entry returned
+	static const sampleFrame * insert( const QString & _key,
+					sampleFrame * _data, f_cnt_t _frames );
+
+	static void release( const sampleFrame * _data );
+
+	// name of file in disk cache for given source file, derived from its
+	// path, size and modification time without reading it - empty if
+	// disk cache is disabled
+	static QString diskCacheFile( const QFileInfo & _file,
+					sample_rate_t _rate, bool _reversed );
+
+	// maps _diskFile and inserts it as _key, NULL if not cached on disk
+	static const sampleFrame * load( const QString & _key,
+					const QString & _diskFile,
+					f_cnt_t & _frames );
+
+	// writes _data to _diskFile for next time
+	static void store( const QString & _diskFile,
+				const sampleFrame * _data, f_cnt_t _frames );
+
+	static int hits()
+	{
+		return s_hits;
+	}
+
+	static int misses()
+	{
+		return s_misses;
+	}
+
+	// bytes held by cache
+	static qint64 bytes();
+
+	// bytes which would be held additionally without sharing
+	static qint64 savedBytes();
+
+
+private:
+	struct Entry
+	{
+		QString key;
+		sampleFrame * data;
+		f_cnt_t frames;
+		int refs;
+		QFile * mappedFile;	// NULL if data is MM_ALLOC'ed
+		uchar * mapping;
+	} ;
+
+	struct DiskHeader
+	{
+		char magic[4];
+		quint32 version;
+		quint32 channels;
+		quint32 frames;
+		char reserved[48];	// data starts 64-byte aligned
+	} ;
+
+	static Entry * addEntry( const QString & _key, sampleFrame * _data,
+							f_cnt_t _frames );
+
+	static QHash<QString, Entry *> s_entries;
+	static QHash<const sampleFrame *, Entry *> s_entriesByData;
+	static QMutex s_mutex;
+	// keys being decoded right now
+	static QSet<QString> s_pending;
+	static QWaitCondition s_pendingDone;
+	static int s_hits;
+	static int s_misses;
+
+} ;
+
+
+#endif
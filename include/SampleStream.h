@@ -0,0 +1,148 @@
+/*
+ * SampleStream.h - streaming long audio files from disk for SampleBuffer
+ *
+ * Copyright (c) 2026 agent <agent/at/local>
+ *
+ * This file is part of LMMS - http://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef SAMPLE_STREAM_H
+#define SAMPLE_STREAM_H
+
+#include <sndfile.h>
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QAtomicPointer>
+#include <QtCore/QString>
+#include <QtCore/QVector>
+
+#include "lmms_basics.h"
+#include "MemoryManager.h"
+
+
+class SampleStreamLoader;
+
+
+// decoded audio of a file which is too big for being kept in memory - only
+// a bounded number of pages is held at once. The first pages are decoded
+// when opening so playback starts instantly, the others are decoded ahead
+// of the read position by a background thread. Frames are counted at the
+// sample rate of the file.
+class SampleStream
+{
+	MM_OPERATORS
+public:
+	static const f_cnt_t PageFrames = 32768;
+	static const int HeadPages = 2;
+	static const int ReadAheadPages = 4;
+	static const int MaxCachedPages = 32;
+	static const f_cnt_t OverviewFrames = 512;
+
+	// returns NULL if file can't be streamed (only seekable formats
+	// supported by libsndfile can) or loader has been shut down
+	static SampleStream * open( const QString & _file, bool _reversed );
+
+	~SampleStream();
+
+	// stops background thread - call before tearing down memory managers
+	// and when no stream is read anymore. Afterwards open() fails.
+	static void shutdownLoader();
+
+	f_cnt_t frames() const
+	{
+		return m_frames;
+	}
+
+	sample_rate_t sampleRate() const
+	{
+		return m_sampleRate;
+	}
+
+	// copies given frames to _dst and schedules decoding of the following
+	// ones - never blocks, frames which aren't decoded yet are silent and
+	// false is returned then
+	bool read( sampleFrame * _dst, f_cnt_t _from, f_cnt_t _frames );
+
+	// min. and max. value of given frames for drawing - false if
+	// overview isn't computed that far yet
+	bool peak( f_cnt_t _from, f_cnt_t _to, float & _min, float & _max ) const;
+
+	// bytes currently used for decoded frames and overview
+	qint64 memoryUsage() const;
+
+	int underruns() const
+	{
+		return m_underruns;
+	}
+
+
+private:
+	struct Page
+	{
+		QAtomicPointer<sampleFrame> data;
+		QAtomicInt requested;
+		volatile int lastUse;
+	} ;
+
+	SampleStream( SNDFILE * _sndFile, const SF_INFO & _info, bool _reversed );
+
+	// map between frame index as seen by SampleBuffer and in file
+	f_cnt_t fileFrame( f_cnt_t _frame ) const
+	{
+		return m_reversed ? m_frames - 1 - _frame : _frame;
+	}
+
+	bool isPinned( int _page ) const;
+	void request( int _page );
+
+	// called by loader thread only
+	bool loadRequestedPages();
+	void decodePage( int _page );
+	void evictPages();
+	bool buildOverview();
+
+	// set once in open() so audio threads never have to look it up,
+	// cleared by SampleStreamLoader::shutdown()
+	SampleStreamLoader * m_loader;
+
+	SNDFILE * m_sndFile;
+	int m_channels;
+	f_cnt_t m_frames;
+	sample_rate_t m_sampleRate;
+	bool m_reversed;
+
+	int m_numPages;
+	Page * m_pages;
+	float * m_decodeBuffer;
+	volatile int m_residentPages;
+
+	// number of reads in progress, pages are only freed while it's zero
+	QAtomicInt m_readers;
+	QAtomicInt m_clock;
+	QAtomicInt m_underruns;
+
+	QVector<float> m_overview;	// min/max per OverviewFrames frames
+	volatile int m_overviewBlocks;
+
+	friend class SampleStreamLoader;
+
+} ;
+
+
+#endif
@@ -67,6 +67,9 @@ private slots:
 	void setBufferSize( int _value );
 	void resetBufSize();
 	void displayBufSizeHelp();
+	void setLookahead( int _value );
+	void resetLookahead();
+	void displayLookaheadHelp();
 
 	// path settings widget
 	void setWorkingDir( const QString & _wd );
@@ -121,6 +124,10 @@ private:
 	QLabel * m_bufSizeLbl;
 	int m_bufferSize;
 
+	QSlider * m_lookaheadSlider;
+	QLabel * m_lookaheadLbl;
+	int m_lookahead;
+
 	bool m_toolTips;
 	bool m_warnAfterSetup;
 	bool m_displaydBV;
@@ -32,6 +32,7 @@
 #include "AutomatableModel.h"
 #include "Controller.h"
 #include "MeterModel.h"
+#include "ProjectLoader.h"
 #include "VstSyncController.h"
 
 
@@ -220,6 +221,12 @@ public:
 		return m_loadingProject;
 	}
 
+	// timings of last loadProject()
+	const ProjectLoader::Metrics & loadMetrics() const
+	{
+		return m_loadMetrics;
+	}
+
 	bool isModified() const
 	{
 		return m_modified;
@@ -343,6 +350,7 @@ private:
 	volatile bool m_paused;
 
 	bool m_loadingProject;
+	ProjectLoader::Metrics m_loadMetrics;
 
 	PlayModes m_playMode;
 	playPos m_playPos[Mode_Count];
@@ -59,6 +59,22 @@ typedef uint32_t jo_id_t;			// (unique) ID of a journalling object
 #define likely(x)	__builtin_expect((x),1)
 #define unlikely(x)	__builtin_expect((x),0)
 
+// use in busy-wait loops - tells the CPU we're spinning so it doesn't
+// speculate ahead and leaves resources to the other hyperthread
+#if defined(LMMS_HOST_X86) || defined(LMMS_HOST_X86_64)
+#define LMMS_SPIN_PAUSE() asm volatile( "pause" )
+#else
+#define LMMS_SPIN_PAUSE()
+#endif
+
+// thread-local storage for plain data - not every compiler we support knows
+// C++11's thread_local yet
+#ifdef _MSC_VER
+#define LMMS_THREAD_LOCAL __declspec(thread)
+#else
+#define LMMS_THREAD_LOCAL __thread
+#endif
+
 
 template<typename T>
 struct typeInfo
@@ -1,5 +1,6 @@
 #include <QDomDocument>
 #include <QDir>
+#include <QHash>
 #include <QApplication>
 #include <QMessageBox>
 #include <QProgressDialog>
@@ -84,6 +84,8 @@ audioFileProcessor::audioFileProcessor( InstrumentTrack * _instrument_track ) :
 	m_nextPlayStartPoint( 0 ),
 	m_nextPlayBackwards( false )
 {
+	m_sampleBuffer.setStreamingAllowed( true );
+
 	connect( &m_reverseModel, SIGNAL( dataChanged() ),
 				this, SLOT( reverseModelChanged() ) );
 	connect( &m_ampModel, SIGNAL( dataChanged() ),
@@ -101,6 +103,8 @@ audioFileProcessor::audioFileProcessor( InstrumentTrack * _instrument_track ) :
 	m_interpolationModel.addItem( tr( "None" ) );
 	m_interpolationModel.addItem( tr( "Linear" ) );
 	m_interpolationModel.addItem( tr( "Sinc" ) );
+	// appended so that saved projects keep their mode
+	m_interpolationModel.addItem( tr( "Cubic" ) );
 	m_interpolationModel.setValue( 1 );
 	
 	pointChanged();
@@ -141,21 +145,25 @@ void audioFileProcessor::playNote( NotePlayHandle * _n,
 			m_nextPlayStartPoint = m_sampleBuffer.startFrame();
 			m_nextPlayBackwards = false;
 		}
-		// set interpolation mode for libsamplerate
-		int srcmode = SRC_LINEAR;
+		// map items of interpolation box (as saved in projects) to
+		// resampler qualities
+		Resampler::Qualities quality = Resampler::Linear;
 		switch( m_interpolationModel.value() )
 		{
 			case 0:
-				srcmode = SRC_ZERO_ORDER_HOLD;
+				quality = Resampler::Nearest;
 				break;
 			case 1:
-				srcmode = SRC_LINEAR;
+				quality = Resampler::Linear;
 				break;
 			case 2:
-				srcmode = SRC_SINC_MEDIUM_QUALITY;
+				quality = Resampler::Sinc;
+				break;
+			case 3:
+				quality = Resampler::Cubic;
 				break;
 		}
-		_n->m_pluginData = new handleState( _n->hasDetuningInfo(), srcmode );
+		_n->m_pluginData = new handleState( _n->hasDetuningInfo(), quality );
 		((handleState *)_n->m_pluginData)->setFrameIndex( m_nextPlayStartPoint );
 		((handleState *)_n->m_pluginData)->setBackwards( m_nextPlayBackwards );
 
@@ -302,7 +310,7 @@ QString audioFileProcessor::nodeName( void ) const
 int audioFileProcessor::getBeatLen( NotePlayHandle * _n ) const
 {
 	const float freq_factor = BaseFreq / _n->frequency() *
-			Engine::mixer()->processingSampleRate() / Engine::mixer()->baseSampleRate();
+			Engine::mixer()->processingSampleRate() / m_sampleBuffer.sampleRate();
 
 	return static_cast<int>( floorf( ( m_sampleBuffer.endFrame() - m_sampleBuffer.startFrame() ) * freq_factor ) );
 }
@@ -1633,7 +1633,7 @@ intptr_t RemoteVstPlugin::hostCallback( AEffect * _effect, int32_t _opcode,
 
 		case audioMasterGetOutputLatency:
 			SHOW_CALLBACK( "amc: audioMasterGetOutputLatency\n" );
-			return __plugin->bufferSize();
+			return __plugin->bufferSize() + __plugin->hostLatency();
 
 		case audioMasterGetCurrentProcessLevel:
 			SHOW_CALLBACK( "amc: audioMasterGetCurrentProcess"
@@ -1766,7 +1766,8 @@ DWORD WINAPI RemoteVstPlugin::processingThread( LPVOID _param )
 	RemotePluginClient::message m;
 	while( ( m = _this->receiveMessage() ).id != IdQuit )
         {
-		if( m.id == IdStartProcessing || m.id == IdMidiEvent )
+		if( m.id == IdStartProcessing || m.id == IdProcessRingSlot ||
+							m.id == IdMidiEvent )
 		{
 			_this->processMessage( m );
 		}
@@ -53,8 +53,8 @@ AutomatableModel::AutomatableModel( DataType type,
 	m_hasLinkedModels( false ),
 	m_controllerConnection( NULL ),
 	m_valueBuffer( static_cast<int>( Engine::mixer()->framesPerPeriod() ) ),
-	m_lastUpdatedPeriod( -1 ),
-	m_hasSampleExactData( false )
+	m_streamPeriod( -1 ),
+	m_rampBufferPeriod( -1 )
 
 {
 	setInitValue( val );
@@ -516,21 +516,52 @@ float AutomatableModel::controllerValue( int frameOffset ) const
 
 ValueBuffer * AutomatableModel::valueBuffer()
 {
-	// if we've already calculated the valuebuffer this period, return the cached buffer
-	if( m_lastUpdatedPeriod == s_periodCounter )
+	const ParameterStream stream = parameterStream();
+	switch( stream.type() )
 	{
-		return m_hasSampleExactData
-			? &m_valueBuffer
-			: NULL;
+		case ParameterStream::Buffer:
+			return &m_valueBuffer;
+
+		case ParameterStream::Ramp:
+			// only written for consumers which can't handle ramps
+			if( claimPeriod( m_rampBufferPeriod ) )
+			{
+				float * values = m_valueBuffer.values();
+				for( int i = 0; i < m_valueBuffer.length(); i++ )
+				{
+					values[i] = stream.value( i );
+				}
+				publishPeriod( m_rampBufferPeriod );
+			}
+			return &m_valueBuffer;
+
+		default:
+			break;
 	}
-	QMutexLocker m( &m_valueBufferMutex );
-	if( m_lastUpdatedPeriod == s_periodCounter )
+
+	// if we have no sample-exact source for a ValueBuffer, return NULL to signify that no data is available at the moment
+	// in which case the recipient knows to use the static value() instead
+	return NULL;
+}
+
+
+
+
+ParameterStream AutomatableModel::parameterStream()
+{
+	if( claimPeriod( m_streamPeriod ) )
 	{
-		return m_hasSampleExactData
-			? &m_valueBuffer
-			: NULL;
+		m_stream = determineParameterStream();
+		publishPeriod( m_streamPeriod );
 	}
+	return m_stream;
+}
+
 
+
+
+ParameterStream AutomatableModel::determineParameterStream()
+{
 	float val = m_value; // make sure our m_value doesn't change midway
 
 	ValueBuffer * vb;
@@ -560,9 +591,7 @@ ValueBuffer * AutomatableModel::valueBuffer()
 					"lacks implementation for a scale type");
 				break;
 			}
-			m_lastUpdatedPeriod = s_periodCounter;
-			m_hasSampleExactData = true;
-			return &m_valueBuffer;
+			return ParameterStream::buffer( nvalues );
 		}
 	}
 	AutomatableModel* lm = NULL;
@@ -579,25 +608,50 @@ ValueBuffer * AutomatableModel::valueBuffer()
 		{
 			nvalues[i] = fittedValue( values[i], false );
 		}
-		m_lastUpdatedPeriod = s_periodCounter;
-		m_hasSampleExactData = true;
-		return &m_valueBuffer;
+		return ParameterStream::buffer( nvalues );
 	}
 	
 	if( m_oldValue != val )
 	{
-		m_valueBuffer.interpolate( m_oldValue, val );
+		const ParameterStream stream = ParameterStream::ramp( m_oldValue, val,
+							m_valueBuffer.length() );
 		m_oldValue = val;
-		m_lastUpdatedPeriod = s_periodCounter;
-		m_hasSampleExactData = true;
-		return &m_valueBuffer;
+		return stream;
 	}
-	
-	// if we have no sample-exact source for a ValueBuffer, return NULL to signify that no data is available at the moment
-	// in which case the recipient knows to use the static value() instead
-	m_lastUpdatedPeriod = s_periodCounter;
-	m_hasSampleExactData = false;
-	return NULL;
+
+	return ParameterStream::constant( value<float>() );
+}
+
+
+
+
+bool AutomatableModel::claimPeriod( QAtomicInt & period )
+{
+	// only used while claiming, so never equal to a period
+	const int Busy = -2;
+
+	const int current = static_cast<int>( s_periodCounter );
+	while( true )
+	{
+		const int p = period;
+		if( p == current )
+		{
+			return false;
+		}
+		// if another thread is busy with it, it won't take long
+		if( p != Busy && period.testAndSetAcquire( p, Busy ) )
+		{
+			return true;
+		}
+	}
+}
+
+
+
+
+void AutomatableModel::publishPeriod( QAtomicInt & period )
+{
+	period.fetchAndStoreRelease( static_cast<int>( s_periodCounter ) );
 }
 
 
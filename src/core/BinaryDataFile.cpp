@@ -0,0 +1,628 @@
+/*
+ * BinaryDataFile.cpp - compact chunked binary encoding of DataFiles
+ *
+ * Copyright (c) 2026 agent <agent/at/local>
+ *
+ * This file is part of LMMS - http://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "BinaryDataFile.h"
+
+#include <cstring>
+
+#include <QtCore/QHash>
+#include <QtCore/QRunnable>
+#include <QtCore/QThread>
+#include <QtCore/QThreadPool>
+#include <QtXml/QDomProcessingInstruction>
+
+
+static const char Magic[4] = { 'L', 'M', 'P', 'B' };
+static const quint8 FormatVersion = 1;
+// magic, version, 3 reserved bytes and number of chunks
+static const int HeaderSize = 12;
+
+// elements which get a chunk of their own
+static const char * ChunkedElement = "track";
+
+
+
+
+static void writeNumber( QByteArray & _out, quint32 _n )
+{
+	while( _n >= 0x80 )
+	{
+		_out.append( (char)( ( _n & 0x7f ) | 0x80 ) );
+		_n >>= 7;
+	}
+	_out.append( (char) _n );
+}
+
+
+
+
+static bool readNumber( const QByteArray & _in, int & _pos, quint32 & _n )
+{
+	_n = 0;
+	for( int shift = 0; shift < 35; shift += 7 )
+	{
+		if( _pos >= _in.size() )
+		{
+			return false;
+		}
+		const quint8 b = _in[_pos++];
+		_n |= (quint32)( b & 0x7f ) << shift;
+		if( !( b & 0x80 ) )
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+
+
+
+static void writeUInt32( QByteArray & _out, quint32 _n )
+{
+	for( int i = 0; i < 4; ++i )
+	{
+		_out.append( (char)( ( _n >> ( i * 8 ) ) & 0xff ) );
+	}
+}
+
+
+
+
+static quint32 readUInt32( const char * _in )
+{
+	quint32 n = 0;
+	for( int i = 0; i < 4; ++i )
+	{
+		n |= (quint32)(quint8) _in[i] << ( i * 8 );
+	}
+	return n;
+}
+
+
+
+
+// compresses chunks when saving, decompresses and decodes them when loading
+class BinaryDataFile::ChunkJob : public QRunnable
+{
+public:
+	ChunkJob( const QByteArray & _in, QByteArray * _compressed,
+							Chunk * _chunk ) :
+		m_in( _in ),
+		m_compressed( _compressed ),
+		m_chunk( _chunk )
+	{
+	}
+
+	virtual void run()
+	{
+		if( m_chunk != NULL )
+		{
+			m_chunk->valid = decodeChunk( qUncompress( m_in ),
+								*m_chunk );
+		}
+		else
+		{
+			*m_compressed = qCompress( m_in );
+		}
+	}
+
+
+private:
+	QByteArray m_in;
+	QByteArray * m_compressed;
+	Chunk * m_chunk;
+
+} ;
+
+
+
+
+// runs jobs on a pool of its own, so we don't wait for unrelated ones
+static void runJobs( const QVector<QRunnable *> & _jobs )
+{
+	if( _jobs.size() == 1 )
+	{
+		_jobs.first()->run();
+		delete _jobs.first();
+		return;
+	}
+
+	QThreadPool pool;
+	pool.setMaxThreadCount( QThread::idealThreadCount() );
+	foreach( QRunnable * job, _jobs )
+	{
+		pool.start( job );
+	}
+	pool.waitForDone();
+}
+
+
+
+
+class BinaryDataFile::Encoder
+{
+public:
+	Encoder() :
+		m_failed( false )
+	{
+	}
+
+	QByteArray encode( const QDomDocument & _doc )
+	{
+		m_chunks.append( QByteArray() );
+		const QByteArray root = encodeChunk( _doc );
+		if( m_failed )
+		{
+			return QByteArray();
+		}
+		m_chunks[0] = root;
+
+		// compress chunks in parallel
+		QVector<QByteArray> compressed( m_chunks.size() );
+		QVector<QRunnable *> jobs;
+		for( int i = 0; i < m_chunks.size(); ++i )
+		{
+			jobs.append( new ChunkJob( m_chunks[i], &compressed[i],
+									NULL ) );
+		}
+		runJobs( jobs );
+
+		QByteArray out;
+		out.append( Magic, sizeof( Magic ) );
+		out.append( (char) FormatVersion );
+		out.append( QByteArray( 3, 0 ) );
+		writeUInt32( out, compressed.size() );
+		foreach( const QByteArray & c, compressed )
+		{
+			writeUInt32( out, c.size() );
+		}
+		foreach( const QByteArray & c, compressed )
+		{
+			out.append( c );
+		}
+		return out;
+	}
+
+
+private:
+	// strings and nodes of chunk being encoded
+	struct ChunkWriter
+	{
+		QHash<QString, quint32> stringIndex;
+		QVector<QString> strings;
+		QByteArray nodes;
+
+		void writeString( const QString & _s )
+		{
+			QHash<QString, quint32>::ConstIterator it =
+						stringIndex.constFind( _s );
+			if( it != stringIndex.constEnd() )
+			{
+				writeNumber( nodes, *it );
+				return;
+			}
+			const quint32 idx = strings.size();
+			stringIndex[_s] = idx;
+			strings.append( _s );
+			writeNumber( nodes, idx );
+		}
+	} ;
+
+	// the document's type goes first as the loader has to create the
+	// document from it - only its name is stored, so refuse anything else
+	QByteArray encodeChunk( const QDomDocument & _doc )
+	{
+		const QDomDocumentType docType = _doc.doctype();
+		if( !docType.publicId().isEmpty() ||
+					!docType.systemId().isEmpty() )
+		{
+			m_failed = true;
+			return QByteArray();
+		}
+
+		ChunkWriter w;
+		w.writeString( docType.name() );
+		QVector<QDomNode> nodes;
+		for( QDomNode n = _doc.firstChild(); !n.isNull();
+							n = n.nextSibling() )
+		{
+			if( !n.isDocumentType() )
+			{
+				nodes.append( n );
+			}
+		}
+		writeNumber( w.nodes, nodes.size() );
+		foreach( const QDomNode & n, nodes )
+		{
+			encodeNode( w, n, true, 1 );
+		}
+		return finishChunk( w );
+	}
+
+	QByteArray encodeChunk( const QDomElement & _element, int _depth )
+	{
+		ChunkWriter w;
+		writeNumber( w.nodes, 1 );
+		encodeNode( w, _element, true, _depth );
+		return finishChunk( w );
+	}
+
+	// string table goes first so the loader can decode it in one go
+	static QByteArray finishChunk( const ChunkWriter & _w )
+	{
+		QByteArray chunk;
+		writeNumber( chunk, _w.strings.size() );
+		foreach( const QString & s, _w.strings )
+		{
+			const QByteArray utf8 = s.toUtf8();
+			writeNumber( chunk, utf8.size() );
+			chunk.append( utf8 );
+		}
+		chunk.append( _w.nodes );
+		return chunk;
+	}
+
+	void encodeNode( ChunkWriter & _w, const QDomNode & _node,
+						bool _chunkRoot, int _depth )
+	{
+		if( _depth > MaxDepth )
+		{
+			// decoder wouldn't accept it
+			m_failed = true;
+			return;
+		}
+
+		if( _node.isElement() )
+		{
+			const QDomElement e = _node.toElement();
+			if( !_chunkRoot && e.tagName() == ChunkedElement )
+			{
+				// reserve index before encoding the chunk as
+				// it may contain chunks itself
+				const int idx = m_chunks.size();
+				m_chunks.append( QByteArray() );
+				const QByteArray chunk = encodeChunk( e, _depth );
+				m_chunks[idx] = chunk;
+				_w.nodes.append( (char) ChunkNode );
+				writeNumber( _w.nodes, idx );
+				return;
+			}
+
+			_w.nodes.append( (char) ElementNode );
+			_w.writeString( e.tagName() );
+			const QDomNamedNodeMap attrs = e.attributes();
+			writeNumber( _w.nodes, attrs.count() );
+			for( int i = 0; i < attrs.count(); ++i )
+			{
+				const QDomAttr a = attrs.item( i ).toAttr();
+				_w.writeString( a.name() );
+				_w.writeString( a.value() );
+			}
+			const QDomNodeList children = e.childNodes();
+			writeNumber( _w.nodes, children.count() );
+			for( int i = 0; i < children.count(); ++i )
+			{
+				encodeNode( _w, children.item( i ), false,
+								_depth + 1 );
+			}
+		}
+		else if( _node.isCDATASection() )
+		{
+			_w.nodes.append( (char) CDataNode );
+			_w.writeString( _node.nodeValue() );
+		}
+		else if( _node.isText() )
+		{
+			_w.nodes.append( (char) TextNode );
+			_w.writeString( _node.nodeValue() );
+		}
+		else if( _node.isComment() )
+		{
+			_w.nodes.append( (char) CommentNode );
+			_w.writeString( _node.nodeValue() );
+		}
+		else if( _node.isProcessingInstruction() )
+		{
+			const QDomProcessingInstruction pi =
+					_node.toProcessingInstruction();
+			_w.nodes.append( (char) ProcessingInstructionNode );
+			_w.writeString( pi.target() );
+			_w.writeString( pi.data() );
+		}
+		else
+		{
+			// entity references etc. - not used by us and there's
+			// no way to store them, so don't write a file which
+			// would load differently
+			m_failed = true;
+		}
+	}
+
+	QVector<QByteArray> m_chunks;
+	bool m_failed;
+
+} ;
+
+
+
+
+class BinaryDataFile::Decoder
+{
+public:
+	Decoder( QDomDocument & _doc, const QVector<Chunk> & _chunks ) :
+		m_doc( _doc ),
+		m_chunks( _chunks ),
+		m_used( _chunks.size(), false )
+	{
+	}
+
+	bool decode()
+	{
+		if( m_chunks.isEmpty() || !m_chunks[0].valid )
+		{
+			return false;
+		}
+		m_used[0] = true;
+
+		int pos = 0;
+		QString docType;
+		if( !readString( m_chunks[0], pos, docType ) )
+		{
+			return false;
+		}
+		m_doc = QDomDocument( docType );
+		return decodeNodes( m_chunks[0], pos, m_doc, 1 );
+	}
+
+
+private:
+	bool decodeChunk( quint32 _idx, QDomNode _parent, int _depth )
+	{
+		// every chunk is referred to once, anything else is broken
+		if( _idx >= (quint32) m_chunks.size() || m_used[_idx] ||
+						!m_chunks[_idx].valid )
+		{
+			return false;
+		}
+		m_used[_idx] = true;
+
+		int pos = 0;
+		return decodeNodes( m_chunks[_idx], pos, _parent, _depth );
+	}
+
+	bool decodeNodes( const Chunk & _c, int & _pos, QDomNode _parent,
+								int _depth )
+	{
+		quint32 count;
+		if( !readNumber( _c.nodes, _pos, count ) )
+		{
+			return false;
+		}
+		for( quint32 i = 0; i < count; ++i )
+		{
+			if( !decodeNode( _c, _pos, _parent, _depth ) )
+			{
+				return false;
+			}
+		}
+		return _pos == _c.nodes.size();
+	}
+
+	bool readString( const Chunk & _c, int & _pos, QString & _s )
+	{
+		quint32 idx;
+		if( !readNumber( _c.nodes, _pos, idx ) ||
+					idx >= (quint32) _c.strings.size() )
+		{
+			return false;
+		}
+		_s = _c.strings[idx];
+		return true;
+	}
+
+	bool decodeNode( const Chunk & _c, int & _pos, QDomNode & _parent,
+								int _depth )
+	{
+		if( _pos >= _c.nodes.size() || _depth > MaxDepth )
+		{
+			return false;
+		}
+		const int type = _c.nodes[_pos++];
+		QString s;
+		QString t;
+		quint32 n;
+		switch( type )
+		{
+			case ElementNode:
+			{
+				if( !readString( _c, _pos, s ) ||
+					!readNumber( _c.nodes, _pos, n ) )
+				{
+					return false;
+				}
+				QDomElement e = m_doc.createElement( s );
+				for( quint32 i = 0; i < n; ++i )
+				{
+					if( !readString( _c, _pos, s ) ||
+						!readString( _c, _pos, t ) )
+					{
+						return false;
+					}
+					e.setAttribute( s, t );
+				}
+				if( !readNumber( _c.nodes, _pos, n ) )
+				{
+					return false;
+				}
+				QDomNode node = _parent.appendChild( e );
+				for( quint32 i = 0; i < n; ++i )
+				{
+					if( !decodeNode( _c, _pos, node,
+								_depth + 1 ) )
+					{
+						return false;
+					}
+				}
+				return true;
+			}
+			case TextNode:
+				if( !readString( _c, _pos, s ) )
+				{
+					return false;
+				}
+				_parent.appendChild( m_doc.createTextNode( s ) );
+				return true;
+			case CDataNode:
+				if( !readString( _c, _pos, s ) )
+				{
+					return false;
+				}
+				_parent.appendChild( m_doc.createCDATASection( s ) );
+				return true;
+			case CommentNode:
+				if( !readString( _c, _pos, s ) )
+				{
+					return false;
+				}
+				_parent.appendChild( m_doc.createComment( s ) );
+				return true;
+			case ProcessingInstructionNode:
+				if( !readString( _c, _pos, s ) ||
+						!readString( _c, _pos, t ) )
+				{
+					return false;
+				}
+				_parent.appendChild(
+				m_doc.createProcessingInstruction( s, t ) );
+				return true;
+			case ChunkNode:
+				return readNumber( _c.nodes, _pos, n ) &&
+					decodeChunk( n, _parent, _depth );
+			default:
+				break;
+		}
+		return false;
+	}
+
+	QDomDocument & m_doc;
+	const QVector<Chunk> & m_chunks;
+	QVector<bool> m_used;
+
+} ;
+
+
+
+
+bool BinaryDataFile::isBinary( const QByteArray & _data )
+{
+	return _data.size() >= HeaderSize &&
+			memcmp( _data.constData(), Magic, sizeof( Magic ) ) == 0;
+}
+
+
+
+
+QByteArray BinaryDataFile::encode( const QDomDocument & _doc )
+{
+	return Encoder().encode( _doc );
+}
+
+
+
+
+bool BinaryDataFile::decode( const QByteArray & _data, QDomDocument & _doc )
+{
+	if( !isBinary( _data ) || (quint8) _data[4] > FormatVersion )
+	{
+		return false;
+	}
+
+	const quint32 count = readUInt32( _data.constData() + 8 );
+	if( count == 0 || (qint64) HeaderSize + (qint64) count * 4 >
+							_data.size() )
+	{
+		return false;
+	}
+
+	// split up chunks
+	QVector<QByteArray> compressed;
+	qint64 offset = HeaderSize + count * 4;
+	for( quint32 i = 0; i < count; ++i )
+	{
+		const quint32 size = readUInt32( _data.constData() +
+							HeaderSize + i * 4 );
+		if( offset + size > _data.size() )
+		{
+			return false;
+		}
+		compressed.append( _data.mid( offset, size ) );
+		offset += size;
+	}
+
+	QVector<Chunk> chunks( count );
+	QVector<QRunnable *> jobs;
+	for( quint32 i = 0; i < count; ++i )
+	{
+		jobs.append( new ChunkJob( compressed[i], NULL, &chunks[i] ) );
+	}
+	runJobs( jobs );
+
+	if( !Decoder( _doc, chunks ).decode() )
+	{
+		_doc.clear();
+		return false;
+	}
+	return true;
+}
+
+
+
+
+bool BinaryDataFile::decodeChunk( const QByteArray & _data, Chunk & _chunk )
+{
+	int pos = 0;
+	quint32 count;
+	if( !readNumber( _data, pos, count ) )
+	{
+		return false;
+	}
+
+	_chunk.strings.reserve( qMin<quint32>( count, _data.size() ) );
+	for( quint32 i = 0; i < count; ++i )
+	{
+		quint32 len;
+		if( !readNumber( _data, pos, len ) ||
+				(qint64) pos + len > _data.size() )
+		{
+			return false;
+		}
+		_chunk.strings.append( QString::fromUtf8(
+					_data.constData() + pos, len ) );
+		pos += len;
+	}
+
+	_chunk.nodes = _data.mid( pos );
+	return true;
+}
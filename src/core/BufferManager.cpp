@@ -25,86 +25,218 @@
 
 #include "BufferManager.h"
 
+#include <string.h>
 
-sampleFrame ** BufferManager::s_available;
-QAtomicInt BufferManager::s_availableIndex = 0;
-sampleFrame ** BufferManager::s_released;
-QAtomicInt BufferManager::s_releasedIndex = 0;
-//QReadWriteLock BufferManager::s_mutex;
-int BufferManager::s_size;
 
-
-void BufferManager::init( fpp_t framesPerPeriod )
+// per-thread stack of buffers - acquire() and release() only have to
+// touch the shared pool when it runs empty or full
+class BufferManager::ThreadCache
 {
-	s_available = MM_ALLOC( sampleFrame*, BM_INITIAL_BUFFERS );
-	s_released = MM_ALLOC( sampleFrame*, BM_INITIAL_BUFFERS );
+public:
+	ThreadCache() :
+		m_count( 0 )
+	{
+	}
 
-	int c = framesPerPeriod * BM_INITIAL_BUFFERS;
-	sampleFrame * b = MM_ALLOC( sampleFrame, c );
-	
-	for( int i = 0; i < BM_INITIAL_BUFFERS; ++i )
+	~ThreadCache()
 	{
-		s_available[ i ] = b;
-		b += framesPerPeriod;
+		// thread is going away, hand back its buffers
+		if( m_count > 0 )
+		{
+			BufferManager::giveBack( m_buffers, m_count );
+		}
 	}
-	s_availableIndex = BM_INITIAL_BUFFERS - 1;
-	s_size = BM_INITIAL_BUFFERS;
+
+	sampleFrame * m_buffers[BM_CACHE_SIZE];
+	int m_count;
+} ;
+
+
+QThreadStorage<BufferManager::ThreadCache *> BufferManager::s_threadCaches;
+sampleFrame ** BufferManager::s_available = NULL;
+int BufferManager::s_availableCount = 0;
+int BufferManager::s_capacity = 0;
+QAtomicInt BufferManager::s_lock = 0;
+fpp_t BufferManager::s_framesPerPeriod = 0;
+int BufferManager::s_size = 0;
+int BufferManager::s_minAvailable = 0;
+QAtomicInt BufferManager::s_extensions( 0 );
+
+
+void BufferManager::init( fpp_t framesPerPeriod )
+{
+	s_framesPerPeriod = framesPerPeriod;
+
+	grow( BM_INITIAL_BUFFERS );
+
+	lock();
+	s_minAvailable = s_availableCount;
+	unlock();
 }
 
 
 sampleFrame * BufferManager::acquire()
 {
-	if( s_availableIndex < 0 )
+	ThreadCache * cache = threadCache();
+	if( cache->m_count == 0 )
 	{
-		qFatal( "BufferManager: out of buffers" );
+		fetch( cache->m_buffers, BM_CACHE_BATCH );
+		cache->m_count = BM_CACHE_BATCH;
 	}
-	
-	int i = s_availableIndex.fetchAndAddOrdered( -1 );
-	sampleFrame * b = s_available[ i ];
-	
-	//qDebug( "acquired buffer: %p - index %d", b, i );
-	return b;
+
+	return cache->m_buffers[--cache->m_count];
 }
 
 
 void BufferManager::release( sampleFrame * buf )
 {
-	int i = s_releasedIndex.fetchAndAddOrdered( 1 );
-	s_released[ i ] = buf;
-	//qDebug( "released buffer: %p - index %d", buf, i );
+	ThreadCache * cache = threadCache();
+	if( cache->m_count == BM_CACHE_SIZE )
+	{
+		cache->m_count -= BM_CACHE_BATCH;
+		giveBack( cache->m_buffers + cache->m_count, BM_CACHE_BATCH );
+	}
+
+	cache->m_buffers[cache->m_count++] = buf;
 }
 
 
-void BufferManager::refresh() // non-threadsafe, hence it's called periodically from mixer at a time when no other threads can interfere
+void BufferManager::extend( int c )
 {
-	if( s_releasedIndex == 0 ) return;
-	//qDebug( "refresh: %d buffers", int( s_releasedIndex ) );
-	
-	int j = s_availableIndex;
-	for( int i = 0; i < s_releasedIndex; ++i )
+	grow( c );
+	s_extensions.fetchAndAddOrdered( 1 );
+}
+
+
+int BufferManager::size()
+{
+	return s_size;
+}
+
+
+int BufferManager::peakUsage()
+{
+	return s_size - s_minAvailable;
+}
+
+
+int BufferManager::extensions()
+{
+	return s_extensions;
+}
+
+
+void BufferManager::resetPeakUsage()
+{
+	lock();
+	s_minAvailable = s_availableCount;
+	unlock();
+}
+
+
+BufferManager::ThreadCache * BufferManager::threadCache()
+{
+	ThreadCache * cache = s_threadCaches.localData();
+	if( cache == NULL )
 	{
-		++j;
-		s_available[ j ] = s_released[ i ];
+		cache = new ThreadCache;
+		s_threadCaches.setLocalData( cache );
 	}
-	s_availableIndex = j;
-	s_releasedIndex = 0;
+	return cache;
 }
 
 
-/* // non-extensible for now
-void BufferManager::extend( int c )
+void BufferManager::fetch( sampleFrame * * bufs, int c )
 {
-	s_size += c;
-	sampleFrame ** tmp = MM_ALLOC( sampleFrame*, s_size );
-	MM_FREE( s_available );
-	s_available = tmp;
+	lock();
+	while( s_availableCount < c )
+	{
+		// rather grow than run dry in the middle of a period - other
+		// threads may take buffers while we allocate, so check again
+		// afterwards. No logging here, we're in a realtime thread -
+		// extensions() gets reported by the profiler
+		unlock();
+		extend( qMax( BM_INCREMENT, c ) );
+		lock();
+	}
+
+	s_availableCount -= c;
+	memcpy( bufs, s_available + s_availableCount, sizeof( sampleFrame * ) * c );
+
+	if( s_availableCount < s_minAvailable )
+	{
+		s_minAvailable = s_availableCount;
+	}
+	unlock();
+}
+
+
+void BufferManager::giveBack( sampleFrame * * bufs, int c )
+{
+	lock();
+	memcpy( s_available + s_availableCount, bufs, sizeof( sampleFrame * ) * c );
+	s_availableCount += c;
+	unlock();
+}
+
+
+void BufferManager::grow( int c )
+{
+	// nothing gets allocated or freed while holding the lock, so threads
+	// spinning for it never wait for the allocator
+	sampleFrame * b = MM_ALLOC( sampleFrame, s_framesPerPeriod * c );
+
+	lock();
+	// the shared pool has to be able to hold all buffers at once
+	while( s_size + c > s_capacity )
+	{
+		const int capacity = qMax( s_capacity * 2, s_size + c );
+		unlock();
+
+		sampleFrame ** available = MM_ALLOC( sampleFrame*, capacity );
+
+		lock();
+		// somebody else might have grown the pool meanwhile
+		if( capacity > s_capacity )
+		{
+			if( s_available )
+			{
+				memcpy( available, s_available, sizeof( sampleFrame * ) * s_availableCount );
+			}
+			qSwap( available, s_available );
+			s_capacity = capacity;
+		}
+		unlock();
+
+		if( available )
+		{
+			MM_FREE( available );
+		}
+
+		lock();
+	}
 
-	int cc = c * Engine::mixer()->framesPerPeriod();
-	sampleFrame * b = MM_ALLOC( sampleFrame, cc );
-	
 	for( int i = 0; i < c; ++i )
 	{
-		s_available[ s_availableIndex.fetchAndAddOrdered( 1 ) + 1 ] = b;
-		b += Engine::mixer()->framesPerPeriod();
+		s_available[s_availableCount++] = b;
+		b += s_framesPerPeriod;
+	}
+	s_size += c;
+	unlock();
+}
+
+
+void BufferManager::lock()
+{
+	while( !s_lock.testAndSetAcquire( 0, 1 ) )
+	{
+		// critical sections are a few memcpy()s only, so just spin
+		LMMS_SPIN_PAUSE();
 	}
-}*/
+}
+
+
+void BufferManager::unlock()
+{
+	s_lock.fetchAndStoreRelease( 0 );
+}
@@ -35,6 +35,7 @@
 #include <QMessageBox>
 
 
+#include "BinaryDataFile.h"
 #include "ConfigManager.h"
 #include "ProjectVersion.h"
 #include "SongEditor.h"
@@ -168,7 +169,8 @@ QString DataFile::nameWithExtension( const QString & _fn ) const
 		case SongProject:
 			if( _fn.section( '.', -1 ) != "mmp" &&
 					_fn.section( '.', -1 ) != "mpt" &&
-					_fn.section( '.', -1 ) != "mmpz" )
+					_fn.section( '.', -1 ) != "mmpz" &&
+					_fn.section( '.', -1 ) != "mmpb" )
 			{
 				if( ConfigManager::inst()->value( "app",
 						"nommpz" ).toInt() == 0 )
@@ -199,14 +201,22 @@ QString DataFile::nameWithExtension( const QString & _fn ) const
 
 
 void DataFile::write( QTextStream & _strm )
+{
+	prepareForWriting();
+
+	save(_strm, 2);
+}
+
+
+
+
+void DataFile::prepareForWriting()
 {
 	if( type() == SongProject || type() == SongProjectTemplate
 					|| type() == InstrumentTrackSettings )
 	{
 		cleanMetaNodes( documentElement() );
 	}
-
-	save(_strm, 2);
 }
 
 
@@ -237,6 +247,13 @@ bool DataFile::writeFile( const QString& filename )
 		write( ts );
 		outfile.write( qCompress( xml.toUtf8() ) );
 	}
+	else if( fullName.section( '.', -1 ) == "mmpb" )
+	{
+		prepareForWriting();
+		// nothing is written if document can't be stored losslessly,
+		// so the size check below fails
+		outfile.write( BinaryDataFile::encode( *this ) );
+	}
 	else
 	{
 		QTextStream ts( &outfile );
@@ -754,7 +771,21 @@ void DataFile::loadData( const QByteArray & _data, const QString & _sourceFile )
 {
 	QString errorMsg;
 	int line = -1, col = -1;
-	if( !setContent( _data, &errorMsg, &line, &col ) )
+	if( BinaryDataFile::isBinary( _data ) )
+	{
+		if( !BinaryDataFile::decode( _data, *this ) )
+		{
+			qWarning() << "invalid binary data in" << _sourceFile;
+			QMessageBox::critical( NULL,
+				SongEditor::tr( "Error in file" ),
+				SongEditor::tr( "The file %1 seems to contain "
+						"errors and therefore can't be "
+						"loaded." ).
+							arg( _sourceFile ) );
+			return;
+		}
+	}
+	else if( !setContent( _data, &errorMsg, &line, &col ) )
 	{
 		// parsing failed? then try to uncompress data
 		QByteArray uncompressed = qUncompress( _data );
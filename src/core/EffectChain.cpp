@@ -29,6 +29,7 @@
 #include "EffectChain.h"
 #include "Effect.h"
 #include "Engine.h"
+#include "Mixer.h"
 #include "debug.h"
 #include "DummyEffect.h"
 #include "MixHelpers.h"
@@ -206,6 +207,8 @@ bool EffectChain::processAudioBuffer( sampleFrame * _buf, const fpp_t _frames, b
 	{
 		if( hasInputNoise || ( *it )->isRunning() )
 		{
+			MixerProfiler::Probe probe( Engine::mixer()->profiler(),
+						MixerProfiler::EffectEntry, *it );
 			moreEffects |= ( *it )->processAudioBuffer( _buf, _frames );
 			if( exporting ) // strip infs/nans if exporting
 			{
@@ -48,7 +48,7 @@ void EnvelopeAndLfoParameters::LfoInstances::trigger()
 	{
 		( *it )->m_lfoFrame +=
 				Engine::mixer()->framesPerPeriod();
-		( *it )->m_bad_lfoShapeData = true;
+		( *it )->updateLfoShapeData();
 	}
 }
 
@@ -62,7 +62,7 @@ void EnvelopeAndLfoParameters::LfoInstances::reset()
 							it != m_lfos.end(); ++it )
 	{
 		( *it )->m_lfoFrame = 0;
-		( *it )->m_bad_lfoShapeData = true;
+		( *it )->updateLfoShapeData();
 	}
 }
 
@@ -122,13 +122,6 @@ EnvelopeAndLfoParameters::EnvelopeAndLfoParameters(
 	m_amountModel.setCenterValue( 0 );
 	m_lfoAmountModel.setCenterValue( 0 );
 
-	if( s_lfoInstances == NULL )
-	{
-		s_lfoInstances = new LfoInstances();
-	}
-
-	instances()->add( this );
-
 	connect( &m_predelayModel, SIGNAL( dataChanged() ),
 			this, SLOT( updateSampleVars() ) );
 	connect( &m_attackModel, SIGNAL( dataChanged() ),
@@ -165,6 +158,16 @@ EnvelopeAndLfoParameters::EnvelopeAndLfoParameters(
 		new sample_t[Engine::mixer()->framesPerPeriod()];
 
 	updateSampleVars();
+	updateLfoShapeData();
+
+	// from now on the mixer updates the LFO shape, so only add when
+	// everything is set up
+	if( s_lfoInstances == NULL )
+	{
+		s_lfoInstances = new LfoInstances();
+	}
+
+	instances()->add( this );
 }
 
 
@@ -240,14 +243,58 @@ inline sample_t EnvelopeAndLfoParameters::lfoShapeSample( fpp_t _frame_offset )
 
 
 
+template<sample_t ( * SHAPE )( const float )>
+void EnvelopeAndLfoParameters::fillLfoShapeData( const fpp_t _frames )
+{
+	const float oscFramesI = 1.0f / m_lfoOscillationFrames;
+	f_cnt_t frame = m_lfoFrame % m_lfoOscillationFrames;
+	for( fpp_t offset = 0; offset < _frames; ++offset )
+	{
+		m_lfoShapeData[offset] = SHAPE( frame * oscFramesI ) * m_lfoAmount;
+		if( ++frame >= m_lfoOscillationFrames )
+		{
+			frame = 0;
+		}
+	}
+}
+
+
+
+
+// called by the mixer between periods, so voices only ever read the shape
+// and don't need to synchronize
 void EnvelopeAndLfoParameters::updateLfoShapeData()
 {
+	if( m_lfoAmountIsZero )
+	{
+		return;
+	}
+
 	const fpp_t frames = Engine::mixer()->framesPerPeriod();
-	for( fpp_t offset = 0; offset < frames; ++offset )
+	// select shape once instead of per frame
+	switch( m_lfoWaveModel.value() )
 	{
-		m_lfoShapeData[offset] = lfoShapeSample( offset );
+		case TriangleWave:
+			fillLfoShapeData<&Oscillator::triangleSample>( frames );
+			break;
+		case SquareWave:
+			fillLfoShapeData<&Oscillator::squareSample>( frames );
+			break;
+		case SawWave:
+			fillLfoShapeData<&Oscillator::sawSample>( frames );
+			break;
+		case UserDefinedWave:
+		case RandomWave:
+			for( fpp_t offset = 0; offset < frames; ++offset )
+			{
+				m_lfoShapeData[offset] = lfoShapeSample( offset );
+			}
+			break;
+		case SineWave:
+		default:
+			fillLfoShapeData<&Oscillator::sinSample>( frames );
+			break;
 	}
-	m_bad_lfoShapeData = false;
 }
 
 
@@ -267,11 +314,6 @@ inline void EnvelopeAndLfoParameters::fillLfoLevel( float * _buf,
 	}
 	_frame -= m_lfoPredelayFrames;
 
-	if( m_bad_lfoShapeData )
-	{
-		updateLfoShapeData();
-	}
-
 	fpp_t offset = 0;
 	const float lafI = 1.0f / m_lfoAttackFrames;
 	for( ; offset < _frames && _frame < m_lfoAttackFrames; ++offset,
@@ -299,35 +341,79 @@ void EnvelopeAndLfoParameters::fillLevel( float * _buf, f_cnt_t _frame,
 
 	fillLfoLevel( _buf, _frame, _frames );
 
-	for( fpp_t offset = 0; offset < _frames; ++offset, ++_buf, ++_frame )
+	if( m_controlEnvAmountModel.value() )
 	{
-		float env_level;
-		if( _frame < _release_begin )
-		{
-			if( _frame < m_pahdFrames )
-			{
-				env_level = m_pahdEnv[_frame];
-			}
-			else
-			{
-				env_level = m_sustainLevel;
-			}
-		}
-		else if( ( _frame - _release_begin ) < m_rFrames )
-		{
-			env_level = m_rEnv[_frame - _release_begin] *
-				( ( _release_begin < m_pahdFrames ) ?
-				m_pahdEnv[_release_begin] : m_sustainLevel );
-		}
-		else
+		fillEnvLevel<true>( _buf, _frame, _release_begin, _frames );
+	}
+	else
+	{
+		fillEnvLevel<false>( _buf, _frame, _release_begin, _frames );
+	}
+}
+
+
+
+
+template<bool CONTROL_ENV_AMOUNT>
+static inline float applyEnvLevel( const float _env, const float _lfo )
+{
+	return CONTROL_ENV_AMOUNT ? _env * ( 0.5f + _lfo ) : _env + _lfo;
+}
+
+
+
+
+// envelope is evaluated segment by segment, so every loop is a plain copy
+// or fill, and combined with the LFO level _buf holds
+template<bool CONTROL_ENV_AMOUNT>
+void EnvelopeAndLfoParameters::fillEnvLevel( float * _buf, f_cnt_t _frame,
+						const f_cnt_t _release_begin,
+						const fpp_t _frames )
+{
+	fpp_t offset = 0;
+
+	// predelay, attack, hold and decay
+	fpp_t n = qBound<f_cnt_t>( 0, qMin( _release_begin, m_pahdFrames ) -
+							_frame, _frames );
+	for( fpp_t i = 0; i < n; ++i )
+	{
+		_buf[i] = applyEnvLevel<CONTROL_ENV_AMOUNT>(
+						m_pahdEnv[_frame + i], _buf[i] );
+	}
+	offset += n;
+	_frame += n;
+
+	// sustain
+	n = qBound<f_cnt_t>( 0, _release_begin - _frame, _frames - offset );
+	for( fpp_t i = offset; i < offset + n; ++i )
+	{
+		_buf[i] = applyEnvLevel<CONTROL_ENV_AMOUNT>( m_sustainLevel,
+								_buf[i] );
+	}
+	offset += n;
+	_frame += n;
+
+	// release
+	const f_cnt_t releaseFrame = _frame - _release_begin;
+	if( offset < _frames && releaseFrame >= 0 )
+	{
+		n = qBound<f_cnt_t>( 0, m_rFrames - releaseFrame,
+							_frames - offset );
+		const float releaseLevel = ( _release_begin < m_pahdFrames ) ?
+				m_pahdEnv[_release_begin] : m_sustainLevel;
+		for( fpp_t i = 0; i < n; ++i )
 		{
-			env_level = 0.0f;
+			_buf[offset + i] = applyEnvLevel<CONTROL_ENV_AMOUNT>(
+				m_rEnv[releaseFrame + i] * releaseLevel,
+							_buf[offset + i] );
 		}
+		offset += n;
+	}
 
-		// at this point, *_buf is LFO level
-		*_buf = m_controlEnvAmountModel.value() ?
-			env_level * ( 0.5f + *_buf ) :
-			env_level + *_buf;
+	// envelope is over
+	for( fpp_t i = offset; i < _frames; ++i )
+	{
+		_buf[i] = applyEnvLevel<CONTROL_ENV_AMOUNT>( 0.0f, _buf[i] );
 	}
 }
 
@@ -530,8 +616,6 @@ void EnvelopeAndLfoParameters::updateSampleVars()
 		m_lfoAmountIsZero = false;
 	}
 
-	m_bad_lfoShapeData = true;
-
 	emit dataChanged();
 
 }
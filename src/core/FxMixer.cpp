@@ -25,6 +25,8 @@
 #include <QDomElement>
 
 #include "FxMixer.h"
+#include "AudioDevice.h"
+#include "AudioPort.h"
 #include "MixerWorkerThread.h"
 #include "MixHelpers.h"
 #include "Effect.h"
@@ -32,7 +34,7 @@
 
 #include "InstrumentTrack.h"
 #include "BBTrackContainer.h"
-#include "ValueBuffer.h"
+#include "ParameterStream.h"
 
 FxRoute::FxRoute( FxChannel * from, FxChannel * to, float amount ) :
 	m_from( from ),
@@ -71,7 +73,8 @@ FxChannel::FxChannel( int idx, Model * _parent ) :
 	m_lock(),
 	m_channelIndex( idx ),
 	m_queued( false ),
-	m_dependenciesMet( 0 )
+	m_dependenciesMet( 0 ),
+	m_audioPortDeps( 0 )
 {
 	Engine::mixer()->clearAudioBuffer( m_buffer,
 					Engine::mixer()->framesPerPeriod() );
@@ -82,10 +85,26 @@ FxChannel::FxChannel( int idx, Model * _parent ) :
 
 FxChannel::~FxChannel()
 {
+	if( m_channelIndex > 0 && Engine::mixer()->audioDev() )
+	{
+		Engine::mixer()->audioDev()->unregisterFxChannel( this );
+	}
 	delete[] m_buffer;
 }
 
 
+
+
+void FxChannel::setName( const QString & _name )
+{
+	m_name = _name;
+	if( m_channelIndex > 0 && Engine::mixer()->audioDev() )
+	{
+		Engine::mixer()->audioDev()->renameFxChannel( this );
+	}
+}
+
+
 inline void FxChannel::processed()
 {
 	foreach( FxRoute * receiverRoute, m_sends )
@@ -99,8 +118,8 @@ inline void FxChannel::processed()
 
 void FxChannel::incrementDeps()
 {
-	m_dependenciesMet.ref();
-	if( m_dependenciesMet >= m_receives.size() && ! m_queued )
+	const int deps = m_dependenciesMet.fetchAndAddOrdered( 1 ) + 1;
+	if( deps >= m_receives.size() + m_audioPortDeps && ! m_queued )
 	{
 		m_queued = true;
 		MixerWorkerThread::addJob( this );
@@ -117,6 +136,9 @@ void FxChannel::unmuteForSolo()
 
 void FxChannel::doProcessing()
 {
+	MixerProfiler::Probe probe( Engine::mixer()->profiler(),
+					MixerProfiler::FxChannelEntry, this );
+
 	const fpp_t fpp = Engine::mixer()->framesPerPeriod();
 	const bool exporting = Engine::getSong()->isExporting();
 
@@ -130,37 +152,14 @@ void FxChannel::doProcessing()
 
 			if( sender->m_hasInput || sender->m_stillRunning )
 			{
-				// figure out if we're getting sample-exact input
-				ValueBuffer * sendBuf = sendModel->valueBuffer();
-				ValueBuffer * volBuf = sender->m_volumeModel.valueBuffer();
+				const ParameterStream sendStream = sendModel->parameterStream();
+				const ParameterStream volStream = sender->m_volumeModel.parameterStream();
 
 				// mix it's output with this one's output
 				sampleFrame * ch_buf = sender->m_buffer;
 
-				// use sample-exact mixing if sample-exact values are available
-				if( ! volBuf && ! sendBuf ) // neither volume nor send has sample-exact data...
-				{
-					const float v = sender->m_volumeModel.value() * sendModel->value();
-					if( exporting ) { MixHelpers::addSanitizedMultiplied( m_buffer, ch_buf, v, fpp ); }
-					else { MixHelpers::addMultiplied( m_buffer, ch_buf, v, fpp ); }
-				}
-				else if( volBuf && sendBuf ) // both volume and send have sample-exact data
-				{
-					if( exporting ) { MixHelpers::addSanitizedMultipliedByBuffers( m_buffer, ch_buf, volBuf, sendBuf, fpp ); }
-					else { MixHelpers::addMultipliedByBuffers( m_buffer, ch_buf, volBuf, sendBuf, fpp ); }
-				}
-				else if( volBuf ) // volume has sample-exact data but send does not
-				{
-					const float v = sendModel->value();
-					if( exporting ) { MixHelpers::addSanitizedMultipliedByBuffer( m_buffer, ch_buf, v, volBuf, fpp ); }
-					else { MixHelpers::addMultipliedByBuffer( m_buffer, ch_buf, v, volBuf, fpp ); }
-				}
-				else // vice versa
-				{
-					const float v = sender->m_volumeModel.value();
-					if( exporting ) { MixHelpers::addSanitizedMultipliedByBuffer( m_buffer, ch_buf, v, sendBuf, fpp ); }
-					else { MixHelpers::addMultipliedByBuffer( m_buffer, ch_buf, v, sendBuf, fpp ); }
-				}
+				if( exporting ) { MixHelpers::addSanitizedMultipliedByStreams( m_buffer, ch_buf, volStream, sendStream, fpp ); }
+				else { MixHelpers::addMultipliedByStreams( m_buffer, ch_buf, volStream, sendStream, fpp ); }
 				m_hasInput = true;
 			}
 		}
@@ -178,6 +177,12 @@ void FxChannel::doProcessing()
 
 		m_peakLeft = qMax( m_peakLeft, Engine::mixer()->peakValueLeft( m_buffer, fpp ) * v );
 		m_peakRight = qMax( m_peakRight, Engine::mixer()->peakValueRight( m_buffer, fpp ) * v );
+
+		// master is available at main outputs anyway
+		if( m_channelIndex > 0 )
+		{
+			Engine::mixer()->audioDev()->processFxChannelOutput( this, m_buffer, v );
+		}
 	}
 	else
 	{
@@ -185,6 +190,7 @@ void FxChannel::doProcessing()
 	}
 
 	// increment dependency counter of all receivers
+	probe.finish();
 	processed();
 }
 
@@ -193,7 +199,8 @@ void FxChannel::doProcessing()
 FxMixer::FxMixer() :
 	Model( NULL ),
 	JournallingObject(),
-	m_fxChannels()
+	m_fxChannels(),
+	m_processingChannels( false )
 {
 	// create master channel
 	createChannel();
@@ -225,6 +232,11 @@ int FxMixer::createChannel()
 	// reset channel state
 	clearChannel( index );
 
+	if( index > 0 && Engine::mixer()->audioDev() )
+	{
+		Engine::mixer()->audioDev()->registerFxChannel( m_fxChannels[index] );
+	}
+
 	return index;
 }
 
@@ -550,55 +562,108 @@ void FxMixer::prepareMasterMix()
 
 
 
-void FxMixer::masterMix( sampleFrame * _buf )
+void FxMixer::prepareChannels( const QVector<AudioPort *> & _ports )
 {
-	const int fpp = Engine::mixer()->framesPerPeriod();
+	if( m_sendsMutex.tryLock() == false )
+	{
+		// routing is being changed - skip channel processing this period
+		return;
+	}
+	m_processingChannels = true;
 
-	if( m_sendsMutex.tryLock() )
+	// latch mute states of all channels before any of them gets processed -
+	// processed() of a muted sender checks the state of its receivers, which
+	// might come later in the list
+	foreach( FxChannel * ch, m_fxChannels )
+	{
+		ch->m_audioPortDeps = 0;
+		ch->m_muted = ch->m_muteModel.value();
+	}
+	foreach( AudioPort * port, _ports )
 	{
-		// add the channels that have no dependencies (no incoming senders, ie. no receives)
-		// to the jobqueue. The channels that have receives get added when their senders get processed, which
-		// is detected by dependency counting.
-		// also instantly add all muted channels as they don't need to care about their senders, and can just increment the deps of
-		// their recipients right away.
-		MixerWorkerThread::resetJobQueue( MixerWorkerThread::JobQueue::Dynamic );
-		foreach( FxChannel * ch, m_fxChannels )
+		if( port->fxChannelDependency() < m_fxChannels.size() )
 		{
-			ch->m_muted = ch->m_muteModel.value();
-			if( ch->m_muted ) // instantly "process" muted channels
-			{
-				ch->processed();
-				ch->done();
-			}
-			else if( ch->m_receives.size() == 0 )
-			{
-				ch->m_queued = true;
-				MixerWorkerThread::addJob( ch );
-			}
+			++m_fxChannels[port->fxChannelDependency()]->m_audioPortDeps;
 		}
-		while( m_fxChannels[0]->state() != ThreadableJob::Done )
+	}
+
+	// add the channels that have no dependencies (no incoming senders, ie. no receives, and no audio ports)
+	// to the jobqueue. The channels that have dependencies get added when their senders get processed, which
+	// is detected by dependency counting.
+	// also instantly add all muted channels as they don't need to care about their senders, and can just increment the deps of
+	// their recipients right away.
+	foreach( FxChannel * ch, m_fxChannels )
+	{
+		if( ch->m_muted ) // instantly "process" muted channels
 		{
-			MixerWorkerThread::startAndWaitForJobs();
+			// audio ports sending to us must not queue us anymore
+			ch->m_queued = true;
+			ch->processed();
+			ch->done();
+		}
+		else if( ch->m_receives.size() == 0 && ch->m_audioPortDeps == 0 )
+		{
+			ch->m_queued = true;
+			MixerWorkerThread::addJob( ch );
 		}
-		m_sendsMutex.unlock();
 	}
+}
 
-	// handle sample-exact data in master volume fader
-	ValueBuffer * volBuf = m_fxChannels[0]->m_volumeModel.valueBuffer();
 
-	if( volBuf )
+
+
+void FxMixer::audioPortProcessed( fx_ch_t _ch )
+{
+	if( m_processingChannels && _ch < m_fxChannels.size() )
 	{
-		for( int f = 0; f < fpp; f++ )
+		m_fxChannels[_ch]->incrementDeps();
+	}
+}
+
+
+
+void FxMixer::reportUnprocessedChannels() const
+{
+	for( int i = 0; i < m_fxChannels.size(); ++i )
+	{
+		const FxChannel * ch = m_fxChannels[i];
+		if( ch->state() != ThreadableJob::Done )
 		{
-			m_fxChannels[0]->m_buffer[f][0] *= volBuf->values()[f];
-			m_fxChannels[0]->m_buffer[f][1] *= volBuf->values()[f];
+			qWarning( "FxMixer: channel %d not processed in this period "
+					"(%d of %d senders and audio ports done)", i,
+					(int) ch->m_dependenciesMet,
+					ch->m_receives.size() + ch->m_audioPortDeps );
 		}
 	}
+	qFatal( "FxMixer: master channel was not scheduled" );
+}
+
+
 
-	const float v = volBuf
-		? 1.0f
-		: m_fxChannels[0]->m_volumeModel.value();
-	MixHelpers::addSanitizedMultiplied( _buf, m_fxChannels[0]->m_buffer, v, fpp );
+
+void FxMixer::masterMix( sampleFrame * _buf )
+{
+	const int fpp = Engine::mixer()->framesPerPeriod();
+
+	// all channels have been processed along with the rest of the
+	// processing graph of this period
+	if( m_processingChannels )
+	{
+		// master is the sink of the graph - anything else means some
+		// dependency was never released, which is a bug in building the
+		// graph and must not be papered over
+		if( m_fxChannels[0]->state() != ThreadableJob::Done )
+		{
+			reportUnprocessedChannels();
+		}
+		m_processingChannels = false;
+		m_sendsMutex.unlock();
+	}
+
+	// handle sample-exact data in master volume fader
+	MixHelpers::addSanitizedMultipliedByStreams( _buf, m_fxChannels[0]->m_buffer,
+			m_fxChannels[0]->m_volumeModel.parameterStream(),
+			ParameterStream::constant( 1.0f ), fpp );
 
 	// clear all channel buffers and
 	// reset channel process state
@@ -635,7 +700,7 @@ void FxMixer::clearChannel(fx_ch_t index)
 	ch->m_volumeModel.setValue( 1.0f );
 	ch->m_muteModel.setValue( false );
 	ch->m_soloModel.setValue( false );
-	ch->m_name = ( index == 0 ) ? tr( "Master" ) : tr( "FX %1" ).arg( index );
+	ch->setName( ( index == 0 ) ? tr( "Master" ) : tr( "FX %1" ).arg( index ) );
 	ch->m_volumeModel.setDisplayName( ch->m_name );
 
 	// send only to master
@@ -719,7 +784,7 @@ void FxMixer::loadSettings( const QDomElement & _this )
 		m_fxChannels[num]->m_volumeModel.loadSettings( fxch, "volume" );
 		m_fxChannels[num]->m_muteModel.loadSettings( fxch, "muted" );
 		m_fxChannels[num]->m_soloModel.loadSettings( fxch, "soloed" );
-		m_fxChannels[num]->m_name = fxch.attribute( "name" );
+		m_fxChannels[num]->setName( fxch.attribute( "name" ) );
 
 		m_fxChannels[num]->m_fxChain.restoreState( fxch.firstChildElement(
 			m_fxChannels[num]->m_fxChain.nodeName() ) );
@@ -762,7 +827,7 @@ void FxMixer::validateChannelName( int index, int oldIndex )
 	FxChannel * fxc = m_fxChannels[ index ];
 	if( fxc->m_name == tr( "FX %1" ).arg( oldIndex ) )
 	{
-		fxc->m_name = tr( "FX %1" ).arg( index );
+		fxc->setName( tr( "FX %1" ).arg( index ) );
 	}
 	// set correct channel index
 	fxc->m_channelIndex = index;
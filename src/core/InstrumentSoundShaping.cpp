@@ -161,7 +161,8 @@ void InstrumentSoundShaping::processAudioBuffer( sampleFrame* buffer,
 
 		if( n->m_filter == NULL )
 		{
-			n->m_filter = new BasicFilters<>( Engine::mixer()->processingSampleRate() );
+			n->m_filter = NotePlayHandleManager::acquireFilter(
+				Engine::mixer()->processingSampleRate() );
 		}
 		n->m_filter->setFilterType( m_filterModel.value() );
 
@@ -177,6 +178,9 @@ void InstrumentSoundShaping::processAudioBuffer( sampleFrame* buffer,
 		const float fcv = m_filterCutModel.value();
 		const float frv = m_filterResModel.value();
 
+		// frames are filtered in blocks between coefficient changes
+		fpp_t blockStart = 0;
+
 		if( m_envLfoParameters[Cut]->isUsed() &&
 			m_envLfoParameters[Resonance]->isUsed() )
 		{
@@ -190,13 +194,12 @@ void InstrumentSoundShaping::processAudioBuffer( sampleFrame* buffer,
 				if( static_cast<int>( new_cut_val ) != old_filter_cut ||
 					static_cast<int>( new_res_val*RES_PRECISION ) != old_filter_res )
 				{
+					n->m_filter->processBlock( buffer + blockStart, frame - blockStart );
+					blockStart = frame;
 					n->m_filter->calcFilterCoeffs( new_cut_val, new_res_val );
 					old_filter_cut = static_cast<int>( new_cut_val );
 					old_filter_res = static_cast<int>( new_res_val*RES_PRECISION );
 				}
-
-				buffer[frame][0] = n->m_filter->update( buffer[frame][0], 0 );
-				buffer[frame][1] = n->m_filter->update( buffer[frame][1], 1 );
 			}
 		}
 		else if( m_envLfoParameters[Cut]->isUsed() )
@@ -208,12 +211,11 @@ void InstrumentSoundShaping::processAudioBuffer( sampleFrame* buffer,
 
 				if( static_cast<int>( new_cut_val ) != old_filter_cut )
 				{
+					n->m_filter->processBlock( buffer + blockStart, frame - blockStart );
+					blockStart = frame;
 					n->m_filter->calcFilterCoeffs( new_cut_val, frv );
 					old_filter_cut = static_cast<int>( new_cut_val );
 				}
-
-				buffer[frame][0] = n->m_filter->update( buffer[frame][0], 0 );
-				buffer[frame][1] = n->m_filter->update( buffer[frame][1], 1 );
 			}
 		}
 		else if( m_envLfoParameters[Resonance]->isUsed() )
@@ -224,24 +226,19 @@ void InstrumentSoundShaping::processAudioBuffer( sampleFrame* buffer,
 
 				if( static_cast<int>( new_res_val*RES_PRECISION ) != old_filter_res )
 				{
+					n->m_filter->processBlock( buffer + blockStart, frame - blockStart );
+					blockStart = frame;
 					n->m_filter->calcFilterCoeffs( fcv, new_res_val );
 					old_filter_res = static_cast<int>( new_res_val*RES_PRECISION );
 				}
-
-				buffer[frame][0] = n->m_filter->update( buffer[frame][0], 0 );
-				buffer[frame][1] = n->m_filter->update( buffer[frame][1], 1 );
 			}
 		}
 		else
 		{
 			n->m_filter->calcFilterCoeffs( fcv, frv );
-
-			for( fpp_t frame = 0; frame < frames; ++frame )
-			{
-				buffer[frame][0] = n->m_filter->update( buffer[frame][0], 0 );
-				buffer[frame][1] = n->m_filter->update( buffer[frame][1], 1 );
-			}
 		}
+
+		n->m_filter->processBlock( buffer + blockStart, frames - blockStart );
 	}
 
 	if( m_envLfoParameters[Volume]->isUsed() )
@@ -25,194 +25,384 @@
 
 
 #include "MemoryManager.h"
+#include "lmms_basics.h"
 #include <QtGlobal>
+#include <QtCore/QAtomicInt>
+#include <QtCore/QThreadStorage>
 #include <stdint.h>
+#include <string.h>
 
 
-MemoryPoolVector MemoryManager::s_memoryPools;
-QReadWriteLock MemoryManager::s_poolMutex;
-PointerInfoMap MemoryManager::s_pointerInfo;
-QMutex MemoryManager::s_pointerMutex;
+namespace
+{
 
+const int LargeAllocation = -1;
 
-bool MemoryManager::init()
+// sits in front of every block
+struct BlockHeader
 {
-	s_memoryPools.reserve( 64 );
-	s_pointerInfo.reserve( 4096 );
-	// construct first MemoryPool and allocate memory
-	MemoryPool m ( MM_INITIAL_CHUNKS );
-	m.m_pool = MemoryHelper::alignedMalloc( MM_INITIAL_CHUNKS * MM_CHUNK_SIZE );
-	s_memoryPools.append( m );
-	return true;
-}
+	int sizeClass;
+	int size; // only set for large allocations
+} ;
 
+// free blocks are linked through their first bytes
+struct FreeBlock
+{
+	FreeBlock * next;
+} ;
 
-void * MemoryManager::alloc( size_t size )
+struct SizeClass
 {
-	int requiredChunks = size / MM_CHUNK_SIZE + ( size % MM_CHUNK_SIZE > 0 ? 1 : 0 );
+	int blockSize; // including header
+	int batch; // blocks exchanged between thread caches and shared list at once
+	QAtomicInt lock;
+	FreeBlock * freeList;
+	int freeCount;
+	int reservedBlocks;
+} ;
+
+
+class ThreadCache;
 
-	MemoryPool * mp = NULL;
-	void * ptr = NULL;
+SizeClass s_classes[MM_MAX_SIZE_CLASSES];
+int s_numClasses = 0;
+// size class for a block size in units of MM_ALIGNMENT
+unsigned char s_classForSize[MM_MAX_BLOCK_SIZE / MM_ALIGNMENT + 1];
 
-	MemoryPoolVector::iterator it = s_memoryPools.begin();
+QMutex s_slabMutex;
+QVector<void *> s_slabs;
 
-	s_poolMutex.lockForRead();
-	while( it != s_memoryPools.end() && !ptr )
+QAtomicInt s_largeBytes = 0;
+
+QMutex s_cacheMutex;
+QVector<ThreadCache *> s_caches;
+qint64 s_retiredInUse[MM_MAX_SIZE_CLASSES];
+
+volatile bool s_cleanedUp = false;
+
+
+inline void lockClass( SizeClass & sc )
+{
+	while( !sc.lock.testAndSetAcquire( 0, 1 ) )
 	{
-		ptr = ( *it ).getChunks( requiredChunks );
-		if( ptr )
-		{
-			mp = &( *it );
-		}
-		++it;
 	}
-	s_poolMutex.unlock();
+}
+
+inline void unlockClass( SizeClass & sc )
+{
+	sc.lock.fetchAndStoreRelease( 0 );
+}
 
-	if( ptr )
+
+
+class ThreadCache
+{
+public:
+	ThreadCache()
 	{
-		s_pointerMutex.lock();
-		PtrInfo p;
-			p.chunks = requiredChunks;
-			p.memPool = mp;
-		s_pointerInfo[ptr] = p;
-		s_pointerMutex.unlock();
-		return ptr;
+		memset( m_freeList, 0, sizeof( m_freeList ) );
+		memset( m_freeCount, 0, sizeof( m_freeCount ) );
+		memset( m_inUse, 0, sizeof( m_inUse ) );
+
+		s_cacheMutex.lock();
+		s_caches.append( this );
+		s_cacheMutex.unlock();
 	}
 
-	// can't find enough chunks in existing pools, so
-	// create a new pool that is guaranteed to have enough chunks
-	int moreChunks = qMax( requiredChunks, MM_INCREMENT_CHUNKS );
-	int i = MemoryManager::extend( moreChunks );
+	~ThreadCache();
+
+	void refill( int c );
+	void giveBack( int c, int n );
+
+	FreeBlock * m_freeList[MM_MAX_SIZE_CLASSES];
+	int m_freeCount[MM_MAX_SIZE_CLASSES];
+	// blocks allocated minus blocks freed by this thread
+	int m_inUse[MM_MAX_SIZE_CLASSES];
+} ;
+
 
-	mp = &s_memoryPools[i];
-	ptr = s_memoryPools[i].getChunks( requiredChunks );
-	if( ptr )
+// fast access to current thread's cache - QThreadStorage makes sure it gets
+// deleted when the thread exits
+LMMS_THREAD_LOCAL ThreadCache * t_cache = NULL;
+QThreadStorage<ThreadCache *> s_cacheStorage;
+
+
+inline ThreadCache * threadCache()
+{
+	if( t_cache == NULL )
 	{
-		s_pointerMutex.lock();
-		PtrInfo p;
-			p.chunks = requiredChunks;
-			p.memPool = mp;
-		s_pointerInfo[ptr] = p;
-		s_pointerMutex.unlock();
-		return ptr;
+		t_cache = new ThreadCache;
+		s_cacheStorage.setLocalData( t_cache );
 	}
-	// still no luck? something is horribly wrong
-	qFatal( "MemoryManager.cpp: Couldn't allocate memory: %d chunks asked", requiredChunks );
-	return NULL;
+	return t_cache;
 }
 
 
-void MemoryManager::free( void * ptr )
+ThreadCache::~ThreadCache()
 {
-	if( ptr == NULL )
+	if( t_cache == this )
 	{
-		qDebug( "MemoryManager: Null pointer deallocation attempted" );
-		return; // let's not try to deallocate null pointers, ok?
+		t_cache = NULL;
 	}
 
-	// fetch info on the ptr and remove
-	s_pointerMutex.lock();
-	if( ! s_pointerInfo.contains( ptr ) ) // if we have no info on ptr, fail loudly
+	s_cacheMutex.lock();
+	s_caches.remove( s_caches.indexOf( this ) );
+	for( int c = 0; c < s_numClasses; ++c )
 	{
-		qFatal( "MemoryManager: Couldn't find pointer info for pointer: %p", ptr );
+		s_retiredInUse[c] += m_inUse[c];
 	}
-	PtrInfo p = s_pointerInfo[ptr];
-	s_pointerInfo.remove( ptr );
-	s_pointerMutex.unlock();
+	s_cacheMutex.unlock();
 
-	p.memPool->releaseChunks( ptr, p.chunks );
+	// slabs are gone already when we're called after cleanup()
+	if( s_cleanedUp )
+	{
+		return;
+	}
+
+	for( int c = 0; c < s_numClasses; ++c )
+	{
+		if( m_freeCount[c] > 0 )
+		{
+			giveBack( c, m_freeCount[c] );
+		}
+	}
 }
 
 
-int MemoryManager::extend( int chunks )
+// get a batch of free blocks from shared list or a new slab
+void ThreadCache::refill( int c )
 {
-	MemoryPool m ( chunks );
-	m.m_pool = MemoryHelper::alignedMalloc( chunks * MM_CHUNK_SIZE );
+	SizeClass & sc = s_classes[c];
 
-	s_poolMutex.lockForWrite();
-	s_memoryPools.append( m );
-	int i = s_memoryPools.size() - 1;
-	s_poolMutex.unlock();
+	lockClass( sc );
+	FreeBlock * head = sc.freeList;
+	FreeBlock * tail = NULL;
+	int n = 0;
+	while( sc.freeList && n < sc.batch )
+	{
+		tail = sc.freeList;
+		sc.freeList = tail->next;
+		++n;
+	}
+	sc.freeCount -= n;
+	unlockClass( sc );
 
-	return i;
-}
+	if( n > 0 )
+	{
+		tail->next = m_freeList[c];
+		m_freeList[c] = head;
+		m_freeCount[c] += n;
+		return;
+	}
 
+	const int blocks = qMax( MM_SLAB_SIZE / sc.blockSize, sc.batch );
+	char * slab = (char *) MemoryHelper::alignedMalloc( blocks * sc.blockSize );
+	if( slab == NULL )
+	{
+		qFatal( "MemoryManager: Couldn't allocate slab of %d bytes", blocks * sc.blockSize );
+	}
 
-void MemoryManager::cleanup()
-{
-	for( MemoryPoolVector::iterator it = s_memoryPools.begin(); it != s_memoryPools.end(); ++it )
+	s_slabMutex.lock();
+	s_slabs.append( slab );
+	sc.reservedBlocks += blocks;
+	s_slabMutex.unlock();
+
+	for( int i = blocks - 1; i >= 0; --i )
 	{
-		MemoryHelper::alignedFree( ( *it ).m_pool );
-		MemoryHelper::alignedFree( ( *it ).m_free );
+		FreeBlock * b = (FreeBlock *)( slab + i * sc.blockSize );
+		b->next = m_freeList[c];
+		m_freeList[c] = b;
 	}
+	m_freeCount[c] += blocks;
 }
 
 
-void * MemoryPool::getChunks( int chunksNeeded )
+// move n blocks to shared list
+void ThreadCache::giveBack( int c, int n )
 {
-	if( chunksNeeded > m_chunks ) // not enough chunks in this pool?
+	SizeClass & sc = s_classes[c];
+
+	FreeBlock * head = m_freeList[c];
+	FreeBlock * tail = head;
+	for( int i = 1; i < n; ++i )
 	{
-		return NULL;
+		tail = tail->next;
 	}
+	m_freeList[c] = tail->next;
+	m_freeCount[c] -= n;
+
+	lockClass( sc );
+	tail->next = sc.freeList;
+	sc.freeList = head;
+	sc.freeCount += n;
+	unlockClass( sc );
+}
+
+}
+
 
-	m_mutex.lock();
 
-	// now find out if we have a long enough sequence of chunks in this pool
-	char last = 0;
-	intptr_t n = 0;
-	intptr_t index = -1;
-	bool found = false;
 
-	for( int i = 0; i < m_chunks; ++i )
+bool MemoryManager::init()
+{
+	// block sizes grow in steps of MM_ALIGNMENT first, then in steps of
+	// a quarter of the next power of two
+	int size = 2 * MM_ALIGNMENT;
+	while( size <= MM_MAX_BLOCK_SIZE && s_numClasses < MM_MAX_SIZE_CLASSES )
 	{
-		if( m_free[i] )
+		SizeClass & sc = s_classes[s_numClasses];
+		sc.blockSize = size;
+		sc.batch = qBound( 1, MM_SLAB_SIZE / 4 / size, 32 );
+		sc.lock = 0;
+		sc.freeList = NULL;
+		sc.freeCount = 0;
+		sc.reservedBlocks = 0;
+		s_retiredInUse[s_numClasses] = 0;
+		++s_numClasses;
+
+		int step = MM_ALIGNMENT;
+		while( step * 8 <= size )
 		{
-			if( !last )
-			{
-				index = i;
-			}
-
-			++n;
-			if( n >= chunksNeeded )
-			{
-				found = true;
-				break;
-			}
+			step *= 2;
 		}
-		else
+		size += step;
+	}
+
+	int c = 0;
+	for( int i = 0; i <= MM_MAX_BLOCK_SIZE / MM_ALIGNMENT; ++i )
+	{
+		while( s_classes[c].blockSize < i * MM_ALIGNMENT )
 		{
-			n = 0;
+			++c;
 		}
-
-		last = m_free[i];
+		s_classForSize[i] = c;
 	}
 
-	if( found ) // if enough chunks found, return pointer to chunks
+	return true;
+}
+
+
+void * MemoryManager::alloc( size_t size )
+{
+	const size_t blockSize = size + MM_ALIGNMENT;
+
+	if( blockSize > (size_t) MM_MAX_BLOCK_SIZE )
 	{
-		// set chunk flags to false so we know the chunks are in use
-		for( intptr_t i = 0; i < chunksNeeded; ++i )
+		char * block = (char *) MemoryHelper::alignedMalloc( blockSize );
+		if( block == NULL )
 		{
-			m_free[ index + i ] = 0;
+			qFatal( "MemoryManager: Couldn't allocate %d bytes", (int) size );
 		}
-		m_mutex.unlock();
-		return (char*)m_pool + ( index * MM_CHUNK_SIZE );
+		BlockHeader * h = (BlockHeader *) block;
+		h->sizeClass = LargeAllocation;
+		h->size = blockSize;
+		s_largeBytes.fetchAndAddOrdered( blockSize );
+		return block + MM_ALIGNMENT;
+	}
+
+	const int c = s_classForSize[( blockSize + MM_ALIGNMENT - 1 ) / MM_ALIGNMENT];
+	ThreadCache * cache = threadCache();
+	if( cache->m_freeList[c] == NULL )
+	{
+		cache->refill( c );
+	}
+
+	FreeBlock * b = cache->m_freeList[c];
+	cache->m_freeList[c] = b->next;
+	--cache->m_freeCount[c];
+	++cache->m_inUse[c];
+
+	( (BlockHeader *) b )->sizeClass = c;
+	return (char *) b + MM_ALIGNMENT;
+}
+
+
+void MemoryManager::free( void * ptr )
+{
+	if( ptr == NULL )
+	{
+		qDebug( "MemoryManager: Null pointer deallocation attempted" );
+		return; // let's not try to deallocate null pointers, ok?
+	}
+
+	char * block = (char *) ptr - MM_ALIGNMENT;
+	const BlockHeader * h = (const BlockHeader *) block;
+
+	if( h->sizeClass == LargeAllocation )
+	{
+		s_largeBytes.fetchAndAddOrdered( -h->size );
+		MemoryHelper::alignedFree( block );
+		return;
+	}
+
+	const int c = h->sizeClass;
+	if( c < 0 || c >= s_numClasses ) // corrupt header or foreign pointer, fail loudly
+	{
+		qFatal( "MemoryManager: Invalid block header for pointer: %p", ptr );
+	}
+
+	ThreadCache * cache = threadCache();
+	FreeBlock * b = (FreeBlock *) block;
+	b->next = cache->m_freeList[c];
+	cache->m_freeList[c] = b;
+	++cache->m_freeCount[c];
+	--cache->m_inUse[c];
+
+	// don't let a thread which only frees hoard blocks
+	if( cache->m_freeCount[c] > 2 * s_classes[c].batch )
+	{
+		cache->giveBack( c, s_classes[c].batch );
 	}
-	m_mutex.unlock();
-	return NULL; // out of stock, come again tomorrow!
 }
 
 
-void MemoryPool::releaseChunks( void * ptr, int chunks )
+void MemoryManager::cleanup()
 {
-	m_mutex.lock();
+	s_cleanedUp = true;
 
-	intptr_t start = ( (intptr_t)ptr - (intptr_t)m_pool ) / MM_CHUNK_SIZE;
-	if( start < 0 )
+	s_slabMutex.lock();
+	for( QVector<void *>::iterator it = s_slabs.begin(); it != s_slabs.end(); ++it )
 	{
-		qFatal( "MemoryManager: error at releaseChunks() - corrupt pointer info?" );
+		MemoryHelper::alignedFree( *it );
 	}
+	s_slabs.clear();
+	s_slabMutex.unlock();
+}
+
 
-	memset( &m_free[ start ], 1, chunks );
+int MemoryManager::sizeClasses()
+{
+	return s_numClasses;
+}
 
-	m_mutex.unlock();
+
+int MemoryManager::blockSize( int sizeClass )
+{
+	return s_classes[sizeClass].blockSize;
+}
+
+
+qint64 MemoryManager::bytesInUse( int sizeClass )
+{
+	s_cacheMutex.lock();
+	qint64 blocks = s_retiredInUse[sizeClass];
+	foreach( const ThreadCache * cache, s_caches )
+	{
+		blocks += cache->m_inUse[sizeClass];
+	}
+	s_cacheMutex.unlock();
+
+	return blocks * s_classes[sizeClass].blockSize;
+}
+
+
+qint64 MemoryManager::bytesReserved( int sizeClass )
+{
+	return (qint64) s_classes[sizeClass].reservedBlocks * s_classes[sizeClass].blockSize;
+}
+
+
+qint64 MemoryManager::largeBytesInUse()
+{
+	return s_largeBytes;
 }
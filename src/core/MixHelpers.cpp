@@ -22,14 +22,37 @@
  *
  */
 
+#include <stdlib.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#if ( defined( __i386__ ) || defined( __x86_64__ ) ) && \
+	( defined( __clang__ ) || __GNUC__ > 4 || \
+				( __GNUC__ == 4 && __GNUC_MINOR__ >= 8 ) )
+#define LMMS_MIXHELPERS_CPU_CHECK
+#endif
+
+#if defined( __ARM_NEON__ ) || defined( __ARM_NEON )
+#include <arm_neon.h>
+#define LMMS_MIXHELPERS_NEON
+#endif
+
 #include "lmms_math.h"
 #include "MixHelpers.h"
+#include "MixHelpersSimd.h"
+#include "ParameterStream.h"
 #include "ValueBuffer.h"
 
 
 namespace MixHelpers
 {
 
+// scalar reference implementation - used if there's no vectorized one
+namespace Scalar
+{
+
 /*! \brief Function for applying MIXOP on all sample frames */
 template<typename MIXOP>
 static inline void run( sampleFrame* dst, const sampleFrame* src, int frames, const MIXOP& OP )
@@ -53,13 +76,11 @@ static inline void run( sampleFrame* dst, const sample_t* srcLeft, const sample_
 
 
 
-bool isSilent( const sampleFrame* src, int frames )
+static bool isSilent( const sampleFrame* src, int frames )
 {
-	const float silenceThreshold = 0.0000001f;
-
 	for( int i = 0; i < frames; ++i )
 	{
-		if( fabsf( src[i][0] ) >= silenceThreshold || fabsf( src[i][1] ) >= silenceThreshold )
+		if( fabsf( src[i][0] ) >= SilenceThreshold || fabsf( src[i][1] ) >= SilenceThreshold )
 		{
 			return false;
 		}
@@ -70,7 +91,7 @@ bool isSilent( const sampleFrame* src, int frames )
 
 
 /*! \brief Function for sanitizing a buffer of infs/nans - returns true if those are found */
-bool sanitize( sampleFrame * src, int frames )
+static bool sanitize( sampleFrame * src, int frames )
 {
 	bool found = false;
 	for( int f = 0; f < frames; ++f )
@@ -97,7 +118,7 @@ struct AddOp
 	}
 } ;
 
-void add( sampleFrame* dst, const sampleFrame* src, int frames )
+static void add( sampleFrame* dst, const sampleFrame* src, int frames )
 {
 	run<>( dst, src, frames, AddOp() );
 }
@@ -118,7 +139,7 @@ struct AddMultipliedOp
 } ;
 
 
-void addMultiplied( sampleFrame* dst, const sampleFrame* src, float coeffSrc, int frames )
+static void addMultiplied( sampleFrame* dst, const sampleFrame* src, float coeffSrc, int frames )
 {
 	run<>( dst, src, frames, AddMultipliedOp(coeffSrc) );
 }
@@ -137,50 +158,50 @@ struct AddSwappedMultipliedOp
 	const float m_coeff;
 };
 
-void addSwappedMultiplied( sampleFrame* dst, const sampleFrame* src, float coeffSrc, int frames )
+static void addSwappedMultiplied( sampleFrame* dst, const sampleFrame* src, float coeffSrc, int frames )
 {
 	run<>( dst, src, frames, AddSwappedMultipliedOp(coeffSrc) );
 }
 
 
-void addMultipliedByBuffer( sampleFrame* dst, const sampleFrame* src, float coeffSrc, ValueBuffer * coeffSrcBuf, int frames )
+static void addMultipliedByBuffer( sampleFrame* dst, const sampleFrame* src, float coeffSrc, const float* coeffSrcBuf, int frames )
 {
 	for( int f = 0; f < frames; ++f )
 	{
-		dst[f][0] += src[f][0] * coeffSrc * coeffSrcBuf->values()[f];
-		dst[f][1] += src[f][1] * coeffSrc * coeffSrcBuf->values()[f];
+		dst[f][0] += src[f][0] * coeffSrc * coeffSrcBuf[f];
+		dst[f][1] += src[f][1] * coeffSrc * coeffSrcBuf[f];
 	}
 }
 
-void addMultipliedByBuffers( sampleFrame* dst, const sampleFrame* src, ValueBuffer * coeffSrcBuf1, ValueBuffer * coeffSrcBuf2, int frames )
+static void addMultipliedByBuffers( sampleFrame* dst, const sampleFrame* src, const float* coeffSrcBuf1, const float* coeffSrcBuf2, int frames )
 {
 	for( int f = 0; f < frames; ++f )
 	{
-		dst[f][0] += src[f][0] * coeffSrcBuf1->values()[f] * coeffSrcBuf2->values()[f];
-		dst[f][1] += src[f][1] * coeffSrcBuf1->values()[f] * coeffSrcBuf2->values()[f];
+		dst[f][0] += src[f][0] * coeffSrcBuf1[f] * coeffSrcBuf2[f];
+		dst[f][1] += src[f][1] * coeffSrcBuf1[f] * coeffSrcBuf2[f];
 	}
 
 }
 
-void addSanitizedMultipliedByBuffer( sampleFrame* dst, const sampleFrame* src, float coeffSrc, ValueBuffer * coeffSrcBuf, int frames )
+static void addSanitizedMultipliedByBuffer( sampleFrame* dst, const sampleFrame* src, float coeffSrc, const float* coeffSrcBuf, int frames )
 {
 	for( int f = 0; f < frames; ++f )
 	{
-		dst[f][0] += ( isinff( src[f][0] ) || isnanf( src[f][0] ) ) ? 0.0f : src[f][0] * coeffSrc * coeffSrcBuf->values()[f];
-		dst[f][1] += ( isinff( src[f][1] ) || isnanf( src[f][1] ) ) ? 0.0f : src[f][1] * coeffSrc * coeffSrcBuf->values()[f];
+		dst[f][0] += ( isinff( src[f][0] ) || isnanf( src[f][0] ) ) ? 0.0f : src[f][0] * coeffSrc * coeffSrcBuf[f];
+		dst[f][1] += ( isinff( src[f][1] ) || isnanf( src[f][1] ) ) ? 0.0f : src[f][1] * coeffSrc * coeffSrcBuf[f];
 	}
 }
 
-void addSanitizedMultipliedByBuffers( sampleFrame* dst, const sampleFrame* src, ValueBuffer * coeffSrcBuf1, ValueBuffer * coeffSrcBuf2, int frames )
+static void addSanitizedMultipliedByBuffers( sampleFrame* dst, const sampleFrame* src, const float* coeffSrcBuf1, const float* coeffSrcBuf2, int frames )
 {
 	for( int f = 0; f < frames; ++f )
 	{
 		dst[f][0] += ( isinff( src[f][0] ) || isnanf( src[f][0] ) )
 			? 0.0f
-			: src[f][0] * coeffSrcBuf1->values()[f] * coeffSrcBuf2->values()[f];
+			: src[f][0] * coeffSrcBuf1[f] * coeffSrcBuf2[f];
 		dst[f][1] += ( isinff( src[f][1] ) || isnanf( src[f][1] ) )
 			? 0.0f
-			: src[f][1] * coeffSrcBuf1->values()[f] * coeffSrcBuf2->values()[f];
+			: src[f][1] * coeffSrcBuf1[f] * coeffSrcBuf2[f];
 	}
 
 }
@@ -199,7 +220,7 @@ struct AddSanitizedMultipliedOp
 	const float m_coeff;
 };
 
-void addSanitizedMultiplied( sampleFrame* dst, const sampleFrame* src, float coeffSrc, int frames )
+static void addSanitizedMultiplied( sampleFrame* dst, const sampleFrame* src, float coeffSrc, int frames )
 {
 	run<>( dst, src, frames, AddSanitizedMultipliedOp(coeffSrc) );
 }
@@ -224,7 +245,7 @@ struct AddMultipliedStereoOp
 } ;
 
 
-void addMultipliedStereo( sampleFrame* dst, const sampleFrame* src, float coeffSrcLeft, float coeffSrcRight, int frames )
+static void addMultipliedStereo( sampleFrame* dst, const sampleFrame* src, float coeffSrcLeft, float coeffSrcRight, int frames )
 {
 
 	run<>( dst, src, frames, AddMultipliedStereoOp(coeffSrcLeft, coeffSrcRight) );
@@ -252,14 +273,14 @@ struct MultiplyAndAddMultipliedOp
 } ;
 
 
-void multiplyAndAddMultiplied( sampleFrame* dst, const sampleFrame* src, float coeffDst, float coeffSrc, int frames )
+static void multiplyAndAddMultiplied( sampleFrame* dst, const sampleFrame* src, float coeffDst, float coeffSrc, int frames )
 {
 	run<>( dst, src, frames, MultiplyAndAddMultipliedOp(coeffDst, coeffSrc) );
 }
 
 
 
-void multiplyAndAddMultipliedJoined( sampleFrame* dst,
+static void multiplyAndAddMultipliedJoined( sampleFrame* dst,
 										const sample_t* srcLeft,
 										const sample_t* srcRight,
 										float coeffDst, float coeffSrc, int frames )
@@ -267,5 +288,452 @@ void multiplyAndAddMultipliedJoined( sampleFrame* dst,
 	run<>( dst, srcLeft, srcRight, frames, MultiplyAndAddMultipliedOp(coeffDst, coeffSrc) );
 }
 
+static const Kernels kernels =
+{
+	"scalar",
+	&isSilent,
+	&sanitize,
+	&add,
+	&addMultiplied,
+	&addSwappedMultiplied,
+	&addMultipliedByBuffer,
+	&addMultipliedByBuffers,
+	&addSanitizedMultiplied,
+	&addSanitizedMultipliedByBuffer,
+	&addSanitizedMultipliedByBuffers,
+	&addMultipliedStereo,
+	&multiplyAndAddMultiplied,
+	&multiplyAndAddMultipliedJoined
+} ;
+
+}
+
+
+
+
+#ifdef __SSE2__
+namespace
+{
+
+struct Sse2
+{
+	typedef __m128 Vec;
+	enum { Width = 4 };
+
+	static inline Vec load( const float* p ) { return _mm_loadu_ps( p ); }
+	static inline void store( float* p, Vec v ) { _mm_storeu_ps( p, v ); }
+	static inline Vec set1( float x ) { return _mm_set1_ps( x ); }
+	static inline Vec set2( float l, float r ) { return _mm_setr_ps( l, r, l, r ); }
+	static inline Vec add( Vec a, Vec b ) { return _mm_add_ps( a, b ); }
+	static inline Vec mul( Vec a, Vec b ) { return _mm_mul_ps( a, b ); }
+
+	static inline Vec swapPairs( Vec v )
+	{
+		return _mm_shuffle_ps( v, v, _MM_SHUFFLE( 2, 3, 0, 1 ) );
+	}
+
+	// { p[0], p[1], 0, 0 }
+	static inline Vec loadLow( const float* p )
+	{
+		return _mm_castpd_ps( _mm_load_sd( reinterpret_cast<const double *>( p ) ) );
+	}
+
+	// { c[0], c[0], c[1], c[1] }
+	static inline Vec loadDuplicated( const float* c )
+	{
+		const Vec v = loadLow( c );
+		return _mm_unpacklo_ps( v, v );
+	}
+
+	// { l[0], r[0], l[1], r[1] }
+	static inline Vec loadInterleaved( const float* l, const float* r )
+	{
+		return _mm_unpacklo_ps( loadLow( l ), loadLow( r ) );
+	}
+
+	static inline Vec nonFinite( Vec v )
+	{
+		const __m128i exp = _mm_set1_epi32( 0x7f800000 );
+		return _mm_castsi128_ps( _mm_cmpeq_epi32(
+				_mm_and_si128( _mm_castps_si128( v ), exp ), exp ) );
+	}
+
+	static inline Vec andNot( Vec mask, Vec v ) { return _mm_andnot_ps( mask, v ); }
+	static inline bool any( Vec mask ) { return _mm_movemask_ps( mask ) != 0; }
+
+	static inline bool anyAbsGreaterEqual( Vec v, Vec threshold )
+	{
+		const Vec abs = _mm_andnot_ps( _mm_set1_ps( -0.0f ), v );
+		return _mm_movemask_ps( _mm_cmpge_ps( abs, threshold ) ) != 0;
+	}
+} ;
+
+}
+#endif
+
+
+
+
+#ifdef LMMS_MIXHELPERS_NEON
+namespace
+{
+
+struct Neon
+{
+	typedef float32x4_t Vec;
+	enum { Width = 4 };
+
+	static inline Vec load( const float* p ) { return vld1q_f32( p ); }
+	static inline void store( float* p, Vec v ) { vst1q_f32( p, v ); }
+	static inline Vec set1( float x ) { return vdupq_n_f32( x ); }
+	static inline Vec add( Vec a, Vec b ) { return vaddq_f32( a, b ); }
+	static inline Vec mul( Vec a, Vec b ) { return vmulq_f32( a, b ); }
+	static inline Vec swapPairs( Vec v ) { return vrev64q_f32( v ); }
+
+	static inline Vec set2( float l, float r )
+	{
+		const float c[2] = { l, r };
+		const float32x2_t v = vld1_f32( c );
+		return vcombine_f32( v, v );
+	}
+
+	static inline Vec loadDuplicated( const float* c )
+	{
+		const float32x2_t v = vld1_f32( c );
+		return vcombine_f32( vdup_lane_f32( v, 0 ), vdup_lane_f32( v, 1 ) );
+	}
+
+	static inline Vec loadInterleaved( const float* l, const float* r )
+	{
+		const float32x2x2_t z = vzip_f32( vld1_f32( l ), vld1_f32( r ) );
+		return vcombine_f32( z.val[0], z.val[1] );
+	}
+
+	static inline Vec nonFinite( Vec v )
+	{
+		const uint32x4_t exp = vdupq_n_u32( 0x7f800000 );
+		return vreinterpretq_f32_u32( vceqq_u32( vandq_u32(
+				vreinterpretq_u32_f32( v ), exp ), exp ) );
+	}
+
+	static inline Vec andNot( Vec mask, Vec v )
+	{
+		return vreinterpretq_f32_u32( vbicq_u32( vreinterpretq_u32_f32( v ),
+						vreinterpretq_u32_f32( mask ) ) );
+	}
+
+	static inline bool any( Vec mask )
+	{
+		const uint32x4_t m = vreinterpretq_u32_f32( mask );
+		const uint32x2_t o = vorr_u32( vget_low_u32( m ), vget_high_u32( m ) );
+		return ( vget_lane_u32( o, 0 ) | vget_lane_u32( o, 1 ) ) != 0;
+	}
+
+	static inline bool anyAbsGreaterEqual( Vec v, Vec threshold )
+	{
+		return any( vreinterpretq_f32_u32( vcgeq_f32( vabsq_f32( v ), threshold ) ) );
+	}
+} ;
+
+}
+#endif
+
+
+
+
+static const Kernels * s_kernels = &Scalar::kernels;
+
+
+
+
+namespace
+{
+
+// per-frame coefficients of the different ParameterStream types, so that
+// loops can be instantiated for each combination instead of branching
+// per frame
+struct ConstantCoeff
+{
+	ConstantCoeff( const ParameterStream & s ) : m_value( s.start() ) { }
+	float operator[]( int ) const { return m_value; }
+	const float m_value;
+} ;
+
+struct RampCoeff
+{
+	RampCoeff( const ParameterStream & s ) : m_start( s.start() ), m_step( s.step() ) { }
+	float operator[]( int f ) const { return m_start + m_step * f; }
+	const float m_start;
+	const float m_step;
+} ;
+
+struct BufferCoeff
+{
+	BufferCoeff( const ParameterStream & s ) : m_values( s.values() ) { }
+	float operator[]( int f ) const { return m_values[f]; }
+	const float * m_values;
+} ;
+
+
+template<class OP, class C1>
+static inline void dispatchSecond( const OP & op, const C1 & c1, const ParameterStream & s2 )
+{
+	switch( s2.type() )
+	{
+		case ParameterStream::Constant: op( c1, ConstantCoeff( s2 ) ); break;
+		case ParameterStream::Ramp: op( c1, RampCoeff( s2 ) ); break;
+		default: op( c1, BufferCoeff( s2 ) ); break;
+	}
+}
+
+/*! \brief Call op with coefficients matching types of s1 and s2 */
+template<class OP>
+static inline void dispatch( const OP & op, const ParameterStream & s1, const ParameterStream & s2 )
+{
+	switch( s1.type() )
+	{
+		case ParameterStream::Constant: dispatchSecond( op, ConstantCoeff( s1 ), s2 ); break;
+		case ParameterStream::Ramp: dispatchSecond( op, RampCoeff( s1 ), s2 ); break;
+		default: dispatchSecond( op, BufferCoeff( s1 ), s2 ); break;
+	}
+}
+
+
+template<bool SANITIZE>
+struct AddMultipliedByCoeffsOp
+{
+	AddMultipliedByCoeffsOp( sampleFrame* dst, const sampleFrame* src, int frames ) :
+		m_dst( dst ), m_src( src ), m_frames( frames ) { }
+
+	template<class C1, class C2>
+	void operator()( const C1 & c1, const C2 & c2 ) const
+	{
+		for( int f = 0; f < m_frames; ++f )
+		{
+			const float c = c1[f] * c2[f];
+			if( SANITIZE )
+			{
+				m_dst[f][0] += ( isinff( m_src[f][0] ) || isnanf( m_src[f][0] ) ) ? 0.0f : m_src[f][0] * c;
+				m_dst[f][1] += ( isinff( m_src[f][1] ) || isnanf( m_src[f][1] ) ) ? 0.0f : m_src[f][1] * c;
+			}
+			else
+			{
+				m_dst[f][0] += m_src[f][0] * c;
+				m_dst[f][1] += m_src[f][1] * c;
+			}
+		}
+	}
+
+	sampleFrame* m_dst;
+	const sampleFrame* m_src;
+	const int m_frames;
+} ;
+
+
+struct MultiplyByVolumeAndPanningOp
+{
+	MultiplyByVolumeAndPanningOp( sampleFrame* buf, int frames ) :
+		m_buf( buf ), m_frames( frames ) { }
+
+	template<class V, class P>
+	void operator()( const V & volume, const P & panning ) const
+	{
+		for( int f = 0; f < m_frames; ++f )
+		{
+			const float v = volume[f] * 0.01f;
+			const float p = panning[f] * 0.01f;
+			m_buf[f][0] *= ( p <= 0 ? 1.0f : 1.0f - p ) * v;
+			m_buf[f][1] *= ( p >= 0 ? 1.0f : 1.0f + p ) * v;
+		}
+	}
+
+	void operator()( const ConstantCoeff & volume, const ConstantCoeff & panning ) const
+	{
+		const float v = volume[0] * 0.01f;
+		const float p = panning[0] * 0.01f;
+		const float l = ( p <= 0 ? 1.0f : 1.0f - p ) * v;
+		const float r = ( p >= 0 ? 1.0f : 1.0f + p ) * v;
+		for( int f = 0; f < m_frames; ++f )
+		{
+			m_buf[f][0] *= l;
+			m_buf[f][1] *= r;
+		}
+	}
+
+	sampleFrame* m_buf;
+	const int m_frames;
+} ;
+
+}
+
+
+void init()
+{
+	const int MaxKernels = 4;
+	const Kernels * available[MaxKernels];
+	int numAvailable = 0;
+
+	available[numAvailable++] = &Scalar::kernels;
+
+#ifdef __SSE2__
+	static const Kernels sse2 = SimdKernels<Sse2>::kernels( "sse2" );
+	available[numAvailable++] = &sse2;
+#endif
+#ifdef LMMS_MIXHELPERS_NEON
+	static const Kernels neon = SimdKernels<Neon>::kernels( "neon" );
+	available[numAvailable++] = &neon;
+#endif
+#ifdef LMMS_MIXHELPERS_CPU_CHECK
+	// not part of any baseline, so checked at runtime
+	if( __builtin_cpu_supports( "avx2" ) && avx2Kernels() )
+	{
+		available[numAvailable++] = avx2Kernels();
+	}
+#endif
+
+	// use the last (= best) one unless another one is requested, e.g.
+	// for comparing them
+	s_kernels = available[numAvailable-1];
+
+	const char * requested = getenv( "LMMS_MIX_KERNELS" );
+	for( int i = 0; requested && i < numAvailable; ++i )
+	{
+		if( strcmp( available[i]->name, requested ) == 0 )
+		{
+			s_kernels = available[i];
+		}
+	}
+}
+
+
+
+
+const char * implementation()
+{
+	return s_kernels->name;
+}
+
+
+
+
+bool isSilent( const sampleFrame* src, int frames )
+{
+	return s_kernels->isSilent( src, frames );
+}
+
+bool sanitize( sampleFrame * src, int frames )
+{
+	return s_kernels->sanitize( src, frames );
+}
+
+void add( sampleFrame* dst, const sampleFrame* src, int frames )
+{
+	s_kernels->add( dst, src, frames );
+}
+
+void addMultiplied( sampleFrame* dst, const sampleFrame* src, float coeffSrc, int frames )
+{
+	s_kernels->addMultiplied( dst, src, coeffSrc, frames );
+}
+
+void addSwappedMultiplied( sampleFrame* dst, const sampleFrame* src, float coeffSrc, int frames )
+{
+	s_kernels->addSwappedMultiplied( dst, src, coeffSrc, frames );
+}
+
+void addMultipliedByBuffer( sampleFrame* dst, const sampleFrame* src, float coeffSrc, ValueBuffer * coeffSrcBuf, int frames )
+{
+	s_kernels->addMultipliedByBuffer( dst, src, coeffSrc, coeffSrcBuf->values(), frames );
+}
+
+void addMultipliedByBuffers( sampleFrame* dst, const sampleFrame* src, ValueBuffer * coeffSrcBuf1, ValueBuffer * coeffSrcBuf2, int frames )
+{
+	s_kernels->addMultipliedByBuffers( dst, src, coeffSrcBuf1->values(), coeffSrcBuf2->values(), frames );
+}
+
+void addSanitizedMultiplied( sampleFrame* dst, const sampleFrame* src, float coeffSrc, int frames )
+{
+	s_kernels->addSanitizedMultiplied( dst, src, coeffSrc, frames );
+}
+
+void addSanitizedMultipliedByBuffer( sampleFrame* dst, const sampleFrame* src, float coeffSrc, ValueBuffer * coeffSrcBuf, int frames )
+{
+	s_kernels->addSanitizedMultipliedByBuffer( dst, src, coeffSrc, coeffSrcBuf->values(), frames );
+}
+
+void addSanitizedMultipliedByBuffers( sampleFrame* dst, const sampleFrame* src, ValueBuffer * coeffSrcBuf1, ValueBuffer * coeffSrcBuf2, int frames )
+{
+	s_kernels->addSanitizedMultipliedByBuffers( dst, src, coeffSrcBuf1->values(), coeffSrcBuf2->values(), frames );
+}
+
+void addMultipliedStereo( sampleFrame* dst, const sampleFrame* src, float coeffSrcLeft, float coeffSrcRight, int frames )
+{
+	s_kernels->addMultipliedStereo( dst, src, coeffSrcLeft, coeffSrcRight, frames );
+}
+
+void multiplyAndAddMultiplied( sampleFrame* dst, const sampleFrame* src, float coeffDst, float coeffSrc, int frames )
+{
+	s_kernels->multiplyAndAddMultiplied( dst, src, coeffDst, coeffSrc, frames );
+}
+
+void multiplyAndAddMultipliedJoined( sampleFrame* dst, const sample_t* srcLeft, const sample_t* srcRight, float coeffDst, float coeffSrc, int frames )
+{
+	s_kernels->multiplyAndAddMultipliedJoined( dst, srcLeft, srcRight, coeffDst, coeffSrc, frames );
+}
+
+void addMultipliedByStreams( sampleFrame* dst, const sampleFrame* src, const ParameterStream & coeffSrc1, const ParameterStream & coeffSrc2, int frames )
+{
+	// use vectorized kernels where there are some
+	if( coeffSrc1.isConstant() && coeffSrc2.isConstant() )
+	{
+		s_kernels->addMultiplied( dst, src, coeffSrc1.start() * coeffSrc2.start(), frames );
+	}
+	else if( coeffSrc1.isConstant() && coeffSrc2.type() == ParameterStream::Buffer )
+	{
+		s_kernels->addMultipliedByBuffer( dst, src, coeffSrc1.start(), coeffSrc2.values(), frames );
+	}
+	else if( coeffSrc2.isConstant() && coeffSrc1.type() == ParameterStream::Buffer )
+	{
+		s_kernels->addMultipliedByBuffer( dst, src, coeffSrc2.start(), coeffSrc1.values(), frames );
+	}
+	else if( coeffSrc1.type() == ParameterStream::Buffer && coeffSrc2.type() == ParameterStream::Buffer )
+	{
+		s_kernels->addMultipliedByBuffers( dst, src, coeffSrc1.values(), coeffSrc2.values(), frames );
+	}
+	else
+	{
+		dispatch( AddMultipliedByCoeffsOp<false>( dst, src, frames ), coeffSrc1, coeffSrc2 );
+	}
+}
+
+void addSanitizedMultipliedByStreams( sampleFrame* dst, const sampleFrame* src, const ParameterStream & coeffSrc1, const ParameterStream & coeffSrc2, int frames )
+{
+	if( coeffSrc1.isConstant() && coeffSrc2.isConstant() )
+	{
+		s_kernels->addSanitizedMultiplied( dst, src, coeffSrc1.start() * coeffSrc2.start(), frames );
+	}
+	else if( coeffSrc1.isConstant() && coeffSrc2.type() == ParameterStream::Buffer )
+	{
+		s_kernels->addSanitizedMultipliedByBuffer( dst, src, coeffSrc1.start(), coeffSrc2.values(), frames );
+	}
+	else if( coeffSrc2.isConstant() && coeffSrc1.type() == ParameterStream::Buffer )
+	{
+		s_kernels->addSanitizedMultipliedByBuffer( dst, src, coeffSrc2.start(), coeffSrc1.values(), frames );
+	}
+	else if( coeffSrc1.type() == ParameterStream::Buffer && coeffSrc2.type() == ParameterStream::Buffer )
+	{
+		s_kernels->addSanitizedMultipliedByBuffers( dst, src, coeffSrc1.values(), coeffSrc2.values(), frames );
+	}
+	else
+	{
+		dispatch( AddMultipliedByCoeffsOp<true>( dst, src, frames ), coeffSrc1, coeffSrc2 );
+	}
+}
+
+void multiplyByVolumeAndPanning( sampleFrame* buf, const ParameterStream & volume, const ParameterStream & panning, int frames )
+{
+	dispatch( MultiplyByVolumeAndPanningOp( buf, frames ), volume, panning );
+}
+
 }
 
@@ -0,0 +1,115 @@
+/*
+ * MixHelpersAvx2.cpp - AVX2 implementation of MixHelpers
+ *
+ * Copyright (c) 2026 agent <agent/at/local>
+ *
+ * This file is part of LMMS - http://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+// this file is the only one built with AVX2 enabled (see CMakeLists.txt) -
+// don't include anything here which could instantiate shared inline code
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#include "MixHelpersSimd.h"
+
+
+namespace MixHelpers
+{
+
+#ifdef __AVX2__
+namespace
+{
+
+struct Avx2
+{
+	typedef __m256 Vec;
+	enum { Width = 8 };
+
+	static inline Vec load( const float* p ) { return _mm256_loadu_ps( p ); }
+	static inline void store( float* p, Vec v ) { _mm256_storeu_ps( p, v ); }
+	static inline Vec set1( float x ) { return _mm256_set1_ps( x ); }
+	static inline Vec set2( float l, float r ) { return _mm256_setr_ps( l, r, l, r, l, r, l, r ); }
+	static inline Vec add( Vec a, Vec b ) { return _mm256_add_ps( a, b ); }
+	static inline Vec mul( Vec a, Vec b ) { return _mm256_mul_ps( a, b ); }
+
+	static inline Vec swapPairs( Vec v )
+	{
+		return _mm256_permute_ps( v, _MM_SHUFFLE( 2, 3, 0, 1 ) );
+	}
+
+	static inline Vec combine( __m128 lo, __m128 hi )
+	{
+		return _mm256_insertf128_ps( _mm256_castps128_ps256( lo ), hi, 1 );
+	}
+
+	// { c[0], c[0], c[1], c[1], c[2], c[2], c[3], c[3] }
+	static inline Vec loadDuplicated( const float* c )
+	{
+		const __m128 v = _mm_loadu_ps( c );
+		return combine( _mm_unpacklo_ps( v, v ), _mm_unpackhi_ps( v, v ) );
+	}
+
+	// { l[0], r[0], l[1], r[1], l[2], r[2], l[3], r[3] }
+	static inline Vec loadInterleaved( const float* l, const float* r )
+	{
+		const __m128 vl = _mm_loadu_ps( l );
+		const __m128 vr = _mm_loadu_ps( r );
+		return combine( _mm_unpacklo_ps( vl, vr ), _mm_unpackhi_ps( vl, vr ) );
+	}
+
+	static inline Vec nonFinite( Vec v )
+	{
+		const __m256i exp = _mm256_set1_epi32( 0x7f800000 );
+		return _mm256_castsi256_ps( _mm256_cmpeq_epi32(
+				_mm256_and_si256( _mm256_castps_si256( v ), exp ), exp ) );
+	}
+
+	static inline Vec andNot( Vec mask, Vec v ) { return _mm256_andnot_ps( mask, v ); }
+	static inline bool any( Vec mask ) { return _mm256_movemask_ps( mask ) != 0; }
+
+	static inline bool anyAbsGreaterEqual( Vec v, Vec threshold )
+	{
+		const Vec abs = _mm256_andnot_ps( _mm256_set1_ps( -0.0f ), v );
+		return _mm256_movemask_ps( _mm256_cmp_ps( abs, threshold, _CMP_GE_OQ ) ) != 0;
+	}
+} ;
+
+}
+
+
+const Kernels * avx2Kernels()
+{
+	static const Kernels kernels = SimdKernels<Avx2>::kernels( "avx2" );
+	return &kernels;
+}
+
+#else
+
+const Kernels * avx2Kernels()
+{
+	return NULL;
+}
+
+#endif
+
+}
+
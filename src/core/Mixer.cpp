@@ -25,6 +25,7 @@
 #include <math.h>
 
 #include "Mixer.h"
+#include "AudioPort.h"
 #include "FxMixer.h"
 #include "MixHelpers.h"
 #include "MixerWorkerThread.h"
@@ -59,6 +60,10 @@
 #include "BufferManager.h"
 
 
+// seconds lookahead stays suspended after last live input
+static const float LiveInputHoldTime = 2.0f;
+
+
 
 Mixer::Mixer() :
 	m_framesPerPeriod( DEFAULT_BUFFER_SIZE ),
@@ -67,16 +72,43 @@ Mixer::Mixer() :
 	m_inputBufferWrite( 1 ),
 	m_readBuf( NULL ),
 	m_writeBuf( NULL ),
+	m_renderPeriod( 0 ),
 	m_workers(),
 	m_numWorkers( QThread::idealThreadCount()-1 ),
 	m_queueReadyWaitCond(),
+	m_playHandles( PlayHandle::MixerList ),
 	m_qualitySettings( qualitySettings::Mode_Draft ),
 	m_masterGain( 1.0f ),
 	m_audioDev( NULL ),
 	m_oldAudioDev( NULL ),
 	m_globalMutex( QMutex::Recursive ),
-	m_profiler()
+	m_fifo( NULL ),
+	m_fifoWriter( NULL ),
+	m_fifoPeriods( 1 ),
+	m_lookahead( 0 ),
+	m_liveInputHold( 0 ),
+	m_profiler(),
+	m_maxVoices( 0 ),
+	m_voiceStealingPolicy( StealReleasedFirst ),
+	m_stolenVoices( 0 ),
+	m_droppedVoices( 0 ),
+	m_voices()
 {
+	m_newPlayHandles.reserve( 256 );
+	m_scheduledPlayHandles.reserve( 256 );
+	m_retiredNotePlayHandles.reserve( 256 );
+
+	m_maxVoices = qMax( ConfigManager::inst()->value( "mixer", "maxvoices" ).toInt(), 0 );
+	const QString policy = ConfigManager::inst()->value( "mixer", "voicestealing" );
+	if( policy == "oldest" )
+	{
+		m_voiceStealingPolicy = StealOldest;
+	}
+	else if( policy == "quietest" )
+	{
+		m_voiceStealingPolicy = StealQuietest;
+	}
+
 	for( int i = 0; i < 2; ++i )
 	{
 		m_inputBufferFrames[i] = 0;
@@ -89,7 +121,6 @@ Mixer::Mixer() :
 	if( !Engine::hasGUI() )
 	{
 		m_framesPerPeriod = DEFAULT_BUFFER_SIZE;
-		m_fifo = new fifo( 1 );
 	}
 	else if( ConfigManager::inst()->value( "mixer", "framesperaudiobuffer"
 						).toInt() >= 32 )
@@ -100,23 +131,25 @@ Mixer::Mixer() :
 
 		if( m_framesPerPeriod > DEFAULT_BUFFER_SIZE )
 		{
-			m_fifo = new fifo( m_framesPerPeriod
-							/ DEFAULT_BUFFER_SIZE );
+			m_fifoPeriods = m_framesPerPeriod / DEFAULT_BUFFER_SIZE;
 			m_framesPerPeriod = DEFAULT_BUFFER_SIZE;
 		}
-		else
-		{
-			m_fifo = new fifo( 1 );
-		}
 	}
 	else
 	{
 		ConfigManager::inst()->setValue( "mixer",
 							"framesperaudiobuffer",
 				QString::number( m_framesPerPeriod ) );
-		m_fifo = new fifo( 1 );
 	}
 
+	// leave room for lookahead, it can be enabled at any time
+	m_fifo = new fifo( m_fifoPeriods + ( Engine::hasGUI() ?
+						MAX_LOOKAHEAD_PERIODS : 0 ),
+							m_framesPerPeriod );
+	m_fifo->setDepth( m_fifoPeriods );
+	setLookahead( ConfigManager::inst()->value( "mixer",
+						"lookahead" ).toInt() );
+
 	// now that framesPerPeriod is fixed initialize global BufferManager
 	BufferManager::init( m_framesPerPeriod );
 
@@ -164,10 +197,6 @@ Mixer::~Mixer()
 		m_workers[w]->wait( 500 );
 	}
 
-	while( m_fifo->available() )
-	{
-		delete[] m_fifo->read();
-	}
 	delete m_fifo;
 
 	delete m_audioDev;
@@ -202,6 +231,7 @@ void Mixer::startProcessing( bool _needs_fifo )
 {
 	if( _needs_fifo )
 	{
+		m_fifo->reset();
 		m_fifoWriter = new fifoWriter( this, m_fifo );
 		m_fifoWriter->start( QThread::HighPriority );
 	}
@@ -314,6 +344,51 @@ void Mixer::pushInputFrames( sampleFrame * _ab, const f_cnt_t _frames )
 
 
 
+void Mixer::setLookahead( int _periods )
+{
+	// nothing to render ahead for if there's no fifo writer at all
+	m_lookahead = Engine::hasGUI() ?
+			qBound( 0, _periods, MAX_LOOKAHEAD_PERIODS ) : 0;
+}
+
+
+
+
+void Mixer::notifyLiveInput()
+{
+	if( m_lookahead > 0 )
+	{
+		// keep latency low for some time, player is likely to go on
+		m_liveInputHold.fetchAndStoreOrdered( qMax( 1,
+				(int)( LiveInputHoldTime * processingSampleRate() /
+							m_framesPerPeriod ) ) );
+	}
+}
+
+
+
+
+void Mixer::updateFifoDepth()
+{
+	const int hold = m_liveInputHold;
+	if( hold > 0 )
+	{
+		// fails if there was new live input meanwhile, which is fine
+		m_liveInputHold.testAndSetOrdered( hold, hold - 1 );
+	}
+
+	// when suspending lookahead, periods already rendered ahead are
+	// played anyway but no new ones are added until ring drained
+	const int depth = m_fifoPeriods + ( hold > 0 ? 0 : m_lookahead );
+	if( depth != m_fifo->depth() )
+	{
+		m_fifo->setDepth( depth );
+	}
+}
+
+
+
+
 const surroundSampleFrame * Mixer::renderNextBuffer()
 {
 	m_profiler.startPeriod();
@@ -348,26 +423,18 @@ const surroundSampleFrame * Mixer::renderNextBuffer()
 
 	// remove all play-handles that have to be deleted and delete
 	// them if they still exist...
-	// maybe this algorithm could be optimized...
 	lockPlayHandleRemoval();
-	ConstPlayHandleList::Iterator it_rem = m_playHandlesToRemove.begin();
-	while( it_rem != m_playHandlesToRemove.end() )
+	for( ConstPlayHandleList::ConstIterator it = m_playHandlesToRemove.begin();
+					it != m_playHandlesToRemove.end(); ++it )
 	{
-		PlayHandleList::Iterator it = qFind( m_playHandles.begin(), m_playHandles.end(), *it_rem );
-
-		if( it != m_playHandles.end() )
+		PlayHandle * ph = const_cast<PlayHandle *>( *it );
+		if( m_playHandles.remove( ph ) )
 		{
-			( *it )->audioPort()->removePlayHandle( ( *it ) );
-			if( ( *it )->type() == PlayHandle::TypeNotePlayHandle ) 
-			{
-				NotePlayHandleManager::release( (NotePlayHandle*) *it );
-			}
-			else delete *it;
-			m_playHandles.erase( it );
+			retirePlayHandle( ph );
 		}
-
-		it_rem = m_playHandlesToRemove.erase( it_rem );
 	}
+	m_playHandlesToRemove.clear();
+	deleteRetiredPlayHandles();
 	unlockPlayHandleRemoval();
 
 	// now we have to make sure no other thread does anything bad
@@ -381,6 +448,9 @@ const surroundSampleFrame * Mixer::renderNextBuffer()
 	m_writeBuf = m_bufferPool[m_writeBuffer];
 	m_readBuf = m_bufferPool[m_readBuffer];
 
+	// never negative, so -1 can be used for "no period"
+	m_renderPeriod = ( m_renderPeriod + 1 ) & 0x7fffffff;
+
 	// clear last audio-buffer
 	clearAudioBuffer( m_writeBuf, m_framesPerPeriod );
 
@@ -388,20 +458,67 @@ const surroundSampleFrame * Mixer::renderNextBuffer()
 	Engine::fxMixer()->prepareMasterMix();
 
 	// create play-handles for new notes, samples etc.
+	m_profiler.startStage();
 	Engine::getSong()->processNextBuffer();
+	m_profiler.finishStage( MixerProfiler::SongStage );
 
 	// add all play-handles that have to be added
 	m_playHandleMutex.lock();
-	m_playHandles += m_newPlayHandles;
-	m_newPlayHandles.clear();
+	for( PlayHandleVector::ConstIterator it = m_newPlayHandles.begin(); it != m_newPlayHandles.end(); ++it )
+	{
+		m_playHandles.append( *it );
+	}
+	m_newPlayHandles.resize( 0 );
 	m_playHandleMutex.unlock();
 
-	// STAGE 1: run and render all play handles
+	// build the processing graph of this period: play handles feed their
+	// audio port, audio ports feed their FX channel and FX channels feed
+	// their receivers down to master. Every node gets queued as soon as all
+	// of its inputs are ready instead of waiting for a stage barrier.
 	lockPlayHandleRemoval();
-	MixerWorkerThread::fillJobQueue<PlayHandleList>( m_playHandles );
+
+	limitVoices();
+
+	MixerWorkerThread::resetJobQueue( MixerWorkerThread::JobQueue::Dynamic );
+
+	for( QVector<AudioPort *>::ConstIterator it = m_audioPorts.begin(); it != m_audioPorts.end(); ++it )
+	{
+		( *it )->resetDependencies();
+	}
+	// requiresProcessing() may change at any time, so ask only once and
+	// queue exactly the handles counted as dependencies - otherwise a port
+	// could wait for a handle which never gets processed
+	m_scheduledPlayHandles.resize( 0 );
+	for( PlayHandleList::ConstIterator it = m_playHandles.begin(); it != m_playHandles.end(); ++it )
+	{
+		if( ( *it )->requiresProcessing() )
+		{
+			( *it )->audioPort()->addDependency();
+			m_scheduledPlayHandles.append( *it );
+		}
+	}
+
+	Engine::fxMixer()->prepareChannels( m_audioPorts );
+
+	for( PlayHandleVector::ConstIterator it = m_scheduledPlayHandles.begin(); it != m_scheduledPlayHandles.end(); ++it )
+	{
+		MixerWorkerThread::enqueueJob( *it );
+	}
+	for( QVector<AudioPort *>::ConstIterator it = m_audioPorts.begin(); it != m_audioPorts.end(); ++it )
+	{
+		if( ( *it )->hasDependencies() == false )
+		{
+			MixerWorkerThread::addJob( *it );
+		}
+	}
+
 	MixerWorkerThread::startAndWaitForJobs();
 
-	// removed all play handles which are done
+	// pick up times of workers while all profiled objects still exist
+	m_profiler.collect();
+
+	// removed all play handles which are done - their audio ports already
+	// took their output of this period
 	for( PlayHandleList::Iterator it = m_playHandles.begin();
 						it != m_playHandles.end(); )
 	{
@@ -413,28 +530,22 @@ const surroundSampleFrame * Mixer::renderNextBuffer()
 		}
 		if( ( *it )->isFinished() )
 		{
-			( *it )->audioPort()->removePlayHandle( ( *it ) );
-			if( ( *it )->type() == PlayHandle::TypeNotePlayHandle ) 
-			{
-				NotePlayHandleManager::release( (NotePlayHandle*) *it );
-			}
-			else delete *it;
+			PlayHandle * ph = *it;
 			it = m_playHandles.erase( it );
+			retirePlayHandle( ph );
 		}
 		else
 		{
 			++it;
 		}
 	}
+	deleteRetiredPlayHandles();
 	unlockPlayHandleRemoval();
 
-	// STAGE 2: process effects of all instrument- and sampletracks
-	MixerWorkerThread::fillJobQueue<QVector<AudioPort *> >( m_audioPorts );
-	MixerWorkerThread::startAndWaitForJobs();
-
-
-	// STAGE 3: do master mix in FX mixer
+	// do master mix in FX mixer
+	m_profiler.startStage();
 	Engine::fxMixer()->masterMix( m_writeBuf );
+	m_profiler.finishStage( MixerProfiler::MasterMixStage );
 
 	unlock();
 
@@ -445,9 +556,6 @@ const surroundSampleFrame * Mixer::renderNextBuffer()
 	EnvelopeAndLfoParameters::instances()->trigger();
 	Controller::triggerFrameCounter();
 	AutomatableModel::incrementPeriodCounter();
-	
-	// refresh buffer pool
-	BufferManager::refresh();
 
 	m_profiler.finishPeriod( processingSampleRate(), m_framesPerPeriod );
 
@@ -627,24 +735,15 @@ void Mixer::removeAudioPort( AudioPort * _port )
 }
 
 
+// new handles are always accepted - if there are too many notes or the CPU
+// can't keep up, limitVoices() decides which notes have to give way
 bool Mixer::addPlayHandle( PlayHandle* handle )
 {
-	if( criticalXRuns() == false )
-	{
-		m_playHandleMutex.lock();
-			m_newPlayHandles.append( handle );
-			handle->audioPort()->addPlayHandle( handle );
-		m_playHandleMutex.unlock();
-		return true;
-	}
-
-	if( handle->type() == PlayHandle::TypeNotePlayHandle ) 
-	{
-		NotePlayHandleManager::release( (NotePlayHandle*)handle );
-	}
-	else delete handle;
-
-	return false;
+	m_playHandleMutex.lock();
+		m_newPlayHandles.append( handle );
+		handle->audioPort()->addPlayHandle( handle );
+	m_playHandleMutex.unlock();
+	return true;
 }
 
 
@@ -656,18 +755,14 @@ void Mixer::removePlayHandle( PlayHandle * _ph )
 				_ph->affinity() == QThread::currentThread() )
 	{
 		lockPlayHandleRemoval();
-		_ph->audioPort()->removePlayHandle( _ph );
-		PlayHandleList::Iterator it =
-				qFind( m_playHandles.begin(),
-						m_playHandles.end(), _ph );
-		if( it != m_playHandles.end() )
-		{
-			m_playHandles.erase( it );
-			if( _ph->type() == PlayHandle::TypeNotePlayHandle ) 
-			{
-				NotePlayHandleManager::release( (NotePlayHandle*) _ph );
-			}
-			else delete _ph;
+		if( m_playHandles.remove( _ph ) )
+		{
+			retirePlayHandle( _ph );
+			deleteRetiredPlayHandles();
+		}
+		else
+		{
+			_ph->audioPort()->removePlayHandle( _ph );
 		}
 		unlockPlayHandleRemoval();
 	}
@@ -688,25 +783,201 @@ void Mixer::removePlayHandles( Track * _track, bool removeIPHs )
 	{
 		if( ( *it )->isFromTrack( _track ) && ( removeIPHs || ( *it )->type() != PlayHandle::TypeInstrumentPlayHandle ) )
 		{
-			( *it )->audioPort()->removePlayHandle( ( *it ) );
-			if( ( *it )->type() == PlayHandle::TypeNotePlayHandle ) 
-			{
-				NotePlayHandleManager::release( (NotePlayHandle*) *it );
-			}
-			else delete *it;
+			PlayHandle * ph = *it;
 			it = m_playHandles.erase( it );
+			retirePlayHandle( ph );
 		}
 		else
 		{
 			++it;
 		}
 	}
+	deleteRetiredPlayHandles();
 	unlockPlayHandleRemoval();
 }
 
 
 
 
+void Mixer::retirePlayHandle( PlayHandle * _ph )
+{
+	_ph->audioPort()->removePlayHandle( _ph );
+	if( _ph->type() == PlayHandle::TypeNotePlayHandle )
+	{
+		m_retiredNotePlayHandles.append( (NotePlayHandle *) _ph );
+	}
+	else
+	{
+		delete _ph;
+	}
+}
+
+
+
+
+void Mixer::deleteRetiredPlayHandles()
+{
+	if( !m_retiredNotePlayHandles.isEmpty() )
+	{
+		NotePlayHandleManager::release( m_retiredNotePlayHandles.data(),
+					m_retiredNotePlayHandles.size() );
+		m_retiredNotePlayHandles.resize( 0 );
+	}
+}
+
+
+
+
+bool Mixer::voiceTrackLessThan( const Voice & _a, const Voice & _b )
+{
+	return _a.track < _b.track;
+}
+
+
+bool Mixer::voicePriorityLessThan( const Voice & _a, const Voice & _b )
+{
+	return _a.priority < _b.priority;
+}
+
+
+void Mixer::limitVoices()
+{
+	// under critical load new notes have to take the place of notes
+	// already playing instead of adding to the load
+	const bool critical = criticalXRuns();
+
+	m_voices.resize( 0 );
+	bool trackLimits = false;
+	int playingVoices = 0;
+
+	for( PlayHandleList::ConstIterator it = m_playHandles.begin(); it != m_playHandles.end(); ++it )
+	{
+		if( ( *it )->type() != PlayHandle::TypeNotePlayHandle )
+		{
+			continue;
+		}
+		NotePlayHandle * nph = (NotePlayHandle *) *it;
+		// master notes of chords and arpeggios don't play themselves
+		if( nph->isMasterNote() || nph->isStolen() || nph->isMuted() ||
+							nph->isFinished() )
+		{
+			continue;
+		}
+
+		Voice v;
+		v.handle = nph;
+		v.track = nph->instrumentTrack();
+		v.priority = 0;
+		m_voices.append( v );
+
+		trackLimits |= v.track->maxVoices() > 0;
+		if( nph->totalFramesPlayed() > 0 )
+		{
+			++playingVoices;
+		}
+	}
+
+	if( trackLimits )
+	{
+		qSort( m_voices.begin(), m_voices.end(), voiceTrackLessThan );
+		for( int first = 0; first < m_voices.size(); )
+		{
+			const InstrumentTrack * track = m_voices[first].track;
+			int last = first + 1;
+			while( last < m_voices.size() && m_voices[last].track == track )
+			{
+				++last;
+			}
+			const int limit = track->maxVoices();
+			if( limit > 0 && last - first > limit )
+			{
+				stealVoices( first, last, last - first - limit );
+			}
+			first = last;
+		}
+
+		// forget about voices stolen above
+		int n = 0;
+		for( int i = 0; i < m_voices.size(); ++i )
+		{
+			if( !m_voices[i].handle->isStolen() )
+			{
+				m_voices[n++] = m_voices[i];
+			}
+		}
+		m_voices.resize( n );
+	}
+
+	int limit = m_maxVoices;
+	if( critical && ( limit == 0 || playingVoices < limit ) )
+	{
+		limit = qMax( playingVoices, 1 );
+	}
+
+	if( limit > 0 && m_voices.size() > limit )
+	{
+		stealVoices( 0, m_voices.size(), m_voices.size() - limit );
+	}
+}
+
+
+
+
+void Mixer::stealVoices( int _first, int _last, int _count )
+{
+	for( int i = _first; i < _last; ++i )
+	{
+		m_voices[i].priority = voicePriority( m_voices[i].handle );
+	}
+	qSort( m_voices.begin() + _first, m_voices.begin() + _last,
+							voicePriorityLessThan );
+
+	for( int i = _first; i < _first + _count; ++i )
+	{
+		NotePlayHandle * nph = m_voices[i].handle;
+		if( nph->totalFramesPlayed() > 0 )
+		{
+			++m_stolenVoices;
+		}
+		else
+		{
+			++m_droppedVoices;
+		}
+		nph->steal();
+	}
+}
+
+
+
+
+double Mixer::voicePriority( NotePlayHandle * _nph ) const
+{
+	const double age = _nph->totalFramesPlayed();
+
+	switch( m_voiceStealingPolicy )
+	{
+		case StealOldest:
+			return -age;
+
+		case StealQuietest:
+		{
+			// the envelope of notes which didn't start yet doesn't
+			// tell anything about how loud they are going to be
+			const double level = _nph->totalFramesPlayed() > 0 ?
+				fabs( _nph->volumeLevel( _nph->totalFramesPlayed() ) ) : 1.0;
+			return level * _nph->getVolume();
+		}
+
+		case StealReleasedFirst:
+		default:
+			// released notes before held ones, oldest first
+			return _nph->isReleased() ? -age - 1e12 : -age;
+	}
+}
+
+
+
+
 bool Mixer::hasNotePlayHandles()
 {
 	lock();
@@ -957,13 +1228,15 @@ void Mixer::fifoWriter::run()
 	const fpp_t frames = m_mixer->framesPerPeriod();
 	while( m_writing )
 	{
-		surroundSampleFrame * buffer = new surroundSampleFrame[frames];
+		m_mixer->updateFifoDepth();
+		surroundSampleFrame * buffer = m_fifo->writeBuffer();
 		const surroundSampleFrame * b = m_mixer->renderNextBuffer();
 		memcpy( buffer, b, frames * sizeof( surroundSampleFrame ) );
-		m_fifo->write( buffer );
+		// mix returned by renderNextBuffer() is the one of previous period
+		m_fifo->publish( m_mixer->renderPeriod() - 1 );
 	}
 
-	m_fifo->write( NULL );
+	m_fifo->close();
 }
 
 
@@ -24,18 +24,78 @@
 
 #include "MixerProfiler.h"
 
+#include <QtCore/QMutexLocker>
+#include <QtCore/QtAlgorithms>
+#include <QtCore/QtEndian>
+
+#include "AudioPort.h"
+#include "BufferManager.h"
+#include "Effect.h"
+#include "Engine.h"
+#include "FxMixer.h"
+#include "Mixer.h"
+#include "SampleCache.h"
+
+
+// max. number of times recorded by workers per period
+const int MAX_RECORDS = 8192;
+const quint16 TRACE_VERSION = 2;
+
+
+static QAtomicInt s_nextProfileId;
+
+
+ProfiledObject::ProfiledObject() :
+	m_profileId( (quint32) s_nextProfileId.fetchAndAddOrdered( 1 ) )
+{
+}
+
+
+
+
+ProfiledObject::~ProfiledObject()
+{
+	// mixer is gone already when FX mixer gets destroyed
+	if( Engine::mixer() != NULL )
+	{
+		Engine::mixer()->profiler().remove( m_profileId );
+	}
+}
+
+
+
 
 MixerProfiler::MixerProfiler() :
 	m_periodTimer(),
+	m_stageTimer(),
 	m_cpuLoad( 0 ),
-	m_outputFile()
+	m_outputFile(),
+	m_traceFile(),
+	m_traceSampleRate( 0 ),
+	m_traceFramesPerPeriod( 0 ),
+	m_detailed( false ),
+	m_records( new Record[MAX_RECORDS] ),
+	m_recordCount( 0 ),
+	m_droppedRecords( 0 ),
+	m_periods( 0 ),
+	m_entryMutex(),
+	m_entries(),
+	m_periodEntryTime(),
+	m_nextEntryId( 0 )
 {
+	for( int i = 0; i < NumStages; ++i )
+	{
+		m_periodStageTime[i] = 0;
+		m_stageTime[i] = 0;
+		m_totalStageTime[i] = 0;
+	}
 }
 
 
 
 MixerProfiler::~MixerProfiler()
 {
+	delete[] m_records;
 }
 
 
@@ -46,18 +106,353 @@ void MixerProfiler::finishPeriod( sample_rate_t sampleRate, fpp_t framesPerPerio
 	const float newCpuLoad = periodElapsed / 10000.0f * sampleRate / framesPerPeriod;
     m_cpuLoad = qBound<int>( 0, ( newCpuLoad * 0.1f + m_cpuLoad * 0.9f ), 100 );
 
+	for( int i = 0; i < NumStages; ++i )
+	{
+		m_stageTime[i] = m_periodStageTime[i];
+		m_totalStageTime[i] += m_periodStageTime[i];
+		m_periodStageTime[i] = 0;
+	}
+	++m_periods;
+
+	QMutexLocker ml( &m_entryMutex );
+
 	if( m_outputFile.isOpen() )
 	{
 		m_outputFile.write( QString( "%1\n" ).arg( periodElapsed ).toLatin1() );
 	}
+
+	if( m_traceFile.isOpen() )
+	{
+		if( sampleRate != m_traceSampleRate || framesPerPeriod != m_traceFramesPerPeriod )
+		{
+			m_traceSampleRate = sampleRate;
+			m_traceFramesPerPeriod = framesPerPeriod;
+			write<quint8>( 'S' );
+			write<quint32>( sampleRate );
+			write<quint16>( framesPerPeriod );
+		}
+
+		write<quint8>( 'P' );
+		write<quint32>( periodElapsed );
+		for( int i = 0; i < NumStages; ++i )
+		{
+			write<quint32>( m_stageTime[i] );
+		}
+
+		write<quint32>( m_periodEntryTime.size() );
+		for( QHash<EntryKey, int>::ConstIterator it =
+						m_periodEntryTime.begin();
+				it != m_periodEntryTime.end(); ++it )
+		{
+			write<quint32>( m_entries[it.key()].id );
+			write<quint32>( it.value() );
+		}
+	}
+
+	m_periodEntryTime.clear();
+}
+
+
+
+
+void MixerProfiler::record( EntryTypes _type, const ProfiledObject * _object,
+								int _time )
+{
+	const int i = m_recordCount.fetchAndAddOrdered( 1 );
+	if( i < MAX_RECORDS )
+	{
+		m_records[i].object = _object;
+		m_records[i].type = _type;
+		m_records[i].time = _time;
+	}
+}
+
+
+
+
+void MixerProfiler::collect()
+{
+	const int recorded = m_recordCount;
+	const int n = qMin( recorded, MAX_RECORDS );
+	m_recordCount = 0;
+
+	if( recorded > n )
+	{
+		m_droppedRecords += recorded - n;
+	}
+
+	if( n == 0 )
+	{
+		return;
+	}
+
+	QMutexLocker ml( &m_entryMutex );
+
+	for( int i = 0; i < n; ++i )
+	{
+		const Record & r = m_records[i];
+
+		switch( r.type )
+		{
+			case PlayHandleEntry: m_periodStageTime[PlayHandleStage] += r.time; break;
+			case AudioPortEntry: m_periodStageTime[AudioPortStage] += r.time; break;
+			case FxChannelEntry: m_periodStageTime[FxChannelStage] += r.time; break;
+			default: break; // effects are part of audio ports and FX channels
+		}
+
+		const EntryKey key( r.object->profileId(), r.type );
+		if( !m_entries.contains( key ) )
+		{
+			Entry e;
+			e.id = m_nextEntryId++;
+			e.type = r.type;
+			e.name = entryName( r.type, r.object );
+			e.totalTime = 0;
+			e.lastTime = 0;
+			e.maxTime = 0;
+
+			m_entries[key] = e;
+			writeName( e );
+		}
+
+		m_periodEntryTime[key] += r.time;
+	}
+
+	for( QHash<EntryKey, int>::ConstIterator it = m_periodEntryTime.begin();
+					it != m_periodEntryTime.end(); ++it )
+	{
+		Entry & e = m_entries[it.key()];
+		e.lastTime = it.value();
+		e.totalTime += e.lastTime;
+		e.maxTime = qMax( e.maxTime, e.lastTime );
+	}
+}
+
+
+
+
+void MixerProfiler::remove( quint32 _profileId )
+{
+	QMutexLocker ml( &m_entryMutex );
+
+	for( int t = 0; t < NumEntryTypes; ++t )
+	{
+		const EntryKey key( _profileId, t );
+		m_entries.remove( key );
+		m_periodEntryTime.remove( key );
+	}
+}
+
+
+
+
+void MixerProfiler::setDetailed( bool _on )
+{
+	m_detailed = _on;
+}
+
+
+
+
+QVector<MixerProfiler::Entry> MixerProfiler::entries() const
+{
+	QMutexLocker ml( &m_entryMutex );
+	return m_entries.values().toVector();
+}
+
+
+
+
+void MixerProfiler::reset()
+{
+	QMutexLocker ml( &m_entryMutex );
+
+	m_entries.clear();
+	m_periodEntryTime.clear();
+
+	for( int i = 0; i < NumStages; ++i )
+	{
+		m_totalStageTime[i] = 0;
+	}
+	m_periods = 0;
+	m_droppedRecords = 0;
+}
+
+
+
+
+static bool entryLessThan( const MixerProfiler::Entry & _a, const MixerProfiler::Entry & _b )
+{
+	return _a.totalTime > _b.totalTime;
 }
 
 
+void MixerProfiler::printSummary( FILE * _out, int _maxEntries ) const
+{
+	const int periods = qMax( m_periods, 1 );
+
+	fprintf( _out, "\nProfile of %d periods\n\n", m_periods );
+	fprintf( _out, "%-24s %12s %12s\n", "stage", "total ms", "avg us" );
+	for( int i = 0; i < NumStages; ++i )
+	{
+		fprintf( _out, "%-24s %12.1f %12.1f\n", stageName( (Stages) i ),
+				m_totalStageTime[i] / 1000.0,
+				(double) m_totalStageTime[i] / periods );
+	}
+
+	fprintf( _out, "\nbuffer pool: %d buffers, peak usage %d, extended "
+			"%d times\n", BufferManager::size(),
+			BufferManager::peakUsage(),
+			BufferManager::extensions() );
+	fprintf( _out, "voices: %d stolen, %d dropped by polyphony limits\n",
+			Engine::mixer()->stolenVoices(),
+			Engine::mixer()->droppedVoices() );
+	fprintf( _out, "sample cache: %d hits, %d misses, %.1f MB held, "
+			"%.1f MB saved by sharing\n", SampleCache::hits(),
+			SampleCache::misses(),
+			SampleCache::bytes() / ( 1024.0 * 1024.0 ),
+			SampleCache::savedBytes() / ( 1024.0 * 1024.0 ) );
+
+	if( m_droppedRecords > 0 )
+	{
+		fprintf( _out, "\n%d times of objects dropped (more than %d in a "
+				"period), per-object times are incomplete\n",
+					m_droppedRecords, MAX_RECORDS );
+	}
+
+	QVector<Entry> e = entries();
+	if( e.isEmpty() )
+	{
+		return;
+	}
+	qSort( e.begin(), e.end(), entryLessThan );
+
+	fprintf( _out, "\n%-14s %-30s %12s %12s %12s\n", "type", "name",
+					"total ms", "avg us", "max us" );
+	for( int i = 0; i < e.size() && i < _maxEntries; ++i )
+	{
+		fprintf( _out, "%-14s %-30s %12.1f %12.1f %12d\n",
+				entryTypeName( e[i].type ),
+				e[i].name.left( 30 ).toUtf8().constData(),
+				e[i].totalTime / 1000.0,
+				(double) e[i].totalTime / periods,
+				e[i].maxTime );
+	}
+}
+
+
+
+
+const char * MixerProfiler::stageName( Stages _stage )
+{
+	switch( _stage )
+	{
+		case SongStage: return "song";
+		case PlayHandleStage: return "play handles";
+		case AudioPortStage: return "audio ports";
+		case FxChannelStage: return "FX channels";
+		case MasterMixStage: return "master mix";
+		default: break;
+	}
+	return "";
+}
+
+
+
+
+const char * MixerProfiler::entryTypeName( EntryTypes _type )
+{
+	switch( _type )
+	{
+		case PlayHandleEntry: return "play handles";
+		case AudioPortEntry: return "audio port";
+		case EffectEntry: return "effect";
+		case FxChannelEntry: return "FX channel";
+		default: break;
+	}
+	return "";
+}
+
+
+
 
 void MixerProfiler::setOutputFile( const QString& outputFile )
 {
+	QMutexLocker ml( &m_entryMutex );
+
 	m_outputFile.close();
 	m_outputFile.setFileName( outputFile );
 	m_outputFile.open( QFile::WriteOnly | QFile::Truncate );
+
+	m_traceFile.close();
+	m_traceFile.setFileName( outputFile + ".trace" );
+	if( m_traceFile.open( QFile::WriteOnly | QFile::Truncate ) )
+	{
+		m_traceFile.write( "LMPF", 4 );
+		write<quint16>( TRACE_VERSION );
+		write<quint8>( NumStages );
+		m_traceSampleRate = 0;
+		m_traceFramesPerPeriod = 0;
+
+		foreach( const Entry & e, m_entries )
+		{
+			writeName( e );
+		}
+
+		// per-object times are what the trace is for
+		setDetailed( true );
+	}
+}
+
+
+
+
+QString MixerProfiler::entryName( EntryTypes _type,
+					const ProfiledObject * _object ) const
+{
+	switch( _type )
+	{
+		case PlayHandleEntry:
+		case AudioPortEntry:
+			return static_cast<const AudioPort *>( _object )->name();
+		case EffectEntry:
+			return static_cast<const Effect *>( _object )->displayName();
+		case FxChannelEntry:
+		{
+			const FxChannel * ch = static_cast<const FxChannel *>( _object );
+			return ch->m_name.isEmpty() ?
+				QString( "FX %1" ).arg( ch->m_channelIndex ) : ch->m_name;
+		}
+		default:
+			break;
+	}
+	return QString();
+}
+
+
+
+
+template<typename T>
+void MixerProfiler::write( T _value )
+{
+	_value = qToLittleEndian( _value );
+	m_traceFile.write( (const char *) &_value, sizeof( _value ) );
 }
 
+
+
+
+void MixerProfiler::writeName( const Entry & _entry )
+{
+	if( !m_traceFile.isOpen() )
+	{
+		return;
+	}
+
+	const QByteArray name = _entry.name.toUtf8().left( 0xffff );
+	write<quint8>( 'N' );
+	write<quint32>( _entry.id );
+	write<quint8>( _entry.type );
+	write<quint16>( name.size() );
+	m_traceFile.write( name );
+}
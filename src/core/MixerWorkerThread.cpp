@@ -22,17 +22,173 @@
  *
  */
 
+#include <string.h>
+
 #include "MixerWorkerThread.h"
-#include "Engine.h"
+#include "lmms_basics.h"
 
 
 MixerWorkerThread::JobQueue MixerWorkerThread::globalJobQueue;
 QWaitCondition * MixerWorkerThread::queueReadyWaitCond = NULL;
+QMutex * MixerWorkerThread::queueReadyMutex = NULL;
+QAtomicInt MixerWorkerThread::queueGeneration( 0 );
 QList<MixerWorkerThread *> MixerWorkerThread::workerThreads;
 
+// index of the deque of the worker running in the current thread, -1 for
+// threads which aren't processing jobs
+static LMMS_THREAD_LOCAL int t_worker = -1;
+
+
+
+// implementation of per-worker job deque
+MixerWorkerThread::JobQueue::Deque::Deque() :
+	m_lock( 0 ),
+	m_count( 0 ),
+	m_items( NULL ),
+	m_capacity( 64 ),
+	m_head( 0 ),
+	m_tail( 0 )
+{
+	m_items = new ThreadableJob *[m_capacity];
+}
+
+
+
+
+MixerWorkerThread::JobQueue::Deque::~Deque()
+{
+	delete[] m_items;
+}
+
+
+
+
+void MixerWorkerThread::JobQueue::Deque::push( ThreadableJob * _job )
+{
+	lock();
+	while( m_tail == m_capacity )
+	{
+		if( m_head > 0 )
+		{
+			// reclaim space at the head first
+			memmove( m_items, m_items + m_head,
+					( m_tail - m_head ) * sizeof( ThreadableJob * ) );
+			m_tail -= m_head;
+			m_head = 0;
+			break;
+		}
+
+		// capacity is kept across periods, so this only happens when a
+		// project needs more jobs per stage than ever before - allocate
+		// without holding the lock so other workers don't spin on it
+		const int capacity = m_capacity;
+		unlock();
+		ThreadableJob * * items = new ThreadableJob *[capacity * 2];
+		lock();
+		if( m_capacity == capacity )
+		{
+			memcpy( items, m_items, m_tail * sizeof( ThreadableJob * ) );
+			qSwap( items, m_items );
+			m_capacity = capacity * 2;
+		}
+		// free the old array, or ours if someone else was faster
+		unlock();
+		delete[] items;
+		lock();
+	}
+	m_items[m_tail++] = _job;
+	m_count = m_tail - m_head;
+	unlock();
+}
+
+
+
+
+ThreadableJob * MixerWorkerThread::JobQueue::Deque::pop()
+{
+	if( isEmpty() )
+	{
+		return NULL;
+	}
+
+	lock();
+	ThreadableJob * job = NULL;
+	if( m_tail > m_head )
+	{
+		job = m_items[--m_tail];
+	}
+	if( m_tail == m_head )
+	{
+		m_head = m_tail = 0;
+	}
+	m_count = m_tail - m_head;
+	unlock();
+
+	return job;
+}
+
+
+
+
+ThreadableJob * MixerWorkerThread::JobQueue::Deque::steal()
+{
+	if( isEmpty() )
+	{
+		return NULL;
+	}
+
+	lock();
+	ThreadableJob * job = NULL;
+	if( m_tail > m_head )
+	{
+		job = m_items[m_head++];
+	}
+	if( m_tail == m_head )
+	{
+		m_head = m_tail = 0;
+	}
+	m_count = m_tail - m_head;
+	unlock();
+
+	return job;
+}
+
+
 
 
 // implementation of internal JobQueue
+MixerWorkerThread::JobQueue::JobQueue() :
+	m_deques(),
+	m_nextDeque( 0 ),
+	m_queueSize( 0 ),
+	m_itemsDone( 0 ),
+	m_opMode( Static ),
+	m_waiting( 0 ),
+	m_doneMutex(),
+	m_doneWaitCond()
+{
+}
+
+
+
+
+MixerWorkerThread::JobQueue::~JobQueue()
+{
+	qDeleteAll( m_deques );
+}
+
+
+
+
+int MixerWorkerThread::JobQueue::registerWorker()
+{
+	m_deques.push_back( new Deque );
+	return m_deques.size() - 1;
+}
+
+
+
+
 void MixerWorkerThread::JobQueue::reset( OperationMode _opMode )
 {
 	m_queueSize = 0;
@@ -47,46 +203,160 @@ void MixerWorkerThread::JobQueue::addJob( ThreadableJob * _job )
 {
 	if( _job->requiresProcessing() )
 	{
-		// update job state
-		_job->queue();
-		// actually queue the job via atomic operations
-		m_items[m_queueSize.fetchAndAddOrdered(1)] = _job;
+		enqueue( _job );
+	}
+}
+
+
+
+
+void MixerWorkerThread::JobQueue::enqueue( ThreadableJob * _job )
+{
+	// update job state
+	_job->queue();
+	// account for the job before publishing it so m_itemsDone can
+	// never overtake m_queueSize
+	m_queueSize.fetchAndAddOrdered( 1 );
+
+	// jobs spawned by a worker (dynamic mode) go to its own deque,
+	// everything else is spread across all deques
+	int d = t_worker;
+	if( d < 0 )
+	{
+		d = (unsigned int) m_nextDeque.fetchAndAddRelaxed( 1 ) %
+						m_deques.size();
+	}
+	m_deques[d]->push( _job );
+
+	// wake up thread parked in wait() so it can help - the ordered access
+	// makes sure it either sees the new job or we see it waiting
+	if( m_waiting.fetchAndAddOrdered( 0 ) > 0 )
+	{
+		m_doneMutex.lock();
+		m_doneWaitCond.wakeAll();
+		m_doneMutex.unlock();
+	}
+}
+
+
+
+
+ThreadableJob * MixerWorkerThread::JobQueue::takeJob( int _worker )
+{
+	ThreadableJob * job = m_deques[_worker]->pop();
+	if( job )
+	{
+		return job;
+	}
+
+	// own deque is empty - try to steal from the other workers
+	const int n = m_deques.size();
+	for( int i = 1; i < n; ++i )
+	{
+		job = m_deques[( _worker + i ) % n]->steal();
+		if( job )
+		{
+			return job;
+		}
 	}
+
+	return NULL;
 }
 
 
 
-void MixerWorkerThread::JobQueue::run()
+
+bool MixerWorkerThread::JobQueue::hasJobs() const
 {
-	bool processedJob = true;
-	while( processedJob && (int) m_itemsDone < (int) m_queueSize )
+	for( int i = 0; i < m_deques.size(); ++i )
 	{
-		processedJob = false;
-		for( int i = 0; i < m_queueSize; ++i )
+		if( !m_deques[i]->isEmpty() )
 		{
-			ThreadableJob * job = m_items[i].fetchAndStoreOrdered( NULL );
-			if( job )
-			{
-				job->process();
-				processedJob = true;
-				m_itemsDone.fetchAndAddOrdered( 1 );
-			}
+			return true;
 		}
-		// always exit loop if we're not in dynamic mode
-		processedJob = processedJob && ( m_opMode == Dynamic );
 	}
+	return false;
 }
 
 
 
 
-void MixerWorkerThread::JobQueue::wait()
+void MixerWorkerThread::JobQueue::finishJob()
 {
+	if( m_itemsDone.fetchAndAddOrdered( 1 ) + 1 >= (int) m_queueSize )
+	{
+		// possibly the last job - wake up thread waiting in wait()
+		m_doneMutex.lock();
+		m_doneWaitCond.wakeAll();
+		m_doneMutex.unlock();
+	}
+}
+
+
+
+
+void MixerWorkerThread::JobQueue::run( int _worker )
+{
+	int spins = 0;
+	while( true )
+	{
+		ThreadableJob * job = takeJob( _worker );
+		if( job )
+		{
+			job->process();
+			finishJob();
+			spins = 0;
+			continue;
+		}
+
+		// nothing left to take - in static mode no jobs will show up
+		// anymore, in dynamic mode other workers still can create some
+		if( m_opMode == Static || (int) m_itemsDone >= (int) m_queueSize ||
+									++spins > SpinIterations )
+		{
+			break;
+		}
+		spinPause();
+	}
+}
+
+
+
+
+void MixerWorkerThread::JobQueue::wait( int _worker )
+{
+	int spins = 0;
 	while( (int) m_itemsDone < (int) m_queueSize )
 	{
-#if defined(LMMS_HOST_X86) || defined(LMMS_HOST_X86_64)
-		asm( "pause" );
-#endif
+		// help processing jobs that were added in the meantime
+		ThreadableJob * job = takeJob( _worker );
+		if( job )
+		{
+			job->process();
+			finishJob();
+			spins = 0;
+			continue;
+		}
+
+		if( spins < SpinIterations )
+		{
+			++spins;
+			spinPause();
+			continue;
+		}
+
+		// remaining jobs are in progress on other workers - instead of
+		// burning this core, park until the last one has finished or one
+		// of them spawns new jobs we can help with (dynamic mode)
+		m_doneMutex.lock();
+		m_waiting.fetchAndAddOrdered( 1 );
+		while( (int) m_itemsDone < (int) m_queueSize && !hasJobs() )
+		{
+			m_doneWaitCond.wait( &m_doneMutex );
+		}
+		m_waiting.fetchAndAddOrdered( -1 );
+		m_doneMutex.unlock();
+		spins = 0;
 	}
 }
 
@@ -96,16 +366,21 @@ void MixerWorkerThread::JobQueue::wait()
 
 // implementation of worker threads
 
-MixerWorkerThread::MixerWorkerThread( Mixer* mixer ) :
-	QThread( mixer ),
+MixerWorkerThread::MixerWorkerThread( QObject * _parent ) :
+	QThread( _parent ),
+	m_index( 0 ),
 	m_quit( false )
 {
 	// initialize global static data
 	if( queueReadyWaitCond == NULL )
 	{
 		queueReadyWaitCond = new QWaitCondition;
+		queueReadyMutex = new QMutex;
 	}
 
+	// every worker gets its own job deque
+	m_index = globalJobQueue.registerWorker();
+
 	// keep track of all instantiated worker threads - this is used for
 	// processing the last worker thread "inline", see comments in
 	// MixerWorkerThread::startAndWaitForJobs() for details
@@ -136,12 +411,50 @@ void MixerWorkerThread::quit()
 
 void MixerWorkerThread::startAndWaitForJobs()
 {
+	if( workerThreads.isEmpty() )
+	{
+		return;
+	}
+
+	// start a new generation and wake up all parked workers
+	queueGeneration.ref();
+	queueReadyMutex->lock();
 	queueReadyWaitCond->wakeAll();
+	queueReadyMutex->unlock();
+
 	// The last worker-thread is never started. Instead it's processed "inline"
 	// i.e. within the global Mixer thread. This way we can reduce latencies
 	// that otherwise would be caused by synchronizing with another thread.
-	globalJobQueue.run();
-	globalJobQueue.wait();
+	const int inlineWorker = workerThreads.last()->m_index;
+	t_worker = inlineWorker;
+	globalJobQueue.run( inlineWorker );
+	globalJobQueue.wait( inlineWorker );
+	// jobs added by this thread for the next stage get spread again
+	t_worker = -1;
+}
+
+
+
+
+void MixerWorkerThread::waitForJobs( int _generation )
+{
+	// stages of a period follow each other closely, so spin a bit before
+	// going to sleep
+	for( int i = 0; i < JobQueue::SpinIterations; ++i )
+	{
+		if( (int) queueGeneration != _generation || m_quit )
+		{
+			return;
+		}
+		spinPause();
+	}
+
+	queueReadyMutex->lock();
+	while( (int) queueGeneration == _generation && m_quit == false )
+	{
+		queueReadyWaitCond->wait( queueReadyMutex );
+	}
+	queueReadyMutex->unlock();
 }
 
 
@@ -158,13 +471,17 @@ void MixerWorkerThread::run()
 /* FTZ flag */
 	_MM_SET_FLUSH_ZERO_MODE( _MM_FLUSH_ZERO_ON );
 #endif	
-	QMutex m;
+	t_worker = m_index;
+
+	int generation = queueGeneration;
 	while( m_quit == false )
 	{
-		m.lock();
-		queueReadyWaitCond->wait( &m );
-		globalJobQueue.run();
-		m.unlock();
+		waitForJobs( generation );
+		generation = queueGeneration;
+		if( m_quit == false )
+		{
+			globalJobQueue.run( m_index );
+		}
 	}
 }
 
@@ -34,6 +34,12 @@
 #include "MidiPort.h"
 #include "Song.h"
 
+#include <QtCore/QMutexLocker>
+#include <QtCore/QSemaphore>
+#include <QtCore/QThread>
+
+#include <cstring>
+
 
 NotePlayHandle::BaseDetuning::BaseDetuning( DetuningHelper *detuning ) :
 	m_value( detuning ? detuning->automationPattern()->valueAt( 0 ) : 0 )
@@ -68,6 +74,8 @@ NotePlayHandle::NotePlayHandle( InstrumentTrack* instrumentTrack,
 	m_parent( parent ),
 	m_hadChildren( false ),
 	m_muted( false ),
+	m_stolen( false ),
+	m_fadedOut( false ),
 	m_bbTrack( NULL ),
 	m_origTempo( Engine::getSong()->getTempo() ),
 	m_origBaseNote( instrumentTrack->baseNote() ),
@@ -156,7 +164,11 @@ void NotePlayHandle::done()
 
 	m_subNotes.clear();
 
-	delete m_filter;
+	if( m_filter != NULL )
+	{
+		NotePlayHandleManager::releaseFilter( m_filter );
+		m_filter = NULL;
+	}
 	
 	if( buffer() ) releaseBuffer();
 
@@ -250,6 +262,24 @@ void NotePlayHandle::play( sampleFrame * _working_buffer )
 		m_instrumentTrack->playNote( this, _working_buffer );
 	}
 
+	if( m_stolen )
+	{
+		// fade out within this period to avoid clicks - single-streamed
+		// instruments handle the note-off we sent on their own
+		if( _working_buffer != NULL &&
+			! ( m_instrumentTrack->instrument()->flags() & Instrument::IsSingleStreamed ) )
+		{
+			const float step = 1.0f / framesThisPeriod;
+			for( f_cnt_t f = 0; f < framesThisPeriod; ++f )
+			{
+				const float gain = 1.0f - f * step;
+				_working_buffer[f][0] *= gain;
+				_working_buffer[f][1] *= gain;
+			}
+		}
+		m_fadedOut = true;
+	}
+
 	if( m_released )
 	{
 		f_cnt_t todo = framesThisPeriod;
@@ -443,6 +473,25 @@ void NotePlayHandle::mute()
 
 
 
+void NotePlayHandle::steal()
+{
+	lock();
+	m_stolen = true;
+	if( m_totalFramesPlayed == 0 )
+	{
+		// nothing to fade out
+		m_fadedOut = true;
+	}
+	else if( m_released == false )
+	{
+		noteOff( 0 );
+	}
+	unlock();
+}
+
+
+
+
 int NotePlayHandle::index() const
 {
 	const PlayHandleList & playHandles = Engine::mixer()->playHandles();
@@ -557,25 +606,309 @@ void NotePlayHandle::resize( const bpm_t _new_tempo )
 }
 
 
-NotePlayHandle ** NotePlayHandleManager::s_available;
-QReadWriteLock NotePlayHandleManager::s_mutex;
-QAtomicInt NotePlayHandleManager::s_availableIndex;
-int NotePlayHandleManager::s_size;
+// pooled objects shared between threads - kept in magazines of up to
+// NPH_MAGAZINE_SIZE objects which are pushed to and popped from lock-free
+// stacks as a whole, one stack for filled magazines and one for empty ones.
+// Stack heads contain index of topmost magazine + 1 in their lower 16 bits
+// and a tag in the upper ones which changes on every operation so that a
+// magazine which got popped and pushed again meanwhile isn't mistaken for
+// an unchanged stack. Empty magazines are created ahead of time by the
+// grower thread, so threads handing back objects don't have to allocate.
+class NotePlayHandleManager::Depot
+{
+public:
+	Depot() :
+		m_full( 0 ),
+		m_empty( 0 ),
+		m_available( 0 ),
+		m_emptyMagazines( 0 ),
+		m_magazines( 0 )
+	{
+		memset( m_chunks, 0, sizeof( m_chunks ) );
+	}
+
+	// takes one magazine, returns number of objects written to _items
+	// or 0 if depot is empty
+	int pop( void * * _items )
+	{
+		const int index = popIndex( m_full );
+		if( index < 0 )
+		{
+			return 0;
+		}
+		Magazine * m = magazine( index );
+		const int c = m->count;
+		memcpy( _items, m->items, sizeof( void * ) * c );
+		m_available.fetchAndAddOrdered( -c );
+		pushIndex( m_empty, index );
+		m_emptyMagazines.ref();
+		return c;
+	}
+
+	void push( void * const * _items, int _count )
+	{
+		while( _count > 0 )
+		{
+			int index = popIndex( m_empty );
+			if( index >= 0 )
+			{
+				m_emptyMagazines.deref();
+			}
+			else
+			{
+				// grower didn't keep up
+				s_emergencyExtensions.ref();
+				index = newMagazine();
+			}
+			Magazine * m = magazine( index );
+			m->count = qMin( _count, NPH_MAGAZINE_SIZE );
+			memcpy( m->items, _items, sizeof( void * ) * m->count );
+			m_available.fetchAndAddOrdered( m->count );
+			pushIndex( m_full, index );
+			_items += m->count;
+			_count -= m->count;
+		}
+	}
+
+	// objects in depot, not counting the ones cached by threads
+	int available() const
+	{
+		return m_available;
+	}
+
+	int emptyMagazines() const
+	{
+		return m_emptyMagazines;
+	}
+
+	// adds empty magazines - not for audio threads
+	void reserve( int _magazines )
+	{
+		for( int i = 0; i < _magazines; ++i )
+		{
+			pushIndex( m_empty, newMagazine() );
+			m_emptyMagazines.ref();
+		}
+	}
+
+
+private:
+	struct Magazine
+	{
+		int next;
+		int count;
+		void * items[NPH_MAGAZINE_SIZE];
+	} ;
+
+	static const int ChunkSize = 256;
+	// index + 1 has to fit into lower half of stack heads
+	static const int MaxMagazines = 65535;
+
+	Magazine * magazine( int _index )
+	{
+		return m_chunks[_index / ChunkSize] + _index % ChunkSize;
+	}
+
+	static int nextHead( int _head, int _index )
+	{
+		return (int)( ( (unsigned int) _head & 0xffff0000u ) + 0x10000u ) |
+								( _index + 1 );
+	}
+
+	int popIndex( QAtomicInt & _stack )
+	{
+		while( true )
+		{
+			const int head = _stack;
+			const int index = ( head & 0xffff ) - 1;
+			if( index < 0 )
+			{
+				return -1;
+			}
+			// magazines are never freed, so reading next is safe even
+			// if magazine was popped by another thread meanwhile
+			const int next = magazine( index )->next - 1;
+			if( _stack.testAndSetOrdered( head, nextHead( head, next ) ) )
+			{
+				return index;
+			}
+		}
+	}
+
+	void pushIndex( QAtomicInt & _stack, int _index )
+	{
+		Magazine * m = magazine( _index );
+		while( true )
+		{
+			const int head = _stack;
+			m->next = head & 0xffff;
+			if( _stack.testAndSetOrdered( head, nextHead( head, _index ) ) )
+			{
+				return;
+			}
+		}
+	}
+
+	// only needed when growing pool or when grower didn't keep up, so
+	// it's fine to take a lock here
+	int newMagazine()
+	{
+		QMutexLocker ml( &m_chunkMutex );
+		const int index = m_magazines;
+		if( index >= MaxMagazines )
+		{
+			qFatal( "NotePlayHandleManager: too many magazines" );
+		}
+		if( index % ChunkSize == 0 )
+		{
+			m_chunks[index / ChunkSize] = MM_ALLOC( Magazine, ChunkSize );
+		}
+		m_magazines.fetchAndAddOrdered( 1 );
+		return index;
+	}
+
+	QAtomicInt m_full;
+	QAtomicInt m_empty;
+	QAtomicInt m_available;
+	QAtomicInt m_emptyMagazines;
+
+	Magazine * m_chunks[( MaxMagazines + ChunkSize - 1 ) / ChunkSize];
+	QAtomicInt m_magazines;
+	QMutex m_chunkMutex;
+
+} ;
+
+
+
+
+// objects each thread keeps for itself - acquire() and release() only have
+// to touch the depots when running empty or full
+class NotePlayHandleManager::ThreadCache
+{
+public:
+	ThreadCache() :
+		m_handleCount( 0 ),
+		m_filterCount( 0 )
+	{
+	}
+
+	~ThreadCache()
+	{
+		// thread is going away, hand back what it cached
+		s_handles.push( m_handles, m_handleCount );
+		s_filters.push( m_filters, m_filterCount );
+	}
+
+	void * m_handles[2 * NPH_MAGAZINE_SIZE];
+	int m_handleCount;
+	void * m_filters[2 * NPH_MAGAZINE_SIZE];
+	int m_filterCount;
+
+} ;
+
+
+
+
+// grows pools when they fall below NPH_CACHE_WATERMARK and keeps
+// NPH_MAGAZINE_RESERVE empty magazines ready, so that audio threads don't
+// have to allocate memory
+class NotePlayHandleManager::Grower : public QThread
+{
+public:
+	Grower() :
+		m_pending( 0 ),
+		m_quit( 0 )
+	{
+	}
+
+	// makes thread leave its loop and waits for it
+	void quit()
+	{
+		m_quit.fetchAndStoreOrdered( 1 );
+		m_sem.release();
+		wait();
+	}
+
+	void wake()
+	{
+		// only signal once until thread picked up request
+		if( m_pending.testAndSetOrdered( 0, 1 ) )
+		{
+			m_sem.release();
+		}
+	}
+
+
+protected:
+	virtual void run()
+	{
+		while( true )
+		{
+			m_sem.acquire();
+			if( (int) m_quit )
+			{
+				break;
+			}
+			m_pending.fetchAndStoreOrdered( 0 );
+
+			while( s_handles.available() < NPH_CACHE_WATERMARK )
+			{
+				grow( false, NPH_CACHE_INCREMENT );
+			}
+			while( s_filters.available() < NPH_CACHE_WATERMARK )
+			{
+				grow( true, NPH_CACHE_INCREMENT );
+			}
+			s_handles.reserve( NPH_MAGAZINE_RESERVE -
+						s_handles.emptyMagazines() );
+			s_filters.reserve( NPH_MAGAZINE_RESERVE -
+						s_filters.emptyMagazines() );
+		}
+	}
+
+
+private:
+	QSemaphore m_sem;
+	QAtomicInt m_pending;
+	QAtomicInt m_quit;
+
+} ;
+
+
+
+
+NotePlayHandleManager::Depot NotePlayHandleManager::s_handles;
+NotePlayHandleManager::Depot NotePlayHandleManager::s_filters;
+QThreadStorage<NotePlayHandleManager::ThreadCache *> NotePlayHandleManager::s_threadCaches;
+QMutex NotePlayHandleManager::s_growMutex;
+NotePlayHandleManager::Grower * NotePlayHandleManager::s_grower = NULL;
+int NotePlayHandleManager::s_size = 0;
+int NotePlayHandleManager::s_filtersSize = 0;
+QAtomicInt NotePlayHandleManager::s_live;
+QAtomicInt NotePlayHandleManager::s_peakLive;
+QAtomicInt NotePlayHandleManager::s_emergencyExtensions;
 
 
 void NotePlayHandleManager::init()
 {
-	s_available = MM_ALLOC( NotePlayHandle*, INITIAL_NPH_CACHE );
+	grow( false, INITIAL_NPH_CACHE );
+	// most notes aren't filtered, so start with less filters
+	grow( true, INITIAL_NPH_CACHE / 4 );
+
+	s_grower = new Grower;
+	s_grower->start( QThread::LowPriority );
+}
 
-	NotePlayHandle * n = MM_ALLOC( NotePlayHandle, INITIAL_NPH_CACHE );
 
-	for( int i=0; i < INITIAL_NPH_CACHE; ++i )
+void NotePlayHandleManager::shutdown()
+{
+	if( s_grower != NULL )
 	{
-		s_available[ i ] = n;
-		++n;
+		Grower * grower = s_grower;
+		s_grower = NULL;
+		grower->quit();
+		delete grower;
 	}
-	s_availableIndex = INITIAL_NPH_CACHE - 1;
-	s_size = INITIAL_NPH_CACHE;
 }
 
 
@@ -587,16 +920,20 @@ NotePlayHandle * NotePlayHandleManager::acquire( InstrumentTrack* instrumentTrac
 				int midiEventChannel,
 				NotePlayHandle::Origin origin )
 {
-	if( s_availableIndex < 0 )
+	ThreadCache * cache = threadCache();
+	if( cache->m_handleCount == 0 )
 	{
-		s_mutex.lockForWrite();
-		if( s_availableIndex < 0 ) extend( NPH_CACHE_INCREMENT );
-		s_mutex.unlock();
+		cache->m_handleCount = fetch( s_handles, cache->m_handles, false );
 	}
-	s_mutex.lockForRead();
-	NotePlayHandle * nph = s_available[ s_availableIndex.fetchAndAddOrdered( -1 ) ];
-	s_mutex.unlock();
-	
+	NotePlayHandle * nph = (NotePlayHandle *) cache->m_handles[--cache->m_handleCount];
+
+	const int live = s_live.fetchAndAddOrdered( 1 ) + 1;
+	int peak;
+	while( live > ( peak = s_peakLive ) &&
+			!s_peakLive.testAndSetOrdered( peak, live ) )
+	{
+	}
+
 	new( (void*)nph ) NotePlayHandle( instrumentTrack, offset, frames, noteToPlay, parent, midiEventChannel, origin );
 	return nph;
 }
@@ -604,25 +941,190 @@ NotePlayHandle * NotePlayHandleManager::acquire( InstrumentTrack* instrumentTrac
 
 void NotePlayHandleManager::release( NotePlayHandle * nph )
 {
-	nph->done();
-	s_mutex.lockForRead();
-	s_available[ s_availableIndex.fetchAndAddOrdered( 1 ) + 1 ] = nph;
-	s_mutex.unlock();
+	release( &nph, 1 );
+}
+
+
+void NotePlayHandleManager::release( NotePlayHandle * const * nphs, int count )
+{
+	ThreadCache * cache = threadCache();
+	for( int i = 0; i < count; ++i )
+	{
+		nphs[i]->done();
+		if( cache->m_handleCount == 2 * NPH_MAGAZINE_SIZE )
+		{
+			cache->m_handleCount -= NPH_MAGAZINE_SIZE;
+			s_handles.push( cache->m_handles + cache->m_handleCount,
+							NPH_MAGAZINE_SIZE );
+		}
+		cache->m_handles[cache->m_handleCount++] = nphs[i];
+	}
+	s_live.fetchAndAddOrdered( -count );
+
+	if( s_handles.emptyMagazines() < NPH_MAGAZINE_RESERVE && s_grower != NULL )
+	{
+		s_grower->wake();
+	}
 }
 
 
 void NotePlayHandleManager::extend( int c )
 {
-	s_size += c;
-	NotePlayHandle ** tmp = MM_ALLOC( NotePlayHandle*, s_size );
-	MM_FREE( s_available );
-	s_available = tmp;
-	
-	NotePlayHandle * n = MM_ALLOC( NotePlayHandle, c );
+	grow( false, c );
+}
 
-	for( int i=0; i < c; ++i )
+
+
+
+BasicFilters<> * NotePlayHandleManager::acquireFilter( sample_rate_t sampleRate )
+{
+	ThreadCache * cache = threadCache();
+	if( cache->m_filterCount == 0 )
 	{
-		s_available[ s_availableIndex.fetchAndAddOrdered( 1 ) + 1 ] = n;
-		++n;
+		cache->m_filterCount = fetch( s_filters, cache->m_filters, true );
 	}
+	BasicFilters<> * filter = (BasicFilters<> *) cache->m_filters[--cache->m_filterCount];
+
+	filter->setSampleRate( sampleRate );
+	filter->clearHistory();
+	return filter;
+}
+
+
+
+
+void NotePlayHandleManager::releaseFilter( BasicFilters<> * filter )
+{
+	ThreadCache * cache = threadCache();
+	if( cache->m_filterCount == 2 * NPH_MAGAZINE_SIZE )
+	{
+		cache->m_filterCount -= NPH_MAGAZINE_SIZE;
+		s_filters.push( cache->m_filters + cache->m_filterCount,
+							NPH_MAGAZINE_SIZE );
+	}
+	cache->m_filters[cache->m_filterCount++] = filter;
+
+	if( s_filters.emptyMagazines() < NPH_MAGAZINE_RESERVE && s_grower != NULL )
+	{
+		s_grower->wake();
+	}
+}
+
+
+
+
+int NotePlayHandleManager::size()
+{
+	return s_size;
+}
+
+
+
+
+int NotePlayHandleManager::live()
+{
+	return s_live;
+}
+
+
+
+
+int NotePlayHandleManager::peakLive()
+{
+	return s_peakLive;
+}
+
+
+
+
+void NotePlayHandleManager::resetPeakLive()
+{
+	s_peakLive.fetchAndStoreOrdered( s_live );
+}
+
+
+
+
+int NotePlayHandleManager::emergencyExtensions()
+{
+	return s_emergencyExtensions;
+}
+
+
+
+
+NotePlayHandleManager::ThreadCache * NotePlayHandleManager::threadCache()
+{
+	ThreadCache * cache = s_threadCaches.localData();
+	if( cache == NULL )
+	{
+		cache = new ThreadCache;
+		s_threadCaches.setLocalData( cache );
+	}
+	return cache;
+}
+
+
+
+
+int NotePlayHandleManager::fetch( Depot & depot, void * * items, bool filters )
+{
+	int c = depot.pop( items );
+	while( c == 0 )
+	{
+		// grower didn't keep up, so there's no way around allocating
+		// in this thread
+		s_emergencyExtensions.ref();
+		grow( filters, NPH_CACHE_INCREMENT );
+		c = depot.pop( items );
+	}
+
+	if( depot.available() < NPH_CACHE_WATERMARK && s_grower != NULL )
+	{
+		s_grower->wake();
+	}
+
+	return c;
+}
+
+
+
+
+void NotePlayHandleManager::grow( bool filters, int c )
+{
+	QMutexLocker ml( &s_growMutex );
+
+	// magazines for new objects and room for handing all of them back
+	// at once
+	const int magazines = ( c + NPH_MAGAZINE_SIZE - 1 ) / NPH_MAGAZINE_SIZE;
+	( filters ? s_filters : s_handles ).reserve( 2 * magazines );
+
+	void * items[NPH_MAGAZINE_SIZE];
+	if( filters )
+	{
+		for( int i = 0; i < c; i += NPH_MAGAZINE_SIZE )
+		{
+			const int n = qMin( c - i, NPH_MAGAZINE_SIZE );
+			for( int j = 0; j < n; ++j )
+			{
+				// sample rate is set when acquiring
+				items[j] = new BasicFilters<>( 44100 );
+			}
+			s_filters.push( items, n );
+		}
+		s_filtersSize += c;
+		return;
+	}
+
+	NotePlayHandle * n = MM_ALLOC( NotePlayHandle, c );
+	for( int i = 0; i < c; i += NPH_MAGAZINE_SIZE )
+	{
+		const int m = qMin( c - i, NPH_MAGAZINE_SIZE );
+		for( int j = 0; j < m; ++j )
+		{
+			items[j] = n++;
+		}
+		s_handles.push( items, m );
+	}
+	s_size += c;
 }
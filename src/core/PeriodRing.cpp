@@ -0,0 +1,176 @@
+/*
+ * PeriodRing.cpp - preallocated single-producer/single-consumer ring of periods
+ *
+ * Copyright (c) 2026 agent <agent/at/local>
+ *
+ * This file is part of LMMS - http://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "PeriodRing.h"
+
+#include <cstring>
+
+#include "MemoryHelper.h"
+
+
+PeriodRing::PeriodRing( int _capacity, fpp_t _frames ) :
+	m_buffers( NULL ),
+	m_periods( NULL ),
+	m_capacity( qMax( _capacity, 1 ) ),
+	m_frames( _frames ),
+	m_depth( m_capacity ),
+	m_closed( 0 ),
+	m_written( 0 ),
+	m_read( 0 ),
+	m_writerWaiting( 0 ),
+	m_readerWaiting( 0 ),
+	m_readPeriod( -1 )
+{
+	m_buffers = new surroundSampleFrame *[m_capacity];
+	m_periods = new int[m_capacity];
+	for( int i = 0; i < m_capacity; ++i )
+	{
+		m_buffers[i] = (surroundSampleFrame *)
+			MemoryHelper::alignedMalloc( m_frames *
+						sizeof( surroundSampleFrame ) );
+		memset( m_buffers[i], 0, m_frames * sizeof( surroundSampleFrame ) );
+		m_periods[i] = -1;
+	}
+}
+
+
+
+
+PeriodRing::~PeriodRing()
+{
+	for( int i = 0; i < m_capacity; ++i )
+	{
+		MemoryHelper::alignedFree( m_buffers[i] );
+	}
+	delete[] m_buffers;
+	delete[] m_periods;
+}
+
+
+
+
+surroundSampleFrame * PeriodRing::writeBuffer()
+{
+	waitFor( &PeriodRing::canWrite, m_writerWaiting, m_writerWake );
+	return m_buffers[index( m_written )];
+}
+
+
+
+
+void PeriodRing::publish( int _period )
+{
+	m_periods[index( m_written )] = _period;
+	m_written.fetchAndAddOrdered( 1 );
+	wake( m_readerWaiting, m_readerWake );
+}
+
+
+
+
+void PeriodRing::close()
+{
+	m_closed.fetchAndStoreOrdered( 1 );
+	wake( m_readerWaiting, m_readerWake );
+}
+
+
+
+
+const surroundSampleFrame * PeriodRing::readBuffer()
+{
+	waitFor( &PeriodRing::canRead, m_readerWaiting, m_readerWake );
+	if( fillLevel() == 0 )
+	{
+		return NULL;
+	}
+	m_readPeriod = m_periods[index( m_read )];
+	return m_buffers[index( m_read )];
+}
+
+
+
+
+void PeriodRing::release()
+{
+	m_read.fetchAndAddOrdered( 1 );
+	wake( m_writerWaiting, m_writerWake );
+}
+
+
+
+
+void PeriodRing::reset()
+{
+	m_written.fetchAndStoreOrdered( 0 );
+	m_read.fetchAndStoreOrdered( 0 );
+	m_closed.fetchAndStoreOrdered( 0 );
+	m_writerWaiting.fetchAndStoreOrdered( 0 );
+	m_readerWaiting.fetchAndStoreOrdered( 0 );
+	m_writerWake.tryAcquire( m_writerWake.available() );
+	m_readerWake.tryAcquire( m_readerWake.available() );
+}
+
+
+
+
+void PeriodRing::setDepth( int _depth )
+{
+	m_depth.fetchAndStoreOrdered( qBound( 1, _depth, m_capacity ) );
+	// writer might be waiting for a slot it can have now
+	wake( m_writerWaiting, m_writerWake );
+}
+
+
+
+
+void PeriodRing::waitFor( Condition _condition, QAtomicInt & _waiting,
+							QSemaphore & _wake )
+{
+	while( !( this->*_condition )() )
+	{
+		_waiting.fetchAndStoreOrdered( 1 );
+		// other side might have changed state before it could see us
+		// waiting - only block if it did not
+		if( ( this->*_condition )() &&
+				_waiting.testAndSetOrdered( 1, 0 ) )
+		{
+			return;
+		}
+		// either we're going to be woken up or other side already
+		// released the semaphore after clearing the flag
+		_wake.acquire();
+	}
+}
+
+
+
+
+void PeriodRing::wake( QAtomicInt & _waiting, QSemaphore & _wake )
+{
+	if( (int) _waiting != 0 && _waiting.testAndSetOrdered( 1, 0 ) )
+	{
+		_wake.release();
+	}
+}
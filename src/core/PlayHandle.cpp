@@ -23,7 +23,10 @@
  */
  
 #include "PlayHandle.h"
+#include "AudioPort.h"
 #include "BufferManager.h"
+#include "Engine.h"
+#include "Mixer.h"
 
 
 PlayHandle::PlayHandle( const Type type, f_cnt_t offset ) :
@@ -33,6 +36,10 @@ PlayHandle::PlayHandle( const Type type, f_cnt_t offset ) :
 		m_playHandleBuffer( NULL ),
 		m_usesBuffer( true )
 {
+	for( int i = 0; i < NumListSlots; ++i )
+	{
+		m_listIndex[i] = -1;
+	}
 }
 
 
@@ -43,6 +50,9 @@ PlayHandle::~PlayHandle()
 
 void PlayHandle::doProcessing()
 {
+	MixerProfiler::Probe probe( Engine::mixer()->profiler(),
+					MixerProfiler::PlayHandleEntry, m_audioPort );
+
 	if( m_usesBuffer )
 	{
 		if( ! m_playHandleBuffer ) m_playHandleBuffer = BufferManager::acquire();
@@ -52,6 +62,11 @@ void PlayHandle::doProcessing()
 	{
 		play( NULL );
 	}
+
+	probe.finish();
+
+	// let our audio port know we're done for this period
+	m_audioPort->incrementDeps();
 }
 
 
@@ -0,0 +1,362 @@
+/*
+ * ProjectLoader.cpp - background sample decoding and timings for loading
+ *                     projects
+ *
+ * Copyright (c) 2026 agent <agent/at/local>
+ *
+ * This file is part of LMMS - http://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "ProjectLoader.h"
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QRunnable>
+#include <QtCore/QThread>
+#include <QtCore/QXmlStreamReader>
+#include <QtXml/QDomDocument>
+
+#include "BinaryDataFile.h"
+#include "SampleBuffer.h"
+
+
+// elements referring to sample files by their "src" attribute
+static const char * AudioFileProcessorElement = "audiofileprocessor";
+static const char * SampleTCOElement = "sampletco";
+
+
+
+
+class ProjectLoader::ScanJob : public QRunnable
+{
+public:
+	ScanJob( ProjectLoader * _loader, const QString & _fileName ) :
+		m_loader( _loader ),
+		m_fileName( _fileName )
+	{
+	}
+
+	virtual void run()
+	{
+		m_loader->scanFile( m_fileName );
+	}
+
+
+private:
+	ProjectLoader * m_loader;
+	QString m_fileName;
+
+} ;
+
+
+
+
+// sets up a buffer the same way the track is going to, so that it ends up
+// with the same cache entry
+class ProjectLoader::SampleJob : public QRunnable
+{
+public:
+	SampleJob( ProjectLoader * _loader, const QString & _file,
+				bool _streamingAllowed, bool _reversed ) :
+		m_loader( _loader ),
+		m_file( _file ),
+		m_streamingAllowed( _streamingAllowed ),
+		m_reversed( _reversed )
+	{
+	}
+
+	virtual void run()
+	{
+		MicroTimer timer;
+		SampleBuffer * buffer = new SampleBuffer( 0 );
+		buffer->setStreamingAllowed( m_streamingAllowed );
+		if( m_reversed )
+		{
+			buffer->setReversed( true );
+		}
+		buffer->setAudioFile( m_file );
+		// gets released by GUI thread
+		buffer->moveToThread( QCoreApplication::instance()->thread() );
+		m_loader->addSample( buffer, timer.elapsed() );
+	}
+
+
+private:
+	ProjectLoader * m_loader;
+	QString m_file;
+	bool m_streamingAllowed;
+	bool m_reversed;
+
+} ;
+
+
+
+
+ProjectLoader::Metrics::Metrics() :
+	totalTime( 0 ),
+	samples( 0 ),
+	sampleTime( 0 )
+{
+	for( int i = 0; i < NumPhases; ++i )
+	{
+		phaseTime[i] = 0;
+	}
+}
+
+
+
+
+void ProjectLoader::Metrics::printSummary( FILE * _out ) const
+{
+	fprintf( _out, "\nProject loaded in %.1f ms\n\n", totalTime / 1000.0 );
+	fprintf( _out, "%-24s %12s\n", "phase", "ms" );
+	for( int i = 0; i < NumPhases; ++i )
+	{
+		fprintf( _out, "%-24s %12.1f\n", phaseName( (Phases) i ),
+						phaseTime[i] / 1000.0 );
+	}
+	fprintf( _out, "\n%d sample files decoded in background, %.1f ms "
+				"CPU\n", samples, sampleTime / 1000.0 );
+}
+
+
+
+
+ProjectLoader::ProjectLoader() :
+	m_pool(),
+	m_samplesMutex(),
+	m_scheduled(),
+	m_samples(),
+	m_sampleTime( 0 ),
+	m_totalTimer(),
+	m_phaseTimer(),
+	m_phase( ParsePhase ),
+	m_metrics()
+{
+	m_pool.setMaxThreadCount( QThread::idealThreadCount() );
+}
+
+
+
+
+ProjectLoader::~ProjectLoader()
+{
+	m_pool.waitForDone();
+
+	foreach( SampleBuffer * buffer, m_samples )
+	{
+		sharedObject::unref( buffer );
+	}
+}
+
+
+
+
+void ProjectLoader::prefetch( const QString & _fileName )
+{
+	m_pool.start( new ScanJob( this, _fileName ) );
+}
+
+
+
+
+void ProjectLoader::beginPhase( Phases _phase )
+{
+	m_metrics.phaseTime[m_phase] += m_phaseTimer.elapsed();
+	m_phaseTimer.reset();
+	m_phase = _phase;
+}
+
+
+
+
+void ProjectLoader::finish()
+{
+	beginPhase( m_phase );
+	m_metrics.totalTime = m_totalTimer.elapsed();
+}
+
+
+
+
+ProjectLoader::Metrics ProjectLoader::metrics() const
+{
+	Metrics m = m_metrics;
+	QMutexLocker ml( &m_samplesMutex );
+	m.samples = m_samples.size();
+	m.sampleTime = m_sampleTime;
+	return m;
+}
+
+
+
+
+const char * ProjectLoader::phaseName( Phases _phase )
+{
+	switch( _phase )
+	{
+		case ParsePhase: return "parsing";
+		case SettingsPhase: return "settings and FX mixer";
+		case TrackPhase: return "tracks";
+		case ControllerPhase: return "controllers";
+		case EditorPhase: return "editors";
+		case FinalizePhase: return "connections";
+		default: break;
+	}
+	return "";
+}
+
+
+
+
+void ProjectLoader::scanFile( const QString & _fileName )
+{
+	QFile f( _fileName );
+	if( !f.open( QIODevice::ReadOnly ) )
+	{
+		// DataFile is going to complain about it
+		return;
+	}
+	const QByteArray data = f.readAll();
+
+	if( BinaryDataFile::isBinary( data ) )
+	{
+		// no text to stream through, but decoding is cheap anyway
+		QDomDocument doc;
+		if( BinaryDataFile::decode( data, doc ) )
+		{
+			scan( doc.documentElement() );
+		}
+		return;
+	}
+
+	QXmlStreamReader reader( data );
+	if( !scan( reader ) )
+	{
+		// not XML, so most likely a compressed project
+		QXmlStreamReader r( qUncompress( data ) );
+		scan( r );
+	}
+}
+
+
+
+
+bool ProjectLoader::scan( QXmlStreamReader & _reader )
+{
+	bool sawElement = false;
+	while( !_reader.atEnd() )
+	{
+		if( _reader.readNext() != QXmlStreamReader::StartElement )
+		{
+			continue;
+		}
+		sawElement = true;
+
+		const QXmlStreamAttributes attrs = _reader.attributes();
+		const QString src = attrs.value( "src" ).toString();
+		if( src.isEmpty() )
+		{
+			continue;
+		}
+		if( _reader.name() ==
+				QLatin1String( AudioFileProcessorElement ) )
+		{
+			// file gets loaded before it's reversed
+			scheduleSample( src, true, false );
+			if( attrs.value( "reversed" ).toString().toInt() )
+			{
+				scheduleSample( src, true, true );
+			}
+		}
+		else if( _reader.name() == QLatin1String( SampleTCOElement ) )
+		{
+			scheduleSample( src, true, false );
+		}
+	}
+	return sawElement || !_reader.hasError();
+}
+
+
+
+
+void ProjectLoader::scan( const QDomElement & _element )
+{
+	const QString src = _element.attribute( "src" );
+	if( !src.isEmpty() )
+	{
+		if( _element.tagName() == AudioFileProcessorElement )
+		{
+			scheduleSample( src, true, false );
+			if( _element.attribute( "reversed" ).toInt() )
+			{
+				scheduleSample( src, true, true );
+			}
+		}
+		else if( _element.tagName() == SampleTCOElement )
+		{
+			scheduleSample( src, true, false );
+		}
+	}
+
+	for( QDomElement e = _element.firstChildElement(); !e.isNull();
+					e = e.nextSiblingElement() )
+	{
+		scan( e );
+	}
+}
+
+
+
+
+void ProjectLoader::scheduleSample( const QString & _file,
+					bool _streamingAllowed, bool _reversed )
+{
+	// DrumSynth decoder uses global state, leave these to the GUI thread
+	if( QFileInfo( _file ).suffix().toLower() == "ds" )
+	{
+		return;
+	}
+
+	const QString key = QString( "%1|%2|%3" ).arg( _file ).
+				arg( _streamingAllowed ).arg( _reversed );
+	{
+		QMutexLocker ml( &m_samplesMutex );
+		if( m_scheduled.contains( key ) )
+		{
+			return;
+		}
+		m_scheduled.insert( key );
+	}
+
+	m_pool.start( new SampleJob( this, _file, _streamingAllowed,
+								_reversed ) );
+}
+
+
+
+
+void ProjectLoader::addSample( SampleBuffer * _buffer, int _time )
+{
+	QMutexLocker ml( &m_samplesMutex );
+	m_samples.append( _buffer );
+	m_sampleTime += _time;
+}
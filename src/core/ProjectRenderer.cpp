@@ -31,12 +31,20 @@
 
 #include "AudioFileWave.h"
 #include "AudioFileOgg.h"
+#include "MicroTimer.h"
 
 #ifdef LMMS_HAVE_SCHED_H
 #include <sched.h>
 #endif
 #include <QMutexLocker>
 
+
+// number of blocks in flight between renderer and encoder
+const int EXPORT_BLOCKS = 4;
+// minimum number of frames handed to the encoder at once
+const f_cnt_t EXPORT_BLOCK_FRAMES = 4096;
+
+
 FileEncodeDevice __fileEncodeDevices[] =
 {
 
@@ -71,7 +79,11 @@ ProjectRenderer::ProjectRenderer( const Mixer::qualitySettings & _qs,
 	m_qualitySettings( _qs ),
 	m_oldQualitySettings( Engine::mixer()->currentQualitySettings() ),
 	m_progress( 0 ),
-	m_abort( false )
+	m_abort( false ),
+	m_framesPerSecond( 0 ),
+	m_framesRendered( 0 ),
+	m_freeBlocks( NULL ),
+	m_renderedBlocks( NULL )
 {
 	if( __fileEncodeDevices[_file_format].m_getDevInst == NULL )
 	{
@@ -166,13 +178,81 @@ void ProjectRenderer::run()
 	Song::playPos & pp = Engine::getSong()->getPlayPos(
 							Song::Mode_PlaySong );
 	m_progress = 0;
+	m_framesPerSecond = 0;
+	m_framesRendered = 0;
 	const int sl = ( Engine::getSong()->length() + 1 ) * 192;
 
+	// rendering and encoding run in parallel - the encoder gets blocks of
+	// several periods while the mixer renders the next ones. Each period
+	// is rendered exactly as in the realtime path, so the output doesn't
+	// change.
+	//
+	// There is no separate offline rendering mode: FX channels which don't
+	// depend on each other already run on different worker threads within
+	// each period. Larger periods would change the output as automation,
+	// LFOs and note offsets are evaluated per period, and rendering stems
+	// on their own would run master effects on each stem separately.
+	const fpp_t fpp = Engine::mixer()->framesPerPeriod();
+	const f_cnt_t blockFrames = qMax<f_cnt_t>( EXPORT_BLOCK_FRAMES / fpp, 1 ) * fpp;
+
+	RenderedBlock blocks[EXPORT_BLOCKS];
+	m_freeBlocks = new BlockFifo( EXPORT_BLOCKS );
+	m_renderedBlocks = new BlockFifo( EXPORT_BLOCKS );
+	for( int i = 0; i < EXPORT_BLOCKS; ++i )
+	{
+		blocks[i].m_data = new surroundSampleFrame[blockFrames];
+		blocks[i].m_frames = 0;
+		m_freeBlocks->write( &blocks[i] );
+	}
+
+	EncoderThread encoder( this );
+	encoder.start(
+#ifndef LMMS_BUILD_WIN32
+			QThread::HighPriority
+#endif
+						);
+
+	MicroTimer timer;
+	f_cnt_t framesRendered = 0;
+
+	RenderedBlock * block = m_freeBlocks->read();
+	block->m_frames = 0;
+
 	while( Engine::getSong()->isExportDone() == false &&
 				Engine::getSong()->isExporting() == true
 							&& !m_abort )
 	{
-		m_fileDev->processNextBuffer();
+		const float masterGain = Engine::mixer()->masterGain();
+
+		// hand over current block if it's full or the master gain changed
+		if( block->m_frames > 0 &&
+			( block->m_frames + fpp > blockFrames ||
+					block->m_masterGain != masterGain ) )
+		{
+			m_renderedBlocks->write( block );
+			block = m_freeBlocks->read();
+			block->m_frames = 0;
+		}
+		block->m_masterGain = masterGain;
+
+		const fpp_t frames = m_fileDev->renderNextBuffer(
+									block->m_data + block->m_frames );
+		block->m_frames += frames;
+		m_framesRendered += frames;
+
+		// measure throughput over windows of about one second
+		framesRendered += frames;
+		const int elapsed = timer.elapsed();
+		if( elapsed >= 1000000 || m_framesPerSecond == 0 )
+		{
+			m_framesPerSecond = framesRendered * 1000000.0f / qMax( elapsed, 1 );
+			if( elapsed >= 1000000 )
+			{
+				framesRendered = 0;
+				timer.reset();
+			}
+		}
+
 		const int nprog = pp * 100 / sl;
 		if( m_progress != nprog )
 		{
@@ -181,6 +261,23 @@ void ProjectRenderer::run()
 		}
 	}
 
+	if( block->m_frames > 0 && !m_abort )
+	{
+		m_renderedBlocks->write( block );
+	}
+	// tell encoder we're done and wait for it to finish
+	m_renderedBlocks->write( NULL );
+	encoder.wait();
+
+	for( int i = 0; i < EXPORT_BLOCKS; ++i )
+	{
+		delete[] blocks[i].m_data;
+	}
+	delete m_freeBlocks;
+	delete m_renderedBlocks;
+	m_freeBlocks = NULL;
+	m_renderedBlocks = NULL;
+
 	Engine::getSong()->stopExport();
 
 	const QString f = m_fileDev->outputFile();
@@ -198,6 +295,37 @@ void ProjectRenderer::run()
 
 
 
+ProjectRenderer::EncoderThread::EncoderThread( ProjectRenderer * _renderer ) :
+	QThread(),
+	m_renderer( _renderer )
+{
+}
+
+
+
+
+void ProjectRenderer::EncoderThread::run()
+{
+	BlockFifo * rendered = m_renderer->m_renderedBlocks;
+	BlockFifo * free = m_renderer->m_freeBlocks;
+
+	RenderedBlock * block;
+	while( ( block = rendered->read() ) != NULL )
+	{
+		// the encoder's frame count is 16 bit only
+		for( f_cnt_t f = 0; f < block->m_frames; f += EXPORT_BLOCK_FRAMES )
+		{
+			m_renderer->m_fileDev->encodeBuffer( block->m_data + f,
+					qMin<f_cnt_t>( block->m_frames - f, EXPORT_BLOCK_FRAMES ),
+							block->m_masterGain );
+		}
+		free->write( block );
+	}
+}
+
+
+
+
 void ProjectRenderer::abortProcessing()
 {
 	m_abort = true;
@@ -209,7 +337,7 @@ void ProjectRenderer::updateConsoleProgress()
 {
 	const int cols = 50;
 	static int rot = 0;
-	char buf[80];
+	char buf[128];
 	char prog[cols+1];
 
 	for( int i = 0; i < cols; ++i )
@@ -220,8 +348,8 @@ void ProjectRenderer::updateConsoleProgress()
 
 	const char * activity = (const char *) "|/-\\";
 	memset( buf, 0, sizeof( buf ) );
-	sprintf( buf, "\r|%s|    %3d%%   %c  ", prog, m_progress,
-							activity[rot] );
+	sprintf( buf, "\r|%s|    %3d%%   %c  %9.0f frames/s  ", prog,
+				m_progress, activity[rot], m_framesPerSecond );
 	rot = ( rot+1 ) % 4;
 
 	fprintf( stderr, "%s", buf );
@@ -41,7 +41,9 @@
 
 
 // simple helper thread monitoring our RemotePlugin - if process terminates
-// unexpectedly invalidate plugin so LMMS doesn't lock up
+// unexpectedly invalidate plugin so LMMS doesn't lock up. It also handles
+// messages the remote process sends on its own (e.g. changed channel
+// counts), so that audio threads don't have to.
 ProcessWatcher::ProcessWatcher( RemotePlugin * _p ) :
 	QThread(),
 	m_plugin( _p ),
@@ -54,7 +56,13 @@ void ProcessWatcher::run()
 {
 	while( !m_quit && m_plugin->isRunning() )
 	{
-		msleep( 200 );
+		if( m_plugin->messagesLeft() )
+		{
+			m_plugin->lock();
+			m_plugin->fetchAndProcessAllMessages();
+			m_plugin->unlock();
+		}
+		msleep( 20 );
 	}
 	if( !m_quit )
 	{
@@ -82,6 +90,8 @@ RemotePlugin::RemotePlugin() :
 #endif
 	m_shmSize( 0 ),
 	m_shm( NULL ),
+	m_pipelined( ConfigManager::inst()->value( "remoteplugins",
+						"pipelined" ).toInt() ),
 	m_inputCount( DEFAULT_CHANNELS ),
 	m_outputCount( DEFAULT_CHANNELS )
 {
@@ -177,16 +187,7 @@ bool RemotePlugin::process( const sampleFrame * _in_buf,
 
 	if( m_shm == NULL )
 	{
-		// m_shm being zero means we didn't initialize everything so
-		// far so process one message each time (and hope we get
-		// information like SHM-key etc.) until we process messages
-		// in a later stage of this procedure
-		if( m_shmSize == 0 )
-		{
-			lock();
-			fetchAndProcessAllMessages();
-			unlock();
-		}
+		// not set up completely yet
 		if( _out_buf != NULL )
 		{
 			Engine::mixer()->clearAudioBuffer( _out_buf,
@@ -195,87 +196,176 @@ bool RemotePlugin::process( const sampleFrame * _in_buf,
 		return false;
 	}
 
-	memset( m_shm, 0, m_shmSize );
+	lock();
+
+	// resizeSharedProcessingMemory() can't happen meanwhile as we hold
+	// the lock
+	const int32_t period = m_shm->submitted;
+	writeInput( m_shm->slot( period ), _in_buf, frames );
+	__sync_add_and_fetch( &m_shm->submitted, 1 );
 
-	ch_cnt_t inputs = qMin<ch_cnt_t>( m_inputCount, DEFAULT_CHANNELS );
+	// period whose output we return
+	int32_t outPeriod = period;
 
-	if( _in_buf != NULL && inputs > 0 )
+#ifdef LMMS_REMOTE_AUDIO_RING
+	if( m_shm->remoteWaits )
 	{
-		if( m_splitChannels )
+		ringRemoteDoorbell();
+		if( m_pipelined )
 		{
-			for( ch_cnt_t ch = 0; ch < inputs; ++ch )
+			outPeriod = period - 1;
+		}
+		// first period in pipelined mode has no output yet
+		if( outPeriod < 0 || !waitForPeriod( outPeriod ) ||
+						_out_buf == NULL || m_outputCount == 0 )
+		{
+			unlock();
+			if( _out_buf != NULL )
 			{
-				for( fpp_t frame = 0; frame < frames; ++frame )
-				{
-					m_shm[ch * frames + frame] =
-							_in_buf[frame][ch];
-				}
+				Engine::mixer()->clearAudioBuffer( _out_buf,
+								frames );
 			}
+			return false;
 		}
-		else if( inputs == DEFAULT_CHANNELS )
+	}
+	else
+#endif
+	{
+		sendMessage( message( IdStartProcessing ).addInt( period ) );
+
+		if( m_failed || _out_buf == NULL || m_outputCount == 0 )
+		{
+			unlock();
+			return false;
+		}
+
+		waitForMessage( IdProcessingDone );
+	}
+
+	readOutput( m_shm->slot( outPeriod ), _out_buf, frames );
+	unlock();
+
+	return true;
+}
+
+
+
+
+f_cnt_t RemotePlugin::latency() const
+{
+#ifdef LMMS_REMOTE_AUDIO_RING
+	if( m_pipelined && m_shm != NULL && m_shm->remoteWaits )
+	{
+		return m_shm->latency;
+	}
+#endif
+	return 0;
+}
+
+
+
+
+void RemotePlugin::writeInput( float * _slot, const sampleFrame * _in_buf,
+							fpp_t _frames )
+{
+	if( m_inputCount == 0 )
+	{
+		return;
+	}
+
+	if( _in_buf == NULL )
+	{
+		memset( _slot, 0, m_inputCount * _frames * sizeof( float ) );
+		return;
+	}
+
+	const ch_cnt_t inputs = qMin<ch_cnt_t>( m_inputCount, DEFAULT_CHANNELS );
+	if( m_splitChannels )
+	{
+		for( ch_cnt_t ch = 0; ch < inputs; ++ch )
 		{
-			memcpy( m_shm, _in_buf, frames * BYTES_PER_FRAME );
+			for( fpp_t frame = 0; frame < _frames; ++frame )
+			{
+				_slot[ch * _frames + frame] = _in_buf[frame][ch];
+			}
 		}
-		else
+	}
+	else if( inputs == DEFAULT_CHANNELS )
+	{
+		memcpy( _slot, _in_buf, _frames * BYTES_PER_FRAME );
+	}
+	else
+	{
+		sampleFrame * o = (sampleFrame *) _slot;
+		for( ch_cnt_t ch = 0; ch < inputs; ++ch )
 		{
-			sampleFrame * o = (sampleFrame *) m_shm;
-			for( ch_cnt_t ch = 0; ch < inputs; ++ch )
+			for( fpp_t frame = 0; frame < _frames; ++frame )
 			{
-				for( fpp_t frame = 0; frame < frames; ++frame )
-				{
-					o[frame][ch] = _in_buf[frame][ch];
-				}
+				o[frame][ch] = _in_buf[frame][ch];
 			}
 		}
 	}
+}
 
-	lock();
-	sendMessage( IdStartProcessing );
 
-	if( m_failed || _out_buf == NULL || m_outputCount == 0 )
-	{
-		unlock();
-		return false;
-	}
 
-	waitForMessage( IdProcessingDone );
-	unlock();
 
+void RemotePlugin::readOutput( const float * _slot, sampleFrame * _out_buf,
+							fpp_t _frames )
+{
+	const float * out = _slot + m_inputCount * _frames;
 	const ch_cnt_t outputs = qMin<ch_cnt_t>( m_outputCount,
 							DEFAULT_CHANNELS );
 	if( m_splitChannels )
 	{
 		for( ch_cnt_t ch = 0; ch < outputs; ++ch )
 		{
-			for( fpp_t frame = 0; frame < frames; ++frame )
+			for( fpp_t frame = 0; frame < _frames; ++frame )
 			{
-				_out_buf[frame][ch] = m_shm[( m_inputCount+ch )*
-								frames + frame];
+				_out_buf[frame][ch] = out[ch * _frames + frame];
 			}
 		}
 	}
 	else if( outputs == DEFAULT_CHANNELS )
 	{
-		memcpy( _out_buf, m_shm + m_inputCount * frames,
-						frames * BYTES_PER_FRAME );
+		memcpy( _out_buf, out, _frames * BYTES_PER_FRAME );
 	}
 	else
 	{
-		sampleFrame * o = (sampleFrame *) ( m_shm +
-							m_inputCount*frames );
+		const sampleFrame * o = (const sampleFrame *) out;
 		// clear buffer, if plugin didn't fill up both channels
-		Engine::mixer()->clearAudioBuffer( _out_buf, frames );
+		Engine::mixer()->clearAudioBuffer( _out_buf, _frames );
 
-		for( ch_cnt_t ch = 0; ch <
-				qMin<int>( DEFAULT_CHANNELS, outputs ); ++ch )
+		for( ch_cnt_t ch = 0; ch < outputs; ++ch )
 		{
-			for( fpp_t frame = 0; frame < frames; ++frame )
+			for( fpp_t frame = 0; frame < _frames; ++frame )
 			{
 				_out_buf[frame][ch] = o[frame][ch];
 			}
 		}
 	}
+}
 
+
+
+
+bool RemotePlugin::waitForPeriod( int32_t _period )
+{
+#ifdef LMMS_REMOTE_AUDIO_RING
+	while( true )
+	{
+		const int32_t completed = m_shm->completed;
+		if( completed - _period > 0 )
+		{
+			return true;
+		}
+		if( m_failed || isInvalid() )
+		{
+			return false;
+		}
+		futexWait( &m_shm->completed, completed, 100 );
+	}
+#endif
 	return true;
 }
 
@@ -301,9 +391,9 @@ void RemotePlugin::processMidiEvent( const MidiEvent & _e,
 
 void RemotePlugin::resizeSharedProcessingMemory()
 {
-	const size_t s = ( m_inputCount+m_outputCount ) *
-				Engine::mixer()->framesPerPeriod() *
-							sizeof( float );
+	const fpp_t frames = Engine::mixer()->framesPerPeriod();
+	const size_t s = RemoteAudioRing::size( m_inputCount, m_outputCount,
+								frames );
 	if( m_shm != NULL )
 	{
 #ifdef USE_QT_SHMEM
@@ -322,15 +412,21 @@ void RemotePlugin::resizeSharedProcessingMemory()
 		m_shmObj.create( s );
 	} while( m_shmObj.error() != QSharedMemory::NoError );
 
-	m_shm = (float *) m_shmObj.data();
+	m_shm = (RemoteAudioRing *) m_shmObj.data();
 #else
 	while( ( m_shmID = shmget( ++shm_key, s, IPC_CREAT | IPC_EXCL |
 								0600 ) ) == -1 )
 	{
 	}
 
-	m_shm = (float *) shmat( m_shmID, 0, 0 );
+	m_shm = (RemoteAudioRing *) shmat( m_shmID, 0, 0 );
 #endif
+	memset( m_shm, 0, sizeof( RemoteAudioRing ) );
+	m_shm->frames = frames;
+	m_shm->inputs = m_inputCount;
+	m_shm->outputs = m_outputCount;
+	m_shm->latency = m_pipelined ? frames : 0;
+
 	m_shmSize = s;
 	sendMessage( message( IdChangeSharedMemoryKey ).
 				addInt( shm_key ).addInt( m_shmSize ) );
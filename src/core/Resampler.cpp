@@ -0,0 +1,355 @@
+/*
+ * Resampler.cpp - stateful resampler for pitched sample playback
+ *
+ * Copyright (c) 2026 agent <agent/at/local>
+ *
+ * This file is part of LMMS - http://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "Resampler.h"
+
+#include <cmath>
+#include <cstring>
+
+#include "interpolation.h"
+#include "lmms_constants.h"
+
+
+const int Resampler::SincWidth;
+const int Resampler::MaxTaps;
+const int Resampler::DefaultInputFrames;
+
+
+// steps per zero crossing in kernel table
+static const int KernelOversampling = 512;
+static const int KernelSize = Resampler::SincWidth * KernelOversampling + 2;
+
+// kernels for all fractional positions when not pitching up
+static const int Phases = 1024;
+static const int PhaseTaps = 2 * Resampler::SincWidth;
+
+static float s_kernel[KernelSize];
+static float s_polyphase[( Phases + 1 ) * PhaseTaps];
+
+
+static float windowedSinc( double _t )
+{
+	if( _t >= Resampler::SincWidth )
+	{
+		return 0;
+	}
+	const double sinc = _t < 1e-9 ? 1.0 : sin( D_PI * _t ) / ( D_PI * _t );
+	// Blackman window
+	const double x = D_PI * _t / Resampler::SincWidth;
+	return sinc * ( 0.42 + 0.5 * cos( x ) + 0.08 * cos( 2 * x ) );
+}
+
+
+
+
+static bool initTables()
+{
+	for( int i = 0; i < KernelSize; ++i )
+	{
+		s_kernel[i] = windowedSinc( (double) i / KernelOversampling );
+	}
+
+	for( int p = 0; p <= Phases; ++p )
+	{
+		float * k = s_polyphase + p * PhaseTaps;
+		const double frac = (double) p / Phases;
+		double sum = 0;
+		for( int t = 0; t < PhaseTaps; ++t )
+		{
+			// tap t is at frame t - SincWidth + 1 relative to position
+			k[t] = windowedSinc( fabs( t - Resampler::SincWidth + 1 - frac ) );
+			sum += k[t];
+		}
+		// unity gain for DC
+		for( int t = 0; t < PhaseTaps; ++t )
+		{
+			k[t] /= sum;
+		}
+	}
+
+	return true;
+}
+
+
+static bool s_tablesInitialized = initTables();
+
+
+
+
+Resampler::Resampler( Qualities _quality, int _maxInputFrames ) :
+	m_quality( _quality ),
+	m_buffer( NULL ),
+	m_bufferFrames( 0 ),
+	// history and taps of the kernel stay in the buffer besides the input
+	m_bufferSize( _maxInputFrames + 3 * MaxTaps ),
+	m_position( 0 )
+{
+	// allocate here rather than when playing
+	m_buffer = MM_ALLOC( sampleFrame, m_bufferSize );
+	reset();
+}
+
+
+
+
+Resampler::~Resampler()
+{
+	MM_FREE( m_buffer );
+}
+
+
+
+
+void Resampler::reset()
+{
+	memset( m_buffer, 0, MaxTaps * sizeof( sampleFrame ) );
+	m_bufferFrames = MaxTaps;
+	m_position = MaxTaps;
+}
+
+
+
+
+fpp_t Resampler::process( const sampleFrame * _in, f_cnt_t _inFrames,
+				sampleFrame * _out, fpp_t _outFrames,
+				double _factor, float _gain, f_cnt_t & _used )
+{
+	const int right = rightTaps( _factor );
+
+	// buffer isn't grown while playing, so more input than fits is
+	// taken in chunks
+	fpp_t generated = 0;
+	_used = 0;
+	while( generated < _outFrames )
+	{
+		// take input needed for all remaining frames of this period
+		const double last = m_position +
+				( _outFrames - generated - 1 ) * _factor;
+		const f_cnt_t needed = qMin<f_cnt_t>( qMin<f_cnt_t>(
+				(f_cnt_t) last + right + 1 - m_bufferFrames,
+							_inFrames - _used ),
+					m_bufferSize - m_bufferFrames );
+		if( needed > 0 )
+		{
+			memcpy( m_buffer + m_bufferFrames, _in + _used,
+					needed * sizeof( sampleFrame ) );
+			m_bufferFrames += needed;
+			_used += needed;
+		}
+
+		// can't generate more frames than kernel has input for
+		const double available = m_bufferFrames - right - 1 - m_position;
+		fpp_t frames = available < 0 ? 0 :
+				qMin<fpp_t>( _outFrames - generated,
+					(fpp_t)( available / _factor ) + 1 );
+		while( frames > 0 && (int)( m_position +
+				( frames - 1 ) * _factor ) + right >= m_bufferFrames )
+		{
+			--frames;
+		}
+
+		switch( m_quality )
+		{
+			case Nearest:
+				processNearest( _out + generated, frames, _factor, _gain );
+				break;
+			case Linear:
+				processLinear( _out + generated, frames, _factor, _gain );
+				break;
+			case Cubic:
+				processCubic( _out + generated, frames, _factor, _gain );
+				break;
+			default:
+				processSinc( _out + generated, frames, _factor, _gain );
+				break;
+		}
+		generated += frames;
+
+		// drop frames which aren't needed as history anymore
+		const int drop = qMin( (int) m_position - MaxTaps, m_bufferFrames );
+		if( drop > 0 )
+		{
+			memmove( m_buffer, m_buffer + drop,
+				( m_bufferFrames - drop ) * sizeof( sampleFrame ) );
+			m_bufferFrames -= drop;
+			m_position -= drop;
+		}
+
+		// out of input
+		if( frames == 0 && needed <= 0 )
+		{
+			break;
+		}
+	}
+
+	return generated;
+}
+
+
+
+
+int Resampler::rightTaps( double _factor ) const
+{
+	switch( m_quality )
+	{
+		case Nearest:
+			return 0;
+		case Linear:
+			return 1;
+		case Cubic:
+			return 2;
+		default:
+			break;
+	}
+	if( _factor <= 1 )
+	{
+		return SincWidth;
+	}
+	// kernel is stretched when pitching up to suppress aliasing
+	return qMin( MaxTaps, (int) ceil( SincWidth * _factor ) );
+}
+
+
+
+
+void Resampler::processNearest( sampleFrame * _out, fpp_t _frames,
+					double _factor, float _gain )
+{
+	double p = m_position;
+	for( fpp_t f = 0; f < _frames; ++f )
+	{
+		const sampleFrame & s = m_buffer[(int) p];
+		_out[f][0] = s[0] * _gain;
+		_out[f][1] = s[1] * _gain;
+		p += _factor;
+	}
+	m_position = p;
+}
+
+
+
+
+void Resampler::processLinear( sampleFrame * _out, fpp_t _frames,
+					double _factor, float _gain )
+{
+	double p = m_position;
+	for( fpp_t f = 0; f < _frames; ++f )
+	{
+		const int i = (int) p;
+		const float x = p - i;
+		const sampleFrame * s = m_buffer + i;
+		_out[f][0] = linearInterpolate( s[0][0], s[1][0], x ) * _gain;
+		_out[f][1] = linearInterpolate( s[0][1], s[1][1], x ) * _gain;
+		p += _factor;
+	}
+	m_position = p;
+}
+
+
+
+
+void Resampler::processCubic( sampleFrame * _out, fpp_t _frames,
+					double _factor, float _gain )
+{
+	double p = m_position;
+	for( fpp_t f = 0; f < _frames; ++f )
+	{
+		const int i = (int) p;
+		const float x = p - i;
+		const sampleFrame * s = m_buffer + i - 1;
+		_out[f][0] = hermiteInterpolate( s[0][0], s[1][0], s[2][0],
+							s[3][0], x ) * _gain;
+		_out[f][1] = hermiteInterpolate( s[0][1], s[1][1], s[2][1],
+							s[3][1], x ) * _gain;
+		p += _factor;
+	}
+	m_position = p;
+}
+
+
+
+
+void Resampler::processSinc( sampleFrame * _out, fpp_t _frames,
+					double _factor, float _gain )
+{
+	double p = m_position;
+
+	if( _factor <= 1 )
+	{
+		// fixed kernel width - use tables for nearest phase. Note that
+		// the sums below are not vectorized by the compiler, as without
+		// -ffast-math it has to keep the order of float additions.
+		for( fpp_t f = 0; f < _frames; ++f )
+		{
+			const int i = (int) p;
+			const int phase = (int)( ( p - i ) * Phases + 0.5 );
+			const float * k = s_polyphase + phase * PhaseTaps;
+			const sampleFrame * s = m_buffer + i - SincWidth + 1;
+			float l = 0;
+			float r = 0;
+			for( int t = 0; t < PhaseTaps; ++t )
+			{
+				l += s[t][0] * k[t];
+				r += s[t][1] * k[t];
+			}
+			_out[f][0] = l * _gain;
+			_out[f][1] = r * _gain;
+			p += _factor;
+		}
+		m_position = p;
+		return;
+	}
+
+	// pitching up: cut off at new nyquist frequency by stretching kernel
+	const int taps = rightTaps( _factor );
+	const double scale = qMax( 1.0 / _factor,
+				(double) SincWidth / MaxTaps ) * KernelOversampling;
+	for( fpp_t f = 0; f < _frames; ++f )
+	{
+		const int i = (int) p;
+		const double x = p - i;
+		float l = 0;
+		float r = 0;
+		float sum = 0;
+		for( int j = -taps + 1; j <= taps; ++j )
+		{
+			const double t = fabs( j - x ) * scale;
+			const int ti = (int) t;
+			if( ti >= KernelSize - 1 )
+			{
+				continue;
+			}
+			const float w = s_kernel[ti] + ( s_kernel[ti+1] -
+						s_kernel[ti] ) * (float)( t - ti );
+			l += m_buffer[i+j][0] * w;
+			r += m_buffer[i+j][1] * w;
+			sum += w;
+		}
+		const float g = sum != 0 ? _gain / sum : 0;
+		_out[f][0] = l * g;
+		_out[f][1] = r * g;
+		p += _factor;
+	}
+	m_position = p;
+}
@@ -31,6 +31,7 @@
 #include <QFileInfo>
 #include <QMessageBox>
 #include <QPainter>
+#include <QThread>
 
 
 #include <cstring>
@@ -58,6 +59,8 @@
 #include "endian_handling.h"
 #include "Engine.h"
 #include "interpolation.h"
+#include "SampleCache.h"
+#include "SampleStream.h"
 #include "templates.h"
 
 #include "FileDialog.h"
@@ -70,6 +73,9 @@ SampleBuffer::SampleBuffer( const QString & _audio_file,
 	m_origData( NULL ),
 	m_origFrames( 0 ),
 	m_data( NULL ),
+	m_dataShared( false ),
+	m_stream( NULL ),
+	m_streamingAllowed( false ),
 	m_frames( 0 ),
 	m_startFrame( 0 ),
 	m_endFrame( 0 ),
@@ -96,6 +102,9 @@ SampleBuffer::SampleBuffer( const sampleFrame * _data, const f_cnt_t _frames ) :
 	m_origData( NULL ),
 	m_origFrames( 0 ),
 	m_data( NULL ),
+	m_dataShared( false ),
+	m_stream( NULL ),
+	m_streamingAllowed( false ),
 	m_frames( 0 ),
 	m_startFrame( 0 ),
 	m_endFrame( 0 ),
@@ -124,6 +133,9 @@ SampleBuffer::SampleBuffer( const f_cnt_t _frames ) :
 	m_origData( NULL ),
 	m_origFrames( 0 ),
 	m_data( NULL ),
+	m_dataShared( false ),
+	m_stream( NULL ),
+	m_streamingAllowed( false ),
 	m_frames( 0 ),
 	m_startFrame( 0 ),
 	m_endFrame( 0 ),
@@ -152,7 +164,8 @@ SampleBuffer::~SampleBuffer()
 	if( m_origData != NULL )
 		MM_FREE( m_origData );
 
-	MM_FREE( m_data );
+	freeData();
+	delete m_stream;
 }
 
 
@@ -165,12 +178,19 @@ void SampleBuffer::sampleRateChanged()
 
 void SampleBuffer::update( bool _keep_settings )
 {
-	const bool lock = ( m_data != NULL );
-	if( lock )
+	const bool wasStreamed = ( m_stream != NULL );
+
+	// keep play() away from data while we replace it - has to happen
+	// before blocking snapshots of parameters
+	m_updating.fetchAndStoreOrdered( 1 );
+	while( m_players.fetchAndAddOrdered( 0 ) > 0 )
 	{
-		m_varLock.lockForWrite();
-		MM_FREE( m_data );
+		QThread::yieldCurrentThread();
 	}
+	beginParamsWrite();
+	freeData();
+	delete m_stream;
+	m_stream = NULL;
 
 	if( m_audioFile.isEmpty() && m_origData != NULL && m_origFrames > 0 )
 	{
@@ -200,42 +220,96 @@ void SampleBuffer::update( bool _keep_settings )
 		m_frames = 0;
 
 		const QFileInfo fileInfo( file );
-		if( fileInfo.size() > 100*1024*1024 )
+		const QString cacheKey = SampleCache::key( fileInfo,
+				Engine::mixer()->baseSampleRate(), m_reversed );
+		// size in MB from which on files are streamed from disk
+		const qint64 threshold = ConfigManager::inst()->value( "samples",
+				"streamingthreshold" ).isEmpty() ? 16 :
+			ConfigManager::inst()->value( "samples",
+					"streamingthreshold" ).toInt();
+		if( m_streamingAllowed && threshold > 0 &&
+				fileInfo.size() >= threshold*1024*1024 )
 		{
-			qWarning( "refusing to load sample files bigger "
-								"than 100 MB" );
+			m_stream = SampleStream::open( file, m_reversed );
 		}
-		else
-		{
 
-#ifdef LMMS_HAVE_OGGVORBIS
-		// workaround for a bug in libsndfile or our libsndfile decoder
-		// causing some OGG files to be distorted -> try with OGG Vorbis
-		// decoder first if filename extension matches "ogg"
-		if( m_frames == 0 && fileInfo.suffix() == "ogg" )
+		// someone else might have decoded this file already, either in
+		// this session or in an earlier one
+		const sampleFrame * cached = NULL;
+		QString diskCacheFile;
+		if( m_stream == NULL )
 		{
-			m_frames = decodeSampleOGGVorbis( f, buf, channels, samplerate );
+			cached = SampleCache::acquireOrReserve( cacheKey, m_frames );
+			if( cached == NULL )
+			{
+				diskCacheFile = SampleCache::diskCacheFile( fileInfo,
+					Engine::mixer()->baseSampleRate(), m_reversed );
+				cached = SampleCache::load( cacheKey, diskCacheFile,
+								m_frames );
+			}
 		}
-#endif
-		if( m_frames == 0 )
+
+		if( m_stream != NULL )
 		{
-			m_frames = decodeSampleSF( f, fbuf, channels,
-								samplerate );
+			// play at native sample rate of file instead of keeping a
+			// resampled copy
+			m_frames = m_stream->frames();
+			m_sampleRate = m_stream->sampleRate();
+			if( _keep_settings == false )
+			{
+				m_loopStartFrame = m_startFrame = 0;
+				m_loopEndFrame = m_endFrame = m_frames;
+			}
+			delete[] f;
 		}
-#ifdef LMMS_HAVE_OGGVORBIS
-		if( m_frames == 0 )
+		else if( cached != NULL )
 		{
-			m_frames = decodeSampleOGGVorbis( f, buf, channels,
-								samplerate );
+			m_data = const_cast<sampleFrame *>( cached );
+			m_dataShared = true;
+			if( _keep_settings == false )
+			{
+				m_loopStartFrame = m_startFrame = 0;
+				m_loopEndFrame = m_endFrame = m_frames;
+			}
+			delete[] f;
 		}
-#endif
-		if( m_frames == 0 )
+		else if( fileInfo.size() > 100*1024*1024 )
 		{
-			m_frames = decodeSampleDS( f, buf, channels,
-								samplerate );
+			qWarning( "refusing to load sample files bigger "
+								"than 100 MB" );
+			SampleCache::cancel( cacheKey );
+			delete[] f;
 		}
+		else
+		{
+#ifdef LMMS_HAVE_OGGVORBIS
+			// workaround for a bug in libsndfile or our libsndfile decoder
+			// causing some OGG files to be distorted -> try with OGG Vorbis
+			// decoder first if filename extension matches "ogg"
+			if( m_frames == 0 && fileInfo.suffix() == "ogg" )
+			{
+				m_frames = decodeSampleOGGVorbis( f, buf, channels, samplerate );
+			}
+#endif
+			if( m_frames == 0 )
+			{
+				m_frames = decodeSampleSF( f, fbuf, channels,
+									samplerate );
+			}
+#ifdef LMMS_HAVE_OGGVORBIS
+			if( m_frames == 0 )
+			{
+				m_frames = decodeSampleOGGVorbis( f, buf, channels,
+									samplerate );
+			}
+#endif
+			if( m_frames == 0 )
+			{
+				m_frames = decodeSampleDS( f, buf, channels,
+									samplerate );
+			}
 
-		delete[] f;
+			delete[] f;
 
 			if ( m_frames == 0 )  // if still no frames, bail
 			{
@@ -246,16 +320,18 @@ void SampleBuffer::update( bool _keep_settings )
 				m_frames = 1;
 				m_loopStartFrame = m_startFrame = 0;
 				m_loopEndFrame = m_endFrame = 1;
+				SampleCache::cancel( cacheKey );
 			}
 			else // otherwise normalize sample rate
 			{
 				normalizeSampleRate( samplerate, _keep_settings );
+				m_data = const_cast<sampleFrame *>(
+					SampleCache::insert( cacheKey, m_data,
+								m_frames ) );
+				m_dataShared = true;
+				SampleCache::store( diskCacheFile, m_data, m_frames );
 			}
-
 		}
-
-
-
 	}
 	else
 	{
@@ -268,15 +344,35 @@ void SampleBuffer::update( bool _keep_settings )
 		m_loopEndFrame = m_endFrame = 1;
 	}
 
-	if( lock )
+	if( wasStreamed && m_stream == NULL )
 	{
-		m_varLock.unlock();
+		m_sampleRate = Engine::mixer()->baseSampleRate();
 	}
 
+	endParamsWrite();
+	m_updating.fetchAndStoreOrdered( 0 );
+
 	emit sampleUpdated();
 }
 
 
+void SampleBuffer::freeData()
+{
+	if( m_dataShared )
+	{
+		SampleCache::release( m_data );
+		m_dataShared = false;
+	}
+	else if( m_data != NULL )
+	{
+		MM_FREE( m_data );
+	}
+	m_data = NULL;
+}
+
+
+
+
 void SampleBuffer::convertIntToFloat ( int_sample_t * & _ibuf, f_cnt_t _frames, int _channels)
 {
 			// following code transforms int-samples into
@@ -365,7 +461,7 @@ void SampleBuffer::normalizeSampleRate( const sample_rate_t _src_sr,
 	{
 		SampleBuffer * resampled = resample( this, _src_sr,
 					Engine::mixer()->baseSampleRate() );
-		MM_FREE( m_data );
+		freeData();
 		m_frames = resampled->frames();
 		m_data = MM_ALLOC( sampleFrame, m_frames );
 		memcpy( m_data, resampled->data(), m_frames *
@@ -606,24 +702,67 @@ bool SampleBuffer::play( sampleFrame * _ab, handleState * _state,
 					const float _freq,
 					const LoopMode _loopmode )
 {
-	m_varLock.lockForRead();
+	m_players.ref();
+	if( m_updating )
+	{
+		// data is being replaced right now
+		m_players.deref();
+		return false;
+	}
+
+	const bool ret = doPlay( _ab, _state, _frames, _freq, _loopmode );
+
+	m_players.deref();
+	return ret;
+}
+
+
+
+
+void SampleBuffer::snapshotParams( PlaybackParams & _p ) const
+{
+	int version;
+	do
+	{
+		version = m_paramsVersion.fetchAndAddOrdered( 0 );
+		_p.startFrame = m_startFrame;
+		_p.endFrame = m_endFrame;
+		_p.loopStartFrame = m_loopStartFrame;
+		_p.loopEndFrame = m_loopEndFrame;
+		_p.amplification = m_amplification;
+		_p.frequency = m_frequency;
+		_p.sampleRate = m_sampleRate;
+	// odd version means a writer is active
+	} while( ( version & 1 ) ||
+			m_paramsVersion.fetchAndAddOrdered( 0 ) != version );
+}
 
-	f_cnt_t startFrame = m_startFrame;
-	f_cnt_t endFrame = m_endFrame;
-	f_cnt_t loopStartFrame = m_loopStartFrame;
-	f_cnt_t loopEndFrame = m_loopEndFrame;
+
+
+
+bool SampleBuffer::doPlay( sampleFrame * _ab, handleState * _state,
+					const fpp_t _frames,
+					const float _freq,
+					const LoopMode _loopmode )
+{
+	PlaybackParams params;
+	snapshotParams( params );
+
+	f_cnt_t startFrame = params.startFrame;
+	f_cnt_t endFrame = params.endFrame;
+	f_cnt_t loopStartFrame = params.loopStartFrame;
+	f_cnt_t loopEndFrame = params.loopEndFrame;
 
 	if( endFrame == 0 || _frames == 0 )
 	{
-		m_varLock.unlock();
 		return false;
 	}
 
 	// variable for determining if we should currently be playing backwards in a ping-pong loop
 	bool is_backwards = _state->isBackwards();
 
-	const double freq_factor = (double) _freq / (double) m_frequency *
-		m_sampleRate / Engine::mixer()->processingSampleRate();
+	const double freq_factor = (double) _freq / (double) params.frequency *
+		params.sampleRate / Engine::mixer()->processingSampleRate();
 
 	// calculate how many frames we have in requested pitch
 	const f_cnt_t total_frames_for_current_pitch = static_cast<f_cnt_t>( (
@@ -632,7 +771,6 @@ bool SampleBuffer::play( sampleFrame * _ab, handleState * _state,
 
 	if( total_frames_for_current_pitch == 0 )
 	{
-		m_varLock.unlock();
 		return false;
 	}
 
@@ -649,7 +787,6 @@ bool SampleBuffer::play( sampleFrame * _ab, handleState * _state,
 	{
 		if( play_frame >= endFrame )
 		{
-			m_varLock.unlock();
 			return false;
 		}
 
@@ -666,74 +803,105 @@ bool SampleBuffer::play( sampleFrame * _ab, handleState * _state,
 		play_frame = getPingPongIndex( play_frame, loopStartFrame, loopEndFrame );
 	}
 
-	f_cnt_t fragment_size = (f_cnt_t)( _frames * freq_factor ) + MARGIN[ _state->interpolationMode() ];
-
-	sampleFrame * tmp = NULL;
+	const float amp = params.amplification;
 
 	// check whether we have to change pitch...
 	if( freq_factor != 1.0 || _state->m_varyingPitch )
 	{
-		SRC_DATA src_data;
-		// Generate output
-		src_data.data_in =
-			getSampleFragment( play_frame, fragment_size, _loopmode, &tmp, &is_backwards,
-			loopStartFrame, loopEndFrame, endFrame )[0];
-		src_data.data_out = _ab[0];
-		src_data.input_frames = fragment_size;
-		src_data.output_frames = _frames;
-		src_data.src_ratio = 1.0 / freq_factor;
-		src_data.end_of_input = 0;
-		int error = src_process( _state->m_resamplingData,
-								&src_data );
-		if( error )
-		{
-			printf( "SampleBuffer: error while resampling: %s\n",
-							src_strerror( error ) );
-		}
-		if( src_data.output_frames_gen > _frames )
-		{
-			printf( "SampleBuffer: not enough frames: %ld / %d\n",
-					src_data.output_frames_gen, _frames );
-		}
-		// Advance
-		switch( _loopmode )
+		const f_cnt_t margin = MARGIN[ _state->interpolationMode() ];
+		fpp_t done = 0;
+		while( done < _frames )
 		{
-			case LoopOff:
-				play_frame += src_data.input_frames_used;
-				break;
-			case LoopOn:
-				play_frame += src_data.input_frames_used;
-				play_frame = getLoopedIndex( play_frame, loopStartFrame, loopEndFrame );
-				break;
-			case LoopPingPong:
+			// fragment buffer is preallocated for usual pitches, so
+			// voices pitched up further are processed in pieces
+			fpp_t frames = _frames - done;
+			if( frames * freq_factor + margin > _state->m_fragmentFrames )
 			{
-				f_cnt_t left = src_data.input_frames_used;
-				if( _state->isBackwards() )
+				frames = (fpp_t)( ( _state->m_fragmentFrames - margin ) /
+								freq_factor );
+				if( frames <= 0 )
 				{
-					play_frame -= src_data.input_frames_used;
-					if( play_frame < loopStartFrame )
+					memset( _ab + done, 0,
+						( _frames - done ) * BYTES_PER_FRAME );
+					break;
+				}
+			}
+			const f_cnt_t fragment_size = qMin<f_cnt_t>(
+					(f_cnt_t)( frames * freq_factor ) + margin,
+						_state->m_fragmentFrames );
+			const bool was_backwards = is_backwards;
+
+			// Generate output
+			const sampleFrame * fragment = getSampleFragment( play_frame,
+					fragment_size, _loopmode, _state->m_fragment,
+					&is_backwards, loopStartFrame, loopEndFrame,
+									endFrame );
+			f_cnt_t used = 0;
+			const fpp_t generated = _state->m_resampler.process( fragment,
+						fragment_size, _ab + done, frames,
+						freq_factor, amp, used );
+			if( generated < frames )
+			{
+				printf( "SampleBuffer: not enough frames: %d / %d\n",
+							generated, frames );
+				memset( _ab + done + generated, 0,
+					( frames - generated ) * BYTES_PER_FRAME );
+			}
+			done += frames;
+			// Advance
+			switch( _loopmode )
+			{
+				case LoopOff:
+					play_frame += used;
+					break;
+				case LoopOn:
+					play_frame += used;
+					play_frame = getLoopedIndex( play_frame, loopStartFrame, loopEndFrame );
+					break;
+				case LoopPingPong:
+				{
+					f_cnt_t left = used;
+					if( was_backwards )
 					{
-						left -= ( loopStartFrame - play_frame );
-						play_frame = loopStartFrame;
+						play_frame -= used;
+						if( play_frame < loopStartFrame )
+						{
+							left -= ( loopStartFrame - play_frame );
+							play_frame = loopStartFrame;
+						}
+						else left = 0;
 					}
-					else left = 0;
+					play_frame += left;
+					play_frame = getPingPongIndex( play_frame, loopStartFrame, loopEndFrame  );
+					break;
 				}
-				play_frame += left;
-				play_frame = getPingPongIndex( play_frame, loopStartFrame, loopEndFrame  );
-				break;
 			}
 		}
 	}
 	else
 	{
-		// we don't have to pitch, so we just copy the sample-data
-		// as is into pitched-copy-buffer
-
-		// Generate output
-		memcpy( _ab,
-			getSampleFragment( play_frame, _frames, _loopmode, &tmp, &is_backwards,
-						loopStartFrame, loopEndFrame, endFrame ),
-						_frames * BYTES_PER_FRAME );
+		// we don't have to pitch - fragments crossing loop points are
+		// assembled directly in output buffer, otherwise we copy
+		// from sample data and amplify in one go
+		const sampleFrame * src = getSampleFragment( play_frame, _frames,
+						_loopmode, _ab, &is_backwards,
+						loopStartFrame, loopEndFrame, endFrame );
+		if( src != _ab )
+		{
+			for( fpp_t i = 0; i < _frames; ++i )
+			{
+				_ab[i][0] = src[i][0] * amp;
+				_ab[i][1] = src[i][1] * amp;
+			}
+		}
+		else if( amp != 1.0f )
+		{
+			for( fpp_t i = 0; i < _frames; ++i )
+			{
+				_ab[i][0] *= amp;
+				_ab[i][1] *= amp;
+			}
+		}
 		// Advance
 		switch( _loopmode )
 		{
@@ -764,69 +932,59 @@ bool SampleBuffer::play( sampleFrame * _ab, handleState * _state,
 		}
 	}
 
-	if( tmp != NULL ) 
-	{
-		MM_FREE( tmp );
-	}
-
 	_state->setBackwards( is_backwards );
 	_state->setFrameIndex( play_frame );
 
-	for( fpp_t i = 0; i < _frames; ++i )
-	{
-		_ab[i][0] *= m_amplification;
-		_ab[i][1] *= m_amplification;
-	}
-
-	m_varLock.unlock();
 	return true;
 }
 
 
 
 
-sampleFrame * SampleBuffer::getSampleFragment( f_cnt_t _index,
-		f_cnt_t _frames, LoopMode _loopmode, sampleFrame * * _tmp, bool * _backwards,
+const sampleFrame * SampleBuffer::getSampleFragment( f_cnt_t _index,
+		f_cnt_t _frames, LoopMode _loopmode, sampleFrame * _tmp, bool * _backwards,
 		f_cnt_t _loopstart, f_cnt_t _loopend, f_cnt_t _end ) const
 {
-	if( _loopmode == LoopOff )
+	// streamed frames always have to be copied
+	if( m_stream == NULL )
 	{
-		if( _index + _frames <= _end )
+		if( _loopmode == LoopOff )
 		{
-			return m_data + _index;
+			if( _index + _frames <= _end )
+			{
+				return m_data + _index;
+			}
 		}
-	}
-	else if( _loopmode == LoopOn )
-	{
-		if( _index + _frames <= _loopend )
+		else if( _loopmode == LoopOn )
+		{
+			if( _index + _frames <= _loopend )
+			{
+				return m_data + _index;
+			}
+		}
+		else
 		{
+			if( ! *_backwards && _index + _frames < _loopend )
 			return m_data + _index;
 		}
 	}
-	else
-	{
-		if( ! *_backwards && _index + _frames < _loopend )
-		return m_data + _index;
-	}
-
-	*_tmp = MM_ALLOC( sampleFrame, _frames );
 
 	if( _loopmode == LoopOff )
 	{
-		f_cnt_t available = _end - _index;
-		memcpy( *_tmp, m_data + _index, available * BYTES_PER_FRAME );
-		memset( *_tmp + available, 0, ( _frames - available ) *
+		f_cnt_t available = qBound<f_cnt_t>( 0, _end - _index, _frames );
+		fetchFrames( _tmp, _index, available );
+		memset( _tmp + available, 0, ( _frames - available ) *
 							BYTES_PER_FRAME );
 	}
 	else if( _loopmode == LoopOn )
 	{
 		f_cnt_t copied = qMin( _frames, _loopend - _index );
-		memcpy( *_tmp, m_data + _index, copied * BYTES_PER_FRAME );
+		fetchFrames( _tmp, _index, copied );
 		f_cnt_t loop_frames = _loopend - _loopstart;
 		while( copied < _frames )
 		{
 			f_cnt_t todo = qMin( _frames - copied, loop_frames );
-			memcpy( *_tmp + copied, m_data + _loopstart, todo * BYTES_PER_FRAME );
+			fetchFrames( _tmp + copied, _loopstart, todo );
 			copied += todo;
 		}
 	}
@@ -842,18 +1000,14 @@ sampleFrame * SampleBuffer::getSampleFragment( f_cnt_t _index,
 		if( backwards )
 		{
 			copied = qMin( _frames, pos - _loopstart );
-			for( int i=0; i < copied; i++ )
-			{
-				(*_tmp)[i][0] = m_data[ pos - i ][0];
-				(*_tmp)[i][1] = m_data[ pos - i ][1];
-			}
+			fetchFramesBackwards( _tmp, pos, copied );
 			pos -= copied;
 			if( pos == _loopstart ) backwards = false;
 		}
 		else
 		{
 			copied = qMin( _frames, _loopend - pos );
-			memcpy( *_tmp, m_data + pos, copied * BYTES_PER_FRAME );
+			fetchFrames( _tmp, pos, copied );
 			pos += copied;
 			if( pos == _loopend ) backwards = true;
 		}
@@ -863,11 +1017,7 @@ sampleFrame * SampleBuffer::getSampleFragment( f_cnt_t _index,
 			if( backwards )
 			{
 				f_cnt_t todo = qMin( _frames - copied, pos - _loopstart );
-				for ( int i=0; i < todo; i++ )
-				{
-					(*_tmp)[ copied + i ][0] = m_data[ pos - i ][0];
-					(*_tmp)[ copied + i ][1] = m_data[ pos - i ][1];
-				}
+				fetchFramesBackwards( _tmp + copied, pos, todo );
 				pos -= todo;
 				copied += todo;
 				if( pos <= _loopstart ) backwards = false;
@@ -875,7 +1025,7 @@ sampleFrame * SampleBuffer::getSampleFragment( f_cnt_t _index,
 			else
 			{
 				f_cnt_t todo = qMin( _frames - copied, _loopend - pos );
-				memcpy( *_tmp + copied, m_data + pos, todo * BYTES_PER_FRAME );
+				fetchFrames( _tmp + copied, pos, todo );
 				pos += todo;
 				copied += todo;
 				if( pos >= _loopend ) backwards = true;
@@ -884,7 +1034,42 @@ sampleFrame * SampleBuffer::getSampleFragment( f_cnt_t _index,
 		*_backwards = backwards;
 	}
 
-	return *_tmp;
+	return _tmp;
+}
+
+
+
+
+void SampleBuffer::fetchFrames( sampleFrame * _dst, f_cnt_t _from,
+						f_cnt_t _frames ) const
+{
+	if( _frames <= 0 )
+	{
+		return;
+	}
+	if( m_stream != NULL )
+	{
+		m_stream->read( _dst, _from, _frames );
+	}
+	else
+	{
+		memcpy( _dst, m_data + _from, _frames * BYTES_PER_FRAME );
+	}
+}
+
+
+
+
+// copies frames _from, _from-1, ... to _dst
+void SampleBuffer::fetchFramesBackwards( sampleFrame * _dst, f_cnt_t _from,
+						f_cnt_t _frames ) const
+{
+	fetchFrames( _dst, _from - _frames + 1, _frames );
+	for( f_cnt_t i = 0; i < _frames / 2; ++i )
+	{
+		qSwap( _dst[i][0], _dst[_frames-1-i][0] );
+		qSwap( _dst[i][1], _dst[_frames-1-i][1] );
+	}
 }
 
 
@@ -921,6 +1106,12 @@ void SampleBuffer::visualize( QPainter & _p, const QRect & _dr,
 {
 	if( m_frames == 0 ) return;
 
+	if( m_stream != NULL )
+	{
+		visualizeStream( _p, _dr, _from_frame, _to_frame );
+		return;
+	}
+
 	const bool focus_on_range = _to_frame <= m_frames
 					&& 0 <= _from_frame && _from_frame < _to_frame;
 //	_p.setClipRect( _clip );
@@ -963,6 +1154,49 @@ void SampleBuffer::visualize( QPainter & _p, const QRect & _dr,
 
 
 
+void SampleBuffer::visualizeStream( QPainter & _p, const QRect & _dr,
+					f_cnt_t _from_frame, f_cnt_t _to_frame )
+{
+	// we can't touch every frame here, so draw min/max per pixel column
+	// of the stream's overview as far as it's computed already
+	const bool focus_on_range = _to_frame <= m_frames
+					&& 0 <= _from_frame && _from_frame < _to_frame;
+	const f_cnt_t first = focus_on_range ? _from_frame : 0;
+	const f_cnt_t last = focus_on_range ? _to_frame : m_frames;
+	const int w = qMax( _dr.width(), 1 );
+	const int yb = _dr.height() / 2 + _dr.y();
+	const float y_space = _dr.height() * 0.5f * m_amplification;
+	const double fpx = double( last - first ) / w;
+
+	for( int x = 0; x < w; ++x )
+	{
+		const f_cnt_t from = first + static_cast<f_cnt_t>( x * fpx );
+		const f_cnt_t to = first + static_cast<f_cnt_t>( ( x + 1 ) * fpx );
+		float min, max;
+		if( !m_stream->peak( from, qMax( to, from + 1 ), min, max ) )
+		{
+			break;
+		}
+		_p.drawLine( _dr.x() + x, (int)( yb - max * y_space ),
+					_dr.x() + x, (int)( yb - min * y_space ) );
+	}
+}
+
+
+
+
+qint64 SampleBuffer::memoryUsage() const
+{
+	if( m_stream != NULL )
+	{
+		return m_stream->memoryUsage();
+	}
+	return (qint64) ( m_frames + m_origFrames ) * BYTES_PER_FRAME;
+}
+
+
+
+
 QString SampleBuffer::openAudioFile() const
 {
 	FileDialog ofd( NULL, tr( "Open audio file" ) );
@@ -1376,9 +1610,9 @@ void SampleBuffer::loadFromBase64( const QString & _data )
 
 void SampleBuffer::setStartFrame( const f_cnt_t _s )
 {
-	m_varLock.lockForWrite();
+	beginParamsWrite();
 	m_startFrame = _s;
-	m_varLock.unlock();
+	endParamsWrite();
 }
 
 
@@ -1386,9 +1620,9 @@ void SampleBuffer::setStartFrame( const f_cnt_t _s )
 
 void SampleBuffer::setEndFrame( const f_cnt_t _e )
 {
-	m_varLock.lockForWrite();
+	beginParamsWrite();
 	m_endFrame = _e;
-	m_varLock.unlock();
+	endParamsWrite();
 }
 
 
@@ -1396,7 +1630,9 @@ void SampleBuffer::setEndFrame( const f_cnt_t _e )
 
 void SampleBuffer::setAmplification( float _a )
 {
+	beginParamsWrite();
 	m_amplification = _a;
+	endParamsWrite();
 	emit sampleUpdated();
 }
 
@@ -1455,22 +1691,32 @@ QString SampleBuffer::tryToMakeAbsolute( const QString & _file )
 
 
 
+// size of fragments which are resampled in one go
+static f_cnt_t fragmentFrames( Resampler::Qualities _interpolationMode,
+							int _pitchRatio )
+{
+	return _pitchRatio * Engine::mixer()->framesPerPeriod() +
+					MARGIN[_interpolationMode];
+}
 
 
 
 
-SampleBuffer::handleState::handleState( bool _varying_pitch, int interpolation_mode ) :
+SampleBuffer::handleState::handleState( bool _varying_pitch,
+				Resampler::Qualities interpolation_mode ) :
 	m_frameIndex( 0 ),
 	m_varyingPitch( _varying_pitch ),
-	m_isBackwards( false )
+	m_isBackwards( false ),
+	// resampler takes whole fragments without growing its buffer
+	m_resampler( interpolation_mode,
+		fragmentFrames( interpolation_mode, FragmentPitchRatio ) ),
+	m_interpolationMode( interpolation_mode ),
+	m_fragment( NULL ),
+	m_fragmentFrames( fragmentFrames( interpolation_mode,
+						FragmentPitchRatio ) )
 {
-	int error;
-	m_interpolationMode = interpolation_mode;
-	
-	if( ( m_resamplingData = src_new( interpolation_mode, DEFAULT_CHANNELS, &error ) ) == NULL )
-	{
-		qDebug( "Error: src_new() failed in sample_buffer.cpp!\n" );
-	}
+	// allocate here rather than when playing
+	m_fragment = MM_ALLOC( sampleFrame, m_fragmentFrames );
 }
 
 
@@ -1478,5 +1724,5 @@ SampleBuffer::handleState::handleState( bool _varying_pitch, int interpolation_m
 
 SampleBuffer::handleState::~handleState()
 {
-	src_delete( m_resamplingData );
+	MM_FREE( m_fragment );
 }
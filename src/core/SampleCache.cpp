@@ -0,0 +1,367 @@
+/*
+ * SampleCache.cpp - process-wide cache of decoded sample files
+ *
+ * Copyright (c) 2026 agent <agent/at/local>
+ *
+ * This file is part of LMMS - http://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "SampleCache.h"
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QDateTime>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QThread>
+
+#include <cstring>
+
+#include "ConfigManager.h"
+#include "MemoryManager.h"
+
+
+static const char DiskCacheMagic[4] = { 'L', 'S', 'C', 'F' };
+static const quint32 DiskCacheVersion = 1;
+
+
+QHash<QString, SampleCache::Entry *> SampleCache::s_entries;
+QHash<const sampleFrame *, SampleCache::Entry *> SampleCache::s_entriesByData;
+QMutex SampleCache::s_mutex;
+QSet<QString> SampleCache::s_pending;
+QWaitCondition SampleCache::s_pendingDone;
+int SampleCache::s_hits = 0;
+int SampleCache::s_misses = 0;
+
+
+
+
+QString SampleCache::key( const QFileInfo & _file, sample_rate_t _rate,
+							bool _reversed )
+{
+	return QString( "%1|%2|%3|%4|%5" ).
+			arg( _file.absoluteFilePath() ).
+			arg( _file.size() ).
+			arg( _file.lastModified().toMSecsSinceEpoch() ).
+			arg( _rate ).
+			arg( _reversed ? 1 : 0 );
+}
+
+
+
+
+const sampleFrame * SampleCache::acquire( const QString & _key,
+							f_cnt_t & _frames )
+{
+	QMutexLocker ml( &s_mutex );
+
+	Entry * e = s_entries.value( _key, NULL );
+	if( e == NULL )
+	{
+		++s_misses;
+		return NULL;
+	}
+
+	++s_hits;
+	++e->refs;
+	_frames = e->frames;
+	return e->data;
+}
+
+
+
+
+const sampleFrame * SampleCache::acquireOrReserve( const QString & _key,
+							f_cnt_t & _frames )
+{
+	QMutexLocker ml( &s_mutex );
+
+	while( s_pending.contains( _key ) )
+	{
+		s_pendingDone.wait( &s_mutex );
+	}
+
+	Entry * e = s_entries.value( _key, NULL );
+	if( e == NULL )
+	{
+		++s_misses;
+		s_pending.insert( _key );
+		return NULL;
+	}
+
+	++s_hits;
+	++e->refs;
+	_frames = e->frames;
+	return e->data;
+}
+
+
+
+
+void SampleCache::cancel( const QString & _key )
+{
+	QMutexLocker ml( &s_mutex );
+
+	if( s_pending.remove( _key ) )
+	{
+		s_pendingDone.wakeAll();
+	}
+}
+
+
+
+
+const sampleFrame * SampleCache::insert( const QString & _key,
+					sampleFrame * _data, f_cnt_t _frames )
+{
+	QMutexLocker ml( &s_mutex );
+
+	Entry * e = s_entries.value( _key, NULL );
+	if( e != NULL )
+	{
+		// someone else was faster decoding the same file
+		MM_FREE( _data );
+		++e->refs;
+		return e->data;
+	}
+
+	addEntry( _key, _data, _frames );
+
+	return _data;
+}
+
+
+
+
+void SampleCache::release( const sampleFrame * _data )
+{
+	QMutexLocker ml( &s_mutex );
+
+	Entry * e = s_entriesByData.value( _data, NULL );
+	if( e == NULL || --e->refs > 0 )
+	{
+		return;
+	}
+
+	s_entriesByData.remove( _data );
+	s_entries.remove( e->key );
+	if( e->mappedFile != NULL )
+	{
+		e->mappedFile->unmap( e->mapping );
+		delete e->mappedFile;
+	}
+	else
+	{
+		MM_FREE( e->data );
+	}
+	delete e;
+}
+
+
+
+
+QString SampleCache::diskCacheFile( const QFileInfo & _file,
+					sample_rate_t _rate, bool _reversed )
+{
+	if( ConfigManager::inst()->value( "samples", "diskcache" ).toInt() == 0 )
+	{
+		return QString();
+	}
+
+	// identify source by path, size and modification time like key()
+	// does - hashing its contents would mean reading the whole file on
+	// every miss before even starting to decode it
+	const QString source = QString( "%1|%2|%3" ).
+			arg( _file.absoluteFilePath() ).
+			arg( _file.size() ).
+			arg( _file.lastModified().toMSecsSinceEpoch() );
+	const QByteArray hash = QCryptographicHash::hash( source.toUtf8(),
+						QCryptographicHash::Sha1 );
+
+	return ConfigManager::inst()->workingDir() + "samplecache/" +
+		QString( "%1-%2%3.lsc" ).
+			arg( QString( hash.toHex() ) ).
+			arg( _rate ).
+			arg( _reversed ? "r" : "" );
+}
+
+
+
+
+const sampleFrame * SampleCache::load( const QString & _key,
+					const QString & _diskFile,
+					f_cnt_t & _frames )
+{
+	if( _diskFile.isEmpty() )
+	{
+		return NULL;
+	}
+
+	QFile * f = new QFile( _diskFile );
+	if( !f->open( QFile::ReadOnly ) || f->size() < (qint64) sizeof( DiskHeader ) )
+	{
+		delete f;
+		return NULL;
+	}
+
+	DiskHeader h;
+	const qint64 size = f->size();
+	if( f->read( (char *) &h, sizeof( h ) ) != sizeof( h ) ||
+		memcmp( h.magic, DiskCacheMagic, sizeof( h.magic ) ) != 0 ||
+		h.version != DiskCacheVersion ||
+		h.channels != DEFAULT_CHANNELS || h.frames == 0 ||
+		// accessing mapped data beyond end of a truncated file
+		// would crash
+		size != (qint64) sizeof( h ) +
+				(qint64) h.frames * sizeof( sampleFrame ) )
+	{
+		// incomplete or from other version - decode again
+		delete f;
+		return NULL;
+	}
+
+	uchar * mapping = f->map( 0, size );
+	if( mapping == NULL )
+	{
+		delete f;
+		return NULL;
+	}
+
+	sampleFrame * data = (sampleFrame *)( mapping + sizeof( h ) );
+
+	QMutexLocker ml( &s_mutex );
+
+	Entry * e = s_entries.value( _key, NULL );
+	if( e != NULL )
+	{
+		f->unmap( mapping );
+		delete f;
+		++e->refs;
+		_frames = e->frames;
+		return e->data;
+	}
+
+	e = addEntry( _key, data, h.frames );
+	e->mappedFile = f;
+	e->mapping = mapping;
+
+	_frames = h.frames;
+	return data;
+}
+
+
+
+
+void SampleCache::store( const QString & _diskFile,
+				const sampleFrame * _data, f_cnt_t _frames )
+{
+	if( _diskFile.isEmpty() || QFile::exists( _diskFile ) )
+	{
+		return;
+	}
+
+	QDir().mkpath( QFileInfo( _diskFile ).absolutePath() );
+
+	// write to temporary file first so that readers never see
+	// incomplete files - name has to be unique as other threads or
+	// instances may be storing the same file right now. Whoever renames
+	// first wins, QFile::rename() doesn't replace existing files.
+	const QString tmpFile = QString( "%1.%2-%3.tmp" ).arg( _diskFile ).
+				arg( QCoreApplication::applicationPid() ).
+				arg( (quintptr) QThread::currentThreadId() );
+	QFile f( tmpFile );
+	if( !f.open( QFile::WriteOnly | QFile::Truncate ) )
+	{
+		return;
+	}
+
+	DiskHeader h;
+	memset( &h, 0, sizeof( h ) );
+	memcpy( h.magic, DiskCacheMagic, sizeof( h.magic ) );
+	h.version = DiskCacheVersion;
+	h.channels = DEFAULT_CHANNELS;
+	h.frames = _frames;
+
+	const qint64 bytes = (qint64) _frames * sizeof( sampleFrame );
+	const bool ok = f.write( (const char *) &h, sizeof( h ) ) == sizeof( h ) &&
+			f.write( (const char *) _data, bytes ) == bytes;
+	f.close();
+
+	if( !ok || !QFile::rename( tmpFile, _diskFile ) )
+	{
+		QFile::remove( tmpFile );
+	}
+}
+
+
+
+
+SampleCache::Entry * SampleCache::addEntry( const QString & _key,
+					sampleFrame * _data, f_cnt_t _frames )
+{
+	// whoever reserved _key is done with it
+	if( s_pending.remove( _key ) )
+	{
+		s_pendingDone.wakeAll();
+	}
+
+	Entry * e = new Entry;
+	e->key = _key;
+	e->data = _data;
+	e->frames = _frames;
+	e->refs = 1;
+	e->mappedFile = NULL;
+	e->mapping = NULL;
+	s_entries[_key] = e;
+	s_entriesByData[_data] = e;
+
+	return e;
+}
+
+
+
+
+qint64 SampleCache::bytes()
+{
+	QMutexLocker ml( &s_mutex );
+
+	qint64 b = 0;
+	foreach( const Entry * e, s_entries )
+	{
+		b += (qint64) e->frames * sizeof( sampleFrame );
+	}
+	return b;
+}
+
+
+
+
+qint64 SampleCache::savedBytes()
+{
+	QMutexLocker ml( &s_mutex );
+
+	qint64 b = 0;
+	foreach( const Entry * e, s_entries )
+	{
+		b += (qint64) ( e->refs - 1 ) * e->frames * sizeof( sampleFrame );
+	}
+	return b;
+}
@@ -153,7 +153,10 @@ bool SamplePlayHandle::isFromTrack( const Track * _track ) const
 
 f_cnt_t SamplePlayHandle::totalFrames() const
 {
-	return ( m_sampleBuffer->endFrame() - m_sampleBuffer->startFrame() ) * ( Engine::mixer()->processingSampleRate() / Engine::mixer()->baseSampleRate() );
+	// streamed buffers keep the sample rate of their file
+	return ( m_sampleBuffer->endFrame() - m_sampleBuffer->startFrame() ) *
+		( (double) Engine::mixer()->processingSampleRate() /
+					m_sampleBuffer->sampleRate() );
 }
 
 
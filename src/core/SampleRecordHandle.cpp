@@ -68,6 +68,9 @@ SampleRecordHandle::~SampleRecordHandle()
 
 void SampleRecordHandle::play( sampleFrame * /*_working_buffer*/ )
 {
+	// recorded input has to line up with what's being heard
+	Engine::mixer()->notifyLiveInput();
+
 	const sampleFrame * recbuf = Engine::mixer()->inputBuffer();
 	const f_cnt_t frames = Engine::mixer()->inputBufferFrames();
 	writeBuffer( recbuf, frames );
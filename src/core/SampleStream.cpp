@@ -0,0 +1,599 @@
+/*
+ * SampleStream.cpp - streaming long audio files from disk for SampleBuffer
+ *
+ * Copyright (c) 2026 agent <agent/at/local>
+ *
+ * This file is part of LMMS - http://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "SampleStream.h"
+
+#include <QtCore/QList>
+#include <QtCore/QMutex>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QThread>
+#include <QtCore/QWaitCondition>
+
+#include <cstring>
+
+#include "lmmsconfig.h"
+
+
+const f_cnt_t SampleStream::PageFrames;
+const int SampleStream::HeadPages;
+const int SampleStream::ReadAheadPages;
+const int SampleStream::MaxCachedPages;
+const f_cnt_t SampleStream::OverviewFrames;
+
+
+// one thread decoding pages for all streams
+class SampleStreamLoader : public QThread
+{
+public:
+	// how long the loader sleeps at most before looking for pages requested
+	// by notify()
+	static const unsigned long PollInterval = 10;	// ms
+
+	// starts loader thread on first call - returns NULL after shutdown()
+	static SampleStreamLoader * inst()
+	{
+		QMutexLocker ml( &s_instanceMutex );
+		if( s_instance == NULL && !s_shutDown )
+		{
+			s_instance = new SampleStreamLoader;
+			s_instance->start( QThread::LowPriority );
+		}
+		return s_instance;
+	}
+
+	// stops and deletes loader thread if it's running - streams still
+	// alive then don't get any further pages decoded
+	static void shutdown()
+	{
+		QMutexLocker ml( &s_instanceMutex );
+		s_shutDown = true;
+		if( s_instance == NULL )
+		{
+			return;
+		}
+		s_instance->m_mutex.lock();
+		s_instance->m_stop = true;
+		foreach( SampleStream * stream, s_instance->m_streams )
+		{
+			stream->m_loader = NULL;
+		}
+		s_instance->m_cond.wakeOne();
+		s_instance->m_mutex.unlock();
+		s_instance->wait();
+		delete s_instance;
+		s_instance = NULL;
+	}
+
+	void add( SampleStream * _stream )
+	{
+		QMutexLocker ml( &m_mutex );
+		m_streams.append( _stream );
+		m_cond.wakeOne();
+	}
+
+	// waits until loader doesn't work on given stream anymore
+	void remove( SampleStream * _stream )
+	{
+		QMutexLocker ml( &m_mutex );
+		m_streams.removeOne( _stream );
+		while( m_current == _stream )
+		{
+			m_idle.wait( &m_mutex );
+		}
+	}
+
+	// called by audio threads when they requested pages - waking the
+	// thread would mean locking a mutex, so only flag the request and let
+	// the loader pick it up after PollInterval at most
+	void notify()
+	{
+		m_pending.fetchAndStoreOrdered( 1 );
+	}
+
+
+protected:
+	virtual void run()
+	{
+		m_mutex.lock();
+		while( !m_stop )
+		{
+			// decoding can take a while, so don't block add() and
+			// remove() meanwhile but work on a copy of the list
+			const QList<SampleStream *> streams = m_streams;
+			m_mutex.unlock();
+
+			// requests coming in from now on are seen by next round
+			m_pending.fetchAndStoreOrdered( 0 );
+
+			bool busy = false;
+			for( int i = 0; i < streams.size(); ++i )
+			{
+				if( acquire( streams[i] ) )
+				{
+					busy |= streams[i]->loadRequestedPages();
+					release();
+				}
+			}
+
+			// overviews have lower priority than pages needed for
+			// playback, so only build one piece at a time
+			for( int i = 0; i < streams.size() && !busy; ++i )
+			{
+				if( acquire( streams[i] ) )
+				{
+					busy = streams[i]->buildOverview();
+					release();
+				}
+			}
+
+			m_mutex.lock();
+			if( !busy && !m_stop &&
+				m_pending.fetchAndAddOrdered( 0 ) == 0 )
+			{
+				if( m_streams.isEmpty() )
+				{
+					// woken up by add() or shutdown()
+					m_cond.wait( &m_mutex );
+				}
+				else
+				{
+					m_cond.wait( &m_mutex, PollInterval );
+				}
+			}
+		}
+		m_mutex.unlock();
+	}
+
+
+private:
+	SampleStreamLoader() :
+		m_pending( 0 ),
+		m_stop( false ),
+		m_current( NULL )
+	{
+	}
+
+	// marks _stream as being worked on unless it has been removed in
+	// the meantime
+	bool acquire( SampleStream * _stream )
+	{
+		QMutexLocker ml( &m_mutex );
+		if( m_stop || !m_streams.contains( _stream ) )
+		{
+			return false;
+		}
+		m_current = _stream;
+		return true;
+	}
+
+	void release()
+	{
+		QMutexLocker ml( &m_mutex );
+		m_current = NULL;
+		m_idle.wakeAll();
+	}
+
+	static QMutex s_instanceMutex;
+	static SampleStreamLoader * s_instance;
+	static bool s_shutDown;
+
+	QMutex m_mutex;
+	QWaitCondition m_cond;
+	QWaitCondition m_idle;
+	QAtomicInt m_pending;
+	QList<SampleStream *> m_streams;
+	bool m_stop;
+	SampleStream * m_current;
+
+} ;
+
+
+QMutex SampleStreamLoader::s_instanceMutex;
+SampleStreamLoader * SampleStreamLoader::s_instance = NULL;
+bool SampleStreamLoader::s_shutDown = false;
+
+
+
+
+// Qt 4 lacks load() for atomics
+static inline sampleFrame * loadPage( QAtomicPointer<sampleFrame> & _data )
+{
+	return _data.fetchAndAddOrdered( 0 );
+}
+
+
+
+
+SampleStream::SampleStream( SNDFILE * _sndFile, const SF_INFO & _info,
+							bool _reversed ) :
+	m_loader( NULL ),
+	m_sndFile( _sndFile ),
+	m_channels( _info.channels ),
+	m_frames( _info.frames ),
+	m_sampleRate( _info.samplerate ),
+	m_reversed( _reversed ),
+	m_numPages( ( _info.frames + PageFrames - 1 ) / PageFrames ),
+	m_pages( new Page[m_numPages] ),
+	m_decodeBuffer( new float[PageFrames * _info.channels] ),
+	m_residentPages( 0 ),
+	m_readers( 0 ),
+	m_clock( 0 ),
+	m_underruns( 0 ),
+	m_overview( 2 * ( ( _info.frames + OverviewFrames - 1 ) / OverviewFrames ) ),
+	m_overviewBlocks( 0 )
+{
+	for( int i = 0; i < m_numPages; ++i )
+	{
+		m_pages[i].lastUse = 0;
+	}
+}
+
+
+
+
+SampleStream::~SampleStream()
+{
+	if( m_loader != NULL )
+	{
+		m_loader->remove( this );
+	}
+
+	sf_close( m_sndFile );
+	for( int i = 0; i < m_numPages; ++i )
+	{
+		sampleFrame * data = loadPage( m_pages[i].data );
+		if( data )
+		{
+			MM_FREE( data );
+		}
+	}
+	delete[] m_pages;
+	delete[] m_decodeBuffer;
+}
+
+
+
+
+void SampleStream::shutdownLoader()
+{
+	SampleStreamLoader::shutdown();
+}
+
+
+
+
+SampleStream * SampleStream::open( const QString & _file, bool _reversed )
+{
+	// nobody would decode pages after the head
+	SampleStreamLoader * loader = SampleStreamLoader::inst();
+	if( loader == NULL )
+	{
+		return NULL;
+	}
+
+	SF_INFO info;
+	memset( &info, 0, sizeof( info ) );
+#ifdef LMMS_BUILD_WIN32
+	SNDFILE * sndFile = sf_open( _file.toLocal8Bit().constData(), SFM_READ, &info );
+#else
+	SNDFILE * sndFile = sf_open( _file.toUtf8().constData(), SFM_READ, &info );
+#endif
+	if( sndFile == NULL )
+	{
+		return NULL;
+	}
+	if( !info.seekable || info.frames <= 0 || info.channels <= 0 )
+	{
+		sf_close( sndFile );
+		return NULL;
+	}
+
+	SampleStream * s = new SampleStream( sndFile, info, _reversed );
+
+	// decode head right away so playback can start without delay
+	for( int i = 0; i < s->m_numPages; ++i )
+	{
+		if( s->isPinned( i ) )
+		{
+			s->decodePage( i );
+		}
+	}
+
+	s->m_loader = loader;
+	loader->add( s );
+
+	return s;
+}
+
+
+
+
+bool SampleStream::read( sampleFrame * _dst, f_cnt_t _from, f_cnt_t _frames )
+{
+	m_readers.ref();
+	const int now = m_clock.fetchAndAddRelaxed( 1 );
+
+	bool complete = true;
+	int lastPage = -1;
+	f_cnt_t done = 0;
+	while( done < _frames )
+	{
+		const f_cnt_t frame = _from + done;
+		if( frame < 0 || frame >= m_frames )
+		{
+			memset( _dst + done, 0, ( _frames - done ) * sizeof( sampleFrame ) );
+			break;
+		}
+
+		const f_cnt_t ff = fileFrame( frame );
+		const int page = ff / PageFrames;
+		const f_cnt_t offset = ff % PageFrames;
+		// frames we can take from this page in reading direction
+		const f_cnt_t available = m_reversed ? offset + 1 :
+				qMin( PageFrames - offset, m_frames - ff );
+		const f_cnt_t todo = qMin( available, _frames - done );
+
+		Page & p = m_pages[page];
+		p.lastUse = now;
+		const sampleFrame * data = loadPage( p.data );
+		if( data == NULL )
+		{
+			memset( _dst + done, 0, todo * sizeof( sampleFrame ) );
+			request( page );
+			complete = false;
+		}
+		else if( m_reversed )
+		{
+			for( f_cnt_t f = 0; f < todo; ++f )
+			{
+				_dst[done+f][0] = data[offset-f][0];
+				_dst[done+f][1] = data[offset-f][1];
+			}
+		}
+		else
+		{
+			memcpy( _dst + done, data + offset, todo * sizeof( sampleFrame ) );
+		}
+
+		lastPage = page;
+		done += todo;
+	}
+
+	m_readers.deref();
+
+	// keep pages ahead of us decoded
+	for( int i = 1; lastPage >= 0 && i <= ReadAheadPages; ++i )
+	{
+		request( m_reversed ? lastPage - i : lastPage + i );
+	}
+
+	if( !complete )
+	{
+		m_underruns.ref();
+	}
+
+	return complete;
+}
+
+
+
+
+bool SampleStream::peak( f_cnt_t _from, f_cnt_t _to, float & _min, float & _max ) const
+{
+	_from = qBound<f_cnt_t>( 0, _from, m_frames - 1 );
+	_to = qBound<f_cnt_t>( _from + 1, _to, m_frames );
+
+	// file frames covered by [_from, _to)
+	const f_cnt_t first = m_reversed ? fileFrame( _to - 1 ) : _from;
+	const f_cnt_t last = m_reversed ? fileFrame( _from ) : _to - 1;
+
+	const int firstBlock = first / OverviewFrames;
+	const int lastBlock = last / OverviewFrames;
+	if( lastBlock >= m_overviewBlocks )
+	{
+		return false;
+	}
+
+	_min = m_overview[2*firstBlock];
+	_max = m_overview[2*firstBlock+1];
+	for( int b = firstBlock + 1; b <= lastBlock; ++b )
+	{
+		_min = qMin( _min, m_overview[2*b] );
+		_max = qMax( _max, m_overview[2*b+1] );
+	}
+
+	return true;
+}
+
+
+
+
+qint64 SampleStream::memoryUsage() const
+{
+	return (qint64) m_residentPages * PageFrames * sizeof( sampleFrame ) +
+		m_overview.size() * sizeof( float ) +
+		PageFrames * m_channels * sizeof( float );
+}
+
+
+
+
+bool SampleStream::isPinned( int _page ) const
+{
+	return m_reversed ? _page >= m_numPages - HeadPages : _page < HeadPages;
+}
+
+
+
+
+void SampleStream::request( int _page )
+{
+	if( _page < 0 || _page >= m_numPages )
+	{
+		return;
+	}
+	Page & p = m_pages[_page];
+	if( loadPage( p.data ) == NULL && p.requested.testAndSetOrdered( 0, 1 ) &&
+							m_loader != NULL )
+	{
+		m_loader->notify();
+	}
+}
+
+
+
+
+bool SampleStream::loadRequestedPages()
+{
+	bool loaded = false;
+	for( int i = 0; i < m_numPages; ++i )
+	{
+		if( m_pages[i].requested == 1 )
+		{
+			if( loadPage( m_pages[i].data ) == NULL )
+			{
+				decodePage( i );
+				loaded = true;
+			}
+			m_pages[i].requested = 0;
+		}
+	}
+
+	if( loaded )
+	{
+		evictPages();
+	}
+
+	return loaded;
+}
+
+
+
+
+void SampleStream::decodePage( int _page )
+{
+	const f_cnt_t start = (f_cnt_t) _page * PageFrames;
+	const f_cnt_t frames = qMin( PageFrames, m_frames - start );
+
+	sf_count_t read = 0;
+	if( sf_seek( m_sndFile, start, SEEK_SET ) == start )
+	{
+		read = qMax<sf_count_t>( sf_readf_float( m_sndFile, m_decodeBuffer, frames ), 0 );
+	}
+
+	sampleFrame * data = MM_ALLOC( sampleFrame, PageFrames );
+	const int ch = m_channels > 1 ? 1 : 0;
+	for( f_cnt_t f = 0; f < read; ++f )
+	{
+		data[f][0] = m_decodeBuffer[f*m_channels];
+		data[f][1] = m_decodeBuffer[f*m_channels+ch];
+	}
+	memset( data + read, 0, ( PageFrames - read ) * sizeof( sampleFrame ) );
+
+	m_pages[_page].lastUse = m_clock.fetchAndAddRelaxed( 0 );
+	m_pages[_page].data.fetchAndStoreOrdered( data );
+	++m_residentPages;
+}
+
+
+
+
+void SampleStream::evictPages()
+{
+	while( m_residentPages > MaxCachedPages + HeadPages )
+	{
+		// drop least recently used page
+		int victim = -1;
+		for( int i = 0; i < m_numPages; ++i )
+		{
+			const Page & p = m_pages[i];
+			if( isPinned( i ) || p.requested == 1 ||
+				loadPage( m_pages[i].data ) == NULL )
+			{
+				continue;
+			}
+			if( victim < 0 || p.lastUse - m_pages[victim].lastUse < 0 )
+			{
+				victim = i;
+			}
+		}
+		if( victim < 0 )
+		{
+			return;
+		}
+
+		sampleFrame * data = m_pages[victim].data.fetchAndStoreOrdered( NULL );
+		// a reader might still copy from it
+		while( m_readers.fetchAndAddOrdered( 0 ) > 0 )
+		{
+			QThread::yieldCurrentThread();
+		}
+		MM_FREE( data );
+		--m_residentPages;
+	}
+}
+
+
+
+
+bool SampleStream::buildOverview()
+{
+	const f_cnt_t start = (f_cnt_t) m_overviewBlocks * OverviewFrames;
+	if( start >= m_frames )
+	{
+		return false;
+	}
+
+	const f_cnt_t frames = qMin( PageFrames, m_frames - start );
+	sf_count_t read = 0;
+	if( sf_seek( m_sndFile, start, SEEK_SET ) == start )
+	{
+		read = qMax<sf_count_t>( sf_readf_float( m_sndFile, m_decodeBuffer, frames ), 0 );
+	}
+	if( read == 0 )
+	{
+		// broken file - give up on rest
+		m_overviewBlocks = m_overview.size() / 2;
+		return false;
+	}
+
+	const int blocks = ( read + OverviewFrames - 1 ) / OverviewFrames;
+	for( int b = 0; b < blocks; ++b )
+	{
+		const int first = b * OverviewFrames * m_channels;
+		const int last = qMin<int>( ( b + 1 ) * OverviewFrames, read ) * m_channels;
+		float min = m_decodeBuffer[first];
+		float max = min;
+		for( int s = first; s < last; ++s )
+		{
+			min = qMin( min, m_decodeBuffer[s] );
+			max = qMax( max, m_decodeBuffer[s] );
+		}
+		m_overview[2*(m_overviewBlocks+b)] = min;
+		m_overview[2*(m_overviewBlocks+b)+1] = max;
+	}
+	m_overviewBlocks += blocks;
+
+	return true;
+}
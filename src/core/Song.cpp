@@ -54,6 +54,7 @@
 #include "Pattern.h"
 #include "PianoRoll.h"
 #include "ProjectJournal.h"
+#include "ProjectLoader.h"
 #include "ProjectNotes.h"
 #include "ProjectRenderer.h"
 #include "RenameDialog.h"
@@ -88,6 +89,7 @@ Song::Song() :
 	m_playing( false ),
 	m_paused( false ),
 	m_loadingProject( false ),
+	m_loadMetrics(),
 	m_playMode( Mode_None ),
 	m_length( 0 ),
 	m_trackToPlay( NULL ),
@@ -919,6 +921,10 @@ void Song::loadProject( const QString & _file_name )
 	m_fileName = _file_name;
 	m_oldFileName = _file_name;
 
+	// starts decoding samples while we're still parsing
+	ProjectLoader loader;
+	loader.prefetch( m_fileName );
+
 	DataFile dataFile( m_fileName );
 	// if file could not be opened, head-node is null and we create
 	// new project
@@ -929,6 +935,8 @@ void Song::loadProject( const QString & _file_name )
 
 	clearProject();
 
+	loader.beginPhase( ProjectLoader::SettingsPhase );
+
 	DataFile::LocaleHelper localeHelper( DataFile::LocaleHelper::ModeLoad );
 
 	Engine::mixer()->lock();
@@ -973,14 +981,17 @@ void Song::loadProject( const QString & _file_name )
 		{
 			if( node.nodeName() == "trackcontainer" )
 			{
+				loader.beginPhase( ProjectLoader::TrackPhase );
 				( (JournallingObject *)( this ) )->restoreState( node.toElement() );
 			}
 			else if( node.nodeName() == "controllers" )
 			{
+				loader.beginPhase( ProjectLoader::ControllerPhase );
 				restoreControllerStates( node.toElement() );
 			}
 			else if( Engine::hasGUI() )
 			{
+				loader.beginPhase( ProjectLoader::EditorPhase );
 				if( node.nodeName() == Engine::getControllerRackView()->nodeName() )
 				{
 					Engine::getControllerRackView()->restoreState( node.toElement() );
@@ -1006,6 +1017,8 @@ void Song::loadProject( const QString & _file_name )
 		node = node.nextSibling();
 	}
 
+	loader.beginPhase( ProjectLoader::FinalizePhase );
+
 	// quirk for fixing projects with broken positions of TCOs inside
 	// BB-tracks
 	Engine::getBBTrackContainer()->fixIncorrectPositions();
@@ -1020,6 +1033,9 @@ void Song::loadProject( const QString & _file_name )
 
 	Engine::mixer()->unlock();
 
+	loader.finish();
+	m_loadMetrics = loader.metrics();
+
 	ConfigManager::inst()->addRecentlyOpenedProject( _file_name );
 
 	Engine::projectJournal()->setJournalling( true );
@@ -107,6 +107,12 @@ void TrackContainer::loadSettings( const QDomElement & _this )
 	{
 		if( pd != NULL )
 		{
+			if( node.isElement() &&
+				node.toElement().hasAttribute( "name" ) )
+			{
+				pd->setLabelText( tr( "Loading track %1..." ).
+					arg( node.toElement().attribute( "name" ) ) );
+			}
 			pd->setValue( pd->value() + 1 );
 			QCoreApplication::instance()->processEvents(
 						QEventLoop::AllEvents, 100 );
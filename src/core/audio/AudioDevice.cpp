@@ -105,10 +105,7 @@ fpp_t AudioDevice::getNextBuffer( surroundSampleFrame * _ab )
 	// release lock
 	unlock();
 
-	if( mixer()->hasFifoWriter() )
-	{
-		delete[] b;
-	}
+	mixer()->releaseNextBuffer();
 
 	return frames;
 }
@@ -167,6 +164,42 @@ void AudioDevice::renamePort( AudioPort * )
 
 
 
+void AudioDevice::registerFxChannel( FxChannel * )
+{
+}
+
+
+
+
+void AudioDevice::unregisterFxChannel( FxChannel * )
+{
+}
+
+
+
+
+void AudioDevice::renameFxChannel( FxChannel * )
+{
+}
+
+
+
+
+void AudioDevice::processPortOutput( AudioPort *, const sampleFrame * )
+{
+}
+
+
+
+
+void AudioDevice::processFxChannelOutput( FxChannel *, const sampleFrame *,
+									float )
+{
+}
+
+
+
+
 void AudioDevice::resample( const surroundSampleFrame * _src,
 						const fpp_t _frames,
 						surroundSampleFrame * _dst,
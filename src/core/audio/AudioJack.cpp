@@ -31,6 +31,7 @@
 #include <QMessageBox>
 
 #include <stdlib.h>
+#include <string.h>
 
 #include "debug.h"
 #include "Engine.h"
@@ -38,7 +39,9 @@
 #include "gui_templates.h"
 #include "ConfigManager.h"
 #include "LcdSpinBox.h"
+#include "LedCheckbox.h"
 #include "AudioPort.h"
+#include "FxMixer.h"
 #include "MainWindow.h"
 
 
@@ -55,7 +58,15 @@ AudioJack::AudioJack( bool & _success_ful, Mixer*  _mixer ) :
 	m_tempOutBufs( new jack_default_audio_sample_t *[channels()] ),
 	m_outBuf( new surroundSampleFrame[mixer()->framesPerPeriod()] ),
 	m_framesDoneInCurBuf( 0 ),
-	m_framesToDoInCurBuf( 0 )
+	m_framesToDoInCurBuf( 0 ),
+	m_curBufPeriod( -1 ),
+	m_portMap(),
+	m_portMapMutex(),
+	m_portSlots( mixer()->fifoCapacity() + 3 ),
+	m_trackOutputs( ConfigManager::inst()->value( "audiojack",
+						"trackoutputs" ).toInt() ),
+	m_fxOutputs( ConfigManager::inst()->value( "audiojack",
+						"fxoutputs" ).toInt() )
 {
 	_success_ful = initJackClient();
 	if( _success_ful )
@@ -76,12 +87,10 @@ AudioJack::~AudioJack()
 {
 	m_stopSemaphore.release();
 
-#ifdef AUDIO_PORT_SUPPORT
 	while( m_portMap.size() )
 	{
-		unregisterPort( m_portMap.begin().key() );
+		removeOutput( m_portMap.begin().key() );
 	}
-#endif
 
 	if( m_client != NULL )
 	{
@@ -173,6 +182,8 @@ bool AudioJack::initJackClient()
 		setSampleRate( jack_get_sample_rate( m_client ) );
 	}
 
+	// ports of previous client are gone if we were restarted
+	m_outputPorts.clear();
 	for( ch_cnt_t ch = 0; ch < channels(); ++ch )
 	{
 		QString name = QString( "master out " ) +
@@ -189,6 +200,15 @@ bool AudioJack::initJackClient()
 		}
 	}
 
+	// we were restarted - bring back individual outputs
+	for( JackPortMap::Iterator it = m_portMap.begin();
+						it != m_portMap.end(); ++it )
+	{
+		const QString name = ( *it )->name;
+		( *it )->ports[0] = registerOutputPort( name + " L" );
+		( *it )->ports[1] = registerOutputPort( name + " R" );
+	}
+
 	return true;
 }
 
@@ -275,20 +295,10 @@ void AudioJack::applyQualitySettings()
 
 void AudioJack::registerPort( AudioPort * _port )
 {
-#ifdef AUDIO_PORT_SUPPORT
-	// make sure, port is not already registered
-	unregisterPort( _port );
-	const QString name[2] = { _port->name() + " L",
-					_port->name() + " R" } ;
-
-	for( ch_cnt_t ch = 0; ch < DEFAULT_CHANNELS; ++ch )
+	if( m_trackOutputs )
 	{
-		m_portMap[_port].ports[ch] = jack_port_register( m_client,
-						name[ch].toLatin1().constData(),
-						JACK_DEFAULT_AUDIO_TYPE,
-							JackPortIsOutput, 0 );
+		addOutput( _port, _port->name() );
 	}
-#endif
 }
 
 
@@ -296,81 +306,266 @@ void AudioJack::registerPort( AudioPort * _port )
 
 void AudioJack::unregisterPort( AudioPort * _port )
 {
-#ifdef AUDIO_PORT_SUPPORT
-	if( m_portMap.contains( _port ) )
+	removeOutput( _port );
+}
+
+
+
+
+void AudioJack::renamePort( AudioPort * _port )
+{
+	renameOutput( _port, _port->name() );
+}
+
+
+
+
+void AudioJack::registerFxChannel( FxChannel * _ch )
+{
+	if( m_fxOutputs )
 	{
-		for( ch_cnt_t ch = 0; ch < DEFAULT_CHANNELS; ++ch )
+		addOutput( _ch, _ch->m_name );
+	}
+}
+
+
+
+
+void AudioJack::unregisterFxChannel( FxChannel * _ch )
+{
+	removeOutput( _ch );
+}
+
+
+
+
+void AudioJack::renameFxChannel( FxChannel * _ch )
+{
+	renameOutput( _ch, _ch->m_name );
+}
+
+
+
+
+void AudioJack::processPortOutput( AudioPort * _port,
+						const sampleFrame * _buf )
+{
+	writeOutput( _port, _buf, 1.0f );
+}
+
+
+
+
+void AudioJack::processFxChannelOutput( FxChannel * _ch,
+				const sampleFrame * _buf, float _gain )
+{
+	writeOutput( _ch, _buf, _gain );
+}
+
+
+
+
+void AudioJack::addOutput( const void * _source, const QString & _name )
+{
+	if( m_client == NULL || m_portMap.contains( _source ) )
+	{
+		return;
+	}
+
+	const fpp_t fpp = mixer()->framesPerPeriod();
+
+	StereoPort * p = new StereoPort;
+	p->name = _name;
+	p->ports[0] = registerOutputPort( _name + " L" );
+	p->ports[1] = registerOutputPort( _name + " R" );
+	p->data = new jack_default_audio_sample_t[m_portSlots *
+							DEFAULT_CHANNELS * fpp];
+	p->periods = new int[m_portSlots];
+	for( int i = 0; i < m_portSlots; ++i )
+	{
+		p->periods[i] = -1;
+	}
+
+	// mixer threads write outputs without locking
+	mixer()->lock();
+	m_portMapMutex.lock();
+	m_portMap[_source] = p;
+	m_portMapMutex.unlock();
+	mixer()->unlock();
+}
+
+
+
+
+void AudioJack::removeOutput( const void * _source )
+{
+	mixer()->lock();
+	m_portMapMutex.lock();
+	StereoPort * p = m_portMap.take( _source );
+	m_portMapMutex.unlock();
+	mixer()->unlock();
+
+	if( p == NULL )
+	{
+		return;
+	}
+
+	for( ch_cnt_t ch = 0; ch < DEFAULT_CHANNELS; ++ch )
+	{
+		if( m_client != NULL && p->ports[ch] != NULL )
 		{
-			if( m_portMap[_port].ports[ch] != NULL )
-			{
-				jack_port_unregister( m_client,
-						m_portMap[_port].ports[ch] );
-			}
+			jack_port_unregister( m_client, p->ports[ch] );
 		}
-		m_portMap.erase( m_portMap.find( _port ) );
 	}
-#endif
+	delete[] p->data;
+	delete[] p->periods;
+	delete p;
 }
 
 
 
 
-void AudioJack::renamePort( AudioPort * _port )
+void AudioJack::renameOutput( const void * _source, const QString & _name )
 {
-#ifdef AUDIO_PORT_SUPPORT
-	if( m_portMap.contains( _port ) )
+	StereoPort * p = m_portMap.value( _source, NULL );
+	if( p == NULL )
 	{
-		const QString name[2] = { _port->name() + " L",
-					_port->name() + " R" };
-		for( ch_cnt_t ch = 0; ch < DEFAULT_CHANNELS; ++ch )
+		return;
+	}
+
+	p->name = _name;
+	const QString name[2] = { _name + " L", _name + " R" };
+	for( ch_cnt_t ch = 0; ch < DEFAULT_CHANNELS; ++ch )
+	{
+		if( p->ports[ch] != NULL )
 		{
-			jack_port_set_name( m_portMap[_port].ports[ch],
+			jack_port_set_name( p->ports[ch],
 					name[ch].toLatin1().constData() );
 		}
 	}
-#endif
 }
 
 
 
 
-int AudioJack::processCallback( jack_nframes_t _nframes, void * _udata )
+void AudioJack::writeOutput( const void * _source, const sampleFrame * _buf,
+								float _gain )
 {
-	for( int c = 0; c < channels(); ++c )
+	JackPortMap::ConstIterator it = m_portMap.constFind( _source );
+	if( it == m_portMap.constEnd() )
 	{
-		m_tempOutBufs[c] =
-			(jack_default_audio_sample_t *) jack_port_get_buffer(
-												m_outputPorts[c], _nframes );
+		return;
 	}
 
-#ifdef AUDIO_PORT_SUPPORT
-	const int frames = qMin<int>( _nframes, mixer()->framesPerPeriod() );
-	for( jackPortMap::iterator it = m_portMap.begin();
-						it != m_portMap.end(); ++it )
+	const fpp_t fpp = mixer()->framesPerPeriod();
+	const int period = mixer()->renderPeriod();
+	const int slot = period % m_portSlots;
+
+	// deinterleave right here, so process callback only has to memcpy
+	jack_default_audio_sample_t * l = ( *it )->data +
+						slot * DEFAULT_CHANNELS * fpp;
+	jack_default_audio_sample_t * r = l + fpp;
+	for( fpp_t f = 0; f < fpp; ++f )
 	{
-		for( ch_cnt_t ch = 0; ch < channels(); ++ch )
+		l[f] = _buf[f][0] * _gain;
+		r[f] = _buf[f][1] * _gain;
+	}
+
+	( *it )->periods[slot] = period;
+}
+
+
+
+
+void AudioJack::copyOutputs( jack_nframes_t _nframes, jack_nframes_t _offset,
+						jack_nframes_t _frames )
+{
+	// (un)registering outputs right now - leave them alone this time
+	if( m_portMap.isEmpty() || !m_portMapMutex.tryLock() )
+	{
+		return;
+	}
+
+	const fpp_t fpp = mixer()->framesPerPeriod();
+	const int slot = m_curBufPeriod >= 0 ? m_curBufPeriod % m_portSlots : 0;
+
+	for( JackPortMap::ConstIterator it = m_portMap.constBegin();
+					it != m_portMap.constEnd(); ++it )
+	{
+		const StereoPort * p = *it;
+		// output didn't make it into period, e.g. as it was muted
+		const bool valid = m_curBufPeriod >= 0 &&
+					p->periods[slot] == m_curBufPeriod;
+		for( ch_cnt_t ch = 0; ch < DEFAULT_CHANNELS; ++ch )
 		{
-			if( it.data().ports[ch] == NULL )
+			if( p->ports[ch] == NULL )
 			{
 				continue;
 			}
 			jack_default_audio_sample_t * buf =
-			(jack_default_audio_sample_t *) jack_port_get_buffer(
-							it.data().ports[ch],
-								_nframes );
-			for( int frame = 0; frame < frames; ++frame )
+				(jack_default_audio_sample_t *)
+					jack_port_get_buffer( p->ports[ch],
+							_nframes ) + _offset;
+			if( valid )
+			{
+				memcpy( buf, p->data + ( slot * DEFAULT_CHANNELS +
+							ch ) * fpp +
+						m_framesDoneInCurBuf,
+					_frames * sizeof( *buf ) );
+			}
+			else
 			{
-				buf[frame] = it.key()->firstBuffer()[frame][ch];
+				memset( buf, 0, _frames * sizeof( *buf ) );
 			}
 		}
 	}
-#endif
+
+	m_portMapMutex.unlock();
+}
+
+
+
+
+jack_port_t * AudioJack::registerOutputPort( const QString & _name )
+{
+	// several tracks might have the same name
+	QString name = _name;
+	for( int i = 2; jack_port_by_name( m_client, ( QString(
+				jack_get_client_name( m_client ) ) + ":" +
+					name ).toLatin1().constData() ); ++i )
+	{
+		name = QString( "%1 (%2)" ).arg( _name ).arg( i );
+	}
+
+	jack_port_t * port = jack_port_register( m_client,
+					name.toLatin1().constData(),
+					JACK_DEFAULT_AUDIO_TYPE,
+					JackPortIsOutput, 0 );
+	if( port == NULL )
+	{
+		printf( "could not register JACK port %s\n",
+					name.toLatin1().constData() );
+	}
+	return port;
+}
+
+
+
+
+int AudioJack::processCallback( jack_nframes_t _nframes, void * _udata )
+{
+	for( int c = 0; c < channels(); ++c )
+	{
+		m_tempOutBufs[c] =
+			(jack_default_audio_sample_t *) jack_port_get_buffer(
+												m_outputPorts[c], _nframes );
+	}
 
 	jack_nframes_t done = 0;
 	while( done < _nframes && m_stopped == false )
 	{
 		jack_nframes_t todo = qMin<jack_nframes_t>(
-						_nframes,
+						_nframes - done,
 						m_framesToDoInCurBuf -
 							m_framesDoneInCurBuf );
 		const float gain = mixer()->masterGain();
@@ -382,11 +577,19 @@ int AudioJack::processCallback( jack_nframes_t _nframes, void * _udata )
 				o[done+frame] = m_outBuf[m_framesDoneInCurBuf+frame][c] * gain;
 			}
 		}
+		if( todo > 0 )
+		{
+			copyOutputs( _nframes, done, todo );
+		}
 		done += todo;
 		m_framesDoneInCurBuf += todo;
 		if( m_framesDoneInCurBuf == m_framesToDoInCurBuf )
 		{
 			m_framesToDoInCurBuf = getNextBuffer( m_outBuf );
+			// individual outputs are at processing sample rate
+			m_curBufPeriod = m_framesToDoInCurBuf ==
+						mixer()->framesPerPeriod() ?
+					mixer()->nextBufferPeriod() : -1;
 			if( !m_framesToDoInCurBuf )
 			{
 				m_stopped = true;
@@ -403,6 +606,8 @@ int AudioJack::processCallback( jack_nframes_t _nframes, void * _udata )
 			jack_default_audio_sample_t * b = m_tempOutBufs[c] + done;
 			memset( b, 0, sizeof( *b ) * ( _nframes - done ) );
 		}
+		m_curBufPeriod = -1;
+		copyOutputs( _nframes, done, _nframes - done );
 	}
 
 	return 0;
@@ -457,6 +662,18 @@ AudioJack::setupWidget::setupWidget( QWidget * _parent ) :
 	m_channels->setLabel( tr( "CHANNELS" ) );
 	m_channels->move( 180, 20 );
 
+	m_trackOutputs = new LedCheckBox( tr( "Individual outputs for tracks" ),
+									this );
+	m_trackOutputs->move( 10, 60 );
+	m_trackOutputs->setChecked( ConfigManager::inst()->value( "audiojack",
+						"trackoutputs" ).toInt() );
+
+	m_fxOutputs = new LedCheckBox( tr( "Individual outputs for FX channels" ),
+									this );
+	m_fxOutputs->move( 10, 80 );
+	m_fxOutputs->setChecked( ConfigManager::inst()->value( "audiojack",
+						"fxoutputs" ).toInt() );
+
 }
 
 
@@ -476,6 +693,10 @@ void AudioJack::setupWidget::saveSettings()
 							m_clientName->text() );
 	ConfigManager::inst()->setValue( "audiojack", "channels",
 				QString::number( m_channels->value<int>() ) );
+	ConfigManager::inst()->setValue( "audiojack", "trackoutputs",
+			QString::number( m_trackOutputs->model()->value() ) );
+	ConfigManager::inst()->setValue( "audiojack", "fxoutputs",
+			QString::number( m_fxOutputs->model()->value() ) );
 }
 
 
@@ -28,8 +28,9 @@
 #include "FxMixer.h"
 #include "Engine.h"
 #include "MixHelpers.h"
+#include "MixerWorkerThread.h"
 #include "BufferManager.h"
-#include "ValueBuffer.h"
+#include "ParameterStream.h"
 #include "panning.h"
 
 
@@ -42,12 +43,15 @@ AudioPort::AudioPort( const QString & _name, bool _has_effect_chain,
 	m_nextFxChannel( 0 ),
 	m_name( "unnamed port" ),
 	m_effects( _has_effect_chain ? new EffectChain( NULL ) : NULL ),
+	m_playHandles( PlayHandle::AudioPortList ),
 	m_volumeModel( volumeModel ),
 	m_panningModel( panningModel ),
-	m_mutedModel( mutedModel )
+	m_mutedModel( mutedModel ),
+	m_dependencies( 0 ),
+	m_dependenciesMet( 0 ),
+	m_fxChannelDependency( 0 )
 {
 	Engine::mixer()->addAudioPort( this );
-	setExtOutputEnabled( true );
 }
 
 
@@ -106,9 +110,13 @@ void AudioPort::doProcessing()
 {
 	if( m_mutedModel && m_mutedModel->value() )
 	{
+		processed();
 		return;
 	}
 
+	MixerProfiler::Probe probe( Engine::mixer()->profiler(),
+					MixerProfiler::AudioPortEntry, this );
+
 	const fpp_t fpp = Engine::mixer()->framesPerPeriod();
 
 	m_portBuffer = BufferManager::acquire(); // get buffer for processing
@@ -116,8 +124,11 @@ void AudioPort::doProcessing()
 	Engine::mixer()->clearAudioBuffer( m_portBuffer, fpp ); // clear the audioport buffer so we can use it
 
 	//qDebug( "Playhandles: %d", m_playHandles.size() );
-	foreach( PlayHandle * ph, m_playHandles ) // now we mix all playhandle buffers into the audioport buffer
+	// play handles of other tracks might still add new play handles to us
+	m_playHandleLock.lock();
+	for( PlayHandleList::ConstIterator it = m_playHandles.begin(); it != m_playHandles.end(); ++it ) // now we mix all playhandle buffers into the audioport buffer
 	{
+		PlayHandle * ph = *it;
 		if( ph->buffer() )
 		{
 			if( ph->usesBuffer() )
@@ -129,90 +140,19 @@ void AudioPort::doProcessing()
 									// pointer to null, so if it doesn't get re-acquired we know to skip it next time
 		}
 	}
+	m_playHandleLock.unlock();
 
 	if( m_bufferUsage )
 	{
-		// handle volume and panning
-		// has both vol and pan models
-		if( m_volumeModel && m_panningModel )
+		// handle volume and panning - constant values and ramps are
+		// handled without writing them into buffers first
+		if( m_volumeModel )
 		{
-			ValueBuffer * volBuf = m_volumeModel->valueBuffer();
-			ValueBuffer * panBuf = m_panningModel->valueBuffer();
-
-			// both vol and pan have s.ex.data:
-			if( volBuf && panBuf )
-			{
-				for( f_cnt_t f = 0; f < fpp; ++f )
-				{
-					float v = volBuf->values()[ f ] * 0.01f;
-					float p = panBuf->values()[ f ] * 0.01f;
-					m_portBuffer[f][0] *= ( p <= 0 ? 1.0f : 1.0f - p ) * v;
-					m_portBuffer[f][1] *= ( p >= 0 ? 1.0f : 1.0f + p ) * v;
-				}
-			}
-
-			// only vol has s.ex.data:
-			else if( volBuf )
-			{
-				float p = m_panningModel->value() * 0.01f;
-				float l = ( p <= 0 ? 1.0f : 1.0f - p );
-				float r = ( p >= 0 ? 1.0f : 1.0f + p );
-				for( f_cnt_t f = 0; f < fpp; ++f )
-				{
-					float v = volBuf->values()[ f ] * 0.01f;
-					m_portBuffer[f][0] *= v * l;
-					m_portBuffer[f][1] *= v * r;
-				}
-			}
-
-			// only pan has s.ex.data:
-			else if( panBuf )
-			{
-				float v = m_volumeModel->value() * 0.01f;
-				for( f_cnt_t f = 0; f < fpp; ++f )
-				{
-					float p = panBuf->values()[ f ] * 0.01f;
-					m_portBuffer[f][0] *= ( p <= 0 ? 1.0f : 1.0f - p ) * v;
-					m_portBuffer[f][1] *= ( p >= 0 ? 1.0f : 1.0f + p ) * v;
-				}
-			}
-
-			// neither has s.ex.data:
-			else
-			{
-				float p = m_panningModel->value() * 0.01f;
-				float v = m_volumeModel->value() * 0.01f;
-				for( f_cnt_t f = 0; f < fpp; ++f )
-				{
-					m_portBuffer[f][0] *= ( p <= 0 ? 1.0f : 1.0f - p ) * v;
-					m_portBuffer[f][1] *= ( p >= 0 ? 1.0f : 1.0f + p ) * v;
-				}
-			}
-		}
-
-		// has vol model only
-		else if( m_volumeModel )
-		{
-			ValueBuffer * volBuf = m_volumeModel->valueBuffer();
-
-			if( volBuf )
-			{
-				for( f_cnt_t f = 0; f < fpp; ++f )
-				{
-					float v = volBuf->values()[ f ] * 0.01f;
-					m_portBuffer[f][0] *= v;
-					m_portBuffer[f][1] *= v;
-				}
-			}
-			else
-			{
-				float v = m_volumeModel->value() * 0.01f;
-				for( f_cnt_t f = 0; f < fpp; ++f )
-				{
-					m_portBuffer[f][0] *= v;
-					m_portBuffer[f][1] *= v;
-				}
-			}
+			MixHelpers::multiplyByVolumeAndPanning( m_portBuffer,
+					m_volumeModel->parameterStream(),
+					m_panningModel ? m_panningModel->parameterStream() :
+							ParameterStream(),
+					fpp );
 		}
 	}
 	// as of now there's no situation where we only have panning model but no volume model
@@ -222,12 +162,40 @@ void AudioPort::doProcessing()
 	const bool me = processEffects();
 	if( me || m_bufferUsage )
 	{
-		Engine::fxMixer()->mixToChannel( m_portBuffer, m_nextFxChannel ); 	// send output to fx mixer
+		Engine::fxMixer()->mixToChannel( m_portBuffer, m_fxChannelDependency ); 	// send output to fx mixer
 																			// TODO: improve the flow here - convert to pull model
 		m_bufferUsage = false;
 	}
 
+	if( m_extOutputEnabled )
+	{
+		Engine::mixer()->audioDev()->processPortOutput( this, m_portBuffer );
+	}
+
 	BufferManager::release( m_portBuffer ); // release buffer, we don't need it anymore
+
+	probe.finish();
+	processed();
+}
+
+
+
+
+void AudioPort::incrementDeps()
+{
+	if( m_dependenciesMet.fetchAndAddOrdered( 1 ) + 1 == m_dependencies )
+	{
+		MixerWorkerThread::addJob( this );
+	}
+}
+
+
+
+
+inline void AudioPort::processed()
+{
+	// our FX channel may be waiting for us
+	Engine::fxMixer()->audioPortProcessed( m_fxChannelDependency );
 }
 
 
@@ -242,10 +210,6 @@ void AudioPort::addPlayHandle( PlayHandle * handle )
 void AudioPort::removePlayHandle( PlayHandle * handle )
 {
 	m_playHandleLock.lock();
-		PlayHandleList::Iterator it =	qFind( m_playHandles.begin(), m_playHandles.end(), handle );
-		if( it != m_playHandles.end() )
-		{
-			m_playHandles.erase( it );
-		}
+		m_playHandles.remove( handle );
 	m_playHandleLock.unlock();
 }
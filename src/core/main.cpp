@@ -47,6 +47,9 @@
 #include <QMessageBox>
 #include <QPainter>
 #include <QSplashScreen>
+#include <QTemporaryFile>
+#include <QTextStream>
+#include <QTime>
 
 #ifdef LMMS_HAVE_SCHED_H
 #include <sched.h>
@@ -56,6 +59,10 @@
 #include <sys/time.h>
 #endif
 
+#ifdef LMMS_HAVE_SYS_RESOURCE_H
+#include <sys/resource.h>
+#endif
+
 #ifdef LMMS_HAVE_PROCESS_H
 #include <process.h>
 #endif
@@ -65,14 +72,17 @@
 #endif
 
 #include "MemoryManager.h"
+#include "MixHelpers.h"
 #include "ConfigManager.h"
 #include "NotePlayHandle.h"
+#include "SampleStream.h"
 #include "embed.h"
 #include "Engine.h"
 #include "LmmsStyle.h"
 #include "ImportFilter.h"
 #include "MainWindow.h"
 #include "ProjectRenderer.h"
+#include "BinaryDataFile.h"
 #include "DataFile.h"
 #include "Song.h"
 #include "LmmsPalette.h"
@@ -97,11 +107,301 @@ inline void loadTranslation( const QString & _tname,
 
 
 
+struct RenderJob
+{
+	QString project;
+	QString output;
+} ;
+
+
+// reads a render manifest - one job per line consisting of the project file,
+// optionally followed by a tab and the output file. Empty lines and lines
+// starting with '#' are skipped, relative paths are relative to the manifest.
+static bool readRenderManifest( const QString & _file,
+						QList<RenderJob> & _jobs )
+{
+	QFile f( _file );
+	if( !f.open( QIODevice::ReadOnly | QIODevice::Text ) )
+	{
+		return false;
+	}
+
+	const QDir dir = QFileInfo( _file ).absoluteDir();
+	QTextStream ts( &f );
+	while( !ts.atEnd() )
+	{
+		const QString line = ts.readLine().trimmed();
+		if( line.isEmpty() || line.startsWith( '#' ) )
+		{
+			continue;
+		}
+		const QStringList fields = line.split( '\t',
+						QString::SkipEmptyParts );
+		RenderJob job;
+		job.project = dir.absoluteFilePath( fields[0].trimmed() );
+		if( fields.size() > 1 )
+		{
+			job.output = dir.absoluteFilePath( fields[1].trimmed() );
+		}
+		_jobs << job;
+	}
+
+	return true;
+}
+
+
+
+
+// CPU time (user + system, all threads) used by this process in seconds or
+// a negative value if not available on this platform
+static double processCpuTime()
+{
+#ifdef LMMS_HAVE_SYS_RESOURCE_H
+	struct rusage ru;
+	if( getrusage( RUSAGE_SELF, &ru ) == 0 )
+	{
+		return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec +
+			( ru.ru_utime.tv_usec + ru.ru_stime.tv_usec ) / 1000000.0;
+	}
+#endif
+	return -1;
+}
+
+
+
+
+// renders all jobs back to back - engine, plugins etc. are initialized only
+// once and reused for every project
+static int renderBatch( const QList<RenderJob> & _jobs,
+				const Mixer::qualitySettings & _qs,
+				const ProjectRenderer::OutputSettings & _os,
+				ProjectRenderer::ExportFileFormats _eff,
+				const QString & _profilerOutputFile )
+{
+	QTime total;
+	total.start();
+	const double totalCpuStart = processCpuTime();
+
+	Engine::init( false );
+
+	if( _profilerOutputFile.isEmpty() == false )
+	{
+		Engine::mixer()->profiler().setOutputFile( _profilerOutputFile );
+	}
+
+	// only draw progress bars if somebody is watching
+	bool showProgress = true;
+#ifdef LMMS_HAVE_UNISTD_H
+	showProgress = isatty( fileno( stderr ) );
+#endif
+
+	int failed = 0;
+	for( int i = 0; i < _jobs.size(); ++i )
+	{
+		const RenderJob & job = _jobs[i];
+		printf( "[%d/%d] %s\n", i + 1, _jobs.size(),
+					job.project.toUtf8().constData() );
+		fflush( stdout );
+
+		if( !QFileInfo( job.project ).isReadable() )
+		{
+			printf( "  could not read project file, skipping\n" );
+			++failed;
+			continue;
+		}
+
+		QString out = job.output;
+		ProjectRenderer::ExportFileFormats eff = _eff;
+		if( out.isEmpty() )
+		{
+			out = baseName( job.project ) +
+				( eff == ProjectRenderer::WaveFile ? ".wav" : ".ogg" );
+		}
+		else
+		{
+			eff = ProjectRenderer::getFileFormatFromExtension(
+					"." + QFileInfo( out ).suffix().toLower() );
+		}
+
+		QTime wall;
+		wall.start();
+		const double cpuStart = processCpuTime();
+
+		Engine::getSong()->loadProject( job.project );
+		const int loadTime = wall.elapsed();
+		if( _profilerOutputFile.isEmpty() == false )
+		{
+			Engine::getSong()->loadMetrics().printSummary( stdout );
+			// with --jobs our output gets passed on by the parent
+			// process - keep the summary in one piece
+			fflush( stdout );
+		}
+
+		ProjectRenderer * r = new ProjectRenderer( _qs, _os, eff, out );
+		if( !r->isReady() )
+		{
+			printf( "  could not open %s for writing, skipping\n",
+						out.toUtf8().constData() );
+			delete r;
+			++failed;
+			continue;
+		}
+
+		r->startProcessing();
+		while( !r->wait( 200 ) )
+		{
+			if( showProgress )
+			{
+				r->updateConsoleProgress();
+			}
+			QCoreApplication::processEvents();
+		}
+		if( showProgress )
+		{
+			fprintf( stderr, "\n" );
+		}
+
+		const double wallTime = wall.elapsed() / 1000.0;
+		const double cpuTime = processCpuTime() - cpuStart;
+		const double audioTime = r->framesRendered() /
+						(double) _os.samplerate;
+		delete r;
+
+		printf( "  -> %s\n"
+			"  %.1f s audio in %.2f s (loading %.2f s), "
+							"%.1fx realtime",
+				out.toUtf8().constData(), audioTime, wallTime,
+				loadTime / 1000.0,
+				audioTime / qMax( wallTime, 0.001 ) );
+		if( cpuStart >= 0 )
+		{
+			printf( ", CPU %.2f s (%.0f%%)", cpuTime,
+				cpuTime * 100.0 / qMax( wallTime, 0.001 ) );
+		}
+		printf( "\n" );
+		fflush( stdout );
+	}
+
+	if( _profilerOutputFile.isEmpty() == false )
+	{
+		Engine::mixer()->profiler().printSummary( stdout );
+	}
+
+	printf( "\n%d of %d projects rendered in %.2f s",
+			_jobs.size() - failed, _jobs.size(),
+						total.elapsed() / 1000.0 );
+	if( totalCpuStart >= 0 )
+	{
+		printf( ", CPU %.2f s", processCpuTime() - totalCpuStart );
+	}
+	printf( "\n" );
+
+	return failed > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+
+
+
+// engine, mixer and song are global, so for rendering several projects at
+// once we distribute the jobs over a pool of LMMS processes each rendering
+// its share back to back
+static int renderBatchInProcesses( const QList<RenderJob> & _jobs,
+					int _processes,
+					const QStringList & _args,
+					const QString & _profilerOutputFile )
+{
+	_processes = qMin( _processes, _jobs.size() );
+
+	QTime total;
+	total.start();
+
+	QList<QTemporaryFile *> manifests;
+	QList<QProcess *> procs;
+	for( int p = 0; p < _processes; ++p )
+	{
+		QTemporaryFile * manifest = new QTemporaryFile;
+		if( !manifest->open() )
+		{
+			printf( "Could not create temporary manifest.\n" );
+			delete manifest;
+			break;
+		}
+		QTextStream ts( manifest );
+		for( int i = p; i < _jobs.size(); i += _processes )
+		{
+			ts << _jobs[i].project << "\t" << _jobs[i].output << "\n";
+		}
+		ts.flush();
+		manifest->close();
+		manifests << manifest;
+
+		QStringList args = _args;
+		if( _profilerOutputFile.isEmpty() == false )
+		{
+			// processes must not write to the same file
+			args << "--profile" << _profilerOutputFile + "." +
+							QString::number( p + 1 );
+		}
+
+		QProcess * proc = new QProcess;
+		proc->setProcessChannelMode( QProcess::MergedChannels );
+		proc->start( QCoreApplication::applicationFilePath(),
+				args << "--render-batch" << manifest->fileName() );
+		procs << proc;
+	}
+
+	// collect output of all processes until they're finished
+	bool failed = procs.size() < _processes;
+	QList<QProcess *> running = procs;
+	while( !running.isEmpty() )
+	{
+		for( int p = 0; p < running.size(); )
+		{
+			QProcess * proc = running[p];
+			const bool done = proc->state() == QProcess::NotRunning ||
+						proc->waitForFinished( 100 );
+			const QByteArray output = proc->readAll();
+			if( !output.isEmpty() )
+			{
+				printf( "%s", output.constData() );
+				fflush( stdout );
+			}
+			if( done )
+			{
+				if( proc->exitStatus() != QProcess::NormalExit ||
+							proc->exitCode() != 0 )
+				{
+					failed = true;
+				}
+				running.removeAt( p );
+			}
+			else
+			{
+				++p;
+			}
+		}
+	}
+
+	printf( "\n%d projects rendered by %d processes in %.2f s%s\n",
+			_jobs.size(), procs.size(), total.elapsed() / 1000.0,
+				failed ? " - some jobs failed" : "" );
+
+	qDeleteAll( procs );
+	qDeleteAll( manifests );
+
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+
+
+
+
 int main( int argc, char * * argv )
 {
 	// initialize memory managers
 	MemoryManager::init();
 	NotePlayHandleManager::init();
+	MixHelpers::init();
 	
 	// intialize RNG
 	srand( getpid() + time( 0 ) );
@@ -120,11 +420,16 @@ int main( int argc, char * * argv )
 	bool fullscreen = true;
 	bool exit_after_import = false;
 	QString file_to_load, file_to_save, file_to_import, render_out, profilerOutputFile;
+	QString batch_manifest;
+	int batch_processes = 1;
+	// options passed on to processes of a batch render pool
+	QStringList batch_args;
 
 	for( int i = 1; i < argc; ++i )
 	{
 		if( argc > i && ( ( QString( argv[i] ) == "--render" ||
-					QString( argv[i] ) == "-r" ) ||
+					QString( argv[i] ) == "-r" ||
+				QString( argv[i] ) == "--render-batch" ) ||
 				( QString( argv[i] ) == "--help" ||
 						QString( argv[i] ) == "-h" ) ) )
 		{
@@ -173,11 +478,20 @@ int main( int argc, char * * argv )
 			printf( "LMMS %s\n"
 	"Copyright (c) 2004-2014 LMMS developers.\n\n"
 	"usage: lmms [ -r <project file> ] [ options ]\n"
+	"            [ --render-batch <manifest> [ -j <n> ] ] [ options ]\n"
 	"            [ -u <in> <out> ]\n"
 	"            [ -d <in> ]\n"
 	"            [ -h ]\n"
 	"            [ <file to load> ]\n\n"
 	"-r, --render <project file>	render given project file\n"
+	"--render-batch <manifest>	render all projects listed in <manifest>\n"
+	"				one after another - each line holds a\n"
+	"				project file, optionally followed by a\n"
+	"				tab and the output file\n"
+	"-j, --jobs <n>			with --render-batch: render <n>\n"
+	"				projects at once in separate processes\n"
+	"				with --profile, process <i> writes its\n"
+	"				timings to <file>.<i>\n"
 	"-o, --output <file>		render into <file>\n"
 	"-f, --output-format <format>	specify format of render-output where\n"
 	"				format is either 'wav' or 'ogg'.\n"
@@ -194,9 +508,13 @@ int main( int argc, char * * argv )
 	"-x, --oversampling <value>	specify oversampling\n"
 	"				possible values: 1, 2, 4, 8\n"
 	"				default: 2\n"
+	"-p, --profile <file>		when rendering, write timings of each\n"
+	"				period to <file>, a detailed trace to\n"
+	"				<file>.trace and print a summary\n"
+	"				including project load times\n"
 	"-u, --upgrade <in> [out]	upgrade file <in> and save as <out>\n"
 	"       standard out is used if no output file is specifed\n"
-	"-d, --dump <in>			dump XML of compressed file <in>\n"
+	"-d, --dump <in>			dump XML of compressed or binary file <in>\n"
 	"-v, --version			show version information and exit.\n"
 	"-h, --help			show this usage information and exit.\n\n",
 							LMMS_VERSION );
@@ -225,7 +543,20 @@ int main( int argc, char * * argv )
 		{
 			QFile f( argv[i + 1] );
 			f.open( QIODevice::ReadOnly );
-			QString d = qUncompress( f.readAll() );
+			const QByteArray data = f.readAll();
+			QString d;
+			if( BinaryDataFile::isBinary( data ) )
+			{
+				QDomDocument doc;
+				if( BinaryDataFile::decode( data, doc ) )
+				{
+					d = doc.toString( 2 );
+				}
+			}
+			else
+			{
+				d = qUncompress( data );
+			}
 			printf( "%s\n", d.toUtf8().constData() );
 			return( EXIT_SUCCESS );
 		}
@@ -236,6 +567,23 @@ int main( int argc, char * * argv )
 			render_out = baseName( file_to_load ) + ".";
 			++i;
 		}
+		else if( argc > i + 1 && QString( argv[i] ) == "--render-batch" )
+		{
+			batch_manifest = QString( argv[i + 1] );
+			++i;
+		}
+		else if( argc > i + 1 && ( QString( argv[i] ) == "--jobs" ||
+						QString( argv[i] ) == "-j" ) )
+		{
+			batch_processes = QString( argv[i + 1] ).toInt();
+			if( batch_processes < 1 )
+			{
+				printf( "\nInvalid number of jobs %s.\n\n"
+	"Try \"%s --help\" for more information.\n\n", argv[i + 1], argv[0] );
+				return( EXIT_FAILURE );
+			}
+			++i;
+		}
 		else if( argc > i && ( QString( argv[i] ) == "--output" ||
 						QString( argv[i] ) == "-o" ) )
 		{
@@ -263,6 +611,7 @@ int main( int argc, char * * argv )
 	"Try \"%s --help\" for more information.\n\n", argv[i + 1], argv[0] );
 				return( EXIT_FAILURE );
 			}
+			batch_args << argv[i] << argv[i + 1];
 			++i;
 		}
 		else if( argc > i &&
@@ -280,6 +629,7 @@ int main( int argc, char * * argv )
 	"Try \"%s --help\" for more information.\n\n", argv[i + 1], argv[0] );
 				return( EXIT_FAILURE );
 			}
+			batch_args << argv[i] << argv[i + 1];
 			++i;
 		}
 		else if( argc > i &&
@@ -297,6 +647,7 @@ int main( int argc, char * * argv )
 	"Try \"%s --help\" for more information.\n\n", argv[i + 1], argv[0] );
 				return( EXIT_FAILURE );
 			}
+			batch_args << argv[i] << argv[i + 1];
 			++i;
 		}
 		else if( argc > i &&
@@ -326,6 +677,7 @@ int main( int argc, char * * argv )
 	"Try \"%s --help\" for more information.\n\n", argv[i + 1], argv[0] );
 				return( EXIT_FAILURE );
 			}
+			batch_args << argv[i] << argv[i + 1];
 			++i;
 		}
 		else if( argc > i &&
@@ -352,6 +704,7 @@ int main( int argc, char * * argv )
 	"Try \"%s --help\" for more information.\n\n", argv[i + 1], argv[0] );
 				return( EXIT_FAILURE );
 			}
+			batch_args << argv[i] << argv[i + 1];
 			++i;
 		}
 		else if( argc > i &&
@@ -416,6 +769,30 @@ int main( int argc, char * * argv )
 
 	ConfigManager::inst()->loadConfigFile();
 
+	if( !batch_manifest.isEmpty() )
+	{
+		QList<RenderJob> jobs;
+		if( !readRenderManifest( batch_manifest, jobs ) )
+		{
+			printf( "Could not read manifest %s.\n",
+					batch_manifest.toUtf8().constData() );
+			return( EXIT_FAILURE );
+		}
+
+		const int ret = batch_processes > 1 && jobs.size() > 1 ?
+			renderBatchInProcesses( jobs, batch_processes, batch_args,
+							profilerOutputFile ) :
+			renderBatch( jobs, qs, os, eff, profilerOutputFile );
+		delete app;
+
+		// cleanup memory managers
+		NotePlayHandleManager::shutdown();
+		SampleStream::shutdownLoader();
+		MemoryManager::cleanup();
+
+		return( ret );
+	}
+
 	if( render_out.isEmpty() )
 	{
 		// init style and palette
@@ -535,9 +912,18 @@ int main( int argc, char * * argv )
 	}
 
 	const int ret = app->exec();
+
+	if( !render_out.isEmpty() && !profilerOutputFile.isEmpty() )
+	{
+		Engine::getSong()->loadMetrics().printSummary( stdout );
+		Engine::mixer()->profiler().printSummary( stdout );
+	}
+
 	delete app;
 	
 	// cleanup memory managers
+	NotePlayHandleManager::shutdown();
+	SampleStream::shutdownLoader();
 	MemoryManager::cleanup();
 	
 	return( ret );
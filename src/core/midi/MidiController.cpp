@@ -83,6 +83,8 @@ void MidiController::updateName()
 
 void MidiController::processInEvent( const MidiEvent& event, const MidiTime& time, f_cnt_t offset )
 {
+	Engine::mixer()->notifyLiveInput();
+
 	unsigned char controllerNum;
 	switch( event.type() )
 	{
@@ -98,7 +98,7 @@ MainWindow::MainWindow() :
 	sideBar->appendTab( new FileBrowser(
 				ConfigManager::inst()->userProjectsDir() + "*" +
 				ConfigManager::inst()->factoryProjectsDir(),
-					"*.mmp *.mmpz *.xml *.mid *.flp",
+					"*.mmp *.mmpz *.mmpb *.xml *.mid *.flp",
 							tr( "My Projects" ),
 					embed::getIconPixmap( "project_file" ).transformed( QTransform().rotate( 90 ) ),
 							splitter ) );
@@ -732,7 +732,7 @@ void MainWindow::openProject()
 {
 	if( mayChangeProject() )
 	{
-		FileDialog ofd( this, tr( "Open Project" ), "", tr( "LMMS (*.mmp *.mmpz)" ) );
+		FileDialog ofd( this, tr( "Open Project" ), "", tr( "LMMS (*.mmp *.mmpz *.mmpb)" ) );
 
 		ofd.setDirectory( ConfigManager::inst()->userProjectsDir() );
 		ofd.setFileMode( FileDialog::ExistingFiles );
@@ -799,6 +799,7 @@ bool MainWindow::saveProjectAs()
 {
 	VersionedSaveDialog sfd( this, tr( "Save Project" ), "",
 			tr( "LMMS Project (*.mmpz *.mmp);;"
+				"LMMS Binary Project (*.mmpb);;"
 				"LMMS Project Template (*.mpt)" ) );
 	QString f = Engine::getSong()->projectFileName();
 	if( f != "" )
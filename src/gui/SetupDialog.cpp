@@ -87,6 +87,8 @@ inline void labelWidget( QWidget * _w, const QString & _txt )
 SetupDialog::SetupDialog( ConfigTabs _tab_to_open ) :
 	m_bufferSize( ConfigManager::inst()->value( "mixer",
 					"framesperaudiobuffer" ).toInt() ),
+	m_lookahead( ConfigManager::inst()->value( "mixer",
+						"lookahead" ).toInt() ),
 	m_toolTips( !ConfigManager::inst()->value( "tooltips",
 							"disabled" ).toInt() ),
 	m_warnAfterSetup( !ConfigManager::inst()->value( "app",
@@ -559,7 +561,43 @@ SetupDialog::SetupDialog( ConfigTabs _tab_to_open ) :
 
 
 
+	TabWidget * lookahead_tw = new TabWidget( tr( "LOOKAHEAD" ),
+								performance );
+	lookahead_tw->setFixedHeight( 80 );
+
+	m_lookaheadSlider = new QSlider( Qt::Horizontal, lookahead_tw );
+	m_lookaheadSlider->setRange( 0, MAX_LOOKAHEAD_PERIODS );
+	m_lookaheadSlider->setTickPosition( QSlider::TicksBelow );
+	m_lookaheadSlider->setPageStep( 4 );
+	m_lookaheadSlider->setTickInterval( 4 );
+	m_lookaheadSlider->setGeometry( 10, 16, 340, 18 );
+	m_lookaheadSlider->setValue( m_lookahead );
+
+	connect( m_lookaheadSlider, SIGNAL( valueChanged( int ) ), this,
+						SLOT( setLookahead( int ) ) );
+
+	m_lookaheadLbl = new QLabel( lookahead_tw );
+	m_lookaheadLbl->setGeometry( 10, 40, 200, 24 );
+	setLookahead( m_lookaheadSlider->value() );
+
+	QPushButton * lookahead_reset_btn = new QPushButton(
+			embed::getIconPixmap( "reload" ), "", lookahead_tw );
+	lookahead_reset_btn->setGeometry( 290, 40, 28, 28 );
+	connect( lookahead_reset_btn, SIGNAL( clicked() ), this,
+						SLOT( resetLookahead() ) );
+	ToolTip::add( lookahead_reset_btn, tr( "Reset to default-value" ) );
+
+	QPushButton * lookahead_help_btn = new QPushButton(
+			embed::getIconPixmap( "help" ), "", lookahead_tw );
+	lookahead_help_btn->setGeometry( 320, 40, 28, 28 );
+	connect( lookahead_help_btn, SIGNAL( clicked() ), this,
+						SLOT( displayLookaheadHelp() ) );
+
+
+
 	perf_layout->addWidget( ui_fx_tw );
+	perf_layout->addSpacing( 10 );
+	perf_layout->addWidget( lookahead_tw );
 	perf_layout->addStretch();
 
 
@@ -805,6 +843,8 @@ void SetupDialog::accept()
 {
 	ConfigManager::inst()->setValue( "mixer", "framesperaudiobuffer",
 					QString::number( m_bufferSize ) );
+	ConfigManager::inst()->setValue( "mixer", "lookahead",
+					QString::number( m_lookahead ) );
 	ConfigManager::inst()->setValue( "mixer", "audiodev",
 			m_audioIfaceNames[m_audioInterfaces->currentText()] );
 	ConfigManager::inst()->setValue( "mixer", "mididev",
@@ -869,6 +909,9 @@ void SetupDialog::accept()
 
 	ConfigManager::inst()->saveConfigFile();
 
+	// unlike buffer size, lookahead can be changed without restarting
+	Engine::mixer()->setLookahead( m_lookahead );
+
 	QDialog::accept();
 	if( m_warnAfterSetup )
 	{
@@ -939,6 +982,48 @@ void SetupDialog::displayBufSizeHelp()
 
 
 
+void SetupDialog::setLookahead( int _value )
+{
+	if( m_lookaheadSlider->value() != _value )
+	{
+		m_lookaheadSlider->setValue( _value );
+	}
+
+	m_lookahead = _value;
+	m_lookaheadLbl->setText( tr( "Periods: %1\nLatency: +%2 ms" ).arg(
+					m_lookahead ).arg(
+			1000.0f * m_lookahead *
+				Engine::mixer()->framesPerPeriod() /
+				Engine::mixer()->processingSampleRate(),
+						0, 'f', 1 ) );
+}
+
+
+
+
+void SetupDialog::resetLookahead()
+{
+	setLookahead( 0 );
+}
+
+
+
+
+void SetupDialog::displayLookaheadHelp()
+{
+	QWhatsThis::showText( QCursor::pos(),
+			tr( "Here you can let LMMS render up to this many "
+					"periods ahead of the audio device. "
+					"Periods which take too long to render "
+					"then don't cause dropouts as easily, "
+					"at the cost of a higher latency. "
+					"While playing live via MIDI or "
+					"recording, lookahead is suspended." ) );
+}
+
+
+
+
 void SetupDialog::toggleToolTips( bool _enabled )
 {
 	m_toolTips = _enabled;
@@ -221,7 +221,7 @@ void FxLine::renameChannel()
 			QLineEdit::Normal, mix->effectChannel(m_channelIndex)->m_name, &ok );
 	if( ok && !new_name.isEmpty() )
 	{
-		mix->effectChannel( m_channelIndex )->m_name = new_name;
+		mix->effectChannel( m_channelIndex )->setName( new_name );
 		update();
 	}
 }
@@ -109,6 +109,7 @@ InstrumentTrack::InstrumentTrack( TrackContainer* tc ) :
 	m_pitchModel( 0, MinPitchDefault, MaxPitchDefault, 1, this, tr( "Pitch" ) ),
 	m_pitchRangeModel( 1, 1, 24, this, tr( "Pitch range" ) ),
 	m_effectChannelModel( 0, 0, 0, this, tr( "FX channel" ) ),
+	m_maxVoicesModel( 0, 0, 256, this, tr( "Voice limit" ) ),
 	m_instrument( NULL ),
 	m_soundShaping( this ),
 	m_arpeggio( this ),
@@ -134,6 +135,7 @@ InstrumentTrack::InstrumentTrack( TrackContainer* tc ) :
 
 	setName( tr( "Default preset" ) );
 
+	m_audioPort.setExtOutputEnabled( true );
 }
 
 
@@ -241,6 +243,8 @@ MidiEvent InstrumentTrack::applyMasterKey( const MidiEvent& event )
 
 void InstrumentTrack::processInEvent( const MidiEvent& event, const MidiTime& time, f_cnt_t offset )
 {
+	Engine::mixer()->notifyLiveInput();
+
 	bool eventHandled = false;
 
 	switch( event.type() )
@@ -700,6 +704,7 @@ void InstrumentTrack::saveTrackSpecificSettings( QDomDocument& doc, QDomElement
 
 	m_effectChannelModel.saveSettings( doc, thisElement, "fxch" );
 	m_baseNoteModel.saveSettings( doc, thisElement, "basenote" );
+	m_maxVoicesModel.saveSettings( doc, thisElement, "maxvoices" );
 
 	if( m_instrument != NULL )
 	{
@@ -731,6 +736,7 @@ void InstrumentTrack::loadTrackSpecificSettings( const QDomElement & thisElement
 	m_effectChannelModel.setRange( 0, Engine::fxMixer()->numChannels()-1 );
 	m_effectChannelModel.loadSettings( thisElement, "fxch" );
 	m_baseNoteModel.loadSettings( thisElement, "basenote" );
+	m_maxVoicesModel.loadSettings( thisElement, "maxvoices" );
 
 	// clear effect-chain just in case we load an old preset without FX-data
 	m_audioPort.effects()->clear();
@@ -1216,6 +1222,13 @@ InstrumentTrackWindow::InstrumentTrackWindow( InstrumentTrackView * _itv ) :
 	m_effectChannelNumber->setLabel( tr( "FX" ) );
 
 	basicControlsLayout->addWidget( m_effectChannelNumber );
+	basicControlsLayout->addStretch();
+
+	// setup spinbox for limiting number of voices
+	m_maxVoicesSpinBox = new LcdSpinBox( 3, NULL, tr( "Voice limit (0 = unlimited)" ) );
+	m_maxVoicesSpinBox->setLabel( tr( "VOICES" ) );
+
+	basicControlsLayout->addWidget( m_maxVoicesSpinBox );
 
 	basicControlsLayout->addStretch();
 
@@ -1346,6 +1359,7 @@ void InstrumentTrackWindow::modelChanged()
 	m_volumeKnob->setModel( &m_track->m_volumeModel );
 	m_panningKnob->setModel( &m_track->m_panningModel );
 	m_effectChannelNumber->setModel( &m_track->m_effectChannelModel );
+	m_maxVoicesSpinBox->setModel( &m_track->m_maxVoicesModel );
 	m_pianoView->setModel( &m_track->m_piano );
 
 	if( m_track->instrument() && m_track->instrument()->flags().testFlag( Instrument::IsNotBendable ) == false )
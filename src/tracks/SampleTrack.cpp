@@ -54,6 +54,8 @@ SampleTCO::SampleTCO( Track * _track ) :
 	TrackContentObject( _track ),
 	m_sampleBuffer( new SampleBuffer )
 {
+	m_sampleBuffer->setStreamingAllowed( true );
+
 	saveJournallingState( false );
 	setSampleFile( "" );
 	restoreJournallingState();
@@ -131,7 +133,11 @@ void SampleTCO::updateLength( bpm_t )
 
 MidiTime SampleTCO::sampleLength() const
 {
-	return (int)( m_sampleBuffer->frames() / Engine::framesPerTick() );
+	// streamed samples are played at the sample rate of the file
+	return (int)( m_sampleBuffer->frames() *
+				Engine::mixer()->baseSampleRate() /
+				m_sampleBuffer->sampleRate() /
+						Engine::framesPerTick() );
 }
 
 
@@ -222,9 +228,19 @@ void SampleTCOView::updateSample()
 	update();
 	// set tooltip to filename so that user can see what sample this
 	// sample-tco contains
-	ToolTip::add( this, ( m_tco->m_sampleBuffer->audioFile() != "" ) ?
-					m_tco->m_sampleBuffer->audioFile() :
-					tr( "double-click to select sample" ) );
+	if( m_tco->m_sampleBuffer->audioFile() == "" )
+	{
+		ToolTip::add( this, tr( "double-click to select sample" ) );
+	}
+	else
+	{
+		ToolTip::add( this, tr( "%1 (%2 MB%3)" ).
+			arg( m_tco->m_sampleBuffer->audioFile() ).
+			arg( m_tco->m_sampleBuffer->memoryUsage() /
+					( 1024.0 * 1024.0 ), 0, 'f', 1 ).
+			arg( m_tco->m_sampleBuffer->isStreamed() ?
+						tr( ", streamed" ) : "" ) );
+	}
 }
 
 
@@ -421,6 +437,8 @@ SampleTrack::SampleTrack( TrackContainer* tc ) :
 {
 	setName( tr( "Sample track" ) );
 	m_panningModel.setCenterValue( DefaultPanning );
+
+	m_audioPort.setExtOutputEnabled( true );
 }
 
 
@@ -0,0 +1,273 @@
+/*
+ * binarydatafile_test.cpp - round trips documents through BinaryDataFile
+ *
+ * Copyright (c) 2026 agent <agent/at/local>
+ *
+ * This file is part of LMMS - http://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+// Documents have to come back from encode() and decode() exactly as they
+// were, documents which can't be stored have to be refused, and broken or
+// crafted files must not be accepted.
+
+#include <stdio.h>
+
+#include <QtXml/QDomDocument>
+
+#include "BinaryDataFile.h"
+
+
+static bool sameNodes( const QDomNode & _a, const QDomNode & _b )
+{
+	if( _a.nodeType() != _b.nodeType() ||
+			_a.nodeName() != _b.nodeName() ||
+			_a.nodeValue() != _b.nodeValue() )
+	{
+		return false;
+	}
+
+	const QDomNamedNodeMap attrsA = _a.attributes();
+	const QDomNamedNodeMap attrsB = _b.attributes();
+	if( attrsA.count() != attrsB.count() )
+	{
+		return false;
+	}
+	for( int i = 0; i < attrsA.count(); ++i )
+	{
+		const QDomAttr a = attrsA.item( i ).toAttr();
+		if( !_b.toElement().hasAttribute( a.name() ) ||
+			_b.toElement().attribute( a.name() ) != a.value() )
+		{
+			return false;
+		}
+	}
+
+	const QDomNodeList childrenA = _a.childNodes();
+	const QDomNodeList childrenB = _b.childNodes();
+	if( childrenA.count() != childrenB.count() )
+	{
+		return false;
+	}
+	for( int i = 0; i < childrenA.count(); ++i )
+	{
+		if( !sameNodes( childrenA.item( i ), childrenB.item( i ) ) )
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+
+
+
+static QDomElement addTrack( QDomDocument & _doc, QDomElement & _parent,
+						const QString & _name, int _type )
+{
+	QDomElement track = _doc.createElement( "track" );
+	track.setAttribute( "name", _name );
+	track.setAttribute( "type", _type );
+	track.setAttribute( "muted", 0 );
+	_parent.appendChild( track );
+	return track;
+}
+
+
+
+
+// like a project with instrument and beat/bassline tracks - tracks end up
+// in chunks of their own, the ones of the beat/bassline track in chunks of
+// its chunk
+static QDomDocument makeProject()
+{
+	QDomDocument doc( "lmms-project" );
+	doc.appendChild( doc.createProcessingInstruction( "xml",
+			"version=\"1.0\" encoding=\"UTF-8\"" ) );
+
+	QDomElement root = doc.createElement( "lmms-project" );
+	root.setAttribute( "version", "1.0" );
+	root.setAttribute( "creator", "LMMS" );
+	doc.appendChild( root );
+
+	QDomElement head = doc.createElement( "head" );
+	head.setAttribute( "bpm", 140 );
+	root.appendChild( head );
+
+	QDomElement song = doc.createElement( "song" );
+	root.appendChild( song );
+	QDomElement tc = doc.createElement( "trackcontainer" );
+	song.appendChild( tc );
+
+	for( int t = 0; t < 3; ++t )
+	{
+		QDomElement track = addTrack( doc, tc,
+				QString::fromUtf8( "Tr\xc3\xa4" "ck %1" ).arg( t ), 0 );
+		QDomElement it = doc.createElement( "instrumenttrack" );
+		it.setAttribute( "vol", 100 );
+		it.setAttribute( "pan", "" );
+		track.appendChild( it );
+		for( int p = 0; p < 4; ++p )
+		{
+			QDomElement pattern = doc.createElement( "pattern" );
+			pattern.setAttribute( "pos", p * 192 );
+			track.appendChild( pattern );
+			QDomElement note = doc.createElement( "note" );
+			note.setAttribute( "key", 57 + p );
+			pattern.appendChild( note );
+		}
+	}
+
+	QDomElement bb = addTrack( doc, tc, "Beat/Bassline 0", 1 );
+	QDomElement bbtrack = doc.createElement( "bbtrack" );
+	bb.appendChild( bbtrack );
+	QDomElement bbtc = doc.createElement( "trackcontainer" );
+	bbtrack.appendChild( bbtc );
+	QDomElement kick = addTrack( doc, bbtc, "Kick", 0 );
+	kick.appendChild( doc.createComment( " four to the floor " ) );
+
+	QDomElement notes = doc.createElement( "projectnotes" );
+	notes.appendChild( doc.createCDATASection(
+				"<p>some <b>notes</b> &amp; more</p>" ) );
+	root.appendChild( notes );
+
+	QDomElement text = doc.createElement( "text" );
+	text.appendChild( doc.createTextNode( "  leading and trailing  " ) );
+	root.appendChild( text );
+
+	return doc;
+}
+
+
+
+
+static QDomDocument makeNested( int _depth )
+{
+	QDomDocument doc( "lmms-project" );
+	QDomNode parent = doc;
+	for( int i = 0; i < _depth; ++i )
+	{
+		parent = parent.appendChild( doc.createElement( "a" ) );
+	}
+	return doc;
+}
+
+
+
+
+// single chunk with _depth nested elements, written by hand so it can
+// describe what the encoder refuses to write
+static QByteArray makeNestedFile( int _depth )
+{
+	QByteArray chunk;
+	chunk.append( (char) 2 );		// strings "" and "a"
+	chunk.append( (char) 0 );
+	chunk.append( (char) 1 );
+	chunk.append( 'a' );
+	chunk.append( (char) 0 );		// document type ""
+	chunk.append( (char) 1 );		// one node
+	for( int i = 0; i < _depth; ++i )
+	{
+		chunk.append( (char) 1 );	// element
+		chunk.append( (char) 1 );	// "a"
+		chunk.append( (char) 0 );	// no attributes
+		chunk.append( (char)( i < _depth - 1 ? 1 : 0 ) );
+	}
+
+	const QByteArray compressed = qCompress( chunk );
+	QByteArray file( "LMPB" );
+	file.append( (char) 1 );		// version
+	file.append( QByteArray( 3, 0 ) );
+	const quint32 words[2] = { 1, (quint32) compressed.size() };
+	for( int w = 0; w < 2; ++w )
+	{
+		for( int i = 0; i < 4; ++i )
+		{
+			file.append( (char)( ( words[w] >> ( i * 8 ) ) & 0xff ) );
+		}
+	}
+	file.append( compressed );
+	return file;
+}
+
+
+
+
+static bool roundTrip( const QDomDocument & _doc )
+{
+	const QByteArray data = BinaryDataFile::encode( _doc );
+	QDomDocument decoded;
+	return BinaryDataFile::isBinary( data ) &&
+			BinaryDataFile::decode( data, decoded ) &&
+			decoded.doctype().name() == _doc.doctype().name() &&
+			sameNodes( decoded, _doc );
+}
+
+
+
+
+static int check( const char * _name, bool _ok )
+{
+	printf( "%s: %s\n", _name, _ok ? "ok" : "FAILED" );
+	return _ok ? 0 : 1;
+}
+
+
+
+
+int main( int, char * * )
+{
+	int failures = 0;
+
+	const QDomDocument project = makeProject();
+	failures += check( "project round trip", roundTrip( project ) );
+
+	// every truncated file has to be refused
+	const QByteArray data = BinaryDataFile::encode( project );
+	bool truncated = true;
+	for( int len = 0; len < data.size(); ++len )
+	{
+		QDomDocument doc;
+		if( BinaryDataFile::decode( data.left( len ), doc ) )
+		{
+			truncated = false;
+		}
+	}
+	failures += check( "truncated files refused", truncated );
+
+	QDomDocument entities = makeProject();
+	entities.documentElement().appendChild(
+				entities.createEntityReference( "nbsp" ) );
+	failures += check( "entity reference refused",
+			BinaryDataFile::encode( entities ).isEmpty() );
+
+	failures += check( "max. depth round trip",
+		roundTrip( makeNested( BinaryDataFile::MaxDepth ) ) );
+	failures += check( "too deep document refused",
+		BinaryDataFile::encode( makeNested(
+				BinaryDataFile::MaxDepth + 1 ) ).isEmpty() );
+
+	QDomDocument doc;
+	failures += check( "nested file accepted", BinaryDataFile::decode(
+				makeNestedFile( BinaryDataFile::MaxDepth ),
+									doc ) );
+	failures += check( "too deep file refused", !BinaryDataFile::decode(
+				makeNestedFile( 100000 ), doc ) );
+
+	return failures > 0 ? 1 : 0;
+}
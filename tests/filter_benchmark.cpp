@@ -0,0 +1,228 @@
+/*
+ * filter_benchmark.cpp - times polyphonic filtered voices with block
+ *                        kernels against per-sample filtering
+ *
+ * Copyright (c) 2026 agent <agent/at/local>
+ *
+ * This file is part of LMMS - http://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+// Each voice has a filter of its own whose cutoff moves every few frames,
+// like InstrumentSoundShaping does with the filter envelope of a note.
+// LMMS 1.1 switched on the filter type for every sample and channel, which
+// is emulated with the per-sample kernels of BasicFilters.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <QtCore/QVector>
+
+#include "BasicFilters.h"
+#include "MemoryManager.h"
+#include "MicroTimer.h"
+
+
+static const int Frames = 256;
+static const int SampleRate = 44100;
+static const int Voices = 64;
+// frames between coefficient changes
+static const int CoeffInterval = 32;
+
+// microseconds available per period
+static const double PeriodTime = 1e6 * Frames / SampleRate;
+
+typedef BasicFilters<2> Filter;
+
+
+enum Methods
+{
+	SwitchPerSample,
+	UpdatePerSample,
+	ProcessBlock,
+	NumMethods
+} ;
+
+static const char * MethodNames[NumMethods] =
+{
+	"switch",
+	"update()",
+	"processBlock()"
+} ;
+
+
+
+
+// the way LMMS 1.1 dispatched each sample
+static inline sample_t updateSwitched( Filter & _f, int _type, sample_t _in,
+								ch_cnt_t _ch )
+{
+	switch( _type )
+	{
+		case Filter::Moog:
+			return _f.updateSample<Filter::Moog>( _in, _ch );
+		case Filter::Tripole:
+			return _f.updateSample<Filter::Tripole>( _in, _ch );
+		case Filter::Lowpass_SV:
+			return _f.updateSample<Filter::Lowpass_SV>( _in, _ch );
+		case Filter::Bandpass_SV:
+			return _f.updateSample<Filter::Bandpass_SV>( _in, _ch );
+		case Filter::Highpass_SV:
+			return _f.updateSample<Filter::Highpass_SV>( _in, _ch );
+		case Filter::Notch_SV:
+			return _f.updateSample<Filter::Notch_SV>( _in, _ch );
+		case Filter::Lowpass_RC12:
+			return _f.updateSample<Filter::Lowpass_RC12>( _in, _ch );
+		case Filter::Bandpass_RC12:
+			return _f.updateSample<Filter::Bandpass_RC12>( _in, _ch );
+		case Filter::Highpass_RC12:
+			return _f.updateSample<Filter::Highpass_RC12>( _in, _ch );
+		case Filter::Lowpass_RC24:
+			return _f.updateSample<Filter::Lowpass_RC24>( _in, _ch );
+		case Filter::Bandpass_RC24:
+			return _f.updateSample<Filter::Bandpass_RC24>( _in, _ch );
+		case Filter::Highpass_RC24:
+			return _f.updateSample<Filter::Highpass_RC24>( _in, _ch );
+		case Filter::Formantfilter:
+			return _f.updateSample<Filter::Formantfilter>( _in, _ch );
+		case Filter::FastFormant:
+			return _f.updateSample<Filter::FastFormant>( _in, _ch );
+		default:
+			break;
+	}
+	return _f.updateSample<Filter::LowPass>( _in, _ch );
+}
+
+
+
+
+// microseconds per voice and period
+static double run( int _type, Methods _method, const sampleFrame * _in,
+								int _periods )
+{
+	QVector<Filter *> filters;
+	for( int v = 0; v < Voices; ++v )
+	{
+		filters.push_back( new Filter( SampleRate ) );
+		filters.last()->setFilterType( _type );
+	}
+	sampleFrame * buf = MM_ALLOC( sampleFrame, Frames );
+
+	MicroTimer timer;
+	for( int p = 0; p < _periods; ++p )
+	{
+		for( int v = 0; v < Voices; ++v )
+		{
+			Filter & f = *filters[v];
+			memcpy( buf, _in, Frames * sizeof( sampleFrame ) );
+			for( int b = 0; b < Frames; b += CoeffInterval )
+			{
+				// slow sweep, different for each voice
+				const float cutoff = 200 + 4000 * ( 1 +
+					sinf( 0.001f * ( p * Frames + b ) + v ) );
+				f.calcFilterCoeffs( cutoff, 2.0f );
+				switch( _method )
+				{
+					case SwitchPerSample:
+						for( int i = b; i < b + CoeffInterval; ++i )
+						{
+							buf[i][0] = updateSwitched( f, _type, buf[i][0], 0 );
+							buf[i][1] = updateSwitched( f, _type, buf[i][1], 1 );
+						}
+						break;
+					case UpdatePerSample:
+						for( int i = b; i < b + CoeffInterval; ++i )
+						{
+							buf[i][0] = f.update( buf[i][0], 0 );
+							buf[i][1] = f.update( buf[i][1], 1 );
+						}
+						break;
+					default:
+						f.processBlock( buf + b, CoeffInterval );
+						break;
+				}
+			}
+		}
+	}
+	const double perVoice = (double) timer.elapsed() / _periods / Voices;
+
+	MM_FREE( buf );
+	qDeleteAll( filters );
+
+	return perVoice;
+}
+
+
+
+
+int main( int, char * * )
+{
+	const int periods = 500;
+
+	MemoryManager::init();
+
+	sampleFrame * in = MM_ALLOC( sampleFrame, Frames );
+	for( int f = 0; f < Frames; ++f )
+	{
+		in[f][0] = rand() / (float) RAND_MAX - 0.5f;
+		in[f][1] = rand() / (float) RAND_MAX - 0.5f;
+	}
+
+	static const struct
+	{
+		const char * name;
+		int type;
+	} types[] =
+	{
+		{ "biquad lowpass", Filter::LowPass },
+		{ "moog", Filter::Moog },
+		{ "rc lowpass 24dB", Filter::Lowpass_RC24 },
+		{ "sv lowpass", Filter::Lowpass_SV },
+		{ "formant", Filter::Formantfilter }
+	} ;
+
+	printf( "Filtered voices - us per voice and period of %d frames, "
+			"coefficients every %d frames (voices per core)\n\n",
+						Frames, CoeffInterval );
+	printf( "%-18s", "filter" );
+	for( int m = 0; m < NumMethods; ++m )
+	{
+		printf( "%22s", MethodNames[m] );
+	}
+	printf( "\n" );
+
+	for( unsigned int t = 0; t < sizeof( types ) / sizeof( types[0] ); ++t )
+	{
+		printf( "%-18s", types[t].name );
+		for( int m = 0; m < NumMethods; ++m )
+		{
+			const double us = run( types[t].type, (Methods) m, in,
+								periods );
+			printf( "%13.2f (%6.0f)", us, PeriodTime / us );
+		}
+		printf( "\n" );
+	}
+
+	MM_FREE( in );
+
+	MemoryManager::cleanup();
+
+	return 0;
+}
@@ -0,0 +1,172 @@
+/*
+ * mixhelpers_benchmark.cpp - times vectorized MixHelpers kernels against
+ *                            the scalar ones
+ *
+ * Copyright (c) 2026 agent <agent/at/local>
+ *
+ * This file is part of LMMS - http://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "MemoryManager.h"
+#include "MicroTimer.h"
+#include "MixHelpers.h"
+
+
+static const int Frames = 256;
+
+
+static void fillRandom( sampleFrame * _buf, int _frames )
+{
+	for( int f = 0; f < _frames; ++f )
+	{
+		_buf[f][0] = rand() / (float) RAND_MAX - 0.5f;
+		_buf[f][1] = rand() / (float) RAND_MAX - 0.5f;
+	}
+}
+
+
+
+
+static bool selectImplementation( const char * _name )
+{
+	setenv( "LMMS_MIX_KERNELS", _name, 1 );
+	MixHelpers::init();
+	return strcmp( MixHelpers::implementation(), _name ) == 0;
+}
+
+
+enum Kernels
+{
+	AddKernel,
+	AddMultipliedKernel,
+	AddSanitizedMultipliedKernel,
+	MultiplyAndAddMultipliedKernel,
+	IsSilentKernel,
+	SanitizeKernel,
+	NumKernels
+} ;
+
+static const char * KernelNames[NumKernels] =
+{
+	"add",
+	"addMultiplied",
+	"addSanitizedMultiplied",
+	"multiplyAndAddMultiplied",
+	"isSilent",
+	"sanitize"
+} ;
+
+
+// nanoseconds per period of Frames frames
+static double timeKernel( Kernels _kernel, sampleFrame * _dst,
+					sampleFrame * _src, int _iterations )
+{
+	volatile bool result = false;
+	MicroTimer timer;
+	for( int i = 0; i < _iterations; ++i )
+	{
+		switch( _kernel )
+		{
+			case AddKernel:
+				MixHelpers::add( _dst, _src, Frames );
+				break;
+			case AddMultipliedKernel:
+				MixHelpers::addMultiplied( _dst, _src, 0.5f, Frames );
+				break;
+			case AddSanitizedMultipliedKernel:
+				MixHelpers::addSanitizedMultiplied( _dst, _src, 0.5f, Frames );
+				break;
+			case MultiplyAndAddMultipliedKernel:
+				MixHelpers::multiplyAndAddMultiplied( _dst, _src, 0.5f, 0.5f, Frames );
+				break;
+			case IsSilentKernel:
+				// silent buffers have to be scanned completely
+				result = MixHelpers::isSilent( _dst, Frames );
+				break;
+			case SanitizeKernel:
+				result = MixHelpers::sanitize( _src, Frames );
+				break;
+			default:
+				break;
+		}
+	}
+	(void) result;
+	return timer.elapsed() * 1000.0 / _iterations;
+}
+
+
+
+
+int main( int, char * * )
+{
+	static const char * implementations[] = { "scalar", "sse2", "avx2", "neon" };
+	const int iterations = 200000;
+
+	MemoryManager::init();
+
+	sampleFrame * dst = MM_ALLOC( sampleFrame, Frames );
+	sampleFrame * src = MM_ALLOC( sampleFrame, Frames );
+
+	printf( "Mix kernels - ns per period of %d frames (speedup)\n\n", Frames );
+	printf( "%-26s", "kernel" );
+	for( int i = 0; i < 4; ++i )
+	{
+		printf( "%16s", implementations[i] );
+	}
+	printf( "\n" );
+
+	for( int k = 0; k < NumKernels; ++k )
+	{
+		printf( "%-26s", KernelNames[k] );
+		double scalar = 0;
+		for( int i = 0; i < 4; ++i )
+		{
+			if( !selectImplementation( implementations[i] ) )
+			{
+				printf( "%16s", "-" );
+				continue;
+			}
+			fillRandom( src, Frames );
+			memset( dst, 0, Frames * sizeof( sampleFrame ) );
+			const double t = timeKernel( (Kernels) k, dst, src,
+								iterations );
+			if( i == 0 )
+			{
+				scalar = t;
+				printf( "%16.1f", t );
+			}
+			else
+			{
+				printf( "%9.1f (%.1fx)", t, scalar / t );
+			}
+		}
+		printf( "\n" );
+	}
+
+	MM_FREE( dst );
+	MM_FREE( src );
+
+	MemoryManager::cleanup();
+
+	return 0;
+}
@@ -0,0 +1,515 @@
+/*
+ * mixhelpers_test.cpp - checks vectorized MixHelpers kernels against the
+ *                       scalar ones
+ *
+ * Copyright (c) 2026 agent <agent/at/local>
+ *
+ * This file is part of LMMS - http://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+// Vectorized kernels do their operations in the same order as the scalar
+// ones, so results have to be bit-identical - for every frame count
+// (remainder loops) and for buffers which aren't aligned to vector size.
+// Whole buffers are compared, so writing past the end is caught as well.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "MemoryManager.h"
+#include "MixHelpers.h"
+#include "ParameterStream.h"
+#include "ValueBuffer.h"
+
+
+static const char * Implementations[] = { "sse2", "avx2", "neon" };
+static const int NumImplementations = 3;
+
+static const int FrameCounts[] = { 0, 1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17,
+						31, 32, 33, 64, 127, 255, 256, 257 };
+static const int NumFrameCounts = sizeof( FrameCounts ) / sizeof( int );
+
+// buffers are shifted by up to this many frames for unaligned access
+static const int MaxOffset = 3;
+static const int BufferFrames = 257 + MaxOffset;
+
+
+struct Buffers
+{
+	sampleFrame dst[BufferFrames];
+	sampleFrame src[BufferFrames];
+	float coeffs1[BufferFrames];
+	float coeffs2[BufferFrames];
+	float left[BufferFrames];
+	float right[BufferFrames];
+} ;
+
+
+enum InputKinds
+{
+	NormalInput,
+	NonFiniteInput,		// infs, nans and denormals in src
+	QuietInput		// src mostly below silence threshold
+} ;
+
+
+// deterministic, so failures can be reproduced
+static unsigned int s_seed = 1;
+
+static float randomSample()
+{
+	s_seed = s_seed * 1103515245 + 12345;
+	return ( ( s_seed >> 8 ) & 0xffff ) / 32768.0f - 1.0f;
+}
+
+
+static float specialSample()
+{
+	static const float specials[] = { NAN, -NAN, INFINITY, -INFINITY,
+				1e-40f, -1e-42f, 0.0f, -0.0f, 3e38f } ;
+	s_seed = s_seed * 1103515245 + 12345;
+	return specials[( s_seed >> 8 ) % ( sizeof( specials ) / sizeof( float ) )];
+}
+
+
+static void fill( Buffers & _b, InputKinds _kind, int _frames, int _offset )
+{
+	for( int f = 0; f < BufferFrames; ++f )
+	{
+		for( int c = 0; c < DEFAULT_CHANNELS; ++c )
+		{
+			_b.dst[f][c] = randomSample();
+			switch( _kind )
+			{
+				case NonFiniteInput:
+					_b.src[f][c] = ( f + c ) % 3 == 0 ?
+						specialSample() : randomSample();
+					break;
+				case QuietInput:
+					_b.src[f][c] = randomSample() * 1e-8f;
+					break;
+				default:
+					// denormals have to be handled alike as well
+					_b.src[f][c] = f % 11 == 5 ?
+						randomSample() * 1e-40f : randomSample();
+					break;
+			}
+		}
+		_b.coeffs1[f] = randomSample();
+		_b.coeffs2[f] = randomSample();
+		_b.left[f] = randomSample();
+		_b.right[f] = randomSample();
+	}
+
+	if( _kind == QuietInput )
+	{
+		// one loud sample somewhere or none at all
+		const int f = s_seed % ( _frames + 1 );
+		if( f < _frames )
+		{
+			_b.src[_offset + f][s_seed % 2] = 0.001f;
+		}
+	}
+}
+
+
+
+
+// each test runs one function on buffers shifted by _offset frames and
+// returns its result if it has one
+typedef bool (*TestFunction)( Buffers & _b, int _offset, int _frames );
+
+static bool testIsSilent( Buffers & _b, int _offset, int _frames )
+{
+	return MixHelpers::isSilent( _b.src + _offset, _frames );
+}
+
+static bool testSanitize( Buffers & _b, int _offset, int _frames )
+{
+	return MixHelpers::sanitize( _b.src + _offset, _frames );
+}
+
+static bool testAdd( Buffers & _b, int _offset, int _frames )
+{
+	// source and destination misaligned differently
+	MixHelpers::add( _b.dst + _offset, _b.src + 1, _frames );
+	return false;
+}
+
+static bool testAddMultiplied( Buffers & _b, int _offset, int _frames )
+{
+	MixHelpers::addMultiplied( _b.dst + _offset, _b.src, 0.7f, _frames );
+	return false;
+}
+
+static bool testAddSwappedMultiplied( Buffers & _b, int _offset, int _frames )
+{
+	MixHelpers::addSwappedMultiplied( _b.dst + _offset, _b.src + _offset,
+								-1.3f, _frames );
+	return false;
+}
+
+static bool testAddMultipliedByBuffer( Buffers & _b, int _offset, int _frames )
+{
+	ValueBuffer coeffs( _b.coeffs1 + _offset, _frames );
+	MixHelpers::addMultipliedByBuffer( _b.dst + _offset, _b.src + _offset,
+						0.5f, &coeffs, _frames );
+	return false;
+}
+
+static bool testAddMultipliedByBuffers( Buffers & _b, int _offset, int _frames )
+{
+	ValueBuffer coeffs1( _b.coeffs1, _frames );
+	ValueBuffer coeffs2( _b.coeffs2 + _offset, _frames );
+	MixHelpers::addMultipliedByBuffers( _b.dst + _offset, _b.src,
+					&coeffs1, &coeffs2, _frames );
+	return false;
+}
+
+static bool testAddSanitizedMultiplied( Buffers & _b, int _offset, int _frames )
+{
+	MixHelpers::addSanitizedMultiplied( _b.dst + _offset, _b.src + _offset,
+								0.25f, _frames );
+	return false;
+}
+
+static bool testAddSanitizedMultipliedByBuffer( Buffers & _b, int _offset, int _frames )
+{
+	ValueBuffer coeffs( _b.coeffs1 + _offset, _frames );
+	MixHelpers::addSanitizedMultipliedByBuffer( _b.dst + _offset,
+				_b.src + _offset, 2.0f, &coeffs, _frames );
+	return false;
+}
+
+static bool testAddSanitizedMultipliedByBuffers( Buffers & _b, int _offset, int _frames )
+{
+	ValueBuffer coeffs1( _b.coeffs1 + _offset, _frames );
+	ValueBuffer coeffs2( _b.coeffs2, _frames );
+	MixHelpers::addSanitizedMultipliedByBuffers( _b.dst, _b.src + _offset,
+					&coeffs1, &coeffs2, _frames );
+	return false;
+}
+
+// streams hand unaligned coefficients to the buffer kernels directly
+static bool testAddMultipliedByStreams( Buffers & _b, int _offset, int _frames )
+{
+	const ParameterStream c = ParameterStream::constant( 0.8f );
+	const ParameterStream b1 = ParameterStream::buffer( _b.coeffs1 + _offset );
+	const ParameterStream b2 = ParameterStream::buffer( _b.coeffs2 + 1 );
+	MixHelpers::addMultipliedByStreams( _b.dst + _offset, _b.src, c, b1, _frames );
+	MixHelpers::addMultipliedByStreams( _b.dst, _b.src + _offset, b2, c, _frames );
+	MixHelpers::addMultipliedByStreams( _b.dst + 1, _b.src, b1, b2, _frames );
+	return false;
+}
+
+static bool testAddSanitizedMultipliedByStreams( Buffers & _b, int _offset, int _frames )
+{
+	const ParameterStream c = ParameterStream::constant( 0.8f );
+	const ParameterStream b1 = ParameterStream::buffer( _b.coeffs1 + _offset );
+	const ParameterStream b2 = ParameterStream::buffer( _b.coeffs2 + 1 );
+	MixHelpers::addSanitizedMultipliedByStreams( _b.dst + _offset, _b.src, c, b1, _frames );
+	MixHelpers::addSanitizedMultipliedByStreams( _b.dst, _b.src + _offset, b2, c, _frames );
+	MixHelpers::addSanitizedMultipliedByStreams( _b.dst + 1, _b.src, b1, b2, _frames );
+	return false;
+}
+
+static bool testAddMultipliedStereo( Buffers & _b, int _offset, int _frames )
+{
+	MixHelpers::addMultipliedStereo( _b.dst + _offset, _b.src + _offset,
+							0.3f, -0.9f, _frames );
+	return false;
+}
+
+static bool testMultiplyAndAddMultiplied( Buffers & _b, int _offset, int _frames )
+{
+	MixHelpers::multiplyAndAddMultiplied( _b.dst + _offset, _b.src,
+							0.6f, 1.1f, _frames );
+	return false;
+}
+
+static bool testMultiplyAndAddMultipliedJoined( Buffers & _b, int _offset, int _frames )
+{
+	MixHelpers::multiplyAndAddMultipliedJoined( _b.dst + _offset,
+			_b.left + _offset, _b.right + 1, 0.6f, 1.1f, _frames );
+	return false;
+}
+
+
+struct Test
+{
+	const char * name;
+	TestFunction function;
+	InputKinds input;
+} ;
+
+static const Test Tests[] =
+{
+	{ "isSilent", testIsSilent, QuietInput },
+	{ "isSilent (loud)", testIsSilent, NormalInput },
+	{ "sanitize", testSanitize, NonFiniteInput },
+	{ "sanitize (finite)", testSanitize, NormalInput },
+	{ "add", testAdd, NormalInput },
+	{ "addMultiplied", testAddMultiplied, NormalInput },
+	{ "addSwappedMultiplied", testAddSwappedMultiplied, NormalInput },
+	{ "addMultipliedByBuffer", testAddMultipliedByBuffer, NormalInput },
+	{ "addMultipliedByBuffers", testAddMultipliedByBuffers, NormalInput },
+	{ "addSanitizedMultiplied", testAddSanitizedMultiplied, NonFiniteInput },
+	{ "addSanitizedMultipliedByBuffer", testAddSanitizedMultipliedByBuffer, NonFiniteInput },
+	{ "addSanitizedMultipliedByBuffers", testAddSanitizedMultipliedByBuffers, NonFiniteInput },
+	{ "addMultipliedByStreams", testAddMultipliedByStreams, NormalInput },
+	{ "addSanitizedMultipliedByStreams", testAddSanitizedMultipliedByStreams, NonFiniteInput },
+	{ "addMultipliedStereo", testAddMultipliedStereo, NormalInput },
+	{ "multiplyAndAddMultiplied", testMultiplyAndAddMultiplied, NormalInput },
+	{ "multiplyAndAddMultipliedJoined", testMultiplyAndAddMultipliedJoined, NormalInput }
+} ;
+
+static const int NumTests = sizeof( Tests ) / sizeof( Test );
+
+
+
+
+// Before ParameterStreams, ramps were written into value buffers with
+// ValueBuffer::interpolate() and mixed with the buffer kernels or the
+// volume/panning loop of AudioPort. Streams compute ramps differently, so
+// results only have to match up to rounding.
+
+static const int NumStreamKinds = 3;
+static const char * StreamKindNames[NumStreamKinds] =
+{
+	"constant",
+	"ramp",
+	"buffer"
+} ;
+
+
+// stream of given kind with values around _center - _reference gets the
+// values of the value buffer LMMS 1.1 would have used instead
+static ParameterStream makeStream( int _kind, float _center, float _range,
+				float * _values, float * _reference,
+								int _frames )
+{
+	const float from = _center + randomSample() * _range;
+	const float to = _center + randomSample() * _range;
+	ParameterStream stream;
+	ValueBuffer vb( _frames );
+	switch( _kind )
+	{
+		case ParameterStream::Constant:
+			stream = ParameterStream::constant( from );
+			vb.fill( from );
+			break;
+		case ParameterStream::Ramp:
+			stream = ParameterStream::ramp( from, to, _frames );
+			vb.interpolate( from, to );
+			break;
+		default:
+			for( int f = 0; f < _frames; ++f )
+			{
+				_values[f] = _center + randomSample() * _range;
+			}
+			stream = ParameterStream::buffer( _values );
+			memcpy( vb.values(), _values, _frames * sizeof( float ) );
+			break;
+	}
+	memcpy( _reference, vb.values(), _frames * sizeof( float ) );
+	return stream;
+}
+
+
+static bool nearlyEqual( const sampleFrame * _a, const sampleFrame * _b,
+								int _frames )
+{
+	for( int f = 0; f < _frames; ++f )
+	{
+		for( int c = 0; c < DEFAULT_CHANNELS; ++c )
+		{
+			if( fabsf( _a[f][c] - _b[f][c] ) >
+					1e-4f * ( 1.0f + fabsf( _b[f][c] ) ) )
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+
+static int compareStreams( const char * _name )
+{
+	static Buffers b;
+	static sampleFrame expected[BufferFrames];
+	static sampleFrame actual[BufferFrames];
+	static float ref1[BufferFrames];
+	static float ref2[BufferFrames];
+
+	int failures = 0;
+	for( int k1 = 0; k1 < NumStreamKinds; ++k1 )
+	{
+		for( int k2 = 0; k2 < NumStreamKinds; ++k2 )
+		{
+			// no ramp within zero frames
+			for( int i = 1; i < NumFrameCounts; ++i )
+			{
+				const int frames = FrameCounts[i];
+				const unsigned int seed = s_seed;
+				fill( b, NormalInput, frames, 0 );
+
+				// addMultipliedByStreams() like in FxMixer
+				ParameterStream s1 = makeStream( k1, 1.0f, 0.5f,
+						b.coeffs1, ref1, frames );
+				ParameterStream s2 = makeStream( k2, 1.0f, 0.5f,
+						b.coeffs2, ref2, frames );
+				memcpy( expected, b.dst, sizeof( expected ) );
+				memcpy( actual, b.dst, sizeof( actual ) );
+				for( int f = 0; f < frames; ++f )
+				{
+					const float c = ref1[f] * ref2[f];
+					expected[f][0] += b.src[f][0] * c;
+					expected[f][1] += b.src[f][1] * c;
+				}
+				MixHelpers::addMultipliedByStreams( actual, b.src,
+							s1, s2, frames );
+				if( !nearlyEqual( expected, actual, BufferFrames ) )
+				{
+					fprintf( stderr, "%s: addMultipliedByStreams "
+						"(%s, %s) differs from value "
+						"buffers (%d frames, seed %u)\n",
+						_name, StreamKindNames[k1],
+						StreamKindNames[k2], frames, seed );
+					++failures;
+				}
+
+				// multiplyByVolumeAndPanning() like in AudioPort
+				ParameterStream volume = makeStream( k1, 100.0f,
+					100.0f, b.coeffs1, ref1, frames );
+				ParameterStream panning = makeStream( k2, 0.0f,
+					100.0f, b.coeffs2, ref2, frames );
+				memcpy( expected, b.src, sizeof( expected ) );
+				memcpy( actual, b.src, sizeof( actual ) );
+				for( int f = 0; f < frames; ++f )
+				{
+					const float v = ref1[f] * 0.01f;
+					const float p = ref2[f] * 0.01f;
+					expected[f][0] *= ( p <= 0 ? 1.0f : 1.0f - p ) * v;
+					expected[f][1] *= ( p >= 0 ? 1.0f : 1.0f + p ) * v;
+				}
+				MixHelpers::multiplyByVolumeAndPanning( actual,
+						volume, panning, frames );
+				if( !nearlyEqual( expected, actual, BufferFrames ) )
+				{
+					fprintf( stderr, "%s: multiplyByVolumeAndPanning "
+						"(%s, %s) differs from value "
+						"buffers (%d frames, seed %u)\n",
+						_name, StreamKindNames[k1],
+						StreamKindNames[k2], frames, seed );
+					++failures;
+				}
+			}
+		}
+	}
+	return failures;
+}
+
+
+
+
+// makes MixHelpers use given implementation - false if it isn't available
+static bool selectImplementation( const char * _name )
+{
+	setenv( "LMMS_MIX_KERNELS", _name, 1 );
+	MixHelpers::init();
+	return strcmp( MixHelpers::implementation(), _name ) == 0;
+}
+
+
+
+
+static int compareImplementation( const char * _name )
+{
+	static Buffers expected;
+	static Buffers actual;
+
+	int failures = 0;
+	for( int t = 0; t < NumTests; ++t )
+	{
+		const Test & test = Tests[t];
+		for( int i = 0; i < NumFrameCounts; ++i )
+		{
+			const int frames = FrameCounts[i];
+			for( int offset = 0; offset <= MaxOffset; ++offset )
+			{
+				const unsigned int seed = s_seed;
+				fill( expected, test.input, frames, offset );
+				memcpy( &actual, &expected, sizeof( Buffers ) );
+
+				selectImplementation( "scalar" );
+				const bool expectedResult =
+					test.function( expected, offset, frames );
+				selectImplementation( _name );
+				const bool actualResult =
+					test.function( actual, offset, frames );
+
+				if( expectedResult != actualResult ||
+					memcmp( &expected, &actual,
+							sizeof( Buffers ) ) != 0 )
+				{
+					fprintf( stderr, "%s: %s differs from scalar "
+						"(%d frames, offset %d, seed %u)\n",
+						_name, test.name, frames, offset,
+									seed );
+					++failures;
+				}
+			}
+		}
+	}
+	return failures;
+}
+
+
+
+
+int main( int, char * * )
+{
+	MemoryManager::init();
+
+	int failures = 0;
+
+	selectImplementation( "scalar" );
+	const int s = compareStreams( "scalar" );
+	printf( "scalar streams: %s\n", s ? "FAILED" : "ok" );
+	failures += s;
+
+	for( int i = 0; i < NumImplementations; ++i )
+	{
+		if( !selectImplementation( Implementations[i] ) )
+		{
+			printf( "%s: not available, skipped\n", Implementations[i] );
+			continue;
+		}
+		const int f = compareImplementation( Implementations[i] ) +
+					compareStreams( Implementations[i] );
+		printf( "%s: %s\n", Implementations[i], f ? "FAILED" : "ok" );
+		failures += f;
+	}
+
+	MemoryManager::cleanup();
+
+	return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,270 @@
+/*
+ * playhandle_benchmark.cpp - times bookkeeping of many short play handles
+ *                            with indexed lists against QList and qFind()
+ *
+ * Copyright (c) 2026 agent <agent/at/local>
+ *
+ * This file is part of LMMS - http://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+// Every period, handles which are done get removed from the list of the
+// mixer and of their audio port and handed back to a pool, and as many new
+// ones get added - like NotePlayHandles of dense drum or arpeggio passages
+// lasting only a few periods. Only this bookkeeping is timed, handles don't
+// render anything.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <QtCore/QList>
+#include <QtCore/QVector>
+#include <QtCore/QtAlgorithms>
+
+#include "IndexedList.h"
+#include "MicroTimer.h"
+
+
+static const int Ports = 16;
+static const int MaxLife = 4;	// periods
+
+enum ListSlots
+{
+	MixerList,
+	AudioPortList,
+	NumListSlots
+} ;
+
+
+struct BenchHandle
+{
+	BenchHandle()
+	{
+		m_listIndex[MixerList] = -1;
+		m_listIndex[AudioPortList] = -1;
+	}
+
+	// remaining periods
+	int m_life;
+	int m_port;
+	int m_listIndex[NumListSlots];
+
+} ;
+
+
+// like NotePlayHandleManager - handles get reused
+class HandlePool
+{
+public:
+	HandlePool( int _size ) :
+		m_handles( _size )
+	{
+		for( int i = 0; i < _size; ++i )
+		{
+			m_free.push_back( &m_handles[i] );
+		}
+	}
+
+	BenchHandle * acquire()
+	{
+		BenchHandle * h = m_free.last();
+		m_free.pop_back();
+		h->m_life = 1 + rand() % MaxLife;
+		h->m_port = rand() % Ports;
+		return h;
+	}
+
+	void release( BenchHandle * _h )
+	{
+		m_free.push_back( _h );
+	}
+
+private:
+	QVector<BenchHandle> m_handles;
+	QVector<BenchHandle *> m_free;
+
+} ;
+
+
+
+
+// bookkeeping of LMMS 1.1: QLists and qFind() for removal from port lists
+class QListBookkeeping
+{
+public:
+	void add( BenchHandle * _h )
+	{
+		m_mixer.append( _h );
+		m_ports[_h->m_port].append( _h );
+	}
+
+	void period( HandlePool & _pool )
+	{
+		for( QList<BenchHandle *>::Iterator it = m_mixer.begin();
+							it != m_mixer.end(); )
+		{
+			if( --( *it )->m_life == 0 )
+			{
+				QList<BenchHandle *> & port = m_ports[( *it )->m_port];
+				QList<BenchHandle *>::Iterator pit =
+					qFind( port.begin(), port.end(), *it );
+				if( pit != port.end() )
+				{
+					port.erase( pit );
+				}
+				_pool.release( *it );
+				it = m_mixer.erase( it );
+			}
+			else
+			{
+				++it;
+			}
+		}
+	}
+
+	int size() const
+	{
+		return m_mixer.size();
+	}
+
+private:
+	QList<BenchHandle *> m_mixer;
+	QList<BenchHandle *> m_ports[Ports];
+
+} ;
+
+
+
+
+// bookkeeping as done by Mixer and AudioPort with PlayHandleLists
+class IndexedBookkeeping
+{
+public:
+	IndexedBookkeeping() :
+		m_mixer( MixerList )
+	{
+		for( int p = 0; p < Ports; ++p )
+		{
+			m_ports.push_back( new IndexedList<BenchHandle>( AudioPortList ) );
+		}
+	}
+
+	~IndexedBookkeeping()
+	{
+		qDeleteAll( m_ports );
+	}
+
+	void add( BenchHandle * _h )
+	{
+		m_mixer.append( _h );
+		m_ports[_h->m_port]->append( _h );
+	}
+
+	void period( HandlePool & _pool )
+	{
+		for( IndexedList<BenchHandle>::Iterator it = m_mixer.begin();
+							it != m_mixer.end(); )
+		{
+			if( --( *it )->m_life == 0 )
+			{
+				BenchHandle * h = *it;
+				it = m_mixer.erase( it );
+				m_ports[h->m_port]->remove( h );
+				m_retired.push_back( h );
+			}
+			else
+			{
+				++it;
+			}
+		}
+
+		// deferred deletion in one batch like Mixer::deleteRetiredPlayHandles()
+		foreach( BenchHandle * h, m_retired )
+		{
+			_pool.release( h );
+		}
+		m_retired.resize( 0 );
+	}
+
+	int size() const
+	{
+		return m_mixer.size();
+	}
+
+private:
+	IndexedList<BenchHandle> m_mixer;
+	QVector<IndexedList<BenchHandle> *> m_ports;
+	QVector<BenchHandle *> m_retired;
+
+} ;
+
+
+
+
+// microseconds per period with about _handles handles alive
+template<class BOOKKEEPING>
+static double run( int _handles, int _periods )
+{
+	srand( 1 );
+
+	HandlePool pool( _handles * 2 );
+	BOOKKEEPING b;
+
+	for( int i = 0; i < _handles; ++i )
+	{
+		b.add( pool.acquire() );
+	}
+
+	MicroTimer timer;
+	for( int i = 0; i < _periods; ++i )
+	{
+		b.period( pool );
+		// replace finished handles
+		while( b.size() < _handles )
+		{
+			b.add( pool.acquire() );
+		}
+	}
+	return (double) timer.elapsed() / _periods;
+}
+
+
+
+
+int main( int, char * * )
+{
+	printf( "Play handles - us per period for removing finished handles "
+				"(living 1 to %d periods, %d ports)\n\n",
+							MaxLife, Ports );
+	printf( "%8s %12s %12s %10s\n", "handles", "QList", "indexed",
+								"speedup" );
+
+	static const int handles[] = { 100, 500, 1000, 2000, 5000, 10000 };
+	for( unsigned int i = 0; i < sizeof( handles ) / sizeof( handles[0] ); ++i )
+	{
+		// QLists get slow quickly, keep total run time bounded
+		const int periods = qMax( 100, 2000000 / handles[i] );
+
+		const double q = run<QListBookkeeping>( handles[i], periods );
+		const double n = run<IndexedBookkeeping>( handles[i], periods );
+
+		printf( "%8d %12.1f %12.1f %9.1fx\n", handles[i], q, n, q / n );
+	}
+
+	return 0;
+}
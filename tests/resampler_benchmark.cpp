@@ -0,0 +1,274 @@
+/*
+ * resampler_benchmark.cpp - times pitched sample voices resampled by
+ *                           Resampler against libsamplerate
+ *
+ * Copyright (c) 2026 agent <agent/at/local>
+ *
+ * This file is part of LMMS - http://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+// Every voice plays the same sine at the same pitch factor but keeps its own
+// state, like SampleBuffer::handleState does. Besides the time per voice,
+// the signal-to-noise ratio of the first voice shows what the time buys.
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <QtCore/QVector>
+
+#include <samplerate.h>
+
+#include "lmms_constants.h"
+#include "MemoryManager.h"
+#include "MicroTimer.h"
+#include "Resampler.h"
+
+
+static const int Frames = 256;
+static const int SampleRate = 44100;
+static const float SineFrequency = 5000;
+
+// microseconds available per period
+static const double PeriodTime = 1e6 * Frames / SampleRate;
+
+
+// signal-to-noise ratio of a sine with known frequency - amplitude and
+// phase are fitted, so latency of the resampler doesn't matter
+static double sineSnr( const sampleFrame * _buf, int _frames, double _omega )
+{
+	double ss = 0, cc = 0, sc = 0, xs = 0, xc = 0;
+	for( int f = 0; f < _frames; ++f )
+	{
+		const double s = sin( _omega * f );
+		const double c = cos( _omega * f );
+		ss += s * s;
+		cc += c * c;
+		sc += s * c;
+		xs += _buf[f][0] * s;
+		xc += _buf[f][0] * c;
+	}
+	const double det = ss * cc - sc * sc;
+	const double a = ( xs * cc - xc * sc ) / det;
+	const double b = ( xc * ss - xs * sc ) / det;
+
+	double signal = 0, noise = 0;
+	for( int f = 0; f < _frames; ++f )
+	{
+		const double fit = a * sin( _omega * f ) + b * cos( _omega * f );
+		signal += fit * fit;
+		noise += ( _buf[f][0] - fit ) * ( _buf[f][0] - fit );
+	}
+	return 10 * log10( signal / qMax( noise, 1e-30 ) );
+}
+
+
+
+
+class VoiceResampler
+{
+public:
+	virtual ~VoiceResampler()
+	{
+	}
+
+	virtual f_cnt_t process( const sampleFrame * _in, f_cnt_t _inFrames,
+				sampleFrame * _out, double _factor ) = 0;
+
+} ;
+
+
+
+
+class InTreeResampler : public VoiceResampler
+{
+public:
+	InTreeResampler( Resampler::Qualities _quality ) :
+		m_resampler( _quality )
+	{
+	}
+
+	virtual f_cnt_t process( const sampleFrame * _in, f_cnt_t _inFrames,
+				sampleFrame * _out, double _factor )
+	{
+		f_cnt_t used = 0;
+		const fpp_t generated = m_resampler.process( _in, _inFrames,
+					_out, Frames, _factor, 1.0f, used );
+		memset( _out + generated, 0,
+				( Frames - generated ) * sizeof( sampleFrame ) );
+		return used;
+	}
+
+
+private:
+	Resampler m_resampler;
+
+} ;
+
+
+
+
+class LibsrcResampler : public VoiceResampler
+{
+public:
+	LibsrcResampler( int _converter )
+	{
+		int error;
+		m_state = src_new( _converter, DEFAULT_CHANNELS, &error );
+	}
+
+	virtual ~LibsrcResampler()
+	{
+		src_delete( m_state );
+	}
+
+	virtual f_cnt_t process( const sampleFrame * _in, f_cnt_t _inFrames,
+				sampleFrame * _out, double _factor )
+	{
+		SRC_DATA data;
+		data.data_in = (float *) _in;
+		data.input_frames = _inFrames;
+		data.data_out = (float *) _out;
+		data.output_frames = Frames;
+		data.src_ratio = 1.0 / _factor;
+		data.end_of_input = 0;
+		src_process( m_state, &data );
+		memset( _out + data.output_frames_gen, 0,
+			( Frames - data.output_frames_gen ) * sizeof( sampleFrame ) );
+		return data.input_frames_used;
+	}
+
+
+private:
+	SRC_STATE * m_state;
+
+} ;
+
+
+
+
+static void runVoices( const char * _label, VoiceResampler * * _voices,
+				int _numVoices, const sampleFrame * _in,
+				f_cnt_t _inFrames, double _factor, int _periods )
+{
+	sampleFrame * out = MM_ALLOC( sampleFrame, Frames );
+	// output of first voice for measuring quality
+	sampleFrame * recorded = MM_ALLOC( sampleFrame, _periods * Frames );
+	QVector<f_cnt_t> positions( _numVoices, 0 );
+
+	MicroTimer timer;
+	for( int p = 0; p < _periods; ++p )
+	{
+		for( int v = 0; v < _numVoices; ++v )
+		{
+			sampleFrame * dst = v == 0 ? recorded + p * Frames : out;
+			// offer input in fragments like SampleBuffer::play()
+			const f_cnt_t fragment = qMin<f_cnt_t>(
+				(f_cnt_t)( Frames * _factor ) + Resampler::MaxTaps,
+						_inFrames - positions[v] );
+			positions[v] += _voices[v]->process( _in + positions[v],
+						fragment, dst, _factor );
+		}
+	}
+	const double perVoice = (double) timer.elapsed() / _periods / _numVoices;
+
+	// skip start-up where kernels still see silence
+	const double snr = sineSnr( recorded + 4 * Frames, ( _periods - 4 ) * Frames,
+			2 * D_PI * SineFrequency * _factor / SampleRate );
+
+	printf( "%-26s %6.2f %12.2f %12.0f %10.1f\n", _label, _factor,
+				perVoice, PeriodTime / perVoice, snr );
+
+	MM_FREE( recorded );
+	MM_FREE( out );
+}
+
+
+
+
+int main( int, char * * )
+{
+	const int numVoices = 32;
+	const int periods = 400;
+	const double factors[] = { 0.75, 1.5 };
+	const f_cnt_t inFrames = (f_cnt_t)( periods * Frames * 1.5 ) + 1024;
+
+	MemoryManager::init();
+
+	sampleFrame * in = MM_ALLOC( sampleFrame, inFrames );
+	for( f_cnt_t f = 0; f < inFrames; ++f )
+	{
+		in[f][0] = in[f][1] = 0.5 *
+			sin( 2 * D_PI * SineFrequency * f / SampleRate );
+	}
+
+	printf( "Voices - %d frames per period at %d Hz, %.0f Hz sine\n\n",
+					Frames, SampleRate, SineFrequency );
+	printf( "%-26s %6s %12s %12s %10s\n", "resampler", "factor",
+			"us / voice", "voices/core", "SNR dB" );
+
+	static const struct
+	{
+		const char * name;
+		bool inTree;
+		int quality;
+	} resamplers[] =
+	{
+		{ "Resampler linear", true, Resampler::Linear },
+		{ "Resampler cubic", true, Resampler::Cubic },
+		{ "Resampler sinc", true, Resampler::Sinc },
+		{ "libsamplerate linear", false, SRC_LINEAR },
+		{ "libsamplerate sinc fast", false, SRC_SINC_FASTEST },
+		{ "libsamplerate sinc medium", false, SRC_SINC_MEDIUM_QUALITY }
+	} ;
+
+	for( int f = 0; f < 2; ++f )
+	{
+		for( unsigned int r = 0; r < sizeof( resamplers ) /
+						sizeof( resamplers[0] ); ++r )
+		{
+			VoiceResampler * voices[numVoices];
+			for( int v = 0; v < numVoices; ++v )
+			{
+				if( resamplers[r].inTree )
+				{
+					voices[v] = new InTreeResampler(
+						(Resampler::Qualities) resamplers[r].quality );
+				}
+				else
+				{
+					voices[v] = new LibsrcResampler(
+							resamplers[r].quality );
+				}
+			}
+			runVoices( resamplers[r].name, voices, numVoices, in,
+						inFrames, factors[f], periods );
+			for( int v = 0; v < numVoices; ++v )
+			{
+				delete voices[v];
+			}
+		}
+	}
+
+	MM_FREE( in );
+
+	MemoryManager::cleanup();
+
+	return 0;
+}
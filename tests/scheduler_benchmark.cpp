@@ -0,0 +1,239 @@
+/*
+ * scheduler_benchmark.cpp - times periods of jobs processed by
+ *                           MixerWorkerThreads against number of threads
+ *
+ * Copyright (c) 2026 agent <agent/at/local>
+ *
+ * This file is part of LMMS - http://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+// usage: scheduler_benchmark [max threads]
+//
+// Jobs form a graph like the one of a mixer period: voices render into
+// buffers of audio ports, which get queued once all of their voices are
+// done.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <QtCore/QThread>
+#include <QtCore/QVector>
+
+#include "MemoryManager.h"
+#include "MicroTimer.h"
+#include "MixHelpers.h"
+#include "MixerWorkerThread.h"
+#include "ThreadableJob.h"
+
+
+static const int Frames = 256;
+
+
+class BenchJob : public ThreadableJob
+{
+public:
+	BenchJob( int _work, BenchJob * _port ) :
+		m_work( _work ),
+		m_port( _port ),
+		m_buffer( MM_ALLOC( sampleFrame, Frames ) ),
+		m_pendingVoices( 0 )
+	{
+		for( int f = 0; f < Frames; ++f )
+		{
+			m_buffer[f][0] = rand() / (float) RAND_MAX - 0.5f;
+			m_buffer[f][1] = rand() / (float) RAND_MAX - 0.5f;
+		}
+	}
+
+	virtual ~BenchJob()
+	{
+		MM_FREE( m_buffer );
+	}
+
+	void setPendingVoices( int _voices )
+	{
+		m_pendingVoices = _voices;
+	}
+
+	virtual bool requiresProcessing() const
+	{
+		return true;
+	}
+
+
+protected:
+	virtual void doProcessing()
+	{
+		for( int i = 0; i < m_work; ++i )
+		{
+			MixHelpers::multiplyAndAddMultiplied( m_buffer, m_buffer,
+							0.5f, 0.5f, Frames );
+		}
+		if( m_port != NULL &&
+			m_port->m_pendingVoices.fetchAndAddOrdered( -1 ) == 1 )
+		{
+			MixerWorkerThread::enqueueJob( m_port );
+		}
+	}
+
+
+private:
+	const int m_work;
+	BenchJob * m_port;
+	sampleFrame * m_buffer;
+	QAtomicInt m_pendingVoices;
+
+} ;
+
+
+
+
+class JobGraph
+{
+public:
+	JobGraph( int _ports, int _voicesPerPort, int _work ) :
+		m_voicesPerPort( _voicesPerPort )
+	{
+		for( int p = 0; p < _ports; ++p )
+		{
+			BenchJob * port = new BenchJob( _work, NULL );
+			m_ports.push_back( port );
+			for( int v = 0; v < _voicesPerPort; ++v )
+			{
+				m_voices.push_back( new BenchJob( _work, port ) );
+			}
+		}
+	}
+
+	~JobGraph()
+	{
+		qDeleteAll( m_voices );
+		qDeleteAll( m_ports );
+	}
+
+	int jobs() const
+	{
+		return m_ports.size() + m_voices.size();
+	}
+
+	// microseconds per period
+	double run( int _periods )
+	{
+		MicroTimer timer;
+		for( int i = 0; i < _periods; ++i )
+		{
+			MixerWorkerThread::resetJobQueue(
+				MixerWorkerThread::JobQueue::Dynamic );
+			foreach( BenchJob * port, m_ports )
+			{
+				port->reset();
+				port->setPendingVoices( m_voicesPerPort );
+			}
+			foreach( BenchJob * voice, m_voices )
+			{
+				voice->reset();
+				MixerWorkerThread::addJob( voice );
+			}
+			MixerWorkerThread::startAndWaitForJobs();
+		}
+		return (double) timer.elapsed() / _periods;
+	}
+
+
+private:
+	const int m_voicesPerPort;
+	QVector<BenchJob *> m_ports;
+	QVector<BenchJob *> m_voices;
+
+} ;
+
+
+
+
+static void runGraphs( int _threads )
+{
+	const int periods = 2000;
+
+	// no work at all shows scheduling overhead per job
+	JobGraph empty( 32, 8, 0 );
+	JobGraph light( 32, 8, 4 );
+	JobGraph heavy( 8, 4, 200 );
+
+	// first run warms up caches and grows deques
+	empty.run( 10 );
+	light.run( 10 );
+	heavy.run( 10 );
+
+	const double e = empty.run( periods );
+	const double l = light.run( periods );
+	const double h = heavy.run( periods );
+
+	printf( "%8d %12.2f %12.1f %12.1f\n", _threads, 1000 * e / empty.jobs(),
+									l, h );
+}
+
+
+
+
+int main( int _argc, char * * _argv )
+{
+	const int maxThreads = _argc > 1 ? atoi( _argv[1] ) :
+					qMax( 2, QThread::idealThreadCount() );
+
+	MemoryManager::init();
+	MixHelpers::init();
+
+	printf( "Scheduler - period of 32 ports with 8 voices each (light) and "
+				"8 ports with 4 voices each (heavy)\n\n" );
+	printf( "%8s %12s %12s %12s\n", "threads", "ns per job", "light us",
+								"heavy us" );
+
+	// like in Mixer, the last worker created is processed inline by the
+	// calling thread, so a single one does everything on its own
+	QVector<MixerWorkerThread *> workers;
+	workers.push_back( new MixerWorkerThread( NULL ) );
+	runGraphs( 1 );
+
+	for( int threads = 2; threads <= maxThreads; ++threads )
+	{
+		// the former inline worker gets a thread of its own now
+		workers.last()->start( QThread::TimeCriticalPriority );
+		workers.push_back( new MixerWorkerThread( NULL ) );
+		if( ( threads & ( threads - 1 ) ) == 0 || threads == maxThreads )
+		{
+			runGraphs( threads );
+		}
+	}
+
+	// same as Mixer's destructor
+	foreach( MixerWorkerThread * worker, workers )
+	{
+		worker->quit();
+	}
+	MixerWorkerThread::startAndWaitForJobs();
+	foreach( MixerWorkerThread * worker, workers )
+	{
+		worker->wait( 500 );
+		delete worker;
+	}
+
+	MemoryManager::cleanup();
+
+	return 0;
+}